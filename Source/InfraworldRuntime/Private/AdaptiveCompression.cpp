@@ -0,0 +1,221 @@
+/*
+ * Copyright 2018 Vizor Games LLC
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS, WITHOUT
+ * WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.See the
+ * License for the specific language governing permissions and limitations
+ * under the License.
+ */
+#include "AdaptiveCompression.h"
+
+#include "InfraworldStats.h"
+#include "HAL/PlatformTime.h"
+#include "Misc/Compression.h"
+#include "Misc/ScopeLock.h"
+
+#include "GrpcIncludesBegin.h"
+
+#include <google/protobuf/message_lite.h>
+
+#include "GrpcIncludesEnd.h"
+
+struct FMethodCompressionState
+{
+    /** Compressed/original size ratio, negative if not sampled yet. */
+    float Ratio = -1.0f;
+
+    /** Estimated compression time per byte. */
+    double SecondsPerByte = 0.0;
+
+    int32 CallsUntilSample = 0;
+};
+
+class FAdaptiveCompression_Internal
+{
+public:
+    static bool Sample(const google::protobuf::MessageLite& Request, int32 Size, int32 SampleSize, float& OutRatio, double& OutSecondsPerByte,
+        double& OutSampleSeconds);
+    static bool TryConsumeBudget(double Seconds, float CpuBudget);
+    static void ChargeBudget(double Seconds, float CpuBudget);
+    static void RefillBudget(float CpuBudget);
+
+    static FCriticalSection Lock;
+    static FAdaptiveCompressionSettings Settings;
+    static TArray<FMethodCompressionState> Methods;
+
+    static double BudgetSeconds;
+    static double LastRefillTime;
+};
+
+FCriticalSection FAdaptiveCompression_Internal::Lock;
+FAdaptiveCompressionSettings FAdaptiveCompression_Internal::Settings;
+TArray<FMethodCompressionState> FAdaptiveCompression_Internal::Methods;
+double FAdaptiveCompression_Internal::BudgetSeconds = 0.0;
+double FAdaptiveCompression_Internal::LastRefillTime = 0.0;
+
+
+/// FAdaptiveCompression_Internal interface
+
+bool FAdaptiveCompression_Internal::Sample(const google::protobuf::MessageLite& Request, int32 Size, int32 SampleSize,
+    float& OutRatio, double& OutSecondsPerByte, double& OutSampleSeconds)
+{
+    SCOPE_CYCLE_COUNTER(STAT_InfraworldCompressionSampling);
+
+    const double SerializationStartTime = FPlatformTime::Seconds();
+    const int32 UncompressedSize = FMath::Min(Size, FMath::Max(SampleSize, 64));
+
+    // The whole message is serialized and only its prefix is compressed: a prefix can't be serialized on its own,
+    // since protobuf fails the serialization as a whole, once a bounded stream is full. Sizes are already cached by
+    // ByteSizeLong().
+    TArray<uint8> Serialized;
+    Serialized.SetNumUninitialized(Size);
+
+    const uint8* const SerializedEnd = Request.SerializeWithCachedSizesToArray(Serialized.GetData());
+    if (SerializedEnd != Serialized.GetData() + Size)
+        return false;
+
+    TArray<uint8> Compressed;
+    int32 CompressedSize = FCompression::CompressMemoryBound(NAME_Zlib, UncompressedSize);
+    Compressed.SetNumUninitialized(CompressedSize);
+
+    const double StartTime = FPlatformTime::Seconds();
+    if (!FCompression::CompressMemory(NAME_Zlib, Compressed.GetData(), CompressedSize, Serialized.GetData(), UncompressedSize))
+        return false;
+
+    const double EndTime = FPlatformTime::Seconds();
+    OutSecondsPerByte = (EndTime - StartTime) / UncompressedSize;
+    OutRatio = static_cast<float>(CompressedSize) / UncompressedSize;
+    OutSampleSeconds = EndTime - SerializationStartTime;
+
+    return true;
+}
+
+void FAdaptiveCompression_Internal::RefillBudget(float CpuBudget)
+{
+    // A token bucket, refilled by CpuBudget seconds per second and holding at most one second worth of budget.
+    const double Now = FPlatformTime::Seconds();
+    BudgetSeconds = FMath::Min(BudgetSeconds + (Now - LastRefillTime) * CpuBudget, static_cast<double>(CpuBudget));
+    LastRefillTime = Now;
+}
+
+bool FAdaptiveCompression_Internal::TryConsumeBudget(double Seconds, float CpuBudget)
+{
+    if (CpuBudget <= 0.0f)
+        return true;
+
+    RefillBudget(CpuBudget);
+
+    if (BudgetSeconds < Seconds)
+        return false;
+
+    BudgetSeconds -= Seconds;
+    return true;
+}
+
+void FAdaptiveCompression_Internal::ChargeBudget(double Seconds, float CpuBudget)
+{
+    if (CpuBudget <= 0.0f)
+        return;
+
+    // The time has already been spent, so the budget may go negative, which delays following compressions.
+    RefillBudget(CpuBudget);
+    BudgetSeconds -= Seconds;
+}
+
+
+/// FAdaptiveCompression interface
+
+void FAdaptiveCompression::SetSettings(const FAdaptiveCompressionSettings& Settings)
+{
+    FScopeLock Lock(&FAdaptiveCompression_Internal::Lock);
+    FAdaptiveCompression_Internal::Settings = Settings;
+}
+
+FAdaptiveCompressionSettings FAdaptiveCompression::GetSettings()
+{
+    FScopeLock Lock(&FAdaptiveCompression_Internal::Lock);
+    return FAdaptiveCompression_Internal::Settings;
+}
+
+EGrpcCompressionAlgorithm FAdaptiveCompression::Choose(FRpcMethodId Method, const google::protobuf::MessageLite& Request)
+{
+    check(Method.IsValid());
+
+    const int32 Size = static_cast<int32>(Request.ByteSizeLong());
+    const FAdaptiveCompressionSettings Settings = GetSettings();
+
+    const int32 MinSize = Settings.bPreferBandwidth ? Settings.MinSize / 4 : Settings.MinSize;
+    const float MaxRatio = Settings.bPreferBandwidth ? FMath::Min(Settings.MaxRatio + 0.1f, 1.0f) : Settings.MaxRatio;
+
+    if (Size < MinSize)
+    {
+        INC_DWORD_STAT(STAT_InfraworldUncompressedRequests);
+        return EGrpcCompressionAlgorithm::CompressNone;
+    }
+
+    bool bShouldSample;
+    {
+        FScopeLock Lock(&FAdaptiveCompression_Internal::Lock);
+
+        TArray<FMethodCompressionState>& Methods = FAdaptiveCompression_Internal::Methods;
+        if (!Methods.IsValidIndex(Method.Index))
+            Methods.SetNum(Method.Index + 1);
+
+        FMethodCompressionState& State = Methods[Method.Index];
+        bShouldSample = State.Ratio < 0.0f || --State.CallsUntilSample <= 0;
+
+        if (bShouldSample)
+            State.CallsUntilSample = FMath::Max(Settings.ResampleInterval, 1);
+    }
+
+    // Sampling is done without holding the lock, so that other workers aren't blocked.
+    float SampledRatio = -1.0f;
+    double SampledSecondsPerByte = 0.0;
+    double SampleSeconds = 0.0;
+    const bool bSampled = bShouldSample &&
+        FAdaptiveCompression_Internal::Sample(Request, Size, Settings.SampleSize, SampledRatio, SampledSecondsPerByte, SampleSeconds);
+
+    FScopeLock Lock(&FAdaptiveCompression_Internal::Lock);
+    FMethodCompressionState& State = FAdaptiveCompression_Internal::Methods[Method.Index];
+
+    if (bSampled)
+    {
+        // Sampling is paid from the same CPU budget as compression itself.
+        FAdaptiveCompression_Internal::ChargeBudget(SampleSeconds, Settings.CpuBudget);
+        INC_FLOAT_STAT_BY(STAT_InfraworldCompressionCpuSeconds, static_cast<float>(SampleSeconds));
+
+        // Exponential moving average, so a single odd payload doesn't flip the decision.
+        const bool bFirstSample = State.Ratio < 0.0f;
+        State.Ratio = bFirstSample ? SampledRatio : State.Ratio * 0.75f + SampledRatio * 0.25f;
+        State.SecondsPerByte = bFirstSample ? SampledSecondsPerByte : State.SecondsPerByte * 0.75 + SampledSecondsPerByte * 0.25;
+    }
+
+    const double EstimatedSeconds = Size * State.SecondsPerByte;
+
+    if (State.Ratio < 0.0f || State.Ratio > MaxRatio || !FAdaptiveCompression_Internal::TryConsumeBudget(EstimatedSeconds, Settings.CpuBudget))
+    {
+        INC_DWORD_STAT(STAT_InfraworldUncompressedRequests);
+        return EGrpcCompressionAlgorithm::CompressNone;
+    }
+
+    INC_DWORD_STAT(STAT_InfraworldCompressedRequests);
+    INC_MEMORY_STAT_BY(STAT_InfraworldCompressionBytesSaved, static_cast<int64>(Size * (1.0f - State.Ratio)));
+    INC_FLOAT_STAT_BY(STAT_InfraworldCompressionCpuSeconds, static_cast<float>(EstimatedSeconds));
+
+    return (Size >= Settings.GzipMinSize) ? EGrpcCompressionAlgorithm::CompressGzip : EGrpcCompressionAlgorithm::CompressDeflate;
+}
+
+float FAdaptiveCompression::GetLearnedRatio(FRpcMethodId Method)
+{
+    FScopeLock Lock(&FAdaptiveCompression_Internal::Lock);
+
+    const TArray<FMethodCompressionState>& Methods = FAdaptiveCompression_Internal::Methods;
+    return Methods.IsValidIndex(Method.Index) ? Methods[Method.Index].Ratio : -1.0f;
+}
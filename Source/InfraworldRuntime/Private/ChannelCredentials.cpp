@@ -16,12 +16,31 @@
 #include "ChannelCredentials.h"
 #include "InfraworldRuntime.h"
 
+#include "Misc/ScopeLock.h"
+
 #include "GrpcIncludesBegin.h"
 
 #include <grpc++/security/credentials.h>
+#include <grpc/grpc_security.h>
 
 #include "GrpcIncludesEnd.h"
 
+class FChannelCredentials_Internal
+{
+public:
+    /** Number of TLS sessions (one per server) kept by the shared cache. */
+    static const int32 SslSessionCacheCapacity = 64;
+
+    /**
+     * @return The process-wide TLS session cache. It is never destroyed, since channels keep their own references to it.
+     */
+    static grpc_ssl_session_cache* GetSslSessionCache()
+    {
+        static grpc_ssl_session_cache* const Cache = grpc_ssl_session_cache_create_lru(SslSessionCacheCapacity);
+        return Cache;
+    }
+};
+
 UChannelCredentials* UChannelCredentials::MakeGoogleDefaultCredentials()
 {
     return NewObject<UGoogleDefaultCredentials>();
@@ -43,6 +62,70 @@ UChannelCredentials* UChannelCredentials::MakeInsecureChannelCredentials()
     return NewObject<UInsecureChannelCredentials>();
 }
 
+std::shared_ptr<grpc::ChannelCredentials> UChannelCredentials::GetGrpcCredentials()
+{
+    FScopeLock ScopeLock(&GrpcCredentialsLock);
+
+    if (!GrpcCredentials)
+        GrpcCredentials = BuildGrpcCredentials();
+
+    return GrpcCredentials;
+}
+
+void UChannelCredentials::ResetGrpcCredentials()
+{
+    FScopeLock ScopeLock(&GrpcCredentialsLock);
+
+    GrpcCredentials.reset();
+}
+
+std::shared_ptr<grpc::ChannelCredentials> UChannelCredentials::BuildGrpcCredentials() const
+{
+    UE_LOG(LogInfraworldRuntime, Error, TEXT("Don't know how to process credentials:'%s'. Replacement is grpc::InsecureChannelCredentials()."),
+        *(GetClass()->GetName()));
+    return grpc::InsecureChannelCredentials();
+}
+
+
+/// UGoogleDefaultCredentials interface
+
+std::shared_ptr<grpc::ChannelCredentials> UGoogleDefaultCredentials::BuildGrpcCredentials() const
+{
+    return grpc::GoogleDefaultCredentials();
+}
+
+
+/// USslCredentials interface
+
+void USslCredentials::ApplyChannelArguments(grpc::ChannelArguments& Arguments) const
+{
+    // The vtable (which references the cache per channel) is only exposed through the C API.
+    const grpc_arg SessionCacheArg = grpc_ssl_session_cache_create_channel_arg(FChannelCredentials_Internal::GetSslSessionCache());
+    Arguments.SetPointerWithVtable(SessionCacheArg.key, SessionCacheArg.value.pointer.p, SessionCacheArg.value.pointer.vtable);
+}
+
+std::shared_ptr<grpc::ChannelCredentials> USslCredentials::BuildGrpcCredentials() const
+{
+    grpc::SslCredentialsOptions Options;
+
+    if (PemRootCerts.Len() > 0)
+        Options.pem_root_certs = TCHAR_TO_ANSI(*PemRootCerts);
+    if (PemPrivateKey.Len() > 0)
+        Options.pem_private_key = TCHAR_TO_ANSI(*PemPrivateKey);
+    if (PemCertChain.Len() > 0)
+        Options.pem_cert_chain = TCHAR_TO_ANSI(*PemCertChain);
+
+    return grpc::SslCredentials(Options);
+}
+
+
+/// UInsecureChannelCredentials interface
+
+std::shared_ptr<grpc::ChannelCredentials> UInsecureChannelCredentials::BuildGrpcCredentials() const
+{
+    return grpc::InsecureChannelCredentials();
+}
+
 #if PLATFORM_WINDOWS
 #include "Windows/HideWindowsPlatformTypes.h"
 #endif
@@ -0,0 +1,320 @@
+/*
+ * Copyright 2018 Vizor Games LLC
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS, WITHOUT
+ * WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.See the
+ * License for the specific language governing permissions and limitations
+ * under the License.
+ */
+#include "CompiledContext.h"
+
+#include "InfraworldRuntime.h"
+#include "Misc/Crc.h"
+#include "Misc/ScopeLock.h"
+#include "Utf8Conversion.h"
+
+class FGrpcCompiledContext_Internal
+{
+public:
+    typedef TWeakPtr<const FGrpcCompiledContext, ESPMode::ThreadSafe> FWeakRef;
+
+    /** Metadata entries of a context, sorted by keys, so equal maps give equal sequences whatever their layout. */
+    typedef TArray<const TPair<FString, FString>*, TInlineAllocator<16>> FSortedMetadata;
+
+    /**
+     * An interned context along with the metadata and authority, it has been compiled from. Lookups compare sources,
+     * so a hit neither compiles nor converts anything.
+     */
+    struct FInternedEntry
+    {
+        FWeakRef Compiled;
+        TArray<TPair<FString, FString>> Metadata;
+        FString Authority;
+    };
+
+    static bool IsLegalKeyChar(TCHAR Char);
+    static bool IsLegalValueChar(TCHAR Char);
+
+    static void SortMetadata(const TMap<FString, FString>& Metadata, FSortedMetadata& OutSorted);
+    static uint32 HashSource(const FSortedMetadata& Metadata, const FString& Authority);
+    static bool IsSameSource(const FInternedEntry& Entry, const FSortedMetadata& Metadata, const FString& Authority);
+
+    /** Removes interned contexts, that are no longer referenced. */
+    static void PruneInterned();
+
+    static FCriticalSection InternLock;
+
+    /** Interned contexts, by hashes of their sorted metadata and authority. */
+    static TMap<uint32, TArray<FInternedEntry>> Interned;
+
+    /** Number of contexts, interned since the last pruning. */
+    static int32 NumInternedSincePrune;
+};
+
+FCriticalSection FGrpcCompiledContext_Internal::InternLock;
+TMap<uint32, TArray<FGrpcCompiledContext_Internal::FInternedEntry>> FGrpcCompiledContext_Internal::Interned;
+int32 FGrpcCompiledContext_Internal::NumInternedSincePrune = 0;
+
+
+/// FGrpcCompiledContext_Internal interface
+
+bool FGrpcCompiledContext_Internal::IsLegalKeyChar(TCHAR Char)
+{
+    return (Char >= TEXT('a') && Char <= TEXT('z')) || (Char >= TEXT('0') && Char <= TEXT('9')) ||
+        Char == TEXT('-') || Char == TEXT('_') || Char == TEXT('.');
+}
+
+bool FGrpcCompiledContext_Internal::IsLegalValueChar(TCHAR Char)
+{
+    return Char >= 0x20 && Char <= 0x7E;
+}
+
+void FGrpcCompiledContext_Internal::SortMetadata(const TMap<FString, FString>& Metadata, FSortedMetadata& OutSorted)
+{
+    OutSorted.Reset(Metadata.Num());
+    for (const TPair<FString, FString>& Pair : Metadata)
+        OutSorted.Add(&Pair);
+
+    // Keys of a map are unique, so the order is total.
+    OutSorted.Sort([](const TPair<FString, FString>& A, const TPair<FString, FString>& B) { return A.Key.Compare(B.Key, ESearchCase::CaseSensitive) < 0; });
+}
+
+uint32 FGrpcCompiledContext_Internal::HashSource(const FSortedMetadata& Metadata, const FString& Authority)
+{
+    // Lengths are hashed along with the data, so ("ab", "c") and ("a", "bc") differ.
+    uint32 Hash = FCrc::MemCrc32(*Authority, Authority.Len() * sizeof(TCHAR), Authority.Len());
+
+    for (const TPair<FString, FString>* Pair : Metadata)
+    {
+        Hash = FCrc::MemCrc32(*Pair->Key, Pair->Key.Len() * sizeof(TCHAR), HashCombine(Hash, static_cast<uint32>(Pair->Key.Len())));
+        Hash = FCrc::MemCrc32(*Pair->Value, Pair->Value.Len() * sizeof(TCHAR), HashCombine(Hash, static_cast<uint32>(Pair->Value.Len())));
+    }
+
+    return Hash;
+}
+
+bool FGrpcCompiledContext_Internal::IsSameSource(const FInternedEntry& Entry, const FSortedMetadata& Metadata, const FString& Authority)
+{
+    if (Entry.Metadata.Num() != Metadata.Num() || !Entry.Authority.Equals(Authority, ESearchCase::CaseSensitive))
+        return false;
+
+    for (int32 Index = 0; Index < Metadata.Num(); Index++)
+    {
+        if (!Entry.Metadata[Index].Key.Equals(Metadata[Index]->Key, ESearchCase::CaseSensitive) ||
+            !Entry.Metadata[Index].Value.Equals(Metadata[Index]->Value, ESearchCase::CaseSensitive))
+        {
+            return false;
+        }
+    }
+
+    return true;
+}
+
+void FGrpcCompiledContext_Internal::PruneInterned()
+{
+    for (auto It = Interned.CreateIterator(); It; ++It)
+    {
+        It->Value.RemoveAllSwap([](const FInternedEntry& Entry) { return !Entry.Compiled.IsValid(); });
+
+        if (It->Value.Num() == 0)
+            It.RemoveCurrent();
+    }
+
+    NumInternedSincePrune = 0;
+}
+
+
+/// FGrpcCompiledContext interface
+
+bool FGrpcCompiledContext::ValidateMetadata(const FString& Key, const FString& Value, FString& OutError)
+{
+    if (Key.IsEmpty())
+    {
+        OutError = TEXT("Metadata key is empty");
+        return false;
+    }
+
+    if (Key.StartsWith(TEXT(":")))
+    {
+        OutError = TEXT("Metadata key starts with ':'");
+        return false;
+    }
+
+    for (const TCHAR Char : Key)
+    {
+        if (!FGrpcCompiledContext_Internal::IsLegalKeyChar(Char))
+        {
+            OutError = FString::Printf(TEXT("Metadata key contains an illegal character '%c', only [a-z0-9-_.] are allowed"), Char);
+            return false;
+        }
+    }
+
+    // Binary values are sent as is, others must be printable ASCII.
+    if (!Key.EndsWith(TEXT("-bin")))
+    {
+        for (const TCHAR Char : Value)
+        {
+            if (!FGrpcCompiledContext_Internal::IsLegalValueChar(Char))
+            {
+                OutError = TEXT("Metadata value contains a non-printable or non-ASCII character, its key should end with '-bin'");
+                return false;
+            }
+        }
+    }
+
+    return true;
+}
+
+FGrpcCompiledContextRef FGrpcCompiledContext::Compile(const FGrpcClientContext& Context)
+{
+    if (Context.Shared.IsValid())
+        return Compile(Flatten(Context));
+
+    TSharedRef<FGrpcCompiledContext, ESPMode::ThreadSafe> Compiled = MakeShared<FGrpcCompiledContext, ESPMode::ThreadSafe>();
+
+    Compiled->Metadata.reserve(Context.Metadata.Num());
+    Compiled->MetadataKeys.Reserve(Context.Metadata.Num());
+    for (const TPair<FString, FString>& Pair : Context.Metadata)
+    {
+        FString Error;
+        if (!ValidateMetadata(Pair.Key, Pair.Value, Error))
+        {
+            UE_LOG(LogInfraworldRuntime, Error, TEXT("%s for mapping '%s'->'%s', thus it won't be added to the compiled context"),
+                *Error, *Pair.Key, *Pair.Value);
+            continue;
+        }
+
+        std::pair<std::string, std::string> Entry;
+        FUtf8Conversion::ToUtf8(*Pair.Key, Pair.Key.Len(), Entry.first);
+        FUtf8Conversion::ToUtf8(*Pair.Value, Pair.Value.Len(), Entry.second);
+        Compiled->Metadata.push_back(MoveTemp(Entry));
+        Compiled->MetadataKeys.Add(Pair.Key);
+    }
+
+    if (!Context.Authority.IsEmpty())
+    {
+        FUtf8Conversion::ToUtf8(*Context.Authority, Context.Authority.Len(), Compiled->Authority);
+        Compiled->bHasAuthority = true;
+    }
+
+    if (Context.DeadlineSeconds > .0f)
+        Compiled->DeadlineMilliseconds = static_cast<int64>((double)Context.DeadlineSeconds * 1000.0);
+
+    Compiled->CompressionAlgorithm = Context.GrpcCompressionAlgorithm;
+    Compiled->bIdempotent = Context.bIdempotent;
+    Compiled->bCacheable = Context.bCacheable;
+    Compiled->bWaitForReady = Context.bWaitForReady;
+    Compiled->bInitialMetadataCorked = Context.bInitialMetadataCorked;
+
+    return Compiled;
+}
+
+FGrpcClientContext FGrpcCompiledContext::Intern(const FGrpcClientContext& Context)
+{
+    if (Context.Metadata.Num() == 0 && Context.Authority.IsEmpty())
+        return Context;
+
+    typedef FGrpcCompiledContext_Internal FInternal;
+
+    // Metadata and authority, merged with the shared ones (if the context has been interned already), are interned.
+    const FGrpcClientContext Merged = Context.Shared.IsValid() ? Flatten(Context) : FGrpcClientContext();
+    const FGrpcClientContext& Source = Context.Shared.IsValid() ? Merged : Context;
+
+    FInternal::FSortedMetadata Sorted;
+    FInternal::SortMetadata(Source.Metadata, Sorted);
+    const uint32 Hash = FInternal::HashSource(Sorted, Source.Authority);
+
+    // Only metadata and authority are shared, other fields stay in the context.
+    FGrpcClientContext Result = Context;
+    Result.Metadata.Empty();
+    Result.bOverride_Metadata = false;
+    Result.Authority.Empty();
+
+    FScopeLock ScopeLock(&FInternal::InternLock);
+
+    TArray<FInternal::FInternedEntry>& Bucket = FInternal::Interned.FindOrAdd(Hash);
+    for (const FInternal::FInternedEntry& Entry : Bucket)
+    {
+        if (FInternal::IsSameSource(Entry, Sorted, Source.Authority))
+        {
+            const TSharedPtr<const FGrpcCompiledContext, ESPMode::ThreadSafe> Existing = Entry.Compiled.Pin();
+            if (Existing.IsValid())
+            {
+                Result.Shared = Existing;
+                return Result;
+            }
+        }
+    }
+
+    // A miss: contexts are usually interned once, so it's compiled right under the lock.
+    FGrpcClientContext SharedPart;
+    SharedPart.Metadata = Source.Metadata;
+    SharedPart.Authority = Source.Authority;
+
+    const FGrpcCompiledContextRef Compiled = Compile(SharedPart);
+
+    FInternal::FInternedEntry& Added = Bucket[Bucket.AddDefaulted()];
+    Added.Compiled = Compiled;
+    Added.Authority = Source.Authority;
+    Added.Metadata.Reserve(Sorted.Num());
+    for (const TPair<FString, FString>* Pair : Sorted)
+        Added.Metadata.Add(*Pair);
+
+    Result.Shared = Compiled;
+
+    // Contexts of abandoned requests shouldn't accumulate forever.
+    if (++FInternal::NumInternedSincePrune >= 256)
+        FInternal::PruneInterned();
+
+    return Result;
+}
+
+FGrpcClientContext FGrpcCompiledContext::Flatten(const FGrpcClientContext& Context)
+{
+    FGrpcClientContext Result = Context;
+
+    if (!Context.Shared.IsValid())
+        return Result;
+
+    Result.Shared.Reset();
+    Result.Metadata.Empty(static_cast<int32>(Context.Shared->Metadata.size()) + Context.Metadata.Num());
+
+    for (const std::pair<std::string, std::string>& Entry : Context.Shared->Metadata)
+        Result.Metadata.Add(UTF8_TO_TCHAR(Entry.first.c_str()), UTF8_TO_TCHAR(Entry.second.c_str()));
+
+    // Per-call entries win over the shared ones with the same keys, a map can't keep both.
+    for (const TPair<FString, FString>& Pair : Context.Metadata)
+        Result.Metadata.Add(Pair.Key, Pair.Value);
+
+    Result.bOverride_Metadata = Result.Metadata.Num() > 0;
+
+    if (Context.Authority.IsEmpty() && Context.Shared->bHasAuthority)
+        Result.Authority = UTF8_TO_TCHAR(Context.Shared->Authority.c_str());
+
+    return Result;
+}
+
+void FGrpcCompiledContext::Restore(FGrpcClientContext& OutContext) const
+{
+    for (const std::pair<std::string, std::string>& Entry : Metadata)
+        OutContext.Metadata.Add(UTF8_TO_TCHAR(Entry.first.c_str()), UTF8_TO_TCHAR(Entry.second.c_str()));
+
+    OutContext.bOverride_Metadata = OutContext.Metadata.Num() > 0;
+    OutContext.DeadlineSeconds = DeadlineMilliseconds > 0 ? DeadlineMilliseconds / 1000.0f : -1.0f;
+
+    if (bHasAuthority)
+        OutContext.Authority = UTF8_TO_TCHAR(Authority.c_str());
+
+    OutContext.GrpcCompressionAlgorithm = CompressionAlgorithm;
+    OutContext.bIdempotent = bIdempotent;
+    OutContext.bCacheable = bCacheable;
+    OutContext.bWaitForReady = bWaitForReady;
+    OutContext.bInitialMetadataCorked = bInitialMetadataCorked;
+}
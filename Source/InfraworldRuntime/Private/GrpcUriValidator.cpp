@@ -16,6 +16,7 @@
 
 #include "GrpcUriValidator.h"
 #include "InfraworldRuntime.h"
+#include "InProcessServers.h"
 #include "Misc/DefaultValueHelper.h"
 
 class FGrpcUriValidator_Internal
@@ -25,6 +26,13 @@ public:
     static bool ValidateIp(const FString& MaybeIpAddress, FString& OutError);
     static bool ValidateDomainName(const FString& MaybeDomainName, FString& OutError);
     
+    /**
+     * Checks "unix:<path>" and "unix://<absolute path>" URIs, "unix-abstract:<name>" ones are refused.
+     *
+     * @return False if the URI doesn't refer to a Unix domain socket at all.
+     */
+    static bool ParseUnixSocketUri(const FString& MaybeGrpcUri, bool& bOutValid, FString& OutError);
+    
     static bool DoesHostLookLikeIp(const FString& MaybeIpAddress);
     
 private:
@@ -106,6 +114,67 @@ bool FGrpcUriValidator_Internal::ValidateDomainName(const FString& MaybeDomainNa
     return true;
 }
 
+bool FGrpcUriValidator_Internal::ParseUnixSocketUri(const FString& MaybeGrpcUri, bool& bOutValid, FString& OutError)
+{
+    static const FString UnixScheme(TEXT("unix:"));
+    static const FString UnixAbstractScheme(TEXT("unix-abstract:"));
+    
+    // sockaddr_un::sun_path is 108 bytes long on Linux (104 on BSD-derived systems), the terminating zero included.
+    static const int32 MaxSocketPathLength = 103;
+    
+    if (MaybeGrpcUri.StartsWith(UnixAbstractScheme, ESearchCase::CaseSensitive))
+    {
+        // The scheme appeared in gRPC 1.34, the bundled gRPC would fail to resolve it only when connecting.
+        OutError = FString::Printf(TEXT("\"%s\": abstract Unix domain sockets are unsupported by the bundled gRPC, use \"unix:<path>\""), *MaybeGrpcUri);
+        bOutValid = false;
+        return true;
+    }
+    
+    FString SocketPath;
+    if (MaybeGrpcUri.StartsWith(UnixScheme, ESearchCase::CaseSensitive))
+    {
+        SocketPath = MaybeGrpcUri.Mid(UnixScheme.Len());
+        
+        // "unix://" must be followed by an absolute path, like in "unix:///run/agent.sock".
+        if (SocketPath.StartsWith(TEXT("//")))
+        {
+            SocketPath = SocketPath.Mid(2);
+            if (!SocketPath.StartsWith(TEXT("/")))
+            {
+                OutError = FString::Printf(TEXT("Socket path of the \"%s\" uri must be absolute, use \"unix:<relative path>\" otherwise"), *MaybeGrpcUri);
+                bOutValid = false;
+                return true;
+            }
+        }
+    }
+    else
+    {
+        return false;
+    }
+    
+#if PLATFORM_WINDOWS
+    OutError = FString::Printf(TEXT("\"%s\": Unix domain sockets are not supported on this platform"), *MaybeGrpcUri);
+    bOutValid = false;
+#else
+    if (SocketPath.IsEmpty())
+    {
+        OutError = FString::Printf(TEXT("Socket path of the \"%s\" uri is empty"), *MaybeGrpcUri);
+        bOutValid = false;
+    }
+    else if (FTCHARToUTF8(*SocketPath).Length() > MaxSocketPathLength)
+    {
+        OutError = FString::Printf(TEXT("Socket path of the \"%s\" uri is too long, at most %d bytes are allowed"), *MaybeGrpcUri, MaxSocketPathLength);
+        bOutValid = false;
+    }
+    else
+    {
+        bOutValid = true;
+    }
+#endif
+    
+    return true;
+}
+
 bool FGrpcUriValidator_Internal::DoesHostLookLikeIp(const FString& MaybeIpAddress)
 {
     for (TCHAR Character : MaybeIpAddress)
@@ -137,6 +206,24 @@ bool FGrpcUriValidator::Validate(const FString& MaybeGrpcUri, FString& OutError)
 {
     static const FString SchemeSeparator(TEXT("://"));
     
+    // In-process servers are referred to by name, @see FGrpcInProcessServers.
+    FString InProcessServerName;
+    if (FGrpcInProcessServers::ParseUri(MaybeGrpcUri, InProcessServerName))
+    {
+        if (!FGrpcInProcessServers::IsValidName(InProcessServerName))
+        {
+            OutError = FString::Printf(TEXT("\"%s\" is not a valid in-process server name in \"%s\""), *InProcessServerName, *MaybeGrpcUri);
+            return false;
+        }
+        
+        return true;
+    }
+    
+    // Unix domain sockets are the only targets, that may have a scheme and a path.
+    bool bIsValidUnixSocketUri;
+    if (FGrpcUriValidator_Internal::ParseUnixSocketUri(MaybeGrpcUri, bIsValidUnixSocketUri, OutError))
+        return bIsValidUnixSocketUri;
+    
     const int32 IndexOfSchemeSeparator = MaybeGrpcUri.Find(SchemeSeparator);
     if (IndexOfSchemeSeparator >= 0)
     {
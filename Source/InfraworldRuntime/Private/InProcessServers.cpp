@@ -0,0 +1,97 @@
+/*
+ * Copyright 2018 Vizor Games LLC
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS, WITHOUT
+ * WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.See the
+ * License for the specific language governing permissions and limitations
+ * under the License.
+ */
+#include "InProcessServers.h"
+
+#include "Misc/ScopeLock.h"
+
+#include "GrpcIncludesBegin.h"
+
+#include <grpcpp/support/channel_arguments.h>
+
+#include "GrpcIncludesEnd.h"
+
+class FGrpcInProcessServers_Internal
+{
+public:
+    static FCriticalSection Lock;
+    static TMap<FString, grpc::Server*> Servers;
+};
+
+FCriticalSection FGrpcInProcessServers_Internal::Lock;
+TMap<FString, grpc::Server*> FGrpcInProcessServers_Internal::Servers;
+
+
+/// FGrpcInProcessServers interface
+
+const TCHAR* const FGrpcInProcessServers::UriPrefix = TEXT("inproc:");
+
+bool FGrpcInProcessServers::Register(const FString& Name, grpc::Server* Server)
+{
+    check(Server);
+
+    if (!IsValidName(Name))
+        return false;
+
+    FScopeLock ScopeLock(&FGrpcInProcessServers_Internal::Lock);
+
+    if (FGrpcInProcessServers_Internal::Servers.Contains(Name))
+        return false;
+
+    FGrpcInProcessServers_Internal::Servers.Add(Name, Server);
+    return true;
+}
+
+void FGrpcInProcessServers::Unregister(const FString& Name)
+{
+    FScopeLock ScopeLock(&FGrpcInProcessServers_Internal::Lock);
+
+    FGrpcInProcessServers_Internal::Servers.Remove(Name);
+}
+
+bool FGrpcInProcessServers::ParseUri(const FString& Uri, FString& OutName)
+{
+    if (!Uri.StartsWith(UriPrefix, ESearchCase::CaseSensitive))
+        return false;
+
+    OutName = Uri.Mid(FCString::Strlen(UriPrefix));
+    return true;
+}
+
+bool FGrpcInProcessServers::IsValidName(const FString& Name)
+{
+    if (Name.IsEmpty())
+        return false;
+
+    for (TCHAR Character : Name)
+    {
+        if (!FChar::IsAlnum(Character) && Character != TEXT('-') && Character != TEXT('_') && Character != TEXT('.'))
+            return false;
+    }
+
+    return true;
+}
+
+std::shared_ptr<grpc::Channel> FGrpcInProcessServers::CreateChannel(const FString& Name)
+{
+    // The lock is held while the channel is being created, so the server can't be unregistered (and shut down) meanwhile.
+    FScopeLock ScopeLock(&FGrpcInProcessServers_Internal::Lock);
+
+    grpc::Server* const* const Server = FGrpcInProcessServers_Internal::Servers.Find(Name);
+    if (!Server)
+        return nullptr;
+
+    return (*Server)->InProcessChannel(grpc::ChannelArguments());
+}
@@ -14,14 +14,42 @@
  * under the License.
  */
 #include "InfraworldRuntime.h"
+#include "InfraworldStats.h"
 
 DEFINE_LOG_CATEGORY(LogInfraworldRuntime);
 
+DEFINE_STAT(STAT_InfraworldConversion);
+DEFINE_STAT(STAT_InfraworldCalls);
+DEFINE_STAT(STAT_InfraworldErrors);
+DEFINE_STAT(STAT_InfraworldInFlight);
+DEFINE_STAT(STAT_InfraworldQueuedRequests);
+DEFINE_STAT(STAT_InfraworldQueuedResponses);
+DEFINE_STAT(STAT_InfraworldSpilledRequests);
+DEFINE_STAT(STAT_InfraworldDroppedRequests);
+DEFINE_STAT(STAT_InfraworldDeadlineMisses);
+DEFINE_STAT(STAT_InfraworldExpiredRequests);
+DEFINE_STAT(STAT_InfraworldCancelledRequests);
+DEFINE_STAT(STAT_InfraworldSpillDiskBytes);
+DEFINE_STAT(STAT_InfraworldBytesSent);
+DEFINE_STAT(STAT_InfraworldBytesReceived);
+DEFINE_STAT(STAT_InfraworldLastNetworkMs);
+DEFINE_STAT(STAT_InfraworldLastDispatchMs);
+
+DEFINE_STAT(STAT_InfraworldCompressionSampling);
+DEFINE_STAT(STAT_InfraworldCompressedRequests);
+DEFINE_STAT(STAT_InfraworldUncompressedRequests);
+DEFINE_STAT(STAT_InfraworldCompressionBytesSaved);
+DEFINE_STAT(STAT_InfraworldCompressionCpuSeconds);
+
+DEFINE_STAT(STAT_InfraworldGrpcMemory);
+DEFINE_STAT(STAT_InfraworldArenaMemory);
+
 #define LOCTEXT_NAMESPACE "FInfraworldRuntimeModule"
 
 void FInfraworldRuntimeModule::StartupModule()
 {
 	// This code will execute after your module is loaded into memory; the exact timing is specified in the .uplugin file per-module
+	// Allocation functions of gRPC have already been installed by then (see FRpcMemory::InstallGrpcAllocator()).
 }
 
 void FInfraworldRuntimeModule::ShutdownModule()
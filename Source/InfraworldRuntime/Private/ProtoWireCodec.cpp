@@ -0,0 +1,1066 @@
+/*
+ * Copyright 2018 Vizor Games LLC
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS, WITHOUT
+ * WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.See the
+ * License for the specific language governing permissions and limitations
+ * under the License.
+ */
+#include "ProtoWireCodec.h"
+
+#include "InfraworldRuntime.h"
+#include "GenUtils.h"
+#include "Utf8Conversion.h"
+
+#include "UObject/Class.h"
+#include "UObject/UnrealType.h"
+#include "UObject/EnumProperty.h"
+#include "Misc/ScopeLock.h"
+
+#include "GrpcIncludesBegin.h"
+
+#include <grpcpp/support/byte_buffer.h>
+#include <grpcpp/support/slice.h>
+
+#include "GrpcIncludesEnd.h"
+
+#include <vector>
+
+enum class EProtoWireType : uint8
+{
+    Varint = 0,
+    Fixed64 = 1,
+    LengthDelimited = 2,
+    Fixed32 = 5
+};
+
+enum class EProtoFieldKind : uint8
+{
+    Int32, Int64, UInt32, UInt64, SInt32, SInt64, Fixed32, Fixed64, SFixed32, SFixed64, Float, Double, Bool, Enum,
+    String, Bytes, Message
+};
+
+enum class EProtoFieldContainer : uint8
+{
+    Single,
+    Array,
+    Map
+};
+
+struct FProtoStructPlan;
+
+// Describes how a single value (a field, an array item, a map key or a map value) is encoded.
+struct FProtoValuePlan
+{
+    UProperty* Property = nullptr;
+    UNumericProperty* Numeric = nullptr;
+    const FProtoStructPlan* Message = nullptr;
+    EProtoFieldKind Kind = EProtoFieldKind::Int32;
+};
+
+struct FProtoFieldPlan
+{
+    UProperty* Property = nullptr;
+    int32 FieldNumber = 0;
+    EProtoFieldContainer Container = EProtoFieldContainer::Single;
+    FProtoValuePlan Key;
+    FProtoValuePlan Value;
+};
+
+struct FProtoStructPlan
+{
+    UScriptStruct* Struct = nullptr;
+    TArray<FProtoFieldPlan> Fields;
+
+    // Field number -> index in Fields. Dense for small field numbers (that's almost always the case).
+    TArray<int32> DenseFieldIndices;
+    TMap<int32, int32> SparseFieldIndices;
+
+    // False if some properties can't be encoded, in this case the struct is never encoded partially.
+    bool bValid = true;
+
+    FORCEINLINE const FProtoFieldPlan* FindField(int32 FieldNumber) const
+    {
+        if (DenseFieldIndices.IsValidIndex(FieldNumber))
+        {
+            const int32 Index = DenseFieldIndices[FieldNumber];
+            return (Index != INDEX_NONE) ? &Fields[Index] : nullptr;
+        }
+
+        const int32* Index = SparseFieldIndices.Find(FieldNumber);
+        return Index ? &Fields[*Index] : nullptr;
+    }
+};
+
+/**
+ * Growable output buffer, allocated via FMemory, so it could be handed over to a grpc::Slice.
+ */
+class FProtoWireWriter
+{
+public:
+    ~FProtoWireWriter()
+    {
+        FMemory::Free(Data);
+    }
+
+    FORCEINLINE void Reserve(int32 Extra)
+    {
+        if (Num + Extra > Capacity)
+        {
+            Capacity = FMath::Max(Num + Extra, FMath::Max(Capacity * 2, 256));
+            Data = static_cast<uint8*>(FMemory::Realloc(Data, Capacity));
+        }
+    }
+
+    FORCEINLINE void WriteVarint(uint64 Value)
+    {
+        Reserve(10);
+        while (Value >= 0x80)
+        {
+            Data[Num++] = static_cast<uint8>(Value) | 0x80;
+            Value >>= 7;
+        }
+        Data[Num++] = static_cast<uint8>(Value);
+    }
+
+    FORCEINLINE void WriteTag(int32 FieldNumber, EProtoWireType WireType)
+    {
+        WriteVarint((static_cast<uint64>(FieldNumber) << 3) | static_cast<uint64>(WireType));
+    }
+
+    FORCEINLINE void WriteFixed32(uint32 Value)
+    {
+        Reserve(4);
+        FMemory::Memcpy(Data + Num, &Value, 4);
+        Num += 4;
+    }
+
+    FORCEINLINE void WriteFixed64(uint64 Value)
+    {
+        Reserve(8);
+        FMemory::Memcpy(Data + Num, &Value, 8);
+        Num += 8;
+    }
+
+    FORCEINLINE void WriteBytes(const void* Bytes, int32 Count)
+    {
+        Reserve(Count);
+        FMemory::Memcpy(Data + Num, Bytes, Count);
+        Num += Count;
+    }
+
+    // Returns a pointer to at least MaxCount writable bytes, then Commit() should be called with an actual amount.
+    FORCEINLINE uint8* BeginRaw(int32 MaxCount)
+    {
+        Reserve(MaxCount);
+        return Data + Num;
+    }
+
+    FORCEINLINE void CommitRaw(int32 Count)
+    {
+        Num += Count;
+    }
+
+    // Length of a nested payload is not known in advance, so a single byte is reserved for it. If the actual length
+    // doesn't fit into a single byte, the payload is shifted (this is rare: most nested payloads are short).
+    FORCEINLINE int32 BeginLengthDelimited()
+    {
+        Reserve(1);
+        return Num++;
+    }
+
+    void EndLengthDelimited(int32 LengthOffset)
+    {
+        const int32 PayloadOffset = LengthOffset + 1;
+        uint32 Length = static_cast<uint32>(Num - PayloadOffset);
+
+        int32 LengthSize = 1;
+        for (uint32 Rest = Length >> 7; Rest != 0; Rest >>= 7)
+            LengthSize++;
+
+        if (LengthSize > 1)
+        {
+            Reserve(LengthSize - 1);
+            FMemory::Memmove(Data + PayloadOffset + LengthSize - 1, Data + PayloadOffset, Length);
+            Num += LengthSize - 1;
+        }
+
+        uint8* Cursor = Data + LengthOffset;
+        while (Length >= 0x80)
+        {
+            *Cursor++ = static_cast<uint8>(Length) | 0x80;
+            Length >>= 7;
+        }
+        *Cursor = static_cast<uint8>(Length);
+    }
+
+    FORCEINLINE const uint8* GetData() const { return Data; }
+    FORCEINLINE int32 GetNum() const { return Num; }
+
+    // Hands the buffer over to the caller, which becomes responsible for calling FMemory::Free() on it.
+    uint8* Release()
+    {
+        uint8* Released = Data;
+        Data = nullptr;
+        Num = Capacity = 0;
+        return Released;
+    }
+
+private:
+    uint8* Data = nullptr;
+    int32 Num = 0;
+    int32 Capacity = 0;
+};
+
+class FProtoWireReader
+{
+public:
+    FProtoWireReader(const uint8* InData, int32 InNum) :
+        Cursor(InData),
+        End(InData + InNum)
+    {
+    }
+
+    FORCEINLINE bool IsAtEnd() const { return Cursor >= End; }
+
+    FORCEINLINE bool ReadVarint(uint64& OutValue)
+    {
+        uint64 Value = 0;
+        for (int32 Shift = 0; Shift < 64 && Cursor < End; Shift += 7)
+        {
+            const uint8 Byte = *Cursor++;
+            Value |= static_cast<uint64>(Byte & 0x7F) << Shift;
+
+            if ((Byte & 0x80) == 0)
+            {
+                OutValue = Value;
+                return true;
+            }
+        }
+
+        return false;
+    }
+
+    // Field numbers outside of [1, 2^29 - 1] are malformed, protobuf refuses them too.
+    FORCEINLINE bool ReadTag(int32& OutFieldNumber, EProtoWireType& OutWireType)
+    {
+        static constexpr uint64 MaxFieldNumber = (1 << 29) - 1;
+
+        uint64 Tag;
+        if (!ReadVarint(Tag) || (Tag >> 3) == 0 || (Tag >> 3) > MaxFieldNumber)
+            return false;
+
+        OutFieldNumber = static_cast<int32>(Tag >> 3);
+        OutWireType = static_cast<EProtoWireType>(Tag & 7);
+        return true;
+    }
+
+    FORCEINLINE bool ReadFixed32(uint64& OutValue)
+    {
+        if (End - Cursor < 4)
+            return false;
+
+        uint32 Value;
+        FMemory::Memcpy(&Value, Cursor, 4);
+        Cursor += 4;
+        OutValue = Value;
+        return true;
+    }
+
+    FORCEINLINE bool ReadFixed64(uint64& OutValue)
+    {
+        if (End - Cursor < 8)
+            return false;
+
+        FMemory::Memcpy(&OutValue, Cursor, 8);
+        Cursor += 8;
+        return true;
+    }
+
+    FORCEINLINE bool ReadLengthDelimited(const uint8*& OutData, int32& OutNum)
+    {
+        uint64 Length;
+        if (!ReadVarint(Length) || Length > static_cast<uint64>(End - Cursor))
+            return false;
+
+        OutData = Cursor;
+        OutNum = static_cast<int32>(Length);
+        Cursor += Length;
+        return true;
+    }
+
+    bool Skip(EProtoWireType WireType)
+    {
+        uint64 Unused;
+        const uint8* UnusedData;
+        int32 UnusedNum;
+
+        switch (WireType)
+        {
+        case EProtoWireType::Varint: return ReadVarint(Unused);
+        case EProtoWireType::Fixed32: return ReadFixed32(Unused);
+        case EProtoWireType::Fixed64: return ReadFixed64(Unused);
+        case EProtoWireType::LengthDelimited: return ReadLengthDelimited(UnusedData, UnusedNum);
+        default: return false; // Groups are deprecated and never produced by proto3
+        }
+    }
+
+private:
+    const uint8* Cursor;
+    const uint8* End;
+};
+
+class FProtoWireCodec_Internal
+{
+public:
+    static const FProtoStructPlan* GetPlan(UScriptStruct* Struct, EProtoFieldNumbering Numbering);
+    static void RegisterFields(UScriptStruct* Struct, const TArray<FProtoFieldSpec>& Fields);
+
+    static void EncodeStruct(const FProtoStructPlan& Plan, const void* StructData, FProtoWireWriter& Writer);
+    static bool DecodeStruct(const FProtoStructPlan& Plan, const uint8* Data, int32 Num, void* StructData);
+
+private:
+    static FProtoStructPlan* BuildPlan(UScriptStruct* Struct, EProtoFieldNumbering Numbering);
+    static bool ResolveValue(UProperty* Property, EProtoFieldEncoding Encoding, EProtoFieldNumbering Numbering, FProtoValuePlan& OutValue);
+
+    static FORCEINLINE EProtoWireType GetWireType(EProtoFieldKind Kind);
+    static FORCEINLINE bool IsPackable(EProtoFieldKind Kind);
+
+    static FORCEINLINE uint64 GetScalarWireValue(const FProtoValuePlan& Value, const void* ValuePtr);
+    static FORCEINLINE void SetScalarFromWireValue(const FProtoValuePlan& Value, void* ValuePtr, uint64 WireValue);
+
+    static void EncodeValue(int32 FieldNumber, const FProtoValuePlan& Value, const void* ValuePtr, FProtoWireWriter& Writer, bool bSkipDefault);
+    static bool DecodeValue(const FProtoValuePlan& Value, EProtoWireType WireType, FProtoWireReader& Reader, void* ValuePtr);
+    static bool DecodeScalar(const FProtoValuePlan& Value, FProtoWireReader& Reader, void* ValuePtr);
+    static bool DecodeMapEntry(const FProtoFieldPlan& Field, const uint8* Data, int32 Num, FScriptMapHelper& Helper);
+
+    static FCriticalSection PlansLock;
+    static TMap<UScriptStruct*, TUniquePtr<FProtoStructPlan>> Plans[2]; // Indexed by EProtoFieldNumbering
+    static TMap<UScriptStruct*, TArray<FProtoFieldSpec>> RegisteredFields;
+};
+
+FCriticalSection FProtoWireCodec_Internal::PlansLock;
+TMap<UScriptStruct*, TUniquePtr<FProtoStructPlan>> FProtoWireCodec_Internal::Plans[2];
+TMap<UScriptStruct*, TArray<FProtoFieldSpec>> FProtoWireCodec_Internal::RegisteredFields;
+
+
+/// Field plans
+
+void FProtoWireCodec_Internal::RegisterFields(UScriptStruct* Struct, const TArray<FProtoFieldSpec>& Fields)
+{
+    FScopeLock Lock(&PlansLock);
+
+    UE_CLOG(Plans[0].Contains(Struct) || Plans[1].Contains(Struct), LogInfraworldRuntime, Error,
+        TEXT("Fields of '%s' are registered after the struct has been encoded, the registration is ignored"), *Struct->GetName());
+
+    RegisteredFields.Add(Struct, Fields);
+}
+
+const FProtoStructPlan* FProtoWireCodec_Internal::GetPlan(UScriptStruct* Struct, EProtoFieldNumbering Numbering)
+{
+    FScopeLock Lock(&PlansLock);
+
+    if (const TUniquePtr<FProtoStructPlan>* Existing = Plans[static_cast<int32>(Numbering)].Find(Struct))
+        return Existing->Get();
+
+    return BuildPlan(Struct, Numbering);
+}
+
+FProtoStructPlan* FProtoWireCodec_Internal::BuildPlan(UScriptStruct* Struct, EProtoFieldNumbering Numbering)
+{
+    // Publish the plan before resolving fields, so that self-referencing structs could find it. The lock is recursive.
+    FProtoStructPlan* const Plan = Plans[static_cast<int32>(Numbering)].Add(Struct, MakeUnique<FProtoStructPlan>()).Get();
+    Plan->Struct = Struct;
+
+    const TArray<FProtoFieldSpec>* const Specs = RegisteredFields.Find(Struct);
+    int32 NextFieldNumber = 1;
+
+    // Guessed numbers would silently produce wrong tags for any message, that isn't numbered sequentially.
+    if (!Specs && Numbering == EProtoFieldNumbering::Registered)
+    {
+        UE_LOG(LogInfraworldRuntime, Error, TEXT("%s has no registered field numbers (see FProtoWireCodec::RegisterFields()), the struct can't be encoded"),
+            *Struct->GetName());
+        Plan->bValid = false;
+        return Plan;
+    }
+
+    for (TFieldIterator<UProperty> It(Struct); It; ++It)
+    {
+        UProperty* const Property = *It;
+
+        FProtoFieldPlan Field;
+        Field.Property = Property;
+
+        EProtoFieldEncoding Encoding = EProtoFieldEncoding::Default;
+        if (Specs)
+        {
+            const FProtoFieldSpec* const Spec = Specs->FindByPredicate([Property](const FProtoFieldSpec& Candidate) {
+                return Candidate.PropertyName == Property->GetFName();
+            });
+
+            if (!Spec)
+                continue;
+
+            Field.FieldNumber = Spec->FieldNumber;
+            Encoding = Spec->Encoding;
+        }
+        else
+        {
+            Field.FieldNumber = NextFieldNumber++;
+        }
+
+        bool bResolved = false;
+        if (Property->ArrayDim != 1)
+        {
+            UE_LOG(LogInfraworldRuntime, Error, TEXT("%s::%s: static arrays can't be encoded"), *Struct->GetName(), *Property->GetName());
+        }
+        else if (UArrayProperty* const ArrayProperty = Cast<UArrayProperty>(Property))
+        {
+            Field.Container = EProtoFieldContainer::Array;
+            bResolved = ResolveValue(ArrayProperty->Inner, Encoding, Numbering, Field.Value);
+        }
+        else if (UMapProperty* const MapProperty = Cast<UMapProperty>(Property))
+        {
+            Field.Container = EProtoFieldContainer::Map;
+            bResolved = ResolveValue(MapProperty->KeyProp, EProtoFieldEncoding::Default, Numbering, Field.Key) &&
+                ResolveValue(MapProperty->ValueProp, Encoding, Numbering, Field.Value);
+        }
+        else
+        {
+            bResolved = ResolveValue(Property, Encoding, Numbering, Field.Value);
+        }
+
+        if (bResolved)
+        {
+            Plan->Fields.Add(Field);
+        }
+        else
+        {
+            UE_LOG(LogInfraworldRuntime, Error, TEXT("%s::%s (%s) has no protobuf representation, the struct can't be encoded"),
+                *Struct->GetName(), *Property->GetName(), *Property->GetClass()->GetName());
+            Plan->bValid = false;
+        }
+    }
+
+    static constexpr int32 MaxDenseFieldNumber = 256;
+    for (int32 Index = 0; Index < Plan->Fields.Num(); Index++)
+    {
+        const int32 FieldNumber = Plan->Fields[Index].FieldNumber;
+        if (FieldNumber <= MaxDenseFieldNumber)
+        {
+            if (Plan->DenseFieldIndices.Num() <= FieldNumber)
+            {
+                const int32 OldNum = Plan->DenseFieldIndices.Num();
+                Plan->DenseFieldIndices.SetNumUninitialized(FieldNumber + 1);
+                for (int32 Fill = OldNum; Fill <= FieldNumber; Fill++)
+                    Plan->DenseFieldIndices[Fill] = INDEX_NONE;
+            }
+            Plan->DenseFieldIndices[FieldNumber] = Index;
+        }
+        else
+        {
+            Plan->SparseFieldIndices.Add(FieldNumber, Index);
+        }
+    }
+
+    return Plan;
+}
+
+bool FProtoWireCodec_Internal::ResolveValue(UProperty* Property, EProtoFieldEncoding Encoding, EProtoFieldNumbering Numbering, FProtoValuePlan& OutValue)
+{
+    OutValue.Property = Property;
+
+    if (Cast<UBoolProperty>(Property))
+    {
+        OutValue.Kind = EProtoFieldKind::Bool;
+        return true;
+    }
+
+    if (UEnumProperty* const EnumProperty = Cast<UEnumProperty>(Property))
+    {
+        OutValue.Kind = EProtoFieldKind::Enum;
+        OutValue.Numeric = EnumProperty->GetUnderlyingProperty();
+        return true;
+    }
+
+    if (UNumericProperty* const NumericProperty = Cast<UNumericProperty>(Property))
+    {
+        OutValue.Numeric = NumericProperty;
+
+        if (NumericProperty->IsFloatingPoint())
+        {
+            OutValue.Kind = (NumericProperty->ElementSize == 4) ? EProtoFieldKind::Float : EProtoFieldKind::Double;
+        }
+        else if (NumericProperty->IsEnum())
+        {
+            OutValue.Kind = EProtoFieldKind::Enum;
+        }
+        else
+        {
+            const bool b64Bit = NumericProperty->ElementSize == 8;
+            const bool bUnsignedProperty = Property->IsA<UByteProperty>() || Property->IsA<UUInt16Property>() ||
+                Property->IsA<UUInt32Property>() || Property->IsA<UUInt64Property>();
+
+            switch (Encoding)
+            {
+            case EProtoFieldEncoding::ZigZag:
+                OutValue.Kind = b64Bit ? EProtoFieldKind::SInt64 : EProtoFieldKind::SInt32;
+                break;
+            case EProtoFieldEncoding::Fixed:
+                OutValue.Kind = bUnsignedProperty ? (b64Bit ? EProtoFieldKind::Fixed64 : EProtoFieldKind::Fixed32)
+                                                  : (b64Bit ? EProtoFieldKind::SFixed64 : EProtoFieldKind::SFixed32);
+                break;
+            case EProtoFieldEncoding::Unsigned:
+                OutValue.Kind = b64Bit ? EProtoFieldKind::UInt64 : EProtoFieldKind::UInt32;
+                break;
+            case EProtoFieldEncoding::UnsignedFixed:
+                OutValue.Kind = b64Bit ? EProtoFieldKind::Fixed64 : EProtoFieldKind::Fixed32;
+                break;
+            default:
+                OutValue.Kind = bUnsignedProperty ? (b64Bit ? EProtoFieldKind::UInt64 : EProtoFieldKind::UInt32)
+                                                  : (b64Bit ? EProtoFieldKind::Int64 : EProtoFieldKind::Int32);
+                break;
+            }
+        }
+
+        return true;
+    }
+
+    if (Property->IsA<UStrProperty>() || Property->IsA<UNameProperty>() || Property->IsA<UTextProperty>())
+    {
+        OutValue.Kind = EProtoFieldKind::String;
+        return true;
+    }
+
+    if (UStructProperty* const StructProperty = Cast<UStructProperty>(Property))
+    {
+        if (StructProperty->Struct == FByteArray::StaticStruct())
+        {
+            OutValue.Kind = EProtoFieldKind::Bytes;
+            return true;
+        }
+
+        // A struct, which can't be encoded, makes its parents invalid as well, otherwise they would be encoded partially.
+        OutValue.Kind = EProtoFieldKind::Message;
+        OutValue.Message = GetPlan(StructProperty->Struct, Numbering);
+        return OutValue.Message->bValid;
+    }
+
+    return false;
+}
+
+
+/// Scalars
+
+EProtoWireType FProtoWireCodec_Internal::GetWireType(EProtoFieldKind Kind)
+{
+    switch (Kind)
+    {
+    case EProtoFieldKind::Fixed32:
+    case EProtoFieldKind::SFixed32:
+    case EProtoFieldKind::Float:
+        return EProtoWireType::Fixed32;
+    case EProtoFieldKind::Fixed64:
+    case EProtoFieldKind::SFixed64:
+    case EProtoFieldKind::Double:
+        return EProtoWireType::Fixed64;
+    case EProtoFieldKind::String:
+    case EProtoFieldKind::Bytes:
+    case EProtoFieldKind::Message:
+        return EProtoWireType::LengthDelimited;
+    default:
+        return EProtoWireType::Varint;
+    }
+}
+
+bool FProtoWireCodec_Internal::IsPackable(EProtoFieldKind Kind)
+{
+    return GetWireType(Kind) != EProtoWireType::LengthDelimited;
+}
+
+uint64 FProtoWireCodec_Internal::GetScalarWireValue(const FProtoValuePlan& Value, const void* ValuePtr)
+{
+    switch (Value.Kind)
+    {
+    case EProtoFieldKind::Bool:
+        return static_cast<const UBoolProperty*>(Value.Property)->GetPropertyValue(ValuePtr) ? 1 : 0;
+    case EProtoFieldKind::Float:
+    {
+        uint32 Bits;
+        FMemory::Memcpy(&Bits, ValuePtr, 4);
+        return Bits;
+    }
+    case EProtoFieldKind::Double:
+    {
+        uint64 Bits;
+        FMemory::Memcpy(&Bits, ValuePtr, 8);
+        return Bits;
+    }
+    default:
+        break;
+    }
+
+    const int64 Signed = Value.Numeric->GetSignedIntPropertyValue(ValuePtr);
+
+    switch (Value.Kind)
+    {
+    case EProtoFieldKind::Int32:
+    case EProtoFieldKind::Enum:
+        return static_cast<uint64>(static_cast<int64>(static_cast<int32>(Signed))); // Sign-extended, as protobuf does
+    case EProtoFieldKind::UInt32:
+    case EProtoFieldKind::Fixed32:
+    case EProtoFieldKind::SFixed32:
+        return static_cast<uint32>(Signed);
+    case EProtoFieldKind::SInt32:
+    {
+        const int32 Narrow = static_cast<int32>(Signed);
+        return (static_cast<uint32>(Narrow) << 1) ^ static_cast<uint32>(Narrow >> 31);
+    }
+    case EProtoFieldKind::SInt64:
+        return (static_cast<uint64>(Signed) << 1) ^ static_cast<uint64>(Signed >> 63);
+    default:
+        return static_cast<uint64>(Signed);
+    }
+}
+
+void FProtoWireCodec_Internal::SetScalarFromWireValue(const FProtoValuePlan& Value, void* ValuePtr, uint64 WireValue)
+{
+    int64 Signed;
+
+    switch (Value.Kind)
+    {
+    case EProtoFieldKind::Bool:
+        static_cast<UBoolProperty*>(Value.Property)->SetPropertyValue(ValuePtr, WireValue != 0);
+        return;
+    case EProtoFieldKind::Float:
+    {
+        const uint32 Bits = static_cast<uint32>(WireValue);
+        FMemory::Memcpy(ValuePtr, &Bits, 4);
+        return;
+    }
+    case EProtoFieldKind::Double:
+        FMemory::Memcpy(ValuePtr, &WireValue, 8);
+        return;
+    case EProtoFieldKind::Int32:
+    case EProtoFieldKind::Enum:
+    case EProtoFieldKind::SFixed32:
+        Signed = static_cast<int32>(static_cast<uint32>(WireValue));
+        break;
+    case EProtoFieldKind::UInt32:
+    case EProtoFieldKind::Fixed32:
+        Signed = static_cast<uint32>(WireValue);
+        break;
+    case EProtoFieldKind::SInt32:
+    {
+        const uint32 Narrow = static_cast<uint32>(WireValue);
+        Signed = static_cast<int32>((Narrow >> 1) ^ (0u - (Narrow & 1)));
+        break;
+    }
+    case EProtoFieldKind::SInt64:
+        Signed = static_cast<int64>((WireValue >> 1) ^ (0ull - (WireValue & 1)));
+        break;
+    default:
+        Signed = static_cast<int64>(WireValue);
+        break;
+    }
+
+    Value.Numeric->SetIntPropertyValue(ValuePtr, Signed);
+}
+
+
+/// Encoding
+
+void FProtoWireCodec_Internal::EncodeValue(int32 FieldNumber, const FProtoValuePlan& Value, const void* ValuePtr, FProtoWireWriter& Writer, bool bSkipDefault)
+{
+    switch (Value.Kind)
+    {
+    case EProtoFieldKind::String:
+    {
+        FString NameOrText;
+        const FString* String = static_cast<const FString*>(ValuePtr);
+
+        if (Value.Property->IsA<UNameProperty>())
+        {
+            // NAME_None is the default value, it is an empty string rather than "None" (which decodes back to it).
+            const FName& Name = *static_cast<const FName*>(ValuePtr);
+            if (!Name.IsNone())
+                NameOrText = Name.ToString();
+
+            String = &NameOrText;
+        }
+        else if (Value.Property->IsA<UTextProperty>())
+        {
+            String = &static_cast<const FText*>(ValuePtr)->ToString();
+        }
+
+        if (bSkipDefault && String->IsEmpty())
+            return;
+
+        Writer.WriteTag(FieldNumber, EProtoWireType::LengthDelimited);
+        const int32 LengthOffset = Writer.BeginLengthDelimited();
+        uint8* const Dest = Writer.BeginRaw(FUtf8Conversion::GetMaxUtf8Length(String->Len()));
+        Writer.CommitRaw(FUtf8Conversion::ToUtf8(**String, String->Len(), Dest));
+        Writer.EndLengthDelimited(LengthOffset);
+        return;
+    }
+    case EProtoFieldKind::Bytes:
+    {
+        const TArray<uint8>& Bytes = static_cast<const FByteArray*>(ValuePtr)->Bytes;
+        if (bSkipDefault && Bytes.Num() == 0)
+            return;
+
+        Writer.WriteTag(FieldNumber, EProtoWireType::LengthDelimited);
+        Writer.WriteVarint(Bytes.Num());
+        Writer.WriteBytes(Bytes.GetData(), Bytes.Num());
+        return;
+    }
+    case EProtoFieldKind::Message:
+    {
+        Writer.WriteTag(FieldNumber, EProtoWireType::LengthDelimited);
+        const int32 LengthOffset = Writer.BeginLengthDelimited();
+        EncodeStruct(*Value.Message, ValuePtr, Writer);
+        Writer.EndLengthDelimited(LengthOffset);
+        return;
+    }
+    default:
+        break;
+    }
+
+    const uint64 WireValue = GetScalarWireValue(Value, ValuePtr);
+    if (bSkipDefault && WireValue == 0)
+        return;
+
+    const EProtoWireType WireType = GetWireType(Value.Kind);
+    Writer.WriteTag(FieldNumber, WireType);
+
+    if (WireType == EProtoWireType::Fixed32)
+        Writer.WriteFixed32(static_cast<uint32>(WireValue));
+    else if (WireType == EProtoWireType::Fixed64)
+        Writer.WriteFixed64(WireValue);
+    else
+        Writer.WriteVarint(WireValue);
+}
+
+void FProtoWireCodec_Internal::EncodeStruct(const FProtoStructPlan& Plan, const void* StructData, FProtoWireWriter& Writer)
+{
+    for (const FProtoFieldPlan& Field : Plan.Fields)
+    {
+        const void* const ValuePtr = Field.Property->ContainerPtrToValuePtr<void>(StructData);
+
+        if (Field.Container == EProtoFieldContainer::Single)
+        {
+            EncodeValue(Field.FieldNumber, Field.Value, ValuePtr, Writer, true);
+        }
+        else if (Field.Container == EProtoFieldContainer::Array)
+        {
+            FScriptArrayHelper Helper(static_cast<UArrayProperty*>(Field.Property), ValuePtr);
+            const int32 Num = Helper.Num();
+            if (Num == 0)
+                continue;
+
+            if (IsPackable(Field.Value.Kind))
+            {
+                const EProtoWireType WireType = GetWireType(Field.Value.Kind);
+
+                Writer.WriteTag(Field.FieldNumber, EProtoWireType::LengthDelimited);
+                const int32 LengthOffset = Writer.BeginLengthDelimited();
+                for (int32 Index = 0; Index < Num; Index++)
+                {
+                    const uint64 WireValue = GetScalarWireValue(Field.Value, Helper.GetRawPtr(Index));
+
+                    if (WireType == EProtoWireType::Fixed32)
+                        Writer.WriteFixed32(static_cast<uint32>(WireValue));
+                    else if (WireType == EProtoWireType::Fixed64)
+                        Writer.WriteFixed64(WireValue);
+                    else
+                        Writer.WriteVarint(WireValue);
+                }
+                Writer.EndLengthDelimited(LengthOffset);
+            }
+            else
+            {
+                for (int32 Index = 0; Index < Num; Index++)
+                    EncodeValue(Field.FieldNumber, Field.Value, Helper.GetRawPtr(Index), Writer, false);
+            }
+        }
+        else
+        {
+            FScriptMapHelper Helper(static_cast<UMapProperty*>(Field.Property), ValuePtr);
+
+            for (int32 Index = 0, MaxIndex = Helper.GetMaxIndex(); Index < MaxIndex; Index++)
+            {
+                if (!Helper.IsValidIndex(Index))
+                    continue;
+
+                // Each map entry is a message, consisting of a key (field 1) and a value (field 2).
+                Writer.WriteTag(Field.FieldNumber, EProtoWireType::LengthDelimited);
+                const int32 LengthOffset = Writer.BeginLengthDelimited();
+                EncodeValue(1, Field.Key, Helper.GetKeyPtr(Index), Writer, false);
+                EncodeValue(2, Field.Value, Helper.GetValuePtr(Index), Writer, false);
+                Writer.EndLengthDelimited(LengthOffset);
+            }
+        }
+    }
+}
+
+
+/// Decoding
+
+bool FProtoWireCodec_Internal::DecodeScalar(const FProtoValuePlan& Value, FProtoWireReader& Reader, void* ValuePtr)
+{
+    uint64 WireValue;
+    bool bRead;
+
+    switch (GetWireType(Value.Kind))
+    {
+    case EProtoWireType::Fixed32: bRead = Reader.ReadFixed32(WireValue); break;
+    case EProtoWireType::Fixed64: bRead = Reader.ReadFixed64(WireValue); break;
+    default: bRead = Reader.ReadVarint(WireValue); break;
+    }
+
+    if (bRead)
+        SetScalarFromWireValue(Value, ValuePtr, WireValue);
+
+    return bRead;
+}
+
+bool FProtoWireCodec_Internal::DecodeValue(const FProtoValuePlan& Value, EProtoWireType WireType, FProtoWireReader& Reader, void* ValuePtr)
+{
+    // Mismatching wire types are treated as unknown fields, as protobuf does.
+    if (WireType != GetWireType(Value.Kind))
+        return Reader.Skip(WireType);
+
+    if (IsPackable(Value.Kind))
+        return DecodeScalar(Value, Reader, ValuePtr);
+
+    const uint8* Data;
+    int32 Num;
+    if (!Reader.ReadLengthDelimited(Data, Num))
+        return false;
+
+    switch (Value.Kind)
+    {
+    case EProtoFieldKind::String:
+        if (Value.Property->IsA<UStrProperty>())
+        {
+            FUtf8Conversion::FromUtf8(reinterpret_cast<const char*>(Data), Num, *static_cast<FString*>(ValuePtr));
+        }
+        else
+        {
+            FString Decoded;
+            FUtf8Conversion::FromUtf8(reinterpret_cast<const char*>(Data), Num, Decoded);
+
+            if (Value.Property->IsA<UNameProperty>())
+                *static_cast<FName*>(ValuePtr) = FName(*Decoded);
+            else
+                *static_cast<FText*>(ValuePtr) = FText::FromString(MoveTemp(Decoded));
+        }
+        return true;
+
+    case EProtoFieldKind::Bytes:
+    {
+        TArray<uint8>& Bytes = static_cast<FByteArray*>(ValuePtr)->Bytes;
+        Bytes.Reset(Num);
+        Bytes.Append(Data, Num);
+        return true;
+    }
+
+    default:
+        // Nested messages are merged, as protobuf does.
+        return DecodeStruct(*Value.Message, Data, Num, ValuePtr);
+    }
+}
+
+bool FProtoWireCodec_Internal::DecodeMapEntry(const FProtoFieldPlan& Field, const uint8* Data, int32 Num, FScriptMapHelper& Helper)
+{
+    // The entry is decoded aside and then added via AddPair(), which overwrites the value of a duplicate key, so that
+    // the last one wins, as in protobuf.
+    UProperty* const KeyProperty = Field.Key.Property;
+    UProperty* const ValueProperty = Field.Value.Property;
+
+    void* const KeyPtr = FMemory_Alloca(KeyProperty->ElementSize);
+    void* const ValuePtr = FMemory_Alloca(ValueProperty->ElementSize);
+    KeyProperty->InitializeValue(KeyPtr);
+    ValueProperty->InitializeValue(ValuePtr);
+
+    bool bSuccess = true;
+
+    FProtoWireReader Reader(Data, Num);
+    while (bSuccess && !Reader.IsAtEnd())
+    {
+        int32 FieldNumber;
+        EProtoWireType WireType;
+        if (!Reader.ReadTag(FieldNumber, WireType))
+        {
+            bSuccess = false;
+            break;
+        }
+
+        switch (FieldNumber)
+        {
+        case 1: bSuccess = DecodeValue(Field.Key, WireType, Reader, KeyPtr); break;
+        case 2: bSuccess = DecodeValue(Field.Value, WireType, Reader, ValuePtr); break;
+        default: bSuccess = Reader.Skip(WireType); break;
+        }
+    }
+
+    if (bSuccess)
+        Helper.AddPair(KeyPtr, ValuePtr);
+
+    KeyProperty->DestroyValue(KeyPtr);
+    ValueProperty->DestroyValue(ValuePtr);
+
+    return bSuccess;
+}
+
+bool FProtoWireCodec_Internal::DecodeStruct(const FProtoStructPlan& Plan, const uint8* Data, int32 Num, void* StructData)
+{
+    bool bSuccess = true;
+
+    FProtoWireReader Reader(Data, Num);
+    while (bSuccess && !Reader.IsAtEnd())
+    {
+        int32 FieldNumber;
+        EProtoWireType WireType;
+        if (!Reader.ReadTag(FieldNumber, WireType))
+        {
+            bSuccess = false;
+            break;
+        }
+
+        const FProtoFieldPlan* const Field = Plan.FindField(FieldNumber);
+
+        if (!Field)
+        {
+            bSuccess = Reader.Skip(WireType);
+            continue;
+        }
+
+        void* const ValuePtr = Field->Property->ContainerPtrToValuePtr<void>(StructData);
+
+        if (Field->Container == EProtoFieldContainer::Single)
+        {
+            bSuccess = DecodeValue(Field->Value, WireType, Reader, ValuePtr);
+        }
+        else if (Field->Container == EProtoFieldContainer::Array)
+        {
+            FScriptArrayHelper Helper(static_cast<UArrayProperty*>(Field->Property), ValuePtr);
+
+            if (WireType == EProtoWireType::LengthDelimited && IsPackable(Field->Value.Kind))
+            {
+                // Packed scalars
+                const uint8* PackedData;
+                int32 PackedNum;
+                bSuccess = Reader.ReadLengthDelimited(PackedData, PackedNum);
+
+                FProtoWireReader PackedReader(PackedData, bSuccess ? PackedNum : 0);
+                while (bSuccess && !PackedReader.IsAtEnd())
+                {
+                    const int32 Index = Helper.AddValue();
+                    bSuccess = DecodeScalar(Field->Value, PackedReader, Helper.GetRawPtr(Index));
+                }
+            }
+            else if (WireType != GetWireType(Field->Value.Kind))
+            {
+                // Checked here rather than in DecodeValue(), an unknown field must not add an element
+                bSuccess = Reader.Skip(WireType);
+            }
+            else
+            {
+                const int32 Index = Helper.AddValue();
+                bSuccess = DecodeValue(Field->Value, WireType, Reader, Helper.GetRawPtr(Index));
+            }
+        }
+        else
+        {
+            const uint8* EntryData;
+            int32 EntryNum;
+
+            if (WireType != EProtoWireType::LengthDelimited)
+            {
+                bSuccess = Reader.Skip(WireType);
+            }
+            else if ((bSuccess = Reader.ReadLengthDelimited(EntryData, EntryNum)))
+            {
+                FScriptMapHelper Helper(static_cast<UMapProperty*>(Field->Property), ValuePtr);
+                bSuccess = DecodeMapEntry(*Field, EntryData, EntryNum, Helper);
+            }
+        }
+    }
+
+    return bSuccess;
+}
+
+
+/// FProtoWireCodec interface
+
+void FProtoWireCodec::RegisterFields(UScriptStruct* Struct, const TArray<FProtoFieldSpec>& Fields)
+{
+    FProtoWireCodec_Internal::RegisterFields(Struct, Fields);
+}
+
+bool FProtoWireCodec::Encode(UScriptStruct* Struct, const void* StructData, TArray<uint8>& OutBytes, EProtoFieldNumbering Numbering)
+{
+    const FProtoStructPlan* const Plan = FProtoWireCodec_Internal::GetPlan(Struct, Numbering);
+    if (!Plan->bValid)
+        return false;
+
+    FProtoWireWriter Writer;
+    FProtoWireCodec_Internal::EncodeStruct(*Plan, StructData, Writer);
+
+    OutBytes.Reset(Writer.GetNum());
+    OutBytes.Append(Writer.GetData(), Writer.GetNum());
+    return true;
+}
+
+bool FProtoWireCodec::Encode(UScriptStruct* Struct, const void* StructData, grpc::ByteBuffer& OutBuffer)
+{
+    const FProtoStructPlan* const Plan = FProtoWireCodec_Internal::GetPlan(Struct, EProtoFieldNumbering::Registered);
+    if (!Plan->bValid)
+        return false;
+
+    FProtoWireWriter Writer;
+    FProtoWireCodec_Internal::EncodeStruct(*Plan, StructData, Writer);
+
+    // The slice takes ownership of the encoded message.
+    const int32 Num = Writer.GetNum();
+    grpc::Slice Slice(Writer.Release(), Num, [](void* Data) { FMemory::Free(Data); });
+    grpc::ByteBuffer Buffer(&Slice, 1);
+    OutBuffer.Swap(&Buffer);
+
+    return true;
+}
+
+bool FProtoWireCodec::Decode(UScriptStruct* Struct, const uint8* Data, int32 Num, void* OutStructData, EProtoFieldNumbering Numbering)
+{
+    const FProtoStructPlan* const Plan = FProtoWireCodec_Internal::GetPlan(Struct, Numbering);
+    if (!Plan->bValid)
+        return false;
+
+    Struct->ClearScriptStruct(OutStructData);
+    return FProtoWireCodec_Internal::DecodeStruct(*Plan, Data, Num, OutStructData);
+}
+
+bool FProtoWireCodec::Decode(UScriptStruct* Struct, const grpc::ByteBuffer& Buffer, void* OutStructData)
+{
+    std::vector<grpc::Slice> Slices;
+    if (!Buffer.Dump(&Slices).ok())
+        return false;
+
+    if (Slices.size() == 1)
+        return Decode(Struct, Slices[0].begin(), static_cast<int32>(Slices[0].size()), OutStructData);
+
+    TArray<uint8> Joined;
+    Joined.Reserve(static_cast<int32>(Buffer.Length()));
+    for (const grpc::Slice& Slice : Slices)
+        Joined.Append(Slice.begin(), static_cast<int32>(Slice.size()));
+
+    return Decode(Struct, Joined.GetData(), Joined.Num(), OutStructData);
+}
@@ -0,0 +1,179 @@
+/*
+ * Copyright 2018 Vizor Games LLC
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS, WITHOUT
+ * WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.See the
+ * License for the specific language governing permissions and limitations
+ * under the License.
+ */
+#include "RpcAllocationCounter.h"
+
+#if !UE_BUILD_SHIPPING
+
+#include "HAL/MemoryBase.h"
+#include "Templates/Atomic.h"
+
+/** Allocations, counted on the current thread. */
+static thread_local uint64 GRpcNumAllocationsOnCurrentThread = 0;
+
+/** Depth of Pause() calls on the current thread, its allocations aren't counted unless it's 0. */
+static thread_local int32 GRpcAllocationCounterPauseDepth = 0;
+
+/**
+ * Forwards everything to the original allocator, counting allocations.
+ */
+class FRpcCountingMalloc : public FMalloc
+{
+public:
+    FMalloc* Inner = nullptr;
+    TAtomic<uint64> NumAllocations;
+
+    FRpcCountingMalloc() : NumAllocations(0)
+    {
+    }
+
+    /// FMalloc interface
+
+    virtual void* Malloc(SIZE_T Count, uint32 Alignment) override
+    {
+        if (GRpcAllocationCounterPauseDepth == 0)
+        {
+            NumAllocations++;
+            GRpcNumAllocationsOnCurrentThread++;
+        }
+
+        return Inner->Malloc(Count, Alignment);
+    }
+
+    virtual void* Realloc(void* Original, SIZE_T Count, uint32 Alignment) override
+    {
+        if (Count > 0 && GRpcAllocationCounterPauseDepth == 0)
+        {
+            NumAllocations++;
+            GRpcNumAllocationsOnCurrentThread++;
+        }
+
+        return Inner->Realloc(Original, Count, Alignment);
+    }
+
+    virtual void Free(void* Original) override
+    {
+        Inner->Free(Original);
+    }
+
+    virtual SIZE_T QuantizeSize(SIZE_T Count, uint32 Alignment) override
+    {
+        return Inner->QuantizeSize(Count, Alignment);
+    }
+
+    virtual bool GetAllocationSize(void* Original, SIZE_T& SizeOut) override
+    {
+        return Inner->GetAllocationSize(Original, SizeOut);
+    }
+
+    virtual void Trim() override
+    {
+        Inner->Trim();
+    }
+
+    virtual void SetupTLSCachesOnCurrentThread() override
+    {
+        Inner->SetupTLSCachesOnCurrentThread();
+    }
+
+    virtual void ClearAndDisableTLSCachesOnCurrentThread() override
+    {
+        Inner->ClearAndDisableTLSCachesOnCurrentThread();
+    }
+
+    virtual void UpdateStats() override
+    {
+        Inner->UpdateStats();
+    }
+
+    virtual void GetAllocatorStats(FGenericMemoryStats& OutStats) override
+    {
+        Inner->GetAllocatorStats(OutStats);
+    }
+
+    virtual void DumpAllocatorStats(FOutputDevice& Ar) override
+    {
+        Inner->DumpAllocatorStats(Ar);
+    }
+
+    virtual bool IsInternallyThreadSafe() const override
+    {
+        return Inner->IsInternallyThreadSafe();
+    }
+
+    virtual bool ValidateHeap() override
+    {
+        return Inner->ValidateHeap();
+    }
+
+    virtual const TCHAR* GetDescriptiveName() override
+    {
+        return Inner->GetDescriptiveName();
+    }
+};
+
+// Leaked on purpose: other threads could still be inside of it after GMalloc has been restored, even at exit. FMalloc
+// allocates itself via the system allocator (FUseSystemMallocForNew), rather than via GMalloc.
+static FRpcCountingMalloc* const GRpcCountingMalloc = new FRpcCountingMalloc();
+static int32 GRpcAllocationCounterDepth = 0;
+
+
+/// FRpcAllocationCounter interface
+
+void FRpcAllocationCounter::Begin()
+{
+    check(IsInGameThread());
+
+    if (GRpcAllocationCounterDepth++ == 0)
+    {
+        GRpcCountingMalloc->Inner = GMalloc;
+        GMalloc = GRpcCountingMalloc;
+    }
+}
+
+void FRpcAllocationCounter::End()
+{
+    check(IsInGameThread() && GRpcAllocationCounterDepth > 0);
+
+    if (--GRpcAllocationCounterDepth == 0)
+    {
+        // Another proxy could have been installed on top of ours meanwhile, it can't be removed safely then.
+        if (ensure(GMalloc == GRpcCountingMalloc))
+            GMalloc = GRpcCountingMalloc->Inner;
+    }
+}
+
+uint64 FRpcAllocationCounter::GetNumAllocations()
+{
+    return GRpcCountingMalloc->NumAllocations.Load();
+}
+
+uint64 FRpcAllocationCounter::GetNumAllocationsOnCurrentThread()
+{
+    return GRpcNumAllocationsOnCurrentThread;
+}
+
+void FRpcAllocationCounter::Pause()
+{
+    GRpcAllocationCounterPauseDepth++;
+}
+
+void FRpcAllocationCounter::Resume()
+{
+    check(GRpcAllocationCounterPauseDepth > 0);
+    GRpcAllocationCounterPauseDepth--;
+}
+
+#endif
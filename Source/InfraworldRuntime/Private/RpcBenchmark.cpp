@@ -0,0 +1,557 @@
+/*
+ * Copyright 2018 Vizor Games LLC
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS, WITHOUT
+ * WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.See the
+ * License for the specific language governing permissions and limitations
+ * under the License.
+ */
+#include "RpcBenchmark.h"
+
+#if !UE_BUILD_SHIPPING
+
+#include "InfraworldRuntime.h"
+#include "CastUtils.h"
+#include "CompiledContext.h"
+#include "Conduit.h"
+#include "GrpcUriValidator.h"
+#include "RpcAllocationCounter.h"
+
+#include "Async/Async.h"
+#include "HAL/IConsoleManager.h"
+#include "HAL/PlatformProcess.h"
+#include "HAL/PlatformTime.h"
+#include "Misc/DateTime.h"
+#include "Misc/EngineVersion.h"
+#include "Misc/FileHelper.h"
+#include "Misc/Parse.h"
+#include "Misc/Paths.h"
+
+#include "GrpcIncludesBegin.h"
+
+#include <grpcpp/client_context.h>
+
+#include "GrpcIncludesEnd.h"
+
+class FRpcBenchmark_Internal
+{
+public:
+    FRpcBenchmark_Internal(const FString& InFilter, double InMinSeconds, TArray<FRpcBenchmarkResult>& InResults) :
+        Filter(InFilter),
+        MinSeconds(InMinSeconds),
+        Results(InResults)
+    {
+    }
+
+    /**
+     * Measures Body, which should perform the given number of operations.
+     */
+    void Measure(const FString& Name, int64 BytesPerOp, TFunctionRef<void(int64 Iterations)> Body);
+
+    /**
+     * Same as Measure(), but the case must make no allocations, @see FRpcBenchmark::CheckAllocations().
+     */
+    void MeasureAllocationFree(const FString& Name, TFunctionRef<void(int64 Iterations)> Body);
+
+    void RunConduit();
+    void RunStringCasts(int32 Length);
+    void RunBytesCasts(int32 Length);
+    void RunNumericArrayCasts(int32 Num);
+    void RunPtrArrayCasts(int32 Num);
+    void RunMapCasts(int32 Num);
+    void RunClientContext(int32 NumMetadata);
+    void RunStatus();
+    void RunUriValidator();
+
+    static void RunFromConsole(const TArray<FString>& Args);
+
+    // Keeps results of operations from being optimized out.
+    static FORCEINLINE void Consume(int64 Value)
+    {
+        Sink += Value;
+    }
+
+private:
+    static constexpr int32 NumRuns = 3;
+    static volatile int64 Sink;
+
+    const FString Filter;
+    const double MinSeconds;
+    TArray<FRpcBenchmarkResult>& Results;
+};
+
+volatile int64 FRpcBenchmark_Internal::Sink = 0;
+
+
+/// FRpcBenchmark_Internal interface
+
+void FRpcBenchmark_Internal::Measure(const FString& Name, int64 BytesPerOp, TFunctionRef<void(int64 Iterations)> Body)
+{
+    if (!Filter.IsEmpty() && !Name.Contains(Filter))
+        return;
+
+    // Warm up caches and allocators, then find out how many iterations take at least MinSeconds.
+    Body(1);
+
+    int64 Iterations = 1;
+    for (;;)
+    {
+        const double StartTime = FPlatformTime::Seconds();
+        Body(Iterations);
+        const double Elapsed = FPlatformTime::Seconds() - StartTime;
+
+        if (Elapsed >= MinSeconds)
+            break;
+
+        // Aim slightly above MinSeconds, but grow at most 10 times per step, since very short runs are noisy.
+        const double Scale = (Elapsed > 0.0) ? FMath::Min(MinSeconds * 1.2 / Elapsed, 10.0) : 10.0;
+        Iterations = FMath::Max<int64>(Iterations + 1, static_cast<int64>(Iterations * Scale));
+    }
+
+    double BestSeconds = MAX_dbl;
+    for (int32 Run = 0; Run < NumRuns; Run++)
+    {
+        const double StartTime = FPlatformTime::Seconds();
+        Body(Iterations);
+        BestSeconds = FMath::Min(BestSeconds, FPlatformTime::Seconds() - StartTime);
+    }
+
+    FRpcBenchmarkResult Result;
+    Result.Name = Name;
+    Result.Iterations = Iterations;
+    Result.NanosecondsPerOp = BestSeconds * 1e9 / Iterations;
+    Result.BytesPerOp = BytesPerOp;
+
+    // Allocations are counted by a separate run, since the counting proxy is slower than the allocator itself.
+    {
+        const FRpcAllocationCounterScope AllocationCounter;
+        Body(Iterations);
+        Result.AllocationsPerOp = static_cast<double>(AllocationCounter.GetNumAllocations()) / Iterations;
+    }
+
+    UE_LOG(LogInfraworldRuntime, Display, TEXT("%-48s %14.1f ns/op %10.2f allocs/op %12lld iterations"), *Name, Result.NanosecondsPerOp,
+        Result.AllocationsPerOp, Iterations);
+    Results.Add(Result);
+}
+
+void FRpcBenchmark_Internal::MeasureAllocationFree(const FString& Name, TFunctionRef<void(int64 Iterations)> Body)
+{
+    const int32 NumResults = Results.Num();
+    Measure(Name, 0, Body);
+
+    // The case could have been filtered out.
+    if (Results.Num() > NumResults)
+        Results.Last().bAllocationFree = true;
+}
+
+void FRpcBenchmark_Internal::RunConduit()
+{
+    typedef TRequestWithContext<FByteArray> FRequest;
+    typedef TResponseWithStatus<FByteArray> FResponse;
+
+    // Requests are being echoed by another thread, at most Window of them are in flight, as the ticker would do.
+    static constexpr int64 Window = 256;
+    FByteArray Payload;
+    Payload.Bytes.Init(0xAB, 32);
+
+    Measure(TEXT("Conduit.RoundTrip"), Payload.Bytes.Num(), [&Payload](int64 Iterations)
+    {
+        TConduit<FRequest, FResponse> Conduit;
+        Conduit.AcquireRequestsProducer();
+
+        TFuture<void> Echo = Async(EAsyncExecution::Thread, [&Conduit, Iterations]()
+        {
+            Conduit.AcquireResponsesProducer();
+
+            FRequest Request;
+            int64 Echoed = 0;
+
+            while (Echoed < Iterations)
+            {
+                if (Conduit.Dequeue(Request))
+                {
+                    FResponse Response;
+                    Response.Response = MoveTemp(Request.Request);
+                    Conduit.Enqueue(MoveTemp(Response));
+                    Echoed++;
+                }
+                else
+                {
+                    FPlatformProcess::Sleep(0.0f);
+                }
+            }
+        });
+
+        FResponse Response;
+        int64 Sent = 0;
+        int64 Received = 0;
+
+        while (Received < Iterations)
+        {
+            while (Sent < Iterations && Sent - Received < Window)
+            {
+                Conduit.Enqueue(FRequest(Payload, FGrpcClientContext()));
+                Sent++;
+            }
+
+            bool bReceivedAny = false;
+            while (Conduit.Dequeue(Response))
+            {
+                Consume(Response.Response.Bytes.Num());
+                Received++;
+                bReceivedAny = true;
+            }
+
+            if (!bReceivedAny)
+                FPlatformProcess::Sleep(0.0f);
+        }
+
+        Echo.Wait();
+    });
+}
+
+void FRpcBenchmark_Internal::RunStringCasts(int32 Length)
+{
+    // ASCII strings take the vectorized path of the UTF-8 conversion, Cyrillic ones are being converted by a scalar one.
+    const FString Ascii = FString::ChrN(Length, TEXT('a'));
+    const FString Cyrillic = FString::ChrN(Length, static_cast<TCHAR>(0x0416));
+
+    const std::string AsciiUtf8 = casts::Proto_Cast<std::string>(Ascii);
+    const std::string CyrillicUtf8 = casts::Proto_Cast<std::string>(Cyrillic);
+
+    Measure(FString::Printf(TEXT("ProtoCast.String.Ascii.ToProto/%d"), Length), AsciiUtf8.size(), [&Ascii](int64 Iterations)
+    {
+        for (int64 Index = 0; Index < Iterations; Index++)
+            Consume(casts::Proto_Cast<std::string>(Ascii).size());
+    });
+
+    Measure(FString::Printf(TEXT("ProtoCast.String.Ascii.FromProto/%d"), Length), AsciiUtf8.size(), [&AsciiUtf8](int64 Iterations)
+    {
+        for (int64 Index = 0; Index < Iterations; Index++)
+            Consume(casts::Proto_Cast<FString>(AsciiUtf8).Len());
+    });
+
+    Measure(FString::Printf(TEXT("ProtoCast.String.Cyrillic.ToProto/%d"), Length), CyrillicUtf8.size(), [&Cyrillic](int64 Iterations)
+    {
+        for (int64 Index = 0; Index < Iterations; Index++)
+            Consume(casts::Proto_Cast<std::string>(Cyrillic).size());
+    });
+
+    Measure(FString::Printf(TEXT("ProtoCast.String.Cyrillic.FromProto/%d"), Length), CyrillicUtf8.size(), [&CyrillicUtf8](int64 Iterations)
+    {
+        for (int64 Index = 0; Index < Iterations; Index++)
+            Consume(casts::Proto_Cast<FString>(CyrillicUtf8).Len());
+    });
+}
+
+void FRpcBenchmark_Internal::RunBytesCasts(int32 Length)
+{
+    TArray<uint8> Bytes;
+    Bytes.SetNumUninitialized(Length);
+
+    for (int32 Index = 0; Index < Length; Index++)
+        Bytes[Index] = static_cast<uint8>(Index * 31);
+
+    const FByteArray Unreal(MoveTemp(Bytes));
+    const std::string Proto = casts::Proto_Cast<std::string>(Unreal);
+
+    Measure(FString::Printf(TEXT("ProtoCast.Bytes.ToProto/%d"), Length), Length, [&Unreal](int64 Iterations)
+    {
+        for (int64 Index = 0; Index < Iterations; Index++)
+            Consume(casts::Proto_Cast<std::string>(Unreal).size());
+    });
+
+    Measure(FString::Printf(TEXT("ProtoCast.Bytes.FromProto/%d"), Length), Length, [&Proto](int64 Iterations)
+    {
+        for (int64 Index = 0; Index < Iterations; Index++)
+            Consume(casts::Proto_Cast<FByteArray>(Proto).Bytes.Num());
+    });
+}
+
+void FRpcBenchmark_Internal::RunNumericArrayCasts(int32 Num)
+{
+    TArray<int32> Integers;
+    TArray<float> Floats;
+
+    for (int32 Index = 0; Index < Num; Index++)
+    {
+        Integers.Add(Index * 7);
+        Floats.Add(Index * 0.5f);
+    }
+
+    const casts::_ProtobufArray<int32> ProtoIntegers = casts::Proto_ArrayCast<int32>(Integers);
+    const casts::_ProtobufArray<float> ProtoFloats = casts::Proto_ArrayCast<float>(Floats);
+
+    Measure(FString::Printf(TEXT("ProtoCast.Int32Array.ToProto/%d"), Num), Num * sizeof(int32), [&Integers](int64 Iterations)
+    {
+        for (int64 Index = 0; Index < Iterations; Index++)
+            Consume(casts::Proto_ArrayCast<int32>(Integers).size());
+    });
+
+    Measure(FString::Printf(TEXT("ProtoCast.Int32Array.FromProto/%d"), Num), Num * sizeof(int32), [&ProtoIntegers](int64 Iterations)
+    {
+        for (int64 Index = 0; Index < Iterations; Index++)
+            Consume(casts::Proto_ArrayCast<int32>(ProtoIntegers).Num());
+    });
+
+    Measure(FString::Printf(TEXT("ProtoCast.FloatArray.ToProto/%d"), Num), Num * sizeof(float), [&Floats](int64 Iterations)
+    {
+        for (int64 Index = 0; Index < Iterations; Index++)
+            Consume(casts::Proto_ArrayCast<float>(Floats).size());
+    });
+
+    Measure(FString::Printf(TEXT("ProtoCast.FloatArray.FromProto/%d"), Num), Num * sizeof(float), [&ProtoFloats](int64 Iterations)
+    {
+        for (int64 Index = 0; Index < Iterations; Index++)
+            Consume(casts::Proto_ArrayCast<float>(ProtoFloats).Num());
+    });
+}
+
+void FRpcBenchmark_Internal::RunPtrArrayCasts(int32 Num)
+{
+    TArray<FString> Strings;
+    for (int32 Index = 0; Index < Num; Index++)
+        Strings.Add(FString::Printf(TEXT("item-%08d"), Index));
+
+    const casts::_ProtobufPtrArray<std::string> ProtoStrings = casts::Proto_PtrArrayCast<std::string>(Strings);
+
+    Measure(FString::Printf(TEXT("ProtoCast.StringArray.ToProto/%d"), Num), 0, [&Strings](int64 Iterations)
+    {
+        for (int64 Index = 0; Index < Iterations; Index++)
+            Consume(casts::Proto_PtrArrayCast<std::string>(Strings).size());
+    });
+
+    Measure(FString::Printf(TEXT("ProtoCast.StringArray.FromProto/%d"), Num), 0, [&ProtoStrings](int64 Iterations)
+    {
+        for (int64 Index = 0; Index < Iterations; Index++)
+            Consume(casts::Proto_PtrArrayCast<FString>(ProtoStrings).Num());
+    });
+}
+
+void FRpcBenchmark_Internal::RunMapCasts(int32 Num)
+{
+    TMap<FString, int32> Map;
+    for (int32 Index = 0; Index < Num; Index++)
+        Map.Add(FString::Printf(TEXT("key-%08d"), Index), Index);
+
+    const casts::_ProtobufMap<std::string, int32> ProtoMap = casts::Proto_MapCast<std::string, int32>(Map);
+
+    Measure(FString::Printf(TEXT("ProtoCast.Map.ToProto/%d"), Num), 0, [&Map](int64 Iterations)
+    {
+        for (int64 Index = 0; Index < Iterations; Index++)
+            Consume(casts::Proto_MapCast<std::string, int32>(Map).size());
+    });
+
+    Measure(FString::Printf(TEXT("ProtoCast.Map.FromProto/%d"), Num), 0, [&ProtoMap](int64 Iterations)
+    {
+        for (int64 Index = 0; Index < Iterations; Index++)
+            Consume(casts::Proto_MapCast<FString, int32>(ProtoMap).Num());
+    });
+}
+
+void FRpcBenchmark_Internal::RunClientContext(int32 NumMetadata)
+{
+    FGrpcClientContext Context;
+    Context.bOverride_Metadata = NumMetadata > 0;
+
+    for (int32 Index = 0; Index < NumMetadata; Index++)
+        Context.Metadata.Add(FString::Printf(TEXT("x-benchmark-%d"), Index), FString::ChrN(32, TEXT('v')));
+
+    const FGrpcCompiledContextRef CompiledContext = FGrpcCompiledContext::Compile(Context);
+
+    // Both include construction of grpc::ClientContext, since a new one is being made for every call.
+    const auto CastContext = [&Context](int64 Iterations)
+    {
+        for (int64 Index = 0; Index < Iterations; Index++)
+        {
+            grpc::ClientContext ClientContext;
+            casts::CastClientContext(Context, ClientContext);
+        }
+    };
+
+    const auto CastCompiledContext = [&CompiledContext](int64 Iterations)
+    {
+        for (int64 Index = 0; Index < Iterations; Index++)
+        {
+            grpc::ClientContext ClientContext;
+            casts::CastClientContext(*CompiledContext, ClientContext);
+        }
+    };
+
+    // Metadata is being copied into grpc::ClientContext, so only contexts without it could be allocation-free.
+    if (NumMetadata == 0)
+    {
+        MeasureAllocationFree(FString::Printf(TEXT("CastClientContext/%d"), NumMetadata), CastContext);
+        MeasureAllocationFree(FString::Printf(TEXT("CastClientContext.Compiled/%d"), NumMetadata), CastCompiledContext);
+    }
+    else
+    {
+        Measure(FString::Printf(TEXT("CastClientContext/%d"), NumMetadata), 0, CastContext);
+        Measure(FString::Printf(TEXT("CastClientContext.Compiled/%d"), NumMetadata), 0, CastCompiledContext);
+    }
+}
+
+void FRpcBenchmark_Internal::RunStatus()
+{
+    const grpc::Status ErrorStatus(grpc::StatusCode::UNAVAILABLE, "failed to connect to all addresses");
+
+    MeasureAllocationFree(TEXT("CastStatus.Ok"), [](int64 Iterations)
+    {
+        FGrpcStatus Status;
+        for (int64 Index = 0; Index < Iterations; Index++)
+        {
+            casts::CastStatus(grpc::Status::OK, Status);
+            Consume(static_cast<int64>(Status.ErrorCode));
+        }
+    });
+
+    // A fresh status for every call, as in responses, so the message is being allocated.
+    Measure(TEXT("CastStatus.Error"), 0, [&ErrorStatus](int64 Iterations)
+    {
+        for (int64 Index = 0; Index < Iterations; Index++)
+        {
+            FGrpcStatus Status;
+            casts::CastStatus(ErrorStatus, Status);
+            Consume(Status.ErrorMessage.Len());
+        }
+    });
+}
+
+void FRpcBenchmark_Internal::RunUriValidator()
+{
+    const TCHAR* const Cases[][2] =
+    {
+        { TEXT("Hostname"), TEXT("api.example.com:50051") },
+        { TEXT("Ipv4"), TEXT("127.0.0.1:50051") },
+        { TEXT("Invalid"), TEXT("https://api.example.com") },
+    };
+
+    for (const TCHAR* const* Case : Cases)
+    {
+        const FString Uri(Case[1]);
+
+        Measure(FString::Printf(TEXT("UriValidator/%s"), Case[0]), 0, [&Uri](int64 Iterations)
+        {
+            FString Error;
+            for (int64 Index = 0; Index < Iterations; Index++)
+                Consume(FGrpcUriValidator::Validate(Uri, Error));
+        });
+    }
+}
+
+void FRpcBenchmark_Internal::RunFromConsole(const TArray<FString>& Args)
+{
+    FString Filter;
+    float MinSeconds = 0.2f;
+    FString OutPath = FPaths::ProfilingDir() / TEXT("Infraworld") / FString::Printf(TEXT("Benchmark-%s.json"), *FDateTime::Now().ToString());
+
+    for (const FString& Arg : Args)
+    {
+        if (!FParse::Value(*Arg, TEXT("-MinSeconds="), MinSeconds) && !FParse::Value(*Arg, TEXT("-Out="), OutPath))
+            Filter = Arg;
+    }
+
+    TArray<FRpcBenchmarkResult> Results;
+    FRpcBenchmark::Run(Filter, MinSeconds, Results);
+    FRpcBenchmark::CheckAllocations(Results);
+
+    if (FFileHelper::SaveStringToFile(FRpcBenchmark::ToJson(Results), *OutPath, FFileHelper::EEncodingOptions::ForceUTF8WithoutBOM))
+        UE_LOG(LogInfraworldRuntime, Display, TEXT("%d benchmark results have been written to %s"), Results.Num(), *OutPath);
+    else
+        UE_LOG(LogInfraworldRuntime, Error, TEXT("Can't write benchmark results to %s"), *OutPath);
+}
+
+static FAutoConsoleCommand CmdInfraworldBenchmark(
+    TEXT("infraworld.Benchmark"),
+    TEXT("Runs microbenchmarks of the Infraworld runtime and writes results as JSON.\n")
+    TEXT("Usage: infraworld.Benchmark [NameFilter] [-MinSeconds=0.2] [-Out=Path.json]"),
+    FConsoleCommandWithArgsDelegate::CreateStatic(&FRpcBenchmark_Internal::RunFromConsole));
+
+
+/// FRpcBenchmark interface
+
+void FRpcBenchmark::Run(const FString& Filter, double MinSeconds, TArray<FRpcBenchmarkResult>& OutResults)
+{
+    FRpcBenchmark_Internal Benchmark(Filter, MinSeconds, OutResults);
+
+    Benchmark.RunConduit();
+
+    for (const int32 Length : { 16, 1024, 65536 })
+    {
+        Benchmark.RunStringCasts(Length);
+        Benchmark.RunBytesCasts(Length);
+    }
+
+    for (const int32 Num : { 16, 1024, 65536 })
+        Benchmark.RunNumericArrayCasts(Num);
+
+    for (const int32 Num : { 16, 256, 4096 })
+    {
+        Benchmark.RunPtrArrayCasts(Num);
+        Benchmark.RunMapCasts(Num);
+    }
+
+    for (const int32 NumMetadata : { 0, 4, 16, 64 })
+        Benchmark.RunClientContext(NumMetadata);
+
+    Benchmark.RunStatus();
+
+    Benchmark.RunUriValidator();
+}
+
+int32 FRpcBenchmark::CheckAllocations(const TArray<FRpcBenchmarkResult>& Results)
+{
+    int32 NumFailed = 0;
+
+    for (const FRpcBenchmarkResult& Result : Results)
+    {
+        if (Result.HasUnexpectedAllocations())
+        {
+            UE_LOG(LogInfraworldRuntime, Error, TEXT("%s must not allocate, but makes %.2f allocations per operation"),
+                *Result.Name, Result.AllocationsPerOp);
+            NumFailed++;
+        }
+    }
+
+    return NumFailed;
+}
+
+FString FRpcBenchmark::ToJson(const TArray<FRpcBenchmarkResult>& Results)
+{
+    FString Json = TEXT("{\n");
+
+    Json += FString::Printf(TEXT("  \"engine\": \"%s\",\n"), *FEngineVersion::Current().ToString());
+    Json += FString::Printf(TEXT("  \"platform\": \"%s\",\n"), ANSI_TO_TCHAR(FPlatformProperties::IniPlatformName()));
+    Json += FString::Printf(TEXT("  \"timestamp\": \"%s\",\n"), *FDateTime::UtcNow().ToIso8601());
+    Json += TEXT("  \"results\": [\n");
+
+    for (int32 Index = 0; Index < Results.Num(); Index++)
+    {
+        const FRpcBenchmarkResult& Result = Results[Index];
+        const double OpsPerSecond = (Result.NanosecondsPerOp > 0.0) ? 1e9 / Result.NanosecondsPerOp : 0.0;
+
+        // Case names are plain identifiers, so they need no escaping.
+        Json += FString::Printf(
+            TEXT("    { \"name\": \"%s\", \"iterations\": %lld, \"ns_per_op\": %.3f, \"ops_per_second\": %.1f, \"bytes_per_second\": %.1f, \"allocs_per_op\": %.3f, \"allocation_free\": %s }%s\n"),
+            *Result.Name,
+            Result.Iterations,
+            Result.NanosecondsPerOp,
+            OpsPerSecond,
+            OpsPerSecond * Result.BytesPerOp,
+            Result.AllocationsPerOp,
+            Result.bAllocationFree ? TEXT("true") : TEXT("false"),
+            (Index + 1 < Results.Num()) ? TEXT(",") : TEXT(""));
+    }
+
+    Json += TEXT("  ]\n}\n");
+    return Json;
+}
+
+#endif
@@ -0,0 +1,95 @@
+/*
+ * Copyright 2018 Vizor Games LLC
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS, WITHOUT
+ * WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.See the
+ * License for the specific language governing permissions and limitations
+ * under the License.
+ */
+#include "RpcCancellation.h"
+
+#include "GenUtils.h"
+
+#include "GrpcIncludesBegin.h"
+
+#include <grpcpp/client_context.h>
+
+#include "GrpcIncludesEnd.h"
+
+FRpcCancellation::FRpcCancellation() : bCancelled(false)
+{
+}
+
+FRpcCancellation::FRpcCancellation(const TSharedPtr<FRpcCancellation, ESPMode::ThreadSafe>& InParent) :
+    bCancelled(false),
+    Parent(InParent)
+{
+}
+
+TSharedRef<FRpcCancellation, ESPMode::ThreadSafe> FRpcCancellation::Attach(FGrpcClientContext& Context)
+{
+    const TSharedRef<FRpcCancellation, ESPMode::ThreadSafe> Cancellation = MakeShared<FRpcCancellation, ESPMode::ThreadSafe>();
+    Context.Cancellation = Cancellation;
+
+    return Cancellation;
+}
+
+TSharedRef<FRpcCancellation, ESPMode::ThreadSafe> FRpcCancellation::AttachLinked(FGrpcClientContext& Context)
+{
+    const TSharedRef<FRpcCancellation, ESPMode::ThreadSafe> Cancellation = MakeShared<FRpcCancellation, ESPMode::ThreadSafe>(Context.Cancellation);
+    Context.Cancellation = Cancellation;
+
+    return Cancellation;
+}
+
+void FRpcCancellation::Cancel()
+{
+    if (bCancelled.Exchange(true))
+        return;
+
+    FScopeLock ScopeLock(&Lock);
+
+    // TryCancel() is thread safe, the call completes on the worker with the Cancelled status.
+    for (grpc::ClientContext* const ClientContext : ClientContexts)
+        ClientContext->TryCancel();
+}
+
+bool FRpcCancellation::BeginCall(grpc::ClientContext& ClientContext)
+{
+    // The parent is locked separately, so locks are never nested.
+    if (Parent.IsValid() && !Parent->BeginCall(ClientContext))
+        return false;
+
+    {
+        FScopeLock ScopeLock(&Lock);
+
+        if (!bCancelled.Load())
+        {
+            ClientContexts.Add(&ClientContext);
+            return true;
+        }
+    }
+
+    if (Parent.IsValid())
+        Parent->EndCall(ClientContext);
+
+    return false;
+}
+
+void FRpcCancellation::EndCall(grpc::ClientContext& ClientContext)
+{
+    {
+        FScopeLock ScopeLock(&Lock);
+        ClientContexts.RemoveSingleSwap(&ClientContext);
+    }
+
+    if (Parent.IsValid())
+        Parent->EndCall(ClientContext);
+}
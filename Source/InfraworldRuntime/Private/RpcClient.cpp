@@ -18,7 +18,9 @@
 #include "InfraworldRuntime.h"
 #include "RpcClientWorker.h"
 #include "GrpcUriValidator.h"
+#include "RpcTrace.h"
 
+#include "Async/Async.h"
 #include "Containers/Ticker.h"
 #include "Misc/CoreDelegates.h"
 
@@ -63,6 +65,7 @@ bool URpcClient::Init(const FString& URI, UChannelCredentials* ChannelCredential
             InnerWorker->ChannelCredentials = ChannelCredentials;
 
             InnerWorker->ErrorMessageQueue = &ErrorMessageQueue;
+            InnerWorker->GameThreadQueue = &GameThreadQueue;
 
             const FString ThreadName(FString::Printf(TEXT("RPC Client Thread %s %d"), *(GetClass()->GetName()), FMath::RandRange(0, TNumericLimits<int32>::Max())));
             Thread = FRunnableThread::Create(InnerWorker.Get(), *ThreadName);
@@ -76,10 +79,12 @@ bool URpcClient::Init(const FString& URI, UChannelCredentials* ChannelCredential
         }
     }
 
-    if (CanSendRequests())
+    if (bCanSendRequests)
     {
         TickDelegateHandle = FTicker::GetCoreTicker().AddTicker(FTickerDelegate::CreateLambda([this](float)
         {
+            RunGameThreadQueue();
+
             if (!ErrorMessageQueue.IsEmpty())
             {
                 FRpcError ReceivedError;
@@ -90,6 +95,7 @@ bool URpcClient::Init(const FString& URI, UChannelCredentials* ChannelCredential
             }
             else
             {
+                INFRAWORLD_TRACE_SCOPE("Infraworld.Dispatch", 0);
                 HierarchicalUpdate();
             }
 
@@ -106,6 +112,31 @@ URpcClient::URpcClient() : InnerWorker(nullptr), TickDelegateHandle()
 
 URpcClient::~URpcClient()
 {
+    // The worker is destroyed before the queue, so its remaining tasks complete their calls as cancelled and post
+    // continuations to the queue, which is still there.
+    InnerWorker.Reset();
+
+    if (IsInGameThread())
+    {
+        RunGameThreadQueue();
+    }
+    else
+    {
+        // Continuations must not run on the thread, the client is destroyed on, so they are handed over to the game thread.
+        TArray<TFunction<void()>> Functions;
+        for (TFunction<void()> Function; GameThreadQueue.Dequeue(Function); )
+            Functions.Add(MoveTemp(Function));
+
+        if (Functions.Num() > 0)
+        {
+            AsyncTask(ENamedThreads::GameThread, [Functions = MoveTemp(Functions)]()
+            {
+                for (const TFunction<void()>& Function : Functions)
+                    Function();
+            });
+        }
+    }
+
     UE_LOG(LogInfraworldRuntime, Verbose, TEXT("An instance of RPC Client has been destroyed. Still can send requests: %s"),
            *UKismetStringLibrary::Conv_BoolToString(CanSendRequests()));
 }
@@ -117,7 +148,30 @@ void URpcClient::Update()
 
 bool URpcClient::CanSendRequests() const
 {
-    return bCanSendRequests;
+    return bCanSendRequests && !(InnerWorker && InnerWorker->IsFailed());
+}
+
+FRpcClientMetricsSnapshot URpcClient::GetMetricsSnapshot() const
+{
+    FRpcClientMetricsSnapshot Snapshot;
+
+    if (InnerWorker)
+        InnerWorker->Metrics.GetSnapshot(Snapshot);
+
+    return Snapshot;
+}
+
+void URpcClient::RunGameThreadQueue()
+{
+    TFunction<void()> Function;
+    while (GameThreadQueue.Dequeue(Function))
+        Function();
+}
+
+void URpcClient::ResetMetrics()
+{
+    if (InnerWorker)
+        InnerWorker->Metrics.Reset();
 }
 
 URpcClient* URpcClient::CreateRpcClient(TSubclassOf<URpcClient> Class, FRpcClientInstantiationParameters InstantiationParameters, UObject* Outer)
@@ -155,8 +209,8 @@ URpcClient* URpcClient::CreateRpcClientUri(TSubclassOf<URpcClient> Class, const
 
 void URpcClient::BeginDestroy()
 {
-    // Being called when GC'ed, should be called synchronously.
-    if (CanSendRequests())
+    // Being called when GC'ed, should be called synchronously. A client, the worker of which has failed, is stopped too.
+    if (bCanSendRequests)
     {
         Stop(true);
     }
@@ -183,6 +237,10 @@ void URpcClient::Stop(bool bSynchronous)
         ThreadToStop = nullptr;
         
         FTicker::GetCoreTicker().RemoveTicker(TickDelegateHandle);
+
+        // Calls, cancelled by stopping, resume their continuations with a Cancelled status.
+        if (bSynchronous)
+            RunGameThreadQueue();
     }
     else
     {
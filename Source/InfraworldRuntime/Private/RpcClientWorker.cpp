@@ -17,8 +17,11 @@
 
 #include "InfraworldRuntime.h"
 
+#include "HAL/IConsoleManager.h"
+#include "HAL/PlatformProcess.h"
 #include "HAL/PlatformTime.h"
 #include "GenUtils.h"
+#include "RpcTrace.h"
 
 #include "GrpcIncludesBegin.h"
 
@@ -28,14 +31,49 @@
 #include "GrpcIncludesEnd.h"
 #include "WorkerUtils.h"
 
+static float GInfraworldReconnectInitialBackoff = 1.0f;
+
+static FAutoConsoleVariableRef CVarInfraworldReconnectInitialBackoff(
+    TEXT("infraworld.Reconnect.InitialBackoff"),
+    GInfraworldReconnectInitialBackoff,
+    TEXT("Delay in seconds before the second attempt of an RPC client to connect, further delays grow exponentially."),
+    ECVF_Default);
+
+static float GInfraworldReconnectMaxBackoff = 30.0f;
+
+static FAutoConsoleVariableRef CVarInfraworldReconnectMaxBackoff(
+    TEXT("infraworld.Reconnect.MaxBackoff"),
+    GInfraworldReconnectMaxBackoff,
+    TEXT("Maximal delay in seconds between attempts of an RPC client to connect."),
+    ECVF_Default);
+
+static int32 GInfraworldReconnectMaxAttempts = 0;
+
+static FAutoConsoleVariableRef CVarInfraworldReconnectMaxAttempts(
+    TEXT("infraworld.Reconnect.MaxAttempts"),
+    GInfraworldReconnectMaxAttempts,
+    TEXT("Number of attempts of an RPC client to connect, before its worker gives up and completes its requests as Unavailable. 0: unlimited (default)"),
+    ECVF_Default);
+
+// Same as gRPC's own connection backoff.
+static const double GInfraworldReconnectMultiplier = 1.6;
+static const double GInfraworldReconnectJitter = 0.2;
+
 // ========= RpcClientWorker implementation ========
 
-RpcClientWorker::RpcClientWorker() : WorkerState(ERpcWorkerState::PendingInitialization)
+RpcClientWorker::RpcClientWorker() :
+	WorkerState(ERpcWorkerState::PendingInitialization),
+	WakeEvent(FPlatformProcess::GetSynchEventFromPool(false))
 {
 }
 
 RpcClientWorker::~RpcClientWorker()
 {
+	// Tasks, posted after the worker has stopped (or if it has never been started), complete their calls as cancelled.
+	RunPendingTasks();
+
+	FPlatformProcess::ReturnSynchEventToPool(WakeEvent);
+	WakeEvent = nullptr;
 }
 
 uint32 RpcClientWorker::Run()
@@ -46,35 +84,117 @@ uint32 RpcClientWorker::Run()
 		return 2;
 	}
 	
-    if (HierarchicalInit())
+	// Requests, enqueued meanwhile, are kept in conduits and are sent once the worker is connected.
+	double Backoff = FMath::Max(GInfraworldReconnectInitialBackoff, 0.01f);
+
+	while (!HierarchicalInit())
 	{
-        UE_LOG(LogInfraworldRuntime, Log, TEXT("Finished initialization via HierarchicalInit!"));
+		// Not even a disconnected channel could be created.
+		if (WorkerState.Load() == ERpcWorkerState::Failed)
+			return 1;
+
+		FailedConnectionAttempts++;
 
-		ERpcWorkerState ExpectedState = ERpcWorkerState::Initializing;
+		if (WorkerState.Load() != ERpcWorkerState::Initializing)
+			return 1;
 
-    	// this will set WorkerState to Working only if no one overwrote it from Initializing
-    	if (!WorkerState.CompareExchange(ExpectedState, ERpcWorkerState::Working))
-    	{
-			UE_LOG(LogInfraworldRuntime, Log, TEXT("Worker already marked pending stopped. Its state is %d"), static_cast<int>(ExpectedState));
-    	}
+		if (GInfraworldReconnectMaxAttempts > 0 && FailedConnectionAttempts >= GInfraworldReconnectMaxAttempts)
+		{
+			UE_LOG(LogInfraworldRuntime, Error, TEXT("RpcClientWorker at [%p] gave up connecting to %s after %d attempts"), this, *URI, FailedConnectionAttempts);
+			DispatchError(FString::Printf(TEXT("Gave up connecting to %s after %d attempts"), *URI, FailedConnectionAttempts));
+
+			// Initialized once more, with a channel that is never connected, so that conduits are still drained and
+			// requests, queued in them, complete as Unavailable rather than waiting forever.
+			ERpcWorkerState ExpectedState = ERpcWorkerState::Initializing;
+			if (!WorkerState.CompareExchange(ExpectedState, ERpcWorkerState::Failed))
+				return 1;
+
+			continue;
+		}
+
+		// Jitter keeps clients, disconnected at once (e.g. by a server restart), from reconnecting in lockstep.
+		const double Delay = Backoff * (1.0 + GInfraworldReconnectJitter * (2.0 * FMath::FRand() - 1.0));
+		UE_LOG(LogInfraworldRuntime, Log, TEXT("RpcClientWorker at [%p] failed to connect to %s (attempt %d), retrying in %.2f s"),
+			this, *URI, FailedConnectionAttempts, Delay);
+
+		if (!WaitWhileInitializing(Delay))
+			return 1;
+
+		Backoff = FMath::Min(Backoff * GInfraworldReconnectMultiplier, static_cast<double>(FMath::Max(GInfraworldReconnectMaxBackoff, 0.01f)));
+	}
+
+	UE_LOG(LogInfraworldRuntime, Log, TEXT("Finished initialization via HierarchicalInit!"));
+
+	ERpcWorkerState ExpectedState = ERpcWorkerState::Initializing;
+
+	// this will set WorkerState to Working only if no one overwrote it from Initializing
+	if (WorkerState.CompareExchange(ExpectedState, ERpcWorkerState::Working))
+	{
+		FailedConnectionAttempts = 0;
+	}
+	else if (ExpectedState != ERpcWorkerState::Failed)
+	{
+		UE_LOG(LogInfraworldRuntime, Log, TEXT("Worker already marked pending stopped. Its state is %d"), static_cast<int>(ExpectedState));
 	}
-    else
-        return 1;
 
-    // Update until not pending stopped
-    while (WorkerState == ERpcWorkerState::Working)
+    // Update until not pending stopped. A failed worker is updated as well, completing requests as Unavailable.
+    while (WorkerState == ERpcWorkerState::Working || WorkerState == ERpcWorkerState::Failed)
     {
         UE_LOG(LogInfraworldRuntime, Verbose, TEXT("Updating via HierarchicalUpdate()"));
 
-        HierarchicalUpdate();
-        FPlatformProcess::Sleep(0.1f);
+        {
+            INFRAWORLD_TRACE_SCOPE("Infraworld.WorkerUpdate", 0);
+            RunPendingTasks();
+            HierarchicalUpdate();
+        }
+
+		// Conduits are still polled, but posted tasks are run right away.
+		WakeEvent->Wait(100);
     }
 
 	WorkerState.Exchange(ERpcWorkerState::Shutdown);
+	RunPendingTasks();
 
     return 0;
 }
 
+void RpcClientWorker::PostTask(TFunction<void(RpcClientWorker&)>&& Task)
+{
+	Tasks.Enqueue(MoveTemp(Task));
+	WakeEvent->Trigger();
+}
+
+void RpcClientWorker::PostToGameThread(TFunction<void()>&& Function)
+{
+	// The client outlives its worker, so the queue is there whenever a call could complete.
+	check(GameThreadQueue);
+	GameThreadQueue->Enqueue(MoveTemp(Function));
+}
+
+void RpcClientWorker::RunPendingTasks()
+{
+	TFunction<void(RpcClientWorker&)> Task;
+	while (Tasks.Dequeue(Task))
+		Task(*this);
+}
+
+bool RpcClientWorker::WaitWhileInitializing(double Seconds) const
+{
+	const double EndTime = FPlatformTime::Seconds() + Seconds;
+
+	while (WorkerState.Load() == ERpcWorkerState::Initializing)
+	{
+		const double Remaining = EndTime - FPlatformTime::Seconds();
+		if (Remaining <= 0.0)
+			return true;
+
+		// Short slices, so stopping the client isn't delayed by the backoff.
+		FPlatformProcess::Sleep(static_cast<float>(FMath::Min(Remaining, 0.05)));
+	}
+
+	return false;
+}
+
 void RpcClientWorker::DispatchError(const FString& ErrorMessage)
 {
     UE_CLOG(!ErrorMessageQueue, LogInfraworldRuntime, Fatal, TEXT("Can not dispatch an error message, because ErrorMessageQueue is null"));
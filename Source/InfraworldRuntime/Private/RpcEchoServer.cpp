@@ -0,0 +1,126 @@
+/*
+ * Copyright 2018 Vizor Games LLC
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS, WITHOUT
+ * WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.See the
+ * License for the specific language governing permissions and limitations
+ * under the License.
+ */
+#include "RpcEchoServer.h"
+
+#if !UE_BUILD_SHIPPING
+
+#include "InProcessServers.h"
+#include "InfraworldRuntime.h"
+
+#include "GrpcIncludesBegin.h"
+
+#include <grpcpp/security/server_credentials.h>
+#include <grpcpp/server_builder.h>
+
+#include "GrpcIncludesEnd.h"
+
+/// FRpcEchoServer interface
+
+FRpcEchoServer::~FRpcEchoServer()
+{
+    Shutdown();
+}
+
+bool FRpcEchoServer::Start(const FString& Address, int32 NumThreads, FString& OutTarget)
+{
+    int32 SelectedPort = 0;
+
+    const bool bInProcess = FGrpcInProcessServers::ParseUri(Address, InProcessName);
+
+    grpc::ServerBuilder Builder;
+    if (!bInProcess)
+        Builder.AddListeningPort(TCHAR_TO_ANSI(*Address), grpc::InsecureServerCredentials(), &SelectedPort);
+    Builder.RegisterAsyncGenericService(&Service);
+
+    Queue = Builder.AddCompletionQueue();
+    Server = Builder.BuildAndStart();
+
+    if (!Server || (!bInProcess && SelectedPort == 0))
+    {
+        UE_LOG(LogInfraworldRuntime, Error, TEXT("Unable to start an echo server on %s"), *Address);
+        InProcessName.Empty();
+        return false;
+    }
+
+    if (bInProcess)
+    {
+        if (!FGrpcInProcessServers::Register(InProcessName, Server.get()))
+        {
+            UE_LOG(LogInfraworldRuntime, Error, TEXT("Unable to register an in-process echo server as \"%s\""), *InProcessName);
+            InProcessName.Empty();
+            return false;
+        }
+
+        OutTarget = Address;
+    }
+    else if (Address.EndsWith(TEXT(":0")))
+    {
+        OutTarget = FString::Printf(TEXT("%s:%d"), *Address.LeftChop(2), SelectedPort);
+    }
+    else
+    {
+        OutTarget = Address;
+    }
+
+    // Calls are accepted one by one, a new one is requested whenever the previous has been accepted.
+    new FCall(*this);
+
+    for (int32 Index = 0; Index < FMath::Max(NumThreads, 1); Index++)
+        Threads.Add(FRunnableThread::Create(this, *FString::Printf(TEXT("RPC Echo Server Thread %d"), Index)));
+
+    return true;
+}
+
+void FRpcEchoServer::Shutdown()
+{
+    if (!Server)
+        return;
+
+    bShuttingDown = true;
+
+    if (!InProcessName.IsEmpty())
+    {
+        FGrpcInProcessServers::Unregister(InProcessName);
+        InProcessName.Empty();
+    }
+
+    // Calls in flight are cancelled, their tags are returned by the queue with bOk == false.
+    Server->Shutdown(std::chrono::system_clock::now());
+    Queue->Shutdown();
+
+    for (FRunnableThread* Thread : Threads)
+    {
+        Thread->WaitForCompletion();
+        delete Thread;
+    }
+
+    Threads.Empty();
+    Server.reset();
+    Queue.reset();
+}
+
+uint32 FRpcEchoServer::Run()
+{
+    void* Tag;
+    bool bOk;
+
+    while (Queue->Next(&Tag, &bOk))
+        static_cast<FCall*>(Tag)->Proceed(bOk);
+
+    return 0;
+}
+
+#endif
@@ -0,0 +1,166 @@
+/*
+ * Copyright 2018 Vizor Games LLC
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS, WITHOUT
+ * WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.See the
+ * License for the specific language governing permissions and limitations
+ * under the License.
+ */
+#pragma once
+
+#include "CoreMinimal.h"
+
+#if !UE_BUILD_SHIPPING
+
+#include "HAL/Runnable.h"
+#include "HAL/RunnableThread.h"
+#include "Templates/Atomic.h"
+
+#include "GrpcIncludesBegin.h"
+
+#include <grpcpp/generic/async_generic_service.h>
+#include <grpcpp/server.h>
+
+#include "GrpcIncludesEnd.h"
+
+/**
+ * A local server, which echoes any unary call back (or responds with an empty message, if it is a sink), or responds
+ * by a handler. Method names are not checked, so it serves URpcLoadTestClient as well as any other unary client.
+ */
+class FRpcEchoServer : public FRunnable
+{
+public:
+    /**
+     * Produces a response to a call. Is called on serving threads.
+     *
+     * @param Context Context of the call, its method and metadata.
+     * @param Buffer Holds the request on input, should be filled with the response on output.
+     * @return Status of the call, the response is not sent if it isn't OK.
+     */
+    typedef TFunction<grpc::Status(const grpc::GenericServerContext& Context, grpc::ByteBuffer& Buffer)> FHandler;
+
+    explicit FRpcEchoServer(bool bInSink) : bSink(bInSink), bShuttingDown(false)
+    {
+    }
+
+    explicit FRpcEchoServer(FHandler&& InHandler) : bSink(false), Handler(MoveTemp(InHandler)), bShuttingDown(false)
+    {
+    }
+
+    virtual ~FRpcEchoServer();
+
+    /**
+     * Starts listening and serving.
+     *
+     * @param Address Address to listen on, like "127.0.0.1:0" (the port is picked by the system then) or
+     *        "unix:<path>", or an "inproc:<Name>" URI to be registered as an in-process server only.
+     * @param NumThreads Number of threads, serving the completion queue.
+     * @param OutTarget URI, clients should connect to.
+     */
+    bool Start(const FString& Address, int32 NumThreads, FString& OutTarget);
+
+    /**
+     * Cancels all the calls and stops serving threads.
+     */
+    void Shutdown();
+
+    /// FRunnable interface
+    virtual uint32 Run() override;
+
+private:
+    /**
+     * State of a single call, is used as a tag of all of its operations.
+     */
+    class FCall
+    {
+    public:
+        FCall(FRpcEchoServer& InServer) : Server(InServer), Stream(&Context), State(EState::Accepting)
+        {
+            Server.Service.RequestCall(&Context, &Stream, Server.Queue.get(), Server.Queue.get(), this);
+        }
+
+        void Proceed(bool bOk)
+        {
+            switch (State)
+            {
+            case EState::Accepting:
+                if (!bOk)
+                {
+                    delete this;
+                    return;
+                }
+
+                // Accept the next call, while this one is being served.
+                if (!Server.bShuttingDown)
+                    new FCall(Server);
+
+                State = EState::Reading;
+                Stream.Read(&Buffer, this);
+                break;
+
+            case EState::Reading:
+                State = EState::Finishing;
+
+                if (!bOk)
+                {
+                    Stream.Finish(grpc::Status(grpc::StatusCode::INVALID_ARGUMENT, "No request has been received"), this);
+                }
+                else if (Server.Handler)
+                {
+                    const grpc::Status Status = Server.Handler(Context, Buffer);
+
+                    if (Status.ok())
+                        Stream.WriteAndFinish(Buffer, grpc::WriteOptions(), Status, this);
+                    else
+                        Stream.Finish(Status, this);
+                }
+                else
+                {
+                    if (Server.bSink)
+                        Buffer.Clear();
+
+                    Stream.WriteAndFinish(Buffer, grpc::WriteOptions(), grpc::Status::OK, this);
+                }
+                break;
+
+            case EState::Finishing:
+                delete this;
+                break;
+            }
+        }
+
+    private:
+        enum class EState : uint8
+        {
+            Accepting,
+            Reading,
+            Finishing
+        };
+
+        FRpcEchoServer& Server;
+        grpc::GenericServerContext Context;
+        grpc::GenericServerAsyncReaderWriter Stream;
+        grpc::ByteBuffer Buffer;
+        EState State;
+    };
+
+    const bool bSink;
+    const FHandler Handler;
+    TAtomic<bool> bShuttingDown;
+
+    grpc::AsyncGenericService Service;
+    std::unique_ptr<grpc::ServerCompletionQueue> Queue;
+    std::unique_ptr<grpc::Server> Server;
+    FString InProcessName;
+
+    TArray<FRunnableThread*> Threads;
+};
+
+#endif
@@ -0,0 +1,75 @@
+/*
+ * Copyright 2018 Vizor Games LLC
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS, WITHOUT
+ * WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.See the
+ * License for the specific language governing permissions and limitations
+ * under the License.
+ */
+#pragma once
+
+#include "CoreMinimal.h"
+#include "CastUtils.h"
+
+#include "GrpcIncludesBegin.h"
+
+#include <google/protobuf/wrappers.pb.h>
+#include <grpcpp/impl/codegen/async_unary_call.h>
+#include <grpcpp/impl/codegen/proto_utils.h>
+#include <grpcpp/impl/codegen/rpc_method.h>
+
+#include "GrpcIncludesEnd.h"
+
+// Payloads are sent as google.protobuf.BytesValue, so no generated code is needed.
+namespace casts
+{
+    template <>
+    FORCEINLINE google::protobuf::BytesValue Proto_Cast(const FByteArray& Item)
+    {
+        // mutable_value() allocates a string, even if the payload is empty.
+        google::protobuf::BytesValue OutItem;
+        if (Item.Bytes.Num() > 0)
+            Proto_BytesAssign(Item, OutItem.mutable_value());
+
+        return OutItem;
+    }
+
+    template <>
+    FORCEINLINE FByteArray Proto_Cast(const google::protobuf::BytesValue& Item)
+    {
+        return Proto_Cast<FByteArray>(Item.value());
+    }
+}
+
+/**
+ * A stub of the echo service, as it would have been generated from:
+ *
+ *     service LoadTest { rpc Echo(google.protobuf.BytesValue) returns (google.protobuf.BytesValue); }
+ */
+class FRpcEchoStub
+{
+public:
+    explicit FRpcEchoStub(const std::shared_ptr<grpc::ChannelInterface>& InChannel) :
+        Channel(InChannel),
+        EchoMethod("/infraworld.LoadTest/Echo", grpc::internal::RpcMethod::NORMAL_RPC, InChannel)
+    {
+    }
+
+    std::unique_ptr<grpc::ClientAsyncResponseReader<google::protobuf::BytesValue>> AsyncEcho(grpc::ClientContext* Context,
+        const google::protobuf::BytesValue& Request, grpc::CompletionQueue* Queue)
+    {
+        return std::unique_ptr<grpc::ClientAsyncResponseReader<google::protobuf::BytesValue>>(
+            ::grpc_impl::internal::ClientAsyncResponseReaderFactory<google::protobuf::BytesValue>::Create(Channel.get(), Queue, EchoMethod, Context, Request, true));
+    }
+
+private:
+    std::shared_ptr<grpc::ChannelInterface> Channel;
+    const grpc::internal::RpcMethod EchoMethod;
+};
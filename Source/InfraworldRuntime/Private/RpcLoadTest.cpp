@@ -0,0 +1,429 @@
+/*
+ * Copyright 2018 Vizor Games LLC
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS, WITHOUT
+ * WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.See the
+ * License for the specific language governing permissions and limitations
+ * under the License.
+ */
+#include "RpcLoadTest.h"
+
+#if !UE_BUILD_SHIPPING
+
+#include "InProcessServers.h"
+#include "InfraworldRuntime.h"
+#include "RpcAllocationCounter.h"
+#include "RpcEchoServer.h"
+#include "RpcLoadTestClient.h"
+#include "RpcTrace.h"
+
+#include "Containers/Ticker.h"
+#include "HAL/IConsoleManager.h"
+#include "HAL/PlatformProcess.h"
+#include "HAL/PlatformTime.h"
+#include "Misc/DateTime.h"
+#include "Misc/FileHelper.h"
+#include "Misc/Parse.h"
+#include "Misc/Paths.h"
+#include "UObject/Package.h"
+
+#include <ctime>
+
+/**
+ * State of a running load test, kept alive by its ticker.
+ */
+class FRpcLoadTest_Internal
+{
+public:
+    FRpcLoadTest_Internal(const FRpcLoadTestSettings& InSettings, TFunction<void(const FRpcLoadTestReport&)>&& InOnFinished) :
+        Settings(InSettings),
+        OnFinished(MoveTemp(InOnFinished)),
+        EchoServer(InSettings.bSink)
+    {
+        Payload.Bytes.SetNumUninitialized(FMath::Max(Settings.PayloadSize, 0));
+        for (int32 Index = 0; Index < Payload.Bytes.Num(); Index++)
+            Payload.Bytes[Index] = static_cast<uint8>(Index * 131);
+    }
+
+    bool Start();
+
+    /**
+     * Moves the test through its phases: warmup, measurement, draining requests in flight and finishing.
+     *
+     * @return False once the test is over.
+     */
+    bool Tick();
+
+    static void RunFromConsole(const TArray<FString>& Args);
+
+private:
+    enum class EPhase : uint8
+    {
+        Warmup,
+        Measurement,
+        Draining
+    };
+
+    void Send(URpcLoadTestClient* Client);
+    void OnResponse(URpcLoadTestClient* Client, const TResponseWithStatus<FByteArray>& Response);
+
+    void BeginMeasurement(double Now);
+    void EndMeasurement(double Now);
+    void Finish();
+
+    FRpcLoadTestSettings Settings;
+    TFunction<void(const FRpcLoadTestReport&)> OnFinished;
+
+    FRpcEchoServer EchoServer;
+    UChannelCredentials* Credentials = nullptr;
+    TArray<URpcLoadTestClient*> Clients;
+
+    FByteArray Payload;
+    EPhase Phase = EPhase::Warmup;
+    double PhaseEndTime = 0.0;
+
+    /** Send times of requests in flight by their correlation ids. */
+    TMap<uint64, double> SendTimes;
+
+    FRpcLatencyHistogram Latency;
+    int64 Requests = 0;
+    int64 Errors = 0;
+
+    double MeasurementStartTime = 0.0;
+    std::clock_t MeasurementStartClock = 0;
+    uint64 MeasurementStartAllocations = 0;
+
+    FRpcLoadTestReport Report;
+};
+
+
+/// FRpcLoadTest_Internal interface
+
+bool FRpcLoadTest_Internal::Start()
+{
+    const FString Address = FRpcLoadTest::GetServerAddress(Settings.Transport, TEXT("LoadTest"));
+    if (Address.IsEmpty())
+        return false;
+
+    FString Target;
+    if (!EchoServer.Start(Address, Settings.NumServerThreads, Target))
+        return false;
+
+    UE_LOG(LogInfraworldRuntime, Display, TEXT("Load test: %d clients x %d requests of %d bytes in flight against %s"),
+        Settings.NumClients, Settings.Concurrency, Settings.PayloadSize, *Target);
+
+    // Nothing else references the objects, so they're kept from being garbage collected until the test is over.
+    Credentials = NewObject<UInsecureChannelCredentials>(GetTransientPackage());
+    Credentials->AddToRoot();
+
+    for (int32 Index = 0; Index < Settings.NumClients; Index++)
+    {
+        URpcLoadTestClient* const Client = NewRpcClient<URpcLoadTestClient>(Target, Credentials);
+        if (!Client)
+        {
+            Finish();
+            return false;
+        }
+
+        Client->AddToRoot();
+        Client->OnEcho = [this, Client](const TResponseWithStatus<FByteArray>& Response)
+        {
+            OnResponse(Client, Response);
+        };
+
+        Clients.Add(Client);
+    }
+
+    for (URpcLoadTestClient* const Client : Clients)
+    {
+        for (int32 Index = 0; Index < Settings.Concurrency; Index++)
+            Send(Client);
+    }
+
+    PhaseEndTime = FPlatformTime::Seconds() + Settings.WarmupSeconds;
+    return true;
+}
+
+bool FRpcLoadTest_Internal::Tick()
+{
+    const double Now = FPlatformTime::Seconds();
+
+    switch (Phase)
+    {
+    case EPhase::Warmup:
+        if (Now >= PhaseEndTime)
+            BeginMeasurement(Now);
+        break;
+
+    case EPhase::Measurement:
+        if (Now >= PhaseEndTime)
+            EndMeasurement(Now);
+        break;
+
+    case EPhase::Draining:
+        // Calls, that got stuck, are cancelled by stopping the clients.
+        if (SendTimes.Num() == 0 || Now >= PhaseEndTime)
+        {
+            Finish();
+            return false;
+        }
+        break;
+    }
+
+    return true;
+}
+
+void FRpcLoadTest_Internal::Send(URpcLoadTestClient* Client)
+{
+    // The correlation id is assigned here (and not by the conduit), so the response could be matched.
+    FGrpcClientContext Context;
+    Context.CorrelationId = FRpcTrace::NextCorrelationId();
+
+    SendTimes.Add(Context.CorrelationId, FPlatformTime::Seconds());
+    Client->Echo(Payload, Context);
+}
+
+void FRpcLoadTest_Internal::OnResponse(URpcLoadTestClient* Client, const TResponseWithStatus<FByteArray>& Response)
+{
+    double SendTime;
+    if (!SendTimes.RemoveAndCopyValue(Response.CorrelationId, SendTime))
+        return;
+
+    if (Phase == EPhase::Measurement)
+    {
+        Latency.Record(FPlatformTime::Seconds() - SendTime);
+        Requests++;
+
+        if (Response.Status.ErrorCode != EGrpcStatusCode::Ok)
+            Errors++;
+    }
+
+    if (Phase != EPhase::Draining)
+        Send(Client);
+}
+
+void FRpcLoadTest_Internal::BeginMeasurement(double Now)
+{
+    Phase = EPhase::Measurement;
+    PhaseEndTime = Now + Settings.DurationSeconds;
+
+    FRpcAllocationCounter::Begin();
+
+    MeasurementStartTime = Now;
+    MeasurementStartClock = std::clock();
+    MeasurementStartAllocations = FRpcAllocationCounter::GetNumAllocations();
+}
+
+void FRpcLoadTest_Internal::EndMeasurement(double Now)
+{
+    const uint64 Allocations = FRpcAllocationCounter::GetNumAllocations() - MeasurementStartAllocations;
+    FRpcAllocationCounter::End();
+
+    // Note that std::clock() is process CPU time on POSIX systems, but is wall time on Windows.
+    const double CpuSeconds = static_cast<double>(std::clock() - MeasurementStartClock) / CLOCKS_PER_SEC;
+
+    Phase = EPhase::Draining;
+    PhaseEndTime = Now + 5.0;
+
+    Report.Settings = Settings;
+    Report.bSucceeded = true;
+    Report.Requests = Requests;
+    Report.Errors = Errors;
+    Report.Seconds = Now - MeasurementStartTime;
+    Report.RequestsPerSecond = Requests / FMath::Max(Report.Seconds, 0.001);
+    Latency.GetSnapshot(Report.Latency);
+
+    if (Requests > 0)
+    {
+        Report.CpuMicrosecondsPerRequest = CpuSeconds * 1000000.0 / Requests;
+        Report.AllocationsPerRequest = static_cast<double>(Allocations) / Requests;
+    }
+}
+
+void FRpcLoadTest_Internal::Finish()
+{
+    for (URpcLoadTestClient* const Client : Clients)
+    {
+        Client->OnEcho = nullptr;
+
+        if (Client->CanSendRequests())
+            Client->Stop(true);
+
+        Client->RemoveFromRoot();
+    }
+
+    Clients.Empty();
+    SendTimes.Empty();
+
+    if (Credentials)
+    {
+        Credentials->RemoveFromRoot();
+        Credentials = nullptr;
+    }
+
+    EchoServer.Shutdown();
+
+    if (Report.bSucceeded && OnFinished)
+        OnFinished(Report);
+}
+
+void FRpcLoadTest_Internal::RunFromConsole(const TArray<FString>& Args)
+{
+    const FString CommandLine = FString::Join(Args, TEXT(" "));
+
+    FRpcLoadTestSettings Settings;
+    FParse::Value(*CommandLine, TEXT("Clients="), Settings.NumClients);
+    FParse::Value(*CommandLine, TEXT("Concurrency="), Settings.Concurrency);
+    FParse::Value(*CommandLine, TEXT("Payload="), Settings.PayloadSize);
+    FParse::Value(*CommandLine, TEXT("Warmup="), Settings.WarmupSeconds);
+    FParse::Value(*CommandLine, TEXT("Duration="), Settings.DurationSeconds);
+    FParse::Value(*CommandLine, TEXT("ServerThreads="), Settings.NumServerThreads);
+    Settings.bSink = FParse::Param(*CommandLine, TEXT("Sink"));
+
+    FString Transport;
+    if (FParse::Value(*CommandLine, TEXT("Transport="), Transport) && !FRpcLoadTest::ParseTransport(Transport, Settings.Transport))
+        return;
+
+    FString OutPath = FPaths::ProfilingDir() / TEXT("Infraworld") / FString::Printf(TEXT("LoadTest-%s.json"), *FDateTime::Now().ToString());
+    FParse::Value(*CommandLine, TEXT("Out="), OutPath);
+
+    const bool bQuit = FParse::Param(*CommandLine, TEXT("Quit"));
+
+    const bool bStarted = FRpcLoadTest::Start(Settings, [OutPath, bQuit](const FRpcLoadTestReport& Report)
+    {
+        UE_LOG(LogInfraworldRuntime, Display, TEXT("Load test: %.0f req/s, p50 %.3f ms, p99 %.3f ms, p999 %.3f ms, %.1f us CPU/req, %.1f allocs/req, %lld errors"),
+            Report.RequestsPerSecond, Report.Latency.P50Ms, Report.Latency.P99Ms, Report.Latency.P999Ms,
+            Report.CpuMicrosecondsPerRequest, Report.AllocationsPerRequest, Report.Errors);
+
+        if (FFileHelper::SaveStringToFile(Report.ToJson(), *OutPath, FFileHelper::EEncodingOptions::ForceUTF8WithoutBOM))
+            UE_LOG(LogInfraworldRuntime, Display, TEXT("Load test results have been written to %s"), *OutPath);
+        else
+            UE_LOG(LogInfraworldRuntime, Error, TEXT("Can't write load test results to %s"), *OutPath);
+
+        if (bQuit)
+            FPlatformMisc::RequestExit(false);
+    });
+
+    if (!bStarted)
+    {
+        UE_LOG(LogInfraworldRuntime, Error, TEXT("Unable to start a load test"));
+
+        if (bQuit)
+            FPlatformMisc::RequestExit(false);
+    }
+}
+
+static FAutoConsoleCommand CmdInfraworldLoadTest(
+    TEXT("infraworld.LoadTest"),
+    TEXT("Loads a local echo gRPC server through RPC clients and writes throughput and latency as JSON.\n")
+    TEXT("Usage: infraworld.LoadTest [-Clients=4] [-Concurrency=8] [-Payload=256] [-Warmup=1] [-Duration=10] [-ServerThreads=2] [-Sink] [-Transport=Tcp|Unix|InProcess] [-Out=Path.json] [-Quit]"),
+    FConsoleCommandWithArgsDelegate::CreateStatic(&FRpcLoadTest_Internal::RunFromConsole));
+
+
+/// FRpcLoadTestReport interface
+
+FString FRpcLoadTestReport::ToJson() const
+{
+    FString Json = TEXT("{\n");
+
+    Json += FString::Printf(TEXT("  \"clients\": %d,\n"), Settings.NumClients);
+    Json += FString::Printf(TEXT("  \"concurrency\": %d,\n"), Settings.Concurrency);
+    Json += FString::Printf(TEXT("  \"payload_bytes\": %d,\n"), Settings.PayloadSize);
+    Json += FString::Printf(TEXT("  \"server_threads\": %d,\n"), Settings.NumServerThreads);
+    Json += FString::Printf(TEXT("  \"sink\": %s,\n"), Settings.bSink ? TEXT("true") : TEXT("false"));
+    Json += FString::Printf(TEXT("  \"transport\": \"%s\",\n"), FRpcLoadTest::GetTransportName(Settings.Transport));
+    Json += FString::Printf(TEXT("  \"seconds\": %.3f,\n"), Seconds);
+    Json += FString::Printf(TEXT("  \"requests\": %lld,\n"), Requests);
+    Json += FString::Printf(TEXT("  \"errors\": %lld,\n"), Errors);
+    Json += FString::Printf(TEXT("  \"requests_per_second\": %.1f,\n"), RequestsPerSecond);
+    Json += FString::Printf(TEXT("  \"latency_ms\": { \"mean\": %.3f, \"p50\": %.3f, \"p90\": %.3f, \"p99\": %.3f, \"p999\": %.3f, \"max\": %.3f },\n"),
+        Latency.MeanMs, Latency.P50Ms, Latency.P90Ms, Latency.P99Ms, Latency.P999Ms, Latency.MaxMs);
+    Json += FString::Printf(TEXT("  \"cpu_us_per_request\": %.2f,\n"), CpuMicrosecondsPerRequest);
+    Json += FString::Printf(TEXT("  \"allocations_per_request\": %.2f\n"), AllocationsPerRequest);
+
+    Json += TEXT("}\n");
+    return Json;
+}
+
+
+/// FRpcLoadTest interface
+
+bool FRpcLoadTest::Start(const FRpcLoadTestSettings& Settings, TFunction<void(const FRpcLoadTestReport&)> OnFinished)
+{
+    check(IsInGameThread());
+
+    TSharedRef<FRpcLoadTest_Internal> LoadTest = MakeShared<FRpcLoadTest_Internal>(Settings, MoveTemp(OnFinished));
+    if (!LoadTest->Start())
+        return false;
+
+    // The ticker owns the test, it is destroyed once the test is over.
+    FTicker::GetCoreTicker().AddTicker(FTickerDelegate::CreateLambda([LoadTest](float)
+    {
+        return LoadTest->Tick();
+    }));
+
+    return true;
+}
+
+bool FRpcLoadTest::ParseTransport(const FString& Name, ERpcLoadTestTransport& OutTransport)
+{
+    if (Name == TEXT("Tcp"))
+        OutTransport = ERpcLoadTestTransport::Tcp;
+    else if (Name == TEXT("Unix"))
+        OutTransport = ERpcLoadTestTransport::UnixSocket;
+    else if (Name == TEXT("InProcess"))
+        OutTransport = ERpcLoadTestTransport::InProcess;
+    else
+    {
+        UE_LOG(LogInfraworldRuntime, Error, TEXT("Unknown transport \"%s\", expected Tcp, Unix or InProcess"), *Name);
+        return false;
+    }
+
+    return true;
+}
+
+const TCHAR* FRpcLoadTest::GetTransportName(ERpcLoadTestTransport Transport)
+{
+    switch (Transport)
+    {
+    case ERpcLoadTestTransport::InProcess:
+        return TEXT("inproc");
+
+    case ERpcLoadTestTransport::UnixSocket:
+        return TEXT("unix");
+
+    default:
+        return TEXT("tcp");
+    }
+}
+
+FString FRpcLoadTest::GetServerAddress(ERpcLoadTestTransport Transport, const FString& ServerName)
+{
+    switch (Transport)
+    {
+    case ERpcLoadTestTransport::InProcess:
+        return FString(FGrpcInProcessServers::UriPrefix) + TEXT("Infraworld") + ServerName;
+
+    case ERpcLoadTestTransport::UnixSocket:
+#if PLATFORM_WINDOWS
+        UE_LOG(LogInfraworldRuntime, Error, TEXT("Unix domain sockets are not supported on this platform"));
+        return FString();
+#else
+        // A stale socket file (left by a crashed run) is removed by gRPC before binding.
+        return FString(TEXT("unix:")) + FPaths::Combine(FPlatformProcess::UserTempDir(),
+            FString::Printf(TEXT("infraworld-%s-%u.sock"), *ServerName.ToLower(), FPlatformProcess::GetCurrentProcessId()));
+#endif
+
+    default:
+        return TEXT("127.0.0.1:0");
+    }
+}
+
+#endif
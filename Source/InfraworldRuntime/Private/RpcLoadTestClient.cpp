@@ -0,0 +1,116 @@
+/*
+ * Copyright 2018 Vizor Games LLC
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS, WITHOUT
+ * WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.See the
+ * License for the specific language governing permissions and limitations
+ * under the License.
+ */
+#include "RpcLoadTestClient.h"
+
+#include "RpcEchoStub.h"
+#include "WorkerUtils.h"
+
+class RpcLoadTestClientWorker : public TStubbedRpcWorker<FRpcEchoStub>
+{
+public:
+    TConduit<TRequestWithContext<FByteArray>, TResponseWithStatus<FByteArray>>* EchoConduit = nullptr;
+    TConduit<TRequestWithContext<FRpcRawCall>, TResponseWithStatus<FByteArray>>* ReplayConduit = nullptr;
+
+    virtual bool HierarchicalInit() override
+    {
+        if (!channel::CreateChannel(this))
+            return false;
+
+        Stub = std::unique_ptr<FRpcEchoStub>(new FRpcEchoStub(Channel));
+        EchoConduit->AcquireResponsesProducer();
+        ReplayConduit->AcquireResponsesProducer();
+
+        return true;
+    }
+
+    virtual void HierarchicalUpdate() override
+    {
+        if (!EchoConduit->IsEmpty())
+        {
+            TRequestWithContext<FByteArray> RequestWithContext;
+            while (EchoConduit->Dequeue(RequestWithContext))
+            {
+                EchoConduit->Enqueue(AsyncRequest<FByteArray, google::protobuf::BytesValue, FByteArray, google::protobuf::BytesValue>(
+                    RequestWithContext.Request, RequestWithContext.Context, &FRpcEchoStub::AsyncEcho));
+            }
+        }
+
+        if (!ReplayConduit->IsEmpty())
+        {
+            TRequestWithContext<FRpcRawCall> RequestWithContext;
+            while (ReplayConduit->Dequeue(RequestWithContext))
+            {
+                ReplayConduit->Enqueue(AsyncBytesRequest(RequestWithContext.Request.Request, RequestWithContext.Context,
+                    RequestWithContext.Request.MethodPath.c_str()));
+            }
+        }
+    }
+};
+
+
+/// URpcLoadTestClient interface
+
+void URpcLoadTestClient::HierarchicalInit()
+{
+    RpcLoadTestClientWorker* const Worker = new RpcLoadTestClientWorker();
+    Worker->EchoConduit = &EchoConduit;
+    Worker->ReplayConduit = &ReplayConduit;
+
+    InnerWorker = TUniquePtr<RpcClientWorker>(Worker);
+    EchoConduit.AcquireRequestsProducer();
+    ReplayConduit.AcquireRequestsProducer();
+}
+
+void URpcLoadTestClient::HierarchicalUpdate()
+{
+    if (!EchoConduit.IsEmpty())
+    {
+        TResponseWithStatus<FByteArray> ResponseWithStatus;
+        while (EchoConduit.Dequeue(ResponseWithStatus))
+        {
+            if (OnEcho)
+                OnEcho(ResponseWithStatus);
+        }
+    }
+
+    if (!ReplayConduit.IsEmpty())
+    {
+        TResponseWithStatus<FByteArray> ResponseWithStatus;
+        while (ReplayConduit.Dequeue(ResponseWithStatus))
+        {
+            if (OnReplay)
+                OnReplay(ResponseWithStatus);
+        }
+    }
+}
+
+bool URpcLoadTestClient::Echo(const FByteArray& Request, const FGrpcClientContext& Context)
+{
+    if (!CanSendRequests())
+        return false;
+
+    EchoConduit.Enqueue(TRequestWithContext$New(Request, Context));
+    return true;
+}
+
+bool URpcLoadTestClient::Replay(const FRpcRawCall& Call, const FGrpcClientContext& Context)
+{
+    if (!CanSendRequests())
+        return false;
+
+    ReplayConduit.Enqueue(TRequestWithContext$New(Call, Context));
+    return true;
+}
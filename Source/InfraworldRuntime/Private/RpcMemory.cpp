@@ -0,0 +1,223 @@
+/*
+ * Copyright 2018 Vizor Games LLC
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS, WITHOUT
+ * WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.See the
+ * License for the specific language governing permissions and limitations
+ * under the License.
+ */
+#include "RpcMemory.h"
+
+#include "InfraworldRuntime.h"
+#include "InfraworldStats.h"
+#include "RpcAllocationCounter.h"
+
+#include "HAL/LowLevelMemTracker.h"
+#include "HAL/UnrealMemory.h"
+
+#include <stdlib.h>
+
+#include "GrpcIncludesBegin.h"
+
+#include <grpc/support/alloc.h>
+
+#include "GrpcIncludesEnd.h"
+
+class FRpcMemory_Internal
+{
+public:
+    // Blocks of gRPC core are prefixed by their sizes, so they could be accounted when being freed or reallocated.
+    // The header keeps the alignment, that gpr_malloc() guarantees.
+    static constexpr SIZE_T HeaderSize = 16;
+
+    struct FBlockHeader
+    {
+        SIZE_T Size;
+
+        /** TagSeed, mixed with the address of the block, tells blocks of these functions from the C runtime ones. */
+        UPTRINT Tag;
+    };
+
+    static_assert(sizeof(FBlockHeader) <= HeaderSize, "The header of a block doesn't fit");
+
+    static constexpr UPTRINT TagSeed = static_cast<UPTRINT>(0x9e3779b97f4a7c15ull);
+
+    /** Memory of gRPC core and protobuf arenas isn't counted by FRpcAllocationCounter, see its description. */
+    struct FUncountedScope
+    {
+#if !UE_BUILD_SHIPPING
+        FUncountedScope()
+        {
+            FRpcAllocationCounter::Pause();
+        }
+
+        ~FUncountedScope()
+        {
+            FRpcAllocationCounter::Resume();
+        }
+#else
+        FUncountedScope()
+        {
+        }
+#endif
+    };
+
+    static void* GrpcMalloc(size_t Size);
+    static void* GrpcZalloc(size_t Size);
+    static void* GrpcRealloc(void* Ptr, size_t Size);
+    static void GrpcFree(void* Ptr);
+
+    /**
+     * @return Header of a block, allocated by GrpcMalloc(), or null for blocks, allocated by the C runtime before the
+     *         functions have been installed. The C runtime keeps its own header in front of every block, so reading
+     *         the header of such a block is safe.
+     */
+    static FBlockHeader* FindHeader(void* Ptr);
+
+    static void* WriteHeader(void* Block, SIZE_T Size);
+
+    static void* ArenaBlockAlloc(size_t Size);
+    static void ArenaBlockDealloc(void* Ptr, size_t Size);
+
+    static google::protobuf::ArenaOptions MakeArenaOptions();
+};
+
+/**
+ * Installs the allocation functions of gRPC core when the module's binary is loaded, before any code of the module
+ * (gRPC is linked into it) runs.
+ */
+static struct FRpcGrpcAllocatorInstaller
+{
+    FRpcGrpcAllocatorInstaller()
+    {
+        FRpcMemory::InstallGrpcAllocator();
+    }
+} GRpcGrpcAllocatorInstaller;
+
+
+/// FRpcMemory_Internal interface
+
+void* FRpcMemory_Internal::GrpcMalloc(size_t Size)
+{
+    LLM_SCOPE(ELLMTag::Networking);
+    const FUncountedScope UncountedScope;
+
+    INC_MEMORY_STAT_BY(STAT_InfraworldGrpcMemory, Size);
+    return WriteHeader(FMemory::Malloc(Size + HeaderSize, HeaderSize), Size);
+}
+
+void* FRpcMemory_Internal::GrpcZalloc(size_t Size)
+{
+    void* const Ptr = GrpcMalloc(Size);
+    FMemory::Memzero(Ptr, Size);
+
+    return Ptr;
+}
+
+void* FRpcMemory_Internal::GrpcRealloc(void* Ptr, size_t Size)
+{
+    if (!Ptr)
+        return GrpcMalloc(Size);
+
+    FBlockHeader* const OldHeader = FindHeader(Ptr);
+    if (!OldHeader)
+        return realloc(Ptr, Size);
+
+    LLM_SCOPE(ELLMTag::Networking);
+    const FUncountedScope UncountedScope;
+
+    const SIZE_T OldSize = OldHeader->Size;
+
+    // The header makes the size non-zero, so the block is never freed by FMemory::Realloc().
+    void* const Block = FMemory::Realloc(OldHeader, Size + HeaderSize, HeaderSize);
+
+    DEC_MEMORY_STAT_BY(STAT_InfraworldGrpcMemory, OldSize);
+    INC_MEMORY_STAT_BY(STAT_InfraworldGrpcMemory, Size);
+    return WriteHeader(Block, Size);
+}
+
+void FRpcMemory_Internal::GrpcFree(void* Ptr)
+{
+    if (!Ptr)
+        return;
+
+    FBlockHeader* const Header = FindHeader(Ptr);
+    if (!Header)
+    {
+        free(Ptr);
+        return;
+    }
+
+    DEC_MEMORY_STAT_BY(STAT_InfraworldGrpcMemory, Header->Size);
+
+    // A stale tag could be mistaken for a live one, if the memory is reused by the C runtime.
+    Header->Tag = 0;
+    FMemory::Free(Header);
+}
+
+FRpcMemory_Internal::FBlockHeader* FRpcMemory_Internal::FindHeader(void* Ptr)
+{
+    FBlockHeader* const Header = reinterpret_cast<FBlockHeader*>(static_cast<uint8*>(Ptr) - HeaderSize);
+    return (Header->Tag == (TagSeed ^ reinterpret_cast<UPTRINT>(Header))) ? Header : nullptr;
+}
+
+void* FRpcMemory_Internal::WriteHeader(void* Block, SIZE_T Size)
+{
+    FBlockHeader* const Header = static_cast<FBlockHeader*>(Block);
+    Header->Size = Size;
+    Header->Tag = TagSeed ^ reinterpret_cast<UPTRINT>(Header);
+
+    return static_cast<uint8*>(Block) + HeaderSize;
+}
+
+void* FRpcMemory_Internal::ArenaBlockAlloc(size_t Size)
+{
+    LLM_SCOPE(ELLMTag::Networking);
+    const FUncountedScope UncountedScope;
+
+    INC_MEMORY_STAT_BY(STAT_InfraworldArenaMemory, Size);
+    return FMemory::Malloc(Size);
+}
+
+void FRpcMemory_Internal::ArenaBlockDealloc(void* Ptr, size_t Size)
+{
+    DEC_MEMORY_STAT_BY(STAT_InfraworldArenaMemory, Size);
+    FMemory::Free(Ptr);
+}
+
+google::protobuf::ArenaOptions FRpcMemory_Internal::MakeArenaOptions()
+{
+    google::protobuf::ArenaOptions Options;
+    Options.block_alloc = &ArenaBlockAlloc;
+    Options.block_dealloc = &ArenaBlockDealloc;
+
+    return Options;
+}
+
+
+/// FRpcMemory interface
+
+void FRpcMemory::InstallGrpcAllocator()
+{
+    // Blocks, that gRPC has allocated before, are recognized by the functions and are left to the C runtime.
+    gpr_allocation_functions Functions;
+    Functions.malloc_fn = &FRpcMemory_Internal::GrpcMalloc;
+    Functions.zalloc_fn = &FRpcMemory_Internal::GrpcZalloc;
+    Functions.realloc_fn = &FRpcMemory_Internal::GrpcRealloc;
+    Functions.free_fn = &FRpcMemory_Internal::GrpcFree;
+
+    gpr_set_allocation_functions(Functions);
+}
+
+const google::protobuf::ArenaOptions& FRpcMemory::GetArenaOptions()
+{
+    static const google::protobuf::ArenaOptions Options = FRpcMemory_Internal::MakeArenaOptions();
+    return Options;
+}
@@ -0,0 +1,88 @@
+/*
+ * Copyright 2018 Vizor Games LLC
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS, WITHOUT
+ * WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.See the
+ * License for the specific language governing permissions and limitations
+ * under the License.
+ */
+#include "RpcMethodId.h"
+
+#include "Misc/ScopeLock.h"
+
+#include "GrpcIncludesBegin.h"
+
+#include <google/protobuf/descriptor.h>
+
+#include "GrpcIncludesEnd.h"
+
+class FRpcMethodId_Internal
+{
+public:
+    static FCriticalSection Lock;
+    static TArray<FString> Names;
+};
+
+FCriticalSection FRpcMethodId_Internal::Lock;
+TArray<FString> FRpcMethodId_Internal::Names;
+
+
+/// FRpcMethodId interface
+
+FRpcMethodId FRpcMethodId::Register(const FString& Name)
+{
+    FScopeLock ScopeLock(&FRpcMethodId_Internal::Lock);
+
+    FRpcMethodId Id;
+    Id.Index = FRpcMethodId_Internal::Names.Find(Name);
+
+    if (Id.Index == INDEX_NONE)
+        Id.Index = FRpcMethodId_Internal::Names.Add(Name);
+
+    return Id;
+}
+
+FString FRpcMethodId::GetName(FRpcMethodId Id)
+{
+    FScopeLock ScopeLock(&FRpcMethodId_Internal::Lock);
+
+    return FRpcMethodId_Internal::Names.IsValidIndex(Id.Index) ? FRpcMethodId_Internal::Names[Id.Index] : FString();
+}
+
+int32 FRpcMethodId::Num()
+{
+    FScopeLock ScopeLock(&FRpcMethodId_Internal::Lock);
+
+    return FRpcMethodId_Internal::Names.Num();
+}
+
+std::string FRpcMethodId::FindMethodPath(const google::protobuf::Descriptor* Request, const google::protobuf::Descriptor* Response)
+{
+    // The service is usually declared next to the request, messages of other files are checked only if it isn't.
+    const google::protobuf::FileDescriptor* const Files[] = { Request->file(), Response->file() };
+
+    for (const google::protobuf::FileDescriptor* File : Files)
+    {
+        for (int ServiceIndex = 0; ServiceIndex < File->service_count(); ServiceIndex++)
+        {
+            const google::protobuf::ServiceDescriptor* const Service = File->service(ServiceIndex);
+
+            for (int MethodIndex = 0; MethodIndex < Service->method_count(); MethodIndex++)
+            {
+                const google::protobuf::MethodDescriptor* const Method = Service->method(MethodIndex);
+
+                if (Method->input_type() == Request && Method->output_type() == Response)
+                    return "/" + Service->full_name() + "/" + Method->name();
+            }
+        }
+    }
+
+    return std::string();
+}
@@ -0,0 +1,258 @@
+/*
+ * Copyright 2018 Vizor Games LLC
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS, WITHOUT
+ * WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.See the
+ * License for the specific language governing permissions and limitations
+ * under the License.
+ */
+#include "RpcMetrics.h"
+
+#include "InfraworldStats.h"
+
+// ========= FRpcLatencyHistogram implementation ========
+
+FRpcLatencyHistogram::FRpcLatencyHistogram()
+{
+    Reset();
+}
+
+int32 FRpcLatencyHistogram::GetBucketIndex(uint64 Microseconds)
+{
+    // The first SubBucketCount values are recorded exactly.
+    if (Microseconds < SubBucketCount)
+        return static_cast<int32>(Microseconds);
+
+    const int32 Exponent = static_cast<int32>(FPlatformMath::FloorLog2_64(Microseconds));
+    const int32 SubBucket = static_cast<int32>(Microseconds >> (Exponent - SubBucketBits)) & (SubBucketCount - 1);
+
+    return FMath::Min((Exponent - SubBucketBits + 1) * SubBucketCount + SubBucket, NumBuckets - 1);
+}
+
+uint64 FRpcLatencyHistogram::GetBucketLowerBound(int32 Index)
+{
+    if (Index < SubBucketCount)
+        return static_cast<uint64>(Index);
+
+    const int32 Exponent = Index / SubBucketCount + SubBucketBits - 1;
+    const uint64 SubBucket = static_cast<uint64>(Index % SubBucketCount);
+
+    return (SubBucketCount + SubBucket) << (Exponent - SubBucketBits);
+}
+
+void FRpcLatencyHistogram::Record(double Seconds)
+{
+    const uint64 Microseconds = static_cast<uint64>(FMath::Max(Seconds, 0.0) * 1000000.0);
+
+    Buckets[GetBucketIndex(Microseconds)] += 1;
+    Count += 1;
+    TotalMicroseconds += Microseconds;
+
+    uint64 CurrentMax = MaxMicroseconds.Load();
+    while (Microseconds > CurrentMax && !MaxMicroseconds.CompareExchange(CurrentMax, Microseconds))
+    {
+    }
+}
+
+void FRpcLatencyHistogram::GetSnapshot(FRpcLatencySnapshot& OutSnapshot) const
+{
+    // Buckets are copied first, so percentiles are consistent with each other even if values are being recorded.
+    uint64 Copy[NumBuckets];
+    uint64 Total = 0;
+
+    for (int32 Index = 0; Index < NumBuckets; Index++)
+    {
+        Copy[Index] = Buckets[Index].Load();
+        Total += Copy[Index];
+    }
+
+    OutSnapshot = FRpcLatencySnapshot();
+    if (Total == 0)
+        return;
+
+    OutSnapshot.Count = static_cast<int32>(FMath::Min<uint64>(Total, MAX_int32));
+    OutSnapshot.MeanMs = static_cast<float>(static_cast<double>(TotalMicroseconds.Load()) / Count.Load() / 1000.0);
+    OutSnapshot.MaxMs = static_cast<float>(MaxMicroseconds.Load() / 1000.0);
+
+    const double Quantiles[] = { 0.5, 0.9, 0.99, 0.999 };
+    float* const Outputs[] = { &OutSnapshot.P50Ms, &OutSnapshot.P90Ms, &OutSnapshot.P99Ms, &OutSnapshot.P999Ms };
+
+    uint64 Accumulated = 0;
+    int32 QuantileIndex = 0;
+
+    for (int32 Index = 0; Index < NumBuckets && QuantileIndex < ARRAY_COUNT(Quantiles); Index++)
+    {
+        Accumulated += Copy[Index];
+
+        while (QuantileIndex < ARRAY_COUNT(Quantiles) && Accumulated >= static_cast<uint64>(FMath::CeilToDouble(Quantiles[QuantileIndex] * Total)))
+        {
+            // Report the middle of a bucket, but never more than the maximum seen.
+            const double Middle = (GetBucketLowerBound(Index) + GetBucketLowerBound(FMath::Min(Index + 1, NumBuckets - 1))) / 2.0;
+            *Outputs[QuantileIndex++] = FMath::Min(static_cast<float>(Middle / 1000.0), OutSnapshot.MaxMs);
+        }
+    }
+}
+
+void FRpcLatencyHistogram::Reset()
+{
+    for (TAtomic<uint64>& Bucket : Buckets)
+        Bucket.Store(0);
+
+    Count.Store(0);
+    TotalMicroseconds.Store(0);
+    MaxMicroseconds.Store(0);
+}
+
+// ========= FRpcMethodMetrics implementation ========
+
+FRpcMethodMetrics::FRpcMethodMetrics(FRpcMethodId InMethod) : Method(InMethod)
+{
+    Reset();
+}
+
+void FRpcMethodMetrics::RecordQueueWait(double Seconds)
+{
+    QueueWait.Record(Seconds);
+}
+
+void FRpcMethodMetrics::RecordConversion(double Seconds)
+{
+    Conversion.Record(Seconds);
+}
+
+void FRpcMethodMetrics::RecordDispatch(double Seconds)
+{
+    Dispatch.Record(Seconds);
+    SET_FLOAT_STAT(STAT_InfraworldLastDispatchMs, static_cast<float>(Seconds * 1000.0));
+}
+
+void FRpcMethodMetrics::RecordExpired()
+{
+    Expired += 1;
+}
+
+void FRpcMethodMetrics::BeginCall()
+{
+    ++InFlight;
+    INC_DWORD_STAT(STAT_InfraworldInFlight);
+}
+
+void FRpcMethodMetrics::EndCall(double NetworkSeconds, EGrpcStatusCode Code, int64 InBytesSent, int64 InBytesReceived)
+{
+    --InFlight;
+    DEC_DWORD_STAT(STAT_InfraworldInFlight);
+
+    Network.Record(NetworkSeconds);
+    Calls += 1;
+    BytesSent += static_cast<uint64>(InBytesSent);
+    BytesReceived += static_cast<uint64>(InBytesReceived);
+
+    const int32 CodeIndex = static_cast<int32>(Code);
+    if (CodeIndex < NumStatusCodes)
+        StatusCodes[CodeIndex] += 1;
+
+    if (Code != EGrpcStatusCode::Ok)
+    {
+        Errors += 1;
+        INC_DWORD_STAT(STAT_InfraworldErrors);
+    }
+
+    if (Code == EGrpcStatusCode::DeadlineExceeded)
+        INC_DWORD_STAT(STAT_InfraworldDeadlineMisses);
+
+    INC_DWORD_STAT(STAT_InfraworldCalls);
+    INC_MEMORY_STAT_BY(STAT_InfraworldBytesSent, InBytesSent);
+    INC_MEMORY_STAT_BY(STAT_InfraworldBytesReceived, InBytesReceived);
+    SET_FLOAT_STAT(STAT_InfraworldLastNetworkMs, static_cast<float>(NetworkSeconds * 1000.0));
+}
+
+void FRpcMethodMetrics::GetSnapshot(FRpcMethodMetricsSnapshot& OutSnapshot) const
+{
+    OutSnapshot.Method = FRpcMethodId::GetName(Method);
+    OutSnapshot.Calls = static_cast<int32>(Calls.Load());
+    OutSnapshot.Errors = static_cast<int32>(Errors.Load());
+    OutSnapshot.Expired = static_cast<int32>(Expired.Load());
+    OutSnapshot.InFlight = InFlight.Load();
+    OutSnapshot.KilobytesSent = static_cast<float>(BytesSent.Load() / 1024.0);
+    OutSnapshot.KilobytesReceived = static_cast<float>(BytesReceived.Load() / 1024.0);
+
+    OutSnapshot.StatusCodes.Reset();
+    for (int32 CodeIndex = 0; CodeIndex < NumStatusCodes; CodeIndex++)
+    {
+        if (const uint64 CodeCount = StatusCodes[CodeIndex].Load())
+            OutSnapshot.StatusCodes.Add(static_cast<EGrpcStatusCode>(CodeIndex), static_cast<int32>(CodeCount));
+    }
+
+    QueueWait.GetSnapshot(OutSnapshot.QueueWait);
+    Network.GetSnapshot(OutSnapshot.Network);
+    Conversion.GetSnapshot(OutSnapshot.Conversion);
+    Dispatch.GetSnapshot(OutSnapshot.Dispatch);
+}
+
+void FRpcMethodMetrics::Reset()
+{
+    // InFlight is not reset, since calls in flight will decrement it.
+    Calls.Store(0);
+    Errors.Store(0);
+    Expired.Store(0);
+    BytesSent.Store(0);
+    BytesReceived.Store(0);
+
+    for (TAtomic<uint64>& CodeCount : StatusCodes)
+        CodeCount.Store(0);
+
+    QueueWait.Reset();
+    Network.Reset();
+    Conversion.Reset();
+    Dispatch.Reset();
+}
+
+// ========= FRpcClientMetrics implementation ========
+
+FRpcMethodMetricsPtr FRpcClientMetrics::GetMethod(FRpcMethodId Method)
+{
+    check(Method.IsValid());
+    FScopeLock ScopeLock(&Lock);
+
+    if (!Methods.IsValidIndex(Method.Index))
+        Methods.SetNum(Method.Index + 1);
+
+    FRpcMethodMetricsPtr& MethodMetrics = Methods[Method.Index];
+    if (!MethodMetrics.IsValid())
+        MethodMetrics = MakeShared<FRpcMethodMetrics, ESPMode::ThreadSafe>(Method);
+
+    return MethodMetrics;
+}
+
+void FRpcClientMetrics::GetSnapshot(FRpcClientMetricsSnapshot& OutSnapshot) const
+{
+    FScopeLock ScopeLock(&Lock);
+
+    OutSnapshot.Methods.Reset(Methods.Num());
+    for (const FRpcMethodMetricsPtr& MethodMetrics : Methods)
+    {
+        if (MethodMetrics.IsValid())
+        {
+            const int32 Index = OutSnapshot.Methods.AddDefaulted();
+            MethodMetrics->GetSnapshot(OutSnapshot.Methods[Index]);
+        }
+    }
+}
+
+void FRpcClientMetrics::Reset()
+{
+    FScopeLock ScopeLock(&Lock);
+
+    for (const FRpcMethodMetricsPtr& MethodMetrics : Methods)
+    {
+        if (MethodMetrics.IsValid())
+            MethodMetrics->Reset();
+    }
+}
@@ -0,0 +1,435 @@
+/*
+ * Copyright 2018 Vizor Games LLC
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS, WITHOUT
+ * WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.See the
+ * License for the specific language governing permissions and limitations
+ * under the License.
+ */
+#include "RpcReplay.h"
+
+#if !UE_BUILD_SHIPPING
+
+#include "InfraworldRuntime.h"
+#include "RpcAllocationCounter.h"
+#include "RpcEchoServer.h"
+#include "RpcLoadTestClient.h"
+#include "RpcTrace.h"
+#include "RpcTrafficLog.h"
+
+#include "Containers/Ticker.h"
+#include "HAL/IConsoleManager.h"
+#include "HAL/PlatformTime.h"
+#include "Misc/DateTime.h"
+#include "Misc/FileHelper.h"
+#include "Misc/Parse.h"
+#include "Misc/Paths.h"
+#include "UObject/Package.h"
+
+#include <ctime>
+
+/**
+ * State of a running replay, kept alive by its ticker.
+ */
+class FRpcReplay_Internal
+{
+public:
+    /** Metadata entry, which tells the stand-in server which recorded call is being replayed. */
+    static const char* const IndexMetadataKey;
+
+    FRpcReplay_Internal(const FString& InFilename, const FRpcReplaySettings& InSettings, TFunction<void(const FRpcReplayReport&)>&& InOnFinished) :
+        Filename(InFilename),
+        Settings(InSettings),
+        OnFinished(MoveTemp(InOnFinished)),
+        Server([this](const grpc::GenericServerContext& Context, grpc::ByteBuffer& Buffer) { return Respond(Context, Buffer); })
+    {
+    }
+
+    bool Start();
+
+    /**
+     * Sends calls, which are due, and finishes the replay once all of them are done.
+     *
+     * @return False once the replay is over.
+     */
+    bool Tick();
+
+    static void RunFromConsole(const TArray<FString>& Args);
+
+private:
+    struct FCallInFlight
+    {
+        int32 Index;
+        double SendTime;
+    };
+
+    /** Is called on serving threads, reads only immutable entries. */
+    grpc::Status Respond(const grpc::GenericServerContext& Context, grpc::ByteBuffer& Buffer) const;
+
+    void Send(URpcLoadTestClient* Client);
+    void OnResponse(URpcLoadTestClient* Client, const TResponseWithStatus<FByteArray>& Response);
+    void Finish();
+
+    const FString Filename;
+    const FRpcReplaySettings Settings;
+    TFunction<void(const FRpcReplayReport&)> OnFinished;
+
+    TArray<FRpcTrafficLogEntry> Entries;
+
+    FRpcEchoServer Server;
+    UChannelCredentials* Credentials = nullptr;
+    TArray<URpcLoadTestClient*> Clients;
+
+    /** Index of the next entry to send. */
+    int32 NextIndex = 0;
+
+    /** Calls in flight by their correlation ids. */
+    TMap<uint64, FCallInFlight> CallsInFlight;
+
+    /** Replay is cut short, if calls haven't been completed by this moment since the last one has been sent. */
+    double DrainEndTime = 0.0;
+
+    FRpcLatencyHistogram Latency;
+    FRpcLatencyHistogram RecordedLatency;
+    int64 Calls = 0;
+    int64 Errors = 0;
+    int64 Mismatches = 0;
+
+    double StartTime = 0.0;
+    std::clock_t StartClock = 0;
+    uint64 StartAllocations = 0;
+};
+
+const char* const FRpcReplay_Internal::IndexMetadataKey = "x-infraworld-replay-index";
+
+
+/// FRpcReplay_Internal interface
+
+bool FRpcReplay_Internal::Start()
+{
+    if (!FRpcTrafficLog::Load(Filename, Entries))
+        return false;
+
+    if (Entries.Num() == 0)
+    {
+        UE_LOG(LogInfraworldRuntime, Error, TEXT("RPC traffic log %s has no calls to replay"), *Filename);
+        return false;
+    }
+
+    // Calls are recorded once they're complete, but are replayed in order of sending.
+    Entries.StableSort([](const FRpcTrafficLogEntry& A, const FRpcTrafficLogEntry& B)
+    {
+        return A.StartSeconds < B.StartSeconds;
+    });
+
+    const FString Address = FRpcLoadTest::GetServerAddress(Settings.Transport, TEXT("Replay"));
+    if (Address.IsEmpty())
+        return false;
+
+    FString Target;
+    if (!Server.Start(Address, Settings.NumServerThreads, Target))
+        return false;
+
+    UE_LOG(LogInfraworldRuntime, Display, TEXT("Replay: %d calls of %s by %d clients against %s"), Entries.Num(), *Filename,
+        Settings.NumClients, *Target);
+
+    // Nothing else references the objects, so they're kept from being garbage collected until the replay is over.
+    Credentials = NewObject<UInsecureChannelCredentials>(GetTransientPackage());
+    Credentials->AddToRoot();
+
+    for (int32 Index = 0; Index < FMath::Max(Settings.NumClients, 1); Index++)
+    {
+        URpcLoadTestClient* const Client = NewRpcClient<URpcLoadTestClient>(Target, Credentials);
+        if (!Client)
+        {
+            Finish();
+            return false;
+        }
+
+        Client->AddToRoot();
+        Client->OnReplay = [this, Client](const TResponseWithStatus<FByteArray>& Response)
+        {
+            OnResponse(Client, Response);
+        };
+
+        Clients.Add(Client);
+    }
+
+    FRpcAllocationCounter::Begin();
+
+    StartTime = FPlatformTime::Seconds();
+    StartClock = std::clock();
+    StartAllocations = FRpcAllocationCounter::GetNumAllocations();
+
+    if (Settings.bAsFastAsPossible)
+    {
+        for (URpcLoadTestClient* const Client : Clients)
+        {
+            for (int32 Index = 0; Index < Settings.Concurrency && NextIndex < Entries.Num(); Index++)
+                Send(Client);
+        }
+    }
+
+    return true;
+}
+
+bool FRpcReplay_Internal::Tick()
+{
+    const double Now = FPlatformTime::Seconds();
+
+    if (!Settings.bAsFastAsPossible)
+    {
+        const double Speed = FMath::Max(Settings.Speed, 0.001f);
+
+        while (NextIndex < Entries.Num() && Entries[NextIndex].StartSeconds / Speed <= Now - StartTime)
+            Send(Clients[NextIndex % Clients.Num()]);
+    }
+
+    if (NextIndex < Entries.Num())
+        return true;
+
+    if (DrainEndTime == 0.0)
+        DrainEndTime = Now + 30.0;
+
+    // Calls, that got stuck, are cancelled by stopping the clients.
+    if (CallsInFlight.Num() == 0 || Now >= DrainEndTime)
+    {
+        Finish();
+        return false;
+    }
+
+    return true;
+}
+
+grpc::Status FRpcReplay_Internal::Respond(const grpc::GenericServerContext& Context, grpc::ByteBuffer& Buffer) const
+{
+    const auto Found = Context.client_metadata().find(IndexMetadataKey);
+    const int32 Index = Found != Context.client_metadata().end() ? FCStringAnsi::Atoi(std::string(Found->second.data(), Found->second.size()).c_str()) : INDEX_NONE;
+
+    if (!Entries.IsValidIndex(Index))
+        return grpc::Status(grpc::StatusCode::INVALID_ARGUMENT, "Not a replayed call");
+
+    const FRpcTrafficLogEntry& Entry = Entries[Index];
+
+    if (Entry.Status.ErrorCode != EGrpcStatusCode::Ok)
+        return grpc::Status(static_cast<grpc::StatusCode>(Entry.Status.ErrorCode), TCHAR_TO_UTF8(*Entry.Status.ErrorMessage));
+
+    grpc::Slice Slice(Entry.Response.GetData(), Entry.Response.Num());
+    grpc::ByteBuffer(&Slice, 1).Swap(&Buffer);
+
+    return grpc::Status::OK;
+}
+
+void FRpcReplay_Internal::Send(URpcLoadTestClient* Client)
+{
+    const int32 Index = NextIndex++;
+    const FRpcTrafficLogEntry& Entry = Entries[Index];
+
+    FRpcRawCall Call;
+    Call.MethodPath = Entry.MethodPath;
+    Call.Request.Bytes = Entry.Request;
+
+    // The correlation id is assigned here (and not by the conduit), so the response could be matched.
+    FGrpcClientContext Context = Entry.Context;
+    Context.bOverride_Metadata = true;
+    Context.Metadata.Add(UTF8_TO_TCHAR(IndexMetadataKey), FString::FromInt(Index));
+    Context.CorrelationId = FRpcTrace::NextCorrelationId();
+
+    CallsInFlight.Add(Context.CorrelationId, FCallInFlight{Index, FPlatformTime::Seconds()});
+    Client->Replay(Call, Context);
+}
+
+void FRpcReplay_Internal::OnResponse(URpcLoadTestClient* Client, const TResponseWithStatus<FByteArray>& Response)
+{
+    FCallInFlight Call;
+    if (!CallsInFlight.RemoveAndCopyValue(Response.CorrelationId, Call))
+        return;
+
+    const FRpcTrafficLogEntry& Entry = Entries[Call.Index];
+
+    Latency.Record(FPlatformTime::Seconds() - Call.SendTime);
+    RecordedLatency.Record(Entry.DurationSeconds);
+    Calls++;
+
+    if (Response.Status.ErrorCode != EGrpcStatusCode::Ok)
+        Errors++;
+
+    if (Response.Status.ErrorCode != Entry.Status.ErrorCode)
+        Mismatches++;
+
+    if (Settings.bAsFastAsPossible && NextIndex < Entries.Num())
+        Send(Client);
+}
+
+void FRpcReplay_Internal::Finish()
+{
+    FRpcReplayReport Report;
+
+    if (StartTime > 0.0)
+    {
+        const uint64 Allocations = FRpcAllocationCounter::GetNumAllocations() - StartAllocations;
+        FRpcAllocationCounter::End();
+
+        // Note that std::clock() is process CPU time on POSIX systems, but is wall time on Windows.
+        const double CpuSeconds = static_cast<double>(std::clock() - StartClock) / CLOCKS_PER_SEC;
+
+        Report.Settings = Settings;
+        Report.Filename = Filename;
+        Report.bSucceeded = true;
+        Report.Calls = Calls;
+        Report.Errors = Errors;
+        Report.Mismatches = Mismatches;
+        Report.Seconds = FPlatformTime::Seconds() - StartTime;
+        Report.RecordedSeconds = Entries.Last().StartSeconds + Entries.Last().DurationSeconds - Entries[0].StartSeconds;
+        Report.CallsPerSecond = Calls / FMath::Max(Report.Seconds, 0.001);
+        Latency.GetSnapshot(Report.Latency);
+        RecordedLatency.GetSnapshot(Report.RecordedLatency);
+
+        if (Calls > 0)
+        {
+            Report.CpuMicrosecondsPerCall = CpuSeconds * 1000000.0 / Calls;
+            Report.AllocationsPerCall = static_cast<double>(Allocations) / Calls;
+        }
+    }
+
+    for (URpcLoadTestClient* const Client : Clients)
+    {
+        Client->OnReplay = nullptr;
+
+        if (Client->CanSendRequests())
+            Client->Stop(true);
+
+        Client->RemoveFromRoot();
+    }
+
+    Clients.Empty();
+    CallsInFlight.Empty();
+
+    if (Credentials)
+    {
+        Credentials->RemoveFromRoot();
+        Credentials = nullptr;
+    }
+
+    Server.Shutdown();
+
+    if (Report.bSucceeded && OnFinished)
+        OnFinished(Report);
+}
+
+void FRpcReplay_Internal::RunFromConsole(const TArray<FString>& Args)
+{
+    if (Args.Num() == 0 || Args[0].StartsWith(TEXT("-")))
+    {
+        UE_LOG(LogInfraworldRuntime, Error, TEXT("Usage: infraworld.Replay Path.rpclog [-AsFastAsPossible] [-Speed=1] [-Clients=1] [-Concurrency=8] [-ServerThreads=2] [-Transport=Tcp|Unix|InProcess] [-Out=Path.json] [-Quit]"));
+        return;
+    }
+
+    const FString LogPath = Args[0];
+    const FString CommandLine = FString::Join(Args, TEXT(" "));
+
+    FRpcReplaySettings Settings;
+    Settings.bAsFastAsPossible = FParse::Param(*CommandLine, TEXT("AsFastAsPossible"));
+    FParse::Value(*CommandLine, TEXT("Speed="), Settings.Speed);
+    FParse::Value(*CommandLine, TEXT("Clients="), Settings.NumClients);
+    FParse::Value(*CommandLine, TEXT("Concurrency="), Settings.Concurrency);
+    FParse::Value(*CommandLine, TEXT("ServerThreads="), Settings.NumServerThreads);
+
+    FString Transport;
+    if (FParse::Value(*CommandLine, TEXT("Transport="), Transport) && !FRpcLoadTest::ParseTransport(Transport, Settings.Transport))
+        return;
+
+    FString OutPath = FPaths::ProfilingDir() / TEXT("Infraworld") / FString::Printf(TEXT("Replay-%s.json"), *FDateTime::Now().ToString());
+    FParse::Value(*CommandLine, TEXT("Out="), OutPath);
+
+    const bool bQuit = FParse::Param(*CommandLine, TEXT("Quit"));
+
+    const bool bStarted = FRpcReplay::Start(LogPath, Settings, [OutPath, bQuit](const FRpcReplayReport& Report)
+    {
+        UE_LOG(LogInfraworldRuntime, Display, TEXT("Replay: %lld calls in %.2f s (recorded in %.2f s), p50 %.3f ms, p99 %.3f ms, %.1f us CPU/call, %.1f allocs/call, %lld errors, %lld mismatches"),
+            Report.Calls, Report.Seconds, Report.RecordedSeconds, Report.Latency.P50Ms, Report.Latency.P99Ms,
+            Report.CpuMicrosecondsPerCall, Report.AllocationsPerCall, Report.Errors, Report.Mismatches);
+
+        if (FFileHelper::SaveStringToFile(Report.ToJson(), *OutPath, FFileHelper::EEncodingOptions::ForceUTF8WithoutBOM))
+            UE_LOG(LogInfraworldRuntime, Display, TEXT("Replay results have been written to %s"), *OutPath);
+        else
+            UE_LOG(LogInfraworldRuntime, Error, TEXT("Can't write replay results to %s"), *OutPath);
+
+        if (bQuit)
+            FPlatformMisc::RequestExit(false);
+    });
+
+    if (!bStarted)
+    {
+        UE_LOG(LogInfraworldRuntime, Error, TEXT("Unable to start a replay of %s"), *LogPath);
+
+        if (bQuit)
+            FPlatformMisc::RequestExit(false);
+    }
+}
+
+static FAutoConsoleCommand CmdInfraworldReplay(
+    TEXT("infraworld.Replay"),
+    TEXT("Replays an RPC traffic log (see infraworld.Record.Start) against a local stand-in server and writes throughput and latency as JSON.\n")
+    TEXT("Usage: infraworld.Replay Path.rpclog [-AsFastAsPossible] [-Speed=1] [-Clients=1] [-Concurrency=8] [-ServerThreads=2] [-Transport=Tcp|Unix|InProcess] [-Out=Path.json] [-Quit]"),
+    FConsoleCommandWithArgsDelegate::CreateStatic(&FRpcReplay_Internal::RunFromConsole));
+
+
+/// FRpcReplayReport interface
+
+FString FRpcReplayReport::ToJson() const
+{
+    FString Json = TEXT("{\n");
+
+    Json += FString::Printf(TEXT("  \"log\": \"%s\",\n"), *Filename.ReplaceCharWithEscapedChar());
+    Json += FString::Printf(TEXT("  \"as_fast_as_possible\": %s,\n"), Settings.bAsFastAsPossible ? TEXT("true") : TEXT("false"));
+    Json += FString::Printf(TEXT("  \"speed\": %.2f,\n"), Settings.Speed);
+    Json += FString::Printf(TEXT("  \"clients\": %d,\n"), Settings.NumClients);
+    Json += FString::Printf(TEXT("  \"concurrency\": %d,\n"), Settings.Concurrency);
+    Json += FString::Printf(TEXT("  \"server_threads\": %d,\n"), Settings.NumServerThreads);
+    Json += FString::Printf(TEXT("  \"transport\": \"%s\",\n"), FRpcLoadTest::GetTransportName(Settings.Transport));
+    Json += FString::Printf(TEXT("  \"seconds\": %.3f,\n"), Seconds);
+    Json += FString::Printf(TEXT("  \"recorded_seconds\": %.3f,\n"), RecordedSeconds);
+    Json += FString::Printf(TEXT("  \"calls\": %lld,\n"), Calls);
+    Json += FString::Printf(TEXT("  \"errors\": %lld,\n"), Errors);
+    Json += FString::Printf(TEXT("  \"mismatches\": %lld,\n"), Mismatches);
+    Json += FString::Printf(TEXT("  \"calls_per_second\": %.1f,\n"), CallsPerSecond);
+    Json += FString::Printf(TEXT("  \"latency_ms\": { \"mean\": %.3f, \"p50\": %.3f, \"p90\": %.3f, \"p99\": %.3f, \"p999\": %.3f, \"max\": %.3f },\n"),
+        Latency.MeanMs, Latency.P50Ms, Latency.P90Ms, Latency.P99Ms, Latency.P999Ms, Latency.MaxMs);
+    Json += FString::Printf(TEXT("  \"recorded_latency_ms\": { \"mean\": %.3f, \"p50\": %.3f, \"p90\": %.3f, \"p99\": %.3f, \"p999\": %.3f, \"max\": %.3f },\n"),
+        RecordedLatency.MeanMs, RecordedLatency.P50Ms, RecordedLatency.P90Ms, RecordedLatency.P99Ms, RecordedLatency.P999Ms, RecordedLatency.MaxMs);
+    Json += FString::Printf(TEXT("  \"cpu_us_per_call\": %.2f,\n"), CpuMicrosecondsPerCall);
+    Json += FString::Printf(TEXT("  \"allocations_per_call\": %.2f\n"), AllocationsPerCall);
+
+    Json += TEXT("}\n");
+    return Json;
+}
+
+
+/// FRpcReplay interface
+
+bool FRpcReplay::Start(const FString& Filename, const FRpcReplaySettings& Settings, TFunction<void(const FRpcReplayReport&)> OnFinished)
+{
+    check(IsInGameThread());
+
+    TSharedRef<FRpcReplay_Internal> Replay = MakeShared<FRpcReplay_Internal>(Filename, Settings, MoveTemp(OnFinished));
+    if (!Replay->Start())
+        return false;
+
+    // The ticker owns the replay, it is destroyed once the replay is over.
+    FTicker::GetCoreTicker().AddTicker(FTickerDelegate::CreateLambda([Replay](float)
+    {
+        return Replay->Tick();
+    }));
+
+    return true;
+}
+
+#endif
@@ -0,0 +1,378 @@
+/*
+ * Copyright 2018 Vizor Games LLC
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS, WITHOUT
+ * WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.See the
+ * License for the specific language governing permissions and limitations
+ * under the License.
+ */
+#include "RpcSpillFile.h"
+
+#include "CompiledContext.h"
+#include "GenUtils.h"
+#include "InfraworldRuntime.h"
+#include "InfraworldStats.h"
+#include "ProtoWireCodec.h"
+
+#include "GenericPlatform/GenericPlatformFile.h"
+#include "HAL/PlatformFilemanager.h"
+#include "HAL/PlatformProcess.h"
+#include "Misc/Paths.h"
+#include "Misc/ScopeLock.h"
+
+class FRpcSpillFile_Internal
+{
+public:
+    /** Size of the header of a record in a segment file (the size of the record). */
+    static const int64 RecordHeaderBytes = sizeof(int32);
+
+    /** Size of the fixed part of an encoded request: correlation id, enqueue time, deadline and size of the context. */
+    static const int32 RequestHeaderBytes = sizeof(uint64) + sizeof(double) + sizeof(double) + sizeof(int32);
+
+    static TAtomic<int32> NextSpillIndex;
+
+    static FString GetDirectory(const FRpcSpillSettings& Settings)
+    {
+        return Settings.Directory.IsEmpty() ? FPaths::ProjectSavedDir() / TEXT("Infraworld") / TEXT("Spill") : Settings.Directory;
+    }
+
+    /**
+     * Deletes segments of request spills (Requests-<pid>-<n>-<segment>.spill), left by processes, that are no longer
+     * running (crashed ones, since the others delete their segments). Done once per directory, since it's shared by
+     * all the conduits of the process (and possibly by other processes, which are still running).
+     */
+    static void DeleteStaleSegments(const FString& Directory)
+    {
+        static FCriticalSection SweptLock;
+        static TSet<FString> SweptDirectories;
+
+        {
+            FScopeLock ScopeLock(&SweptLock);
+
+            bool bAlreadySwept = false;
+            SweptDirectories.Add(Directory, &bAlreadySwept);
+            if (bAlreadySwept)
+                return;
+        }
+
+        IPlatformFile& PlatformFile = FPlatformFileManager::Get().GetPlatformFile();
+        if (!PlatformFile.DirectoryExists(*Directory))
+            return;
+
+        TArray<FString> Filenames;
+        PlatformFile.FindFiles(Filenames, *Directory, TEXT("spill"));
+
+        const uint32 CurrentProcessId = FPlatformProcess::GetCurrentProcessId();
+        int32 NumDeleted = 0;
+
+        for (const FString& Filename : Filenames)
+        {
+            TArray<FString> Parts;
+            FPaths::GetBaseFilename(Filename).ParseIntoArray(Parts, TEXT("-"));
+
+            if (Parts.Num() != 4 || Parts[0] != TEXT("Requests") || !Parts[1].IsNumeric())
+                continue;
+
+            const uint32 ProcessId = static_cast<uint32>(FCString::Strtoui64(*Parts[1], nullptr, 10));
+            if (ProcessId == CurrentProcessId || FPlatformProcess::IsApplicationRunning(ProcessId))
+                continue;
+
+            if (PlatformFile.DeleteFile(*Filename))
+                NumDeleted++;
+        }
+
+        UE_CLOG(NumDeleted > 0, LogInfraworldRuntime, Warning, TEXT("Deleted %d stale spill segments from %s, requests of crashed processes are lost"),
+            NumDeleted, *Directory);
+    }
+
+    template<class T>
+    static FORCEINLINE void Append(TArray<uint8>& Bytes, const T& Value)
+    {
+        Bytes.Append(reinterpret_cast<const uint8*>(&Value), sizeof(T));
+    }
+
+    template<class T>
+    static FORCEINLINE T ReadAt(const TArray<uint8>& Bytes, int32 Offset)
+    {
+        T Value;
+        FMemory::Memcpy(&Value, Bytes.GetData() + Offset, sizeof(T));
+        return Value;
+    }
+};
+
+TAtomic<int32> FRpcSpillFile_Internal::NextSpillIndex(0);
+
+
+/// FRpcSpillFile interface
+
+FRpcSpillFile::FRpcSpillFile(const FString& InDirectory, const FString& InName, int64 InSegmentBytes) :
+    Directory(InDirectory),
+    Name(InName),
+    SegmentBytes(FMath::Max<int64>(InSegmentBytes, 4096))
+{
+}
+
+FRpcSpillFile::~FRpcSpillFile()
+{
+    for (FSegment& Segment : Segments)
+        DeleteSegment(Segment);
+
+    DEC_MEMORY_STAT_BY(STAT_InfraworldSpillDiskBytes, DiskBytes);
+}
+
+bool FRpcSpillFile::Write(const TArray<uint8>& Record)
+{
+    if (Segments.Num() == 0 || Segments.Last().WriteOffset >= SegmentBytes)
+    {
+        IPlatformFile& PlatformFile = FPlatformFileManager::Get().GetPlatformFile();
+        PlatformFile.CreateDirectoryTree(*Directory);
+
+        FSegment Segment;
+        Segment.Filename = Directory / FString::Printf(TEXT("%s-%d.spill"), *Name, NextSegmentIndex++);
+        Segment.Handle = PlatformFile.OpenWrite(*Segment.Filename, false, true);
+
+        if (!Segment.Handle)
+            return false;
+
+        Segments.Add(Segment);
+    }
+
+    // The handle is positioned at the end of the segment, unless it has been read since the last write.
+    FSegment& Segment = Segments.Last();
+    const int32 Size = Record.Num();
+
+    if (!Segment.Handle->Seek(Segment.WriteOffset) ||
+        !Segment.Handle->Write(reinterpret_cast<const uint8*>(&Size), FRpcSpillFile_Internal::RecordHeaderBytes) ||
+        !Segment.Handle->Write(Record.GetData(), Size))
+    {
+        // A partially written record is overwritten by the next one.
+        return false;
+    }
+
+    const int64 Written = FRpcSpillFile_Internal::RecordHeaderBytes + Size;
+    Segment.WriteOffset += Written;
+
+    NumRecords++;
+    DiskBytes += Written;
+    INC_MEMORY_STAT_BY(STAT_InfraworldSpillDiskBytes, Written);
+
+    return true;
+}
+
+bool FRpcSpillFile::Read(TArray<uint8>& OutRecord)
+{
+    if (NumRecords == 0 || Segments.Num() == 0)
+        return false;
+
+    FSegment& Segment = Segments[0];
+
+    // Written data must be visible to the read.
+    Segment.Handle->Flush();
+
+    int32 Size = 0;
+    if (!Segment.Handle->Seek(Segment.ReadOffset) ||
+        !Segment.Handle->Read(reinterpret_cast<uint8*>(&Size), FRpcSpillFile_Internal::RecordHeaderBytes) ||
+        Size < 0 || Segment.ReadOffset + FRpcSpillFile_Internal::RecordHeaderBytes + Size > Segment.WriteOffset)
+    {
+        return false;
+    }
+
+    OutRecord.SetNumUninitialized(Size, false);
+    if (!Segment.Handle->Read(OutRecord.GetData(), Size))
+        return false;
+
+    Segment.ReadOffset += FRpcSpillFile_Internal::RecordHeaderBytes + Size;
+    NumRecords--;
+
+    // Fully read segments are deleted right away, so the disk usage follows the backlog.
+    if (Segment.ReadOffset >= Segment.WriteOffset)
+    {
+        DiskBytes -= Segment.WriteOffset;
+        DEC_MEMORY_STAT_BY(STAT_InfraworldSpillDiskBytes, Segment.WriteOffset);
+
+        DeleteSegment(Segment);
+        Segments.RemoveAt(0);
+    }
+
+    return true;
+}
+
+void FRpcSpillFile::DeleteSegment(FSegment& Segment)
+{
+    delete Segment.Handle;
+    Segment.Handle = nullptr;
+
+    FPlatformFileManager::Get().GetPlatformFile().DeleteFile(*Segment.Filename);
+}
+
+
+/// FRpcRequestSpill interface
+
+FRpcRequestSpill::FRpcRequestSpill(const FRpcSpillSettings& Settings) :
+    MemoryLimitBytes(Settings.MemoryLimitBytes),
+    File(FRpcSpillFile_Internal::GetDirectory(Settings),
+        FString::Printf(TEXT("Requests-%u-%d"), FPlatformProcess::GetCurrentProcessId(), FRpcSpillFile_Internal::NextSpillIndex++),
+        Settings.SegmentBytes),
+    MemoryBytes(0),
+    NumSpilled(0),
+    NumDropped(0)
+{
+    FRpcSpillFile_Internal::DeleteStaleSegments(FRpcSpillFile_Internal::GetDirectory(Settings));
+}
+
+FRpcRequestSpill::~FRpcRequestSpill()
+{
+    DEC_DWORD_STAT_BY(STAT_InfraworldSpilledRequests, NumSpilled.Load());
+}
+
+bool FRpcRequestSpill::ShouldSerialize()
+{
+    if (--RequestsUntilSample <= 0)
+    {
+        RequestsUntilSample = SizeSampleInterval;
+        return true;
+    }
+
+    return NumSpilled.Load() > 0 || MemoryBytes.Load() + AverageRecordBytes > MemoryLimitBytes;
+}
+
+ERpcSpillResult FRpcRequestSpill::SpillOrKeep(const TArray<uint8>& Record)
+{
+    AverageRecordBytes = (AverageRecordBytes > 0) ? (AverageRecordBytes * 3 + Record.Num()) / 4 : Record.Num();
+
+    FScopeLock ScopeLock(&Lock);
+
+    // Once anything has been spilled, everything goes to disk until it is drained, so the order is preserved.
+    if (NumSpilled.Load() > 0 || MemoryBytes.Load() + Record.Num() > MemoryLimitBytes)
+    {
+        if (File.Write(Record))
+        {
+            ++NumSpilled;
+            INC_DWORD_STAT(STAT_InfraworldSpilledRequests);
+            return ERpcSpillResult::Spilled;
+        }
+
+        // Keeping it in memory would put it ahead of the spilled requests.
+        if (NumSpilled.Load() > 0)
+        {
+            UE_LOG(LogInfraworldRuntime, Error, TEXT("Unable to spill a request to disk, it is dropped"));
+            OnDropped();
+            return ERpcSpillResult::Dropped;
+        }
+
+        // Nothing to reorder: losing the request is worse than exceeding the limit.
+        UE_CLOG(!bWriteErrorReported, LogInfraworldRuntime, Error, TEXT("Unable to spill a request to disk, it is kept in memory"));
+        bWriteErrorReported = true;
+    }
+
+    Keep(Record.Num());
+    return ERpcSpillResult::Kept;
+}
+
+void FRpcRequestSpill::Keep()
+{
+    Keep(AverageRecordBytes);
+}
+
+void FRpcRequestSpill::Keep(int64 Size)
+{
+    // The size is queued before the request, so it's always there once the request is dequeued.
+    MemorySizes.Enqueue(Size);
+    MemoryBytes += Size;
+}
+
+void FRpcRequestSpill::OnDequeuedFromMemory()
+{
+    int64 Size;
+    if (MemorySizes.Dequeue(Size))
+        MemoryBytes -= Size;
+}
+
+void FRpcRequestSpill::OnDropped()
+{
+    ++NumDropped;
+    INC_DWORD_STAT(STAT_InfraworldDroppedRequests);
+}
+
+bool FRpcRequestSpill::ReadSpilled(TArray<uint8>& OutRecord)
+{
+    FScopeLock ScopeLock(&Lock);
+
+    if (NumSpilled.Load() == 0)
+        return false;
+
+    if (!File.Read(OutRecord))
+    {
+        UE_LOG(LogInfraworldRuntime, Error, TEXT("Unable to read a spilled request, %d spilled requests are lost"), NumSpilled.Load());
+
+        DEC_DWORD_STAT_BY(STAT_InfraworldSpilledRequests, NumSpilled.Load());
+        INC_DWORD_STAT_BY(STAT_InfraworldDroppedRequests, NumSpilled.Load());
+        NumDropped += NumSpilled.Load();
+        NumSpilled = 0;
+        return false;
+    }
+
+    --NumSpilled;
+    DEC_DWORD_STAT(STAT_InfraworldSpilledRequests);
+    return true;
+}
+
+bool FRpcRequestSpill::EncodeRecord(UScriptStruct* RequestStruct, const void* Request, const FGrpcClientContext& Context, TArray<uint8>& OutRecord)
+{
+    // Shared metadata isn't a UPROPERTY, so it's merged into the context being encoded.
+    if (Context.Shared.IsValid())
+        return EncodeRecord(RequestStruct, Request, FGrpcCompiledContext::Flatten(Context), OutRecord);
+
+    // Records never leave the process, so structs without registered field numbers are spilled as well.
+    TArray<uint8> ContextBytes;
+    if (!FProtoWireCodec::Encode(Context, ContextBytes, EProtoFieldNumbering::DeclarationOrder))
+        return false;
+
+    TArray<uint8> RequestBytes;
+    if (!FProtoWireCodec::Encode(RequestStruct, Request, RequestBytes, EProtoFieldNumbering::DeclarationOrder))
+        return false;
+
+    // Fields, that aren't UPROPERTYs, are written explicitly.
+    OutRecord.Reset(FRpcSpillFile_Internal::RequestHeaderBytes + ContextBytes.Num() + RequestBytes.Num());
+    FRpcSpillFile_Internal::Append(OutRecord, Context.CorrelationId);
+    FRpcSpillFile_Internal::Append(OutRecord, Context.EnqueueTimeSeconds);
+    FRpcSpillFile_Internal::Append(OutRecord, Context.AbsoluteDeadlineSeconds);
+    FRpcSpillFile_Internal::Append(OutRecord, ContextBytes.Num());
+    OutRecord.Append(ContextBytes);
+    OutRecord.Append(RequestBytes);
+
+    return true;
+}
+
+bool FRpcRequestSpill::DecodeRecord(UScriptStruct* RequestStruct, const TArray<uint8>& Record, void* OutRequest, FGrpcClientContext& OutContext)
+{
+    if (Record.Num() < FRpcSpillFile_Internal::RequestHeaderBytes)
+        return false;
+
+    const int32 ContextSize = FRpcSpillFile_Internal::ReadAt<int32>(Record, sizeof(uint64) + sizeof(double) + sizeof(double));
+    const int32 ContextOffset = FRpcSpillFile_Internal::RequestHeaderBytes;
+
+    if (ContextSize < 0 || ContextSize > Record.Num() - ContextOffset)
+        return false;
+
+    if (!FProtoWireCodec::Decode(Record.GetData() + ContextOffset, ContextSize, OutContext, EProtoFieldNumbering::DeclarationOrder))
+        return false;
+
+    const int32 RequestOffset = ContextOffset + ContextSize;
+    if (!FProtoWireCodec::Decode(RequestStruct, Record.GetData() + RequestOffset, Record.Num() - RequestOffset, OutRequest,
+        EProtoFieldNumbering::DeclarationOrder))
+        return false;
+
+    OutContext.CorrelationId = FRpcSpillFile_Internal::ReadAt<uint64>(Record, 0);
+    OutContext.EnqueueTimeSeconds = FRpcSpillFile_Internal::ReadAt<double>(Record, sizeof(uint64));
+    OutContext.AbsoluteDeadlineSeconds = FRpcSpillFile_Internal::ReadAt<double>(Record, sizeof(uint64) + sizeof(double));
+
+    return true;
+}
@@ -0,0 +1,65 @@
+/*
+ * Copyright 2018 Vizor Games LLC
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS, WITHOUT
+ * WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.See the
+ * License for the specific language governing permissions and limitations
+ * under the License.
+ */
+#include "RpcTrace.h"
+
+#include "HAL/IConsoleManager.h"
+#include "HAL/PlatformMisc.h"
+#include "Misc/CString.h"
+#include "Runtime/Launch/Resources/Version.h"
+#include "Templates/Atomic.h"
+
+#define INFRAWORLD_WITH_INSIGHTS (ENGINE_MAJOR_VERSION > 4 || (ENGINE_MAJOR_VERSION == 4 && ENGINE_MINOR_VERSION >= 25))
+
+#if INFRAWORLD_WITH_INSIGHTS
+#include "ProfilingDebugging/CpuProfilerTrace.h"
+#endif
+
+int32 GInfraworldTrace = 0;
+
+static FAutoConsoleVariableRef CVarInfraworldTrace(
+    TEXT("infraworld.Trace"),
+    GInfraworldTrace,
+    TEXT("Emit profiler scopes for every stage of RPC calls, tagged with correlation ids.\n")
+    TEXT("0: off (default), 1: on"),
+    ECVF_Default);
+
+static TAtomic<uint64> GInfraworldNextCorrelationId(1);
+
+uint64 FRpcTrace::NextCorrelationId()
+{
+    return GInfraworldNextCorrelationId++;
+}
+
+void FRpcTrace::BeginScope(const TCHAR* Name, uint64 CorrelationId)
+{
+    TCHAR EventName[128];
+    FCString::Snprintf(EventName, ARRAY_COUNT(EventName), TEXT("%s #%llu"), Name, CorrelationId);
+
+#if INFRAWORLD_WITH_INSIGHTS
+    FCpuProfilerTrace::OutputBeginDynamicEvent(EventName);
+#else
+    FPlatformMisc::BeginNamedEvent(FColor(90, 160, 220), EventName);
+#endif
+}
+
+void FRpcTrace::EndScope()
+{
+#if INFRAWORLD_WITH_INSIGHTS
+    FCpuProfilerTrace::OutputEndEvent();
+#else
+    FPlatformMisc::EndNamedEvent();
+#endif
+}
@@ -0,0 +1,460 @@
+/*
+ * Copyright 2018 Vizor Games LLC
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS, WITHOUT
+ * WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.See the
+ * License for the specific language governing permissions and limitations
+ * under the License.
+ */
+#include "RpcTrafficLog.h"
+
+#if !UE_BUILD_SHIPPING
+
+#include "CompiledContext.h"
+#include "InfraworldRuntime.h"
+#include "ProtoWireCodec.h"
+
+#include "HAL/FileManager.h"
+#include "HAL/IConsoleManager.h"
+#include "HAL/PlatformTime.h"
+#include "Misc/DateTime.h"
+#include "Misc/FileHelper.h"
+#include "Misc/Paths.h"
+#include "Misc/ScopeLock.h"
+#include "Serialization/Archive.h"
+
+#include <vector>
+
+#include "GrpcIncludesBegin.h"
+
+#include <google/protobuf/message_lite.h>
+#include <grpcpp/support/byte_buffer.h>
+
+#include "GrpcIncludesEnd.h"
+
+/*
+ * Layout of a log (all numbers are little-endian):
+ *
+ *     Header:  uint32 Magic, uint32 Version
+ *     Records: uint8 Kind, followed by
+ *         Method: Blob Path (methods are numbered in order of appearance)
+ *         Call:   int32 MethodIndex, double StartSeconds, double DurationSeconds, Blob Context, Blob Status,
+ *                 Blob Request, Blob Response
+ *
+ * A Blob is an int32 size followed by bytes. Contexts and statuses are encoded by FProtoWireCodec, fields are numbered
+ * in declaration order.
+ */
+class FRpcTrafficLog_Internal
+{
+public:
+    static const uint32 Magic = 0x4C545749; // "IWTL"
+    static const uint32 Version = 1;
+
+    enum class ERecordKind : uint8
+    {
+        Method = 0,
+        Call = 1
+    };
+
+    static FCriticalSection Lock;
+    static TUniquePtr<FArchive> Writer;
+    static TMap<FString, int32> MethodIndices;
+    static double StartTime;
+    static int64 NumCalls;
+    static int64 NumSkipped;
+
+    /** Metadata keys, values of which aren't recorded. Guarded by Lock. */
+    static TArray<FString> RedactedMetadataKeys;
+
+    static bool ShouldRedact(const FString& Key);
+
+    static void Write(const char* MethodPath, double SendTime, double ReceiveTime, const FGrpcClientContext& Context,
+        const TArray<uint8>& Request, const TArray<uint8>& Response, const FGrpcStatus& Status);
+
+    static void SerializeMessage(const google::protobuf::MessageLite& Message, TArray<uint8>& OutBytes)
+    {
+        OutBytes.SetNumUninitialized(static_cast<int32>(Message.ByteSizeLong()));
+        Message.SerializeWithCachedSizesToArray(OutBytes.GetData());
+    }
+
+    static void SerializeBuffer(const grpc::ByteBuffer& Buffer, TArray<uint8>& OutBytes)
+    {
+        std::vector<grpc::Slice> Slices;
+        if (!Buffer.Dump(&Slices).ok())
+            return;
+
+        OutBytes.Reserve(static_cast<int32>(Buffer.Length()));
+        for (const grpc::Slice& Slice : Slices)
+            OutBytes.Append(Slice.begin(), static_cast<int32>(Slice.size()));
+    }
+
+    template<class T>
+    static FORCEINLINE void Append(TArray<uint8>& Bytes, const T& Value)
+    {
+        Bytes.Append(reinterpret_cast<const uint8*>(&Value), sizeof(T));
+    }
+
+    static void AppendBlob(TArray<uint8>& Bytes, const uint8* Data, int32 Num)
+    {
+        Append(Bytes, Num);
+        Bytes.Append(Data, Num);
+    }
+
+    /**
+     * Reads a log sequentially, checking bounds.
+     */
+    class FReader
+    {
+    public:
+        explicit FReader(const TArray<uint8>& InBytes) : Bytes(InBytes), Offset(0)
+        {
+        }
+
+        FORCEINLINE bool IsAtEnd() const
+        {
+            return Offset >= Bytes.Num();
+        }
+
+        template<class T>
+        bool Read(T& OutValue)
+        {
+            if (Bytes.Num() - Offset < static_cast<int32>(sizeof(T)))
+                return false;
+
+            FMemory::Memcpy(&OutValue, Bytes.GetData() + Offset, sizeof(T));
+            Offset += sizeof(T);
+            return true;
+        }
+
+        bool ReadBlob(const uint8*& OutData, int32& OutNum)
+        {
+            if (!Read(OutNum) || OutNum < 0 || OutNum > Bytes.Num() - Offset)
+                return false;
+
+            OutData = Bytes.GetData() + Offset;
+            Offset += OutNum;
+            return true;
+        }
+
+    private:
+        const TArray<uint8>& Bytes;
+        int32 Offset;
+    };
+
+    static bool ReadCall(FReader& Reader, const TArray<std::string>& Methods, FRpcTrafficLogEntry& OutEntry);
+
+    static void StartFromConsole(const TArray<FString>& Args);
+    static void StopFromConsole(const TArray<FString>& Args);
+};
+
+FCriticalSection FRpcTrafficLog_Internal::Lock;
+TUniquePtr<FArchive> FRpcTrafficLog_Internal::Writer;
+TMap<FString, int32> FRpcTrafficLog_Internal::MethodIndices;
+double FRpcTrafficLog_Internal::StartTime = 0.0;
+int64 FRpcTrafficLog_Internal::NumCalls = 0;
+int64 FRpcTrafficLog_Internal::NumSkipped = 0;
+TArray<FString> FRpcTrafficLog_Internal::RedactedMetadataKeys = {
+    TEXT("proxy-authorization"), TEXT("cookie"), TEXT("x-api-key"), TEXT("*token*"), TEXT("*-bin")
+};
+
+bool FRpcTrafficLog_Internal::ShouldRedact(const FString& Key)
+{
+    if (Key.Equals(TEXT("authorization"), ESearchCase::IgnoreCase))
+        return true;
+
+    for (const FString& Pattern : RedactedMetadataKeys)
+    {
+        if (Key.MatchesWildcard(Pattern, ESearchCase::IgnoreCase))
+            return true;
+    }
+
+    return false;
+}
+
+void FRpcTrafficLog_Internal::Write(const char* MethodPath, double SendTime, double ReceiveTime, const FGrpcClientContext& Context,
+    const TArray<uint8>& Request, const TArray<uint8>& Response, const FGrpcStatus& Status)
+{
+    // Shared metadata isn't a UPROPERTY, so it's merged into the context being recorded.
+    if (Context.Shared.IsValid())
+        return Write(MethodPath, SendTime, ReceiveTime, FGrpcCompiledContext::Flatten(Context), Request, Response, Status);
+
+    FScopeLock ScopeLock(&Lock);
+
+    // Recording could have been stopped since the check.
+    if (!Writer)
+        return;
+
+    // Credentials mustn't end up in a log file, so the context is copied only if it carries any.
+    const FGrpcClientContext* RecordedContext = &Context;
+    FGrpcClientContext RedactedContext;
+
+    for (const TPair<FString, FString>& Pair : Context.Metadata)
+    {
+        if (ShouldRedact(Pair.Key))
+        {
+            RedactedContext = Context;
+            for (TPair<FString, FString>& RedactedPair : RedactedContext.Metadata)
+            {
+                if (ShouldRedact(RedactedPair.Key))
+                    RedactedPair.Value = TEXT("<redacted>");
+            }
+
+            RecordedContext = &RedactedContext;
+            break;
+        }
+    }
+
+    TArray<uint8> ContextBytes;
+    TArray<uint8> StatusBytes;
+
+    if (!FProtoWireCodec::Encode(*RecordedContext, ContextBytes, EProtoFieldNumbering::DeclarationOrder) ||
+        !FProtoWireCodec::Encode(Status, StatusBytes, EProtoFieldNumbering::DeclarationOrder))
+        return;
+
+    // Methods without a service (their paths couldn't be inferred) can't be replayed.
+    if (!MethodPath || !*MethodPath)
+    {
+        NumSkipped++;
+        return;
+    }
+
+    TArray<uint8> Record;
+    Record.Reserve(64 + ContextBytes.Num() + StatusBytes.Num() + Request.Num() + Response.Num());
+
+    const FString Path = UTF8_TO_TCHAR(MethodPath);
+    const int32* const ExistingIndex = MethodIndices.Find(Path);
+    const int32 MethodIndex = ExistingIndex ? *ExistingIndex : MethodIndices.Num();
+
+    if (!ExistingIndex)
+    {
+        MethodIndices.Add(Path, MethodIndex);
+
+        Append(Record, ERecordKind::Method);
+        AppendBlob(Record, reinterpret_cast<const uint8*>(MethodPath), FCStringAnsi::Strlen(MethodPath));
+    }
+
+    Append(Record, ERecordKind::Call);
+    Append(Record, MethodIndex);
+    Append(Record, SendTime - StartTime);
+    Append(Record, ReceiveTime - SendTime);
+    AppendBlob(Record, ContextBytes.GetData(), ContextBytes.Num());
+    AppendBlob(Record, StatusBytes.GetData(), StatusBytes.Num());
+    AppendBlob(Record, Request.GetData(), Request.Num());
+    AppendBlob(Record, Response.GetData(), Response.Num());
+
+    Writer->Serialize(Record.GetData(), Record.Num());
+    NumCalls++;
+}
+
+bool FRpcTrafficLog_Internal::ReadCall(FReader& Reader, const TArray<std::string>& Methods, FRpcTrafficLogEntry& OutEntry)
+{
+    int32 MethodIndex;
+    if (!Reader.Read(MethodIndex) || !Methods.IsValidIndex(MethodIndex))
+        return false;
+
+    if (!Reader.Read(OutEntry.StartSeconds) || !Reader.Read(OutEntry.DurationSeconds))
+        return false;
+
+    const uint8* Data;
+    int32 Num;
+
+    if (!Reader.ReadBlob(Data, Num) || !FProtoWireCodec::Decode(Data, Num, OutEntry.Context, EProtoFieldNumbering::DeclarationOrder))
+        return false;
+
+    if (!Reader.ReadBlob(Data, Num) || !FProtoWireCodec::Decode(Data, Num, OutEntry.Status, EProtoFieldNumbering::DeclarationOrder))
+        return false;
+
+    if (!Reader.ReadBlob(Data, Num))
+        return false;
+    OutEntry.Request = TArray<uint8>(Data, Num);
+
+    if (!Reader.ReadBlob(Data, Num))
+        return false;
+    OutEntry.Response = TArray<uint8>(Data, Num);
+
+    OutEntry.MethodPath = Methods[MethodIndex];
+    return true;
+}
+
+void FRpcTrafficLog_Internal::StartFromConsole(const TArray<FString>& Args)
+{
+    const FString Filename = Args.Num() > 0 ? Args[0] :
+        FPaths::ProfilingDir() / TEXT("Infraworld") / FString::Printf(TEXT("Traffic-%s.rpclog"), *FDateTime::Now().ToString());
+
+    if (FRpcTrafficRecorder::Start(Filename))
+        UE_LOG(LogInfraworldRuntime, Display, TEXT("Recording RPC traffic into %s"), *Filename);
+}
+
+void FRpcTrafficLog_Internal::StopFromConsole(const TArray<FString>& Args)
+{
+    FRpcTrafficRecorder::Stop();
+}
+
+static FAutoConsoleCommand CmdInfraworldRecordStart(
+    TEXT("infraworld.Record.Start"),
+    TEXT("Starts recording unary calls of all RPC clients into a binary log, which could be replayed by infraworld.Replay.\n")
+    TEXT("Usage: infraworld.Record.Start [Path.rpclog]"),
+    FConsoleCommandWithArgsDelegate::CreateStatic(&FRpcTrafficLog_Internal::StartFromConsole));
+
+static FAutoConsoleCommand CmdInfraworldRecordStop(
+    TEXT("infraworld.Record.Stop"),
+    TEXT("Stops recording RPC traffic."),
+    FConsoleCommandWithArgsDelegate::CreateStatic(&FRpcTrafficLog_Internal::StopFromConsole));
+
+
+/// FRpcTrafficRecorder interface
+
+TAtomic<bool> FRpcTrafficRecorder::bRecording(false);
+
+bool FRpcTrafficRecorder::Start(const FString& Filename)
+{
+    Stop();
+
+    FScopeLock ScopeLock(&FRpcTrafficLog_Internal::Lock);
+
+    FArchive* const Writer = IFileManager::Get().CreateFileWriter(*Filename);
+    if (!Writer)
+    {
+        UE_LOG(LogInfraworldRuntime, Error, TEXT("Unable to create an RPC traffic log %s"), *Filename);
+        return false;
+    }
+
+    uint32 Header[] = { FRpcTrafficLog_Internal::Magic, FRpcTrafficLog_Internal::Version };
+    Writer->Serialize(Header, sizeof(Header));
+
+    FRpcTrafficLog_Internal::Writer = TUniquePtr<FArchive>(Writer);
+    FRpcTrafficLog_Internal::StartTime = FPlatformTime::Seconds();
+    FRpcTrafficLog_Internal::NumCalls = 0;
+    FRpcTrafficLog_Internal::NumSkipped = 0;
+
+    bRecording = true;
+    return true;
+}
+
+void FRpcTrafficRecorder::Stop()
+{
+    FScopeLock ScopeLock(&FRpcTrafficLog_Internal::Lock);
+
+    if (!FRpcTrafficLog_Internal::Writer)
+        return;
+
+    bRecording = false;
+
+    FRpcTrafficLog_Internal::Writer->Close();
+    FRpcTrafficLog_Internal::Writer.Reset();
+    FRpcTrafficLog_Internal::MethodIndices.Empty();
+
+    UE_LOG(LogInfraworldRuntime, Display, TEXT("RPC traffic recording has been stopped: %lld calls recorded, %lld calls of unknown methods skipped"),
+        FRpcTrafficLog_Internal::NumCalls, FRpcTrafficLog_Internal::NumSkipped);
+}
+
+void FRpcTrafficRecorder::SetRedactedMetadataKeys(const TArray<FString>& Keys)
+{
+    FScopeLock ScopeLock(&FRpcTrafficLog_Internal::Lock);
+    FRpcTrafficLog_Internal::RedactedMetadataKeys = Keys;
+}
+
+void FRpcTrafficRecorder::Record(const char* MethodPath, double SendTime, double ReceiveTime, const FGrpcClientContext& Context,
+    const google::protobuf::MessageLite& Request, const google::protobuf::MessageLite* Response, const FGrpcStatus& Status)
+{
+    TArray<uint8> RequestBytes;
+    TArray<uint8> ResponseBytes;
+
+    FRpcTrafficLog_Internal::SerializeMessage(Request, RequestBytes);
+    if (Response)
+        FRpcTrafficLog_Internal::SerializeMessage(*Response, ResponseBytes);
+
+    FRpcTrafficLog_Internal::Write(MethodPath, SendTime, ReceiveTime, Context, RequestBytes, ResponseBytes, Status);
+}
+
+void FRpcTrafficRecorder::Record(const char* MethodPath, double SendTime, double ReceiveTime, const FGrpcCompiledContext& Context,
+    const google::protobuf::MessageLite& Request, const google::protobuf::MessageLite* Response, const FGrpcStatus& Status)
+{
+    FGrpcClientContext RestoredContext;
+    Context.Restore(RestoredContext);
+
+    Record(MethodPath, SendTime, ReceiveTime, RestoredContext, Request, Response, Status);
+}
+
+void FRpcTrafficRecorder::Record(const char* MethodPath, double SendTime, double ReceiveTime, const FGrpcClientContext& Context,
+    const grpc::ByteBuffer& Request, const grpc::ByteBuffer* Response, const FGrpcStatus& Status)
+{
+    TArray<uint8> RequestBytes;
+    TArray<uint8> ResponseBytes;
+
+    FRpcTrafficLog_Internal::SerializeBuffer(Request, RequestBytes);
+    if (Response)
+        FRpcTrafficLog_Internal::SerializeBuffer(*Response, ResponseBytes);
+
+    FRpcTrafficLog_Internal::Write(MethodPath, SendTime, ReceiveTime, Context, RequestBytes, ResponseBytes, Status);
+}
+
+
+/// FRpcTrafficLog interface
+
+bool FRpcTrafficLog::Load(const FString& Filename, TArray<FRpcTrafficLogEntry>& OutEntries)
+{
+    TArray<uint8> Bytes;
+    if (!FFileHelper::LoadFileToArray(Bytes, *Filename))
+    {
+        UE_LOG(LogInfraworldRuntime, Error, TEXT("Unable to read an RPC traffic log %s"), *Filename);
+        return false;
+    }
+
+    FRpcTrafficLog_Internal::FReader Reader(Bytes);
+
+    uint32 Magic = 0;
+    uint32 Version = 0;
+
+    if (!Reader.Read(Magic) || !Reader.Read(Version) || Magic != FRpcTrafficLog_Internal::Magic || Version != FRpcTrafficLog_Internal::Version)
+    {
+        UE_LOG(LogInfraworldRuntime, Error, TEXT("%s is not an RPC traffic log (or is of an unsupported version)"), *Filename);
+        return false;
+    }
+
+    TArray<std::string> Methods;
+
+    while (!Reader.IsAtEnd())
+    {
+        FRpcTrafficLog_Internal::ERecordKind Kind;
+        if (!Reader.Read(Kind))
+            break;
+
+        if (Kind == FRpcTrafficLog_Internal::ERecordKind::Method)
+        {
+            const uint8* Data;
+            int32 Num;
+
+            if (!Reader.ReadBlob(Data, Num))
+                break;
+
+            Methods.Add(std::string(reinterpret_cast<const char*>(Data), Num));
+        }
+        else if (Kind == FRpcTrafficLog_Internal::ERecordKind::Call)
+        {
+            FRpcTrafficLogEntry Entry;
+            if (!FRpcTrafficLog_Internal::ReadCall(Reader, Methods, Entry))
+                break;
+
+            OutEntries.Add(MoveTemp(Entry));
+        }
+        else
+        {
+            break;
+        }
+    }
+
+    UE_CLOG(!Reader.IsAtEnd(), LogInfraworldRuntime, Warning, TEXT("RPC traffic log %s is truncated or damaged, %d calls have been read"),
+        *Filename, OutEntries.Num());
+
+    return true;
+}
+
+#endif
@@ -0,0 +1,94 @@
+/*
+ * Copyright 2018 Vizor Games LLC
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS, WITHOUT
+ * WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.See the
+ * License for the specific language governing permissions and limitations
+ * under the License.
+ */
+#include "AdaptiveCompression.h"
+
+#include "Math/RandomStream.h"
+#include "Misc/AutomationTest.h"
+
+#if WITH_DEV_AUTOMATION_TESTS
+
+#include "GrpcIncludesBegin.h"
+
+#include <google/protobuf/wrappers.pb.h>
+
+#include "GrpcIncludesEnd.h"
+
+IMPLEMENT_SIMPLE_AUTOMATION_TEST(FAdaptiveCompressionRatioTest, "Infraworld.AdaptiveCompression.Ratio",
+    EAutomationTestFlags::ApplicationContextMask | EAutomationTestFlags::EngineFilter)
+
+bool FAdaptiveCompressionRatioTest::RunTest(const FString& Parameters)
+{
+    // Every call is sampled and the CPU budget is off, so that only the learned ratio drives the decision.
+    const FAdaptiveCompressionSettings SavedSettings = FAdaptiveCompression::GetSettings();
+
+    FAdaptiveCompressionSettings Settings;
+    Settings.ResampleInterval = 1;
+    Settings.CpuBudget = 0.0f;
+    FAdaptiveCompression::SetSettings(Settings);
+
+    // Requests are several times larger than a sample, so that only a prefix of them is compressed.
+    static constexpr int32 RequestSize = 16 * 1024;
+    static constexpr int32 NumCalls = 32;
+
+    google::protobuf::BytesValue Compressible;
+    while (Compressible.value().size() < RequestSize)
+        Compressible.mutable_value()->append("Infraworld compresses repetitive payloads. ");
+
+    FRandomStream Random(42);
+    google::protobuf::BytesValue Incompressible;
+    for (int32 Index = 0; Index < RequestSize; Index++)
+        Incompressible.mutable_value()->push_back(static_cast<char>(Random.RandRange(0, 255)));
+
+    // The registry outlives the test, so the method may have been sampled by a previous run: the ratio is checked
+    // to move towards each payload's own one, rather than to start from it.
+    const FRpcMethodId Method = FRpcMethodId::Register(TEXT("Infraworld.AdaptiveCompression.Ratio"));
+
+    float PreviousRatio = FAdaptiveCompression::GetLearnedRatio(Method);
+    bool bConverging = true;
+    EGrpcCompressionAlgorithm Algorithm = EGrpcCompressionAlgorithm::CompressNone;
+
+    for (int32 Call = 0; Call < NumCalls; Call++)
+    {
+        Algorithm = FAdaptiveCompression::Choose(Method, Compressible);
+
+        const float Ratio = FAdaptiveCompression::GetLearnedRatio(Method);
+        bConverging &= Ratio >= 0.0f && (PreviousRatio < 0.0f || Ratio <= PreviousRatio);
+        PreviousRatio = Ratio;
+    }
+
+    TestTrue(TEXT("The ratio of a compressible payload is sampled and decreases"), bConverging);
+    TestTrue(TEXT("The ratio of a compressible payload converges"), PreviousRatio < 0.1f);
+    TestTrue(TEXT("A compressible payload is deflated"), Algorithm == EGrpcCompressionAlgorithm::CompressDeflate);
+
+    for (int32 Call = 0; Call < NumCalls; Call++)
+    {
+        Algorithm = FAdaptiveCompression::Choose(Method, Incompressible);
+
+        const float Ratio = FAdaptiveCompression::GetLearnedRatio(Method);
+        bConverging &= Ratio >= PreviousRatio;
+        PreviousRatio = Ratio;
+    }
+
+    TestTrue(TEXT("The ratio of an incompressible payload increases"), bConverging);
+    TestTrue(TEXT("The ratio of an incompressible payload converges"), PreviousRatio > Settings.MaxRatio);
+    TestTrue(TEXT("An incompressible payload isn't compressed"), Algorithm == EGrpcCompressionAlgorithm::CompressNone);
+
+    FAdaptiveCompression::SetSettings(SavedSettings);
+
+    return true;
+}
+
+#endif
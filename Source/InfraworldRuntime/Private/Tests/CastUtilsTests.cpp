@@ -0,0 +1,118 @@
+/*
+ * Copyright 2018 Vizor Games LLC
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS, WITHOUT
+ * WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.See the
+ * License for the specific language governing permissions and limitations
+ * under the License.
+ */
+#include "CastUtils.h"
+#include "Templates/IsFloatingPoint.h"
+
+#include "Misc/AutomationTest.h"
+
+#if WITH_DEV_AUTOMATION_TESTS
+
+class FCastUtilsTests_Internal
+{
+public:
+    // Small sizes cover tails of vectorized loops, the large one covers the bulk path itself.
+    static TArray<int32> GetSizes()
+    {
+        TArray<int32> Sizes;
+        for (int32 Num = 0; Num <= 40; Num++)
+            Sizes.Add(Num);
+
+        Sizes.Add(1000003);
+        return Sizes;
+    }
+
+    template<class T>
+    static T MakeValue(int32 Index)
+    {
+        // Negative, fractional and large magnitudes, which are still exact in every tested type.
+        const int64 Magnitude = (static_cast<int64>(Index) * 7919) % 1000003;
+        return static_cast<T>((Index % 3 == 0) ? -Magnitude : Magnitude) / static_cast<T>(TIsFloatingPoint<T>::Value ? 4 : 1);
+    }
+
+    /**
+     * Checks bulk casts of OutT <-> InT in both directions against per-item Proto_Cast<>() of every element.
+     */
+    template<class OutT, class InT>
+    static bool TestPair(FAutomationTestBase& Test, const TCHAR* Name)
+    {
+        for (const int32 Num : GetSizes())
+        {
+            TArray<InT> Array;
+            casts::_ProtobufArray<InT> Repeated;
+            for (int32 Index = 0; Index < Num; Index++)
+            {
+                Array.Add(MakeValue<InT>(Index));
+                Repeated.Add(MakeValue<InT>(Index));
+            }
+
+            const casts::_ProtobufArray<OutT> ToProto = casts::Proto_ArrayCast<OutT>(Array);
+            const TArray<OutT> ToUnreal = casts::Proto_ArrayCast<OutT>(Repeated);
+
+            if (ToProto.size() != Num || ToUnreal.Num() != Num)
+            {
+                Test.AddError(FString::Printf(TEXT("%s: %d items were cast into %d and %d"), Name, Num, ToProto.size(), ToUnreal.Num()));
+                return false;
+            }
+
+            for (int32 Index = 0; Index < Num; Index++)
+            {
+                const OutT Expected = casts::Proto_Cast<OutT>(Array[Index]);
+                if (ToProto.Get(Index) != Expected || ToUnreal[Index] != Expected)
+                {
+                    Test.AddError(FString::Printf(TEXT("%s: item %d of %d differs from Proto_Cast<>()"), Name, Index, Num));
+                    return false;
+                }
+            }
+        }
+
+        return true;
+    }
+};
+
+IMPLEMENT_SIMPLE_AUTOMATION_TEST(FCastUtilsArrayCastTest, "Infraworld.CastUtils.NumericArrays",
+    EAutomationTestFlags::ApplicationContextMask | EAutomationTestFlags::EngineFilter)
+
+bool FCastUtilsArrayCastTest::RunTest(const FString& Parameters)
+{
+    typedef FCastUtilsTests_Internal FTests;
+
+    // Same types (memcpy).
+    FTests::TestPair<int32, int32>(*this, TEXT("int32 <- int32"));
+    FTests::TestPair<int64, int64>(*this, TEXT("int64 <- int64"));
+    FTests::TestPair<float, float>(*this, TEXT("float <- float"));
+    FTests::TestPair<double, double>(*this, TEXT("double <- double"));
+
+    // Same-sized integers (memcpy), as uint32 fields are exposed to Blueprints.
+    FTests::TestPair<int32, uint32>(*this, TEXT("int32 <- uint32"));
+    FTests::TestPair<uint32, int32>(*this, TEXT("uint32 <- int32"));
+
+    // Widening and narrowing (converting loops).
+    FTests::TestPair<double, float>(*this, TEXT("double <- float"));
+    FTests::TestPair<float, double>(*this, TEXT("float <- double"));
+    FTests::TestPair<int64, int32>(*this, TEXT("int64 <- int32"));
+    FTests::TestPair<int32, int64>(*this, TEXT("int32 <- int64"));
+
+    // The uint32 -> int32 specialization keeps the bit pattern of values above MAX_int32.
+    casts::_ProtobufArray<uint32> Unsigned;
+    Unsigned.Add(0xFFFFFFFFu);
+    Unsigned.Add(0x80000000u);
+    const TArray<int32> Signed = casts::Proto_ArrayCast<int32>(Unsigned);
+    TestTrue(TEXT("uint32 bits are preserved"), Signed.Num() == 2 && Signed[0] == -1 && Signed[1] == MIN_int32);
+
+    return true;
+}
+
+#endif
@@ -0,0 +1,77 @@
+/*
+ * Copyright 2018 Vizor Games LLC
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS, WITHOUT
+ * WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.See the
+ * License for the specific language governing permissions and limitations
+ * under the License.
+ */
+#include "Conduit.h"
+#include "GenUtils.h"
+
+#include "Misc/AutomationTest.h"
+
+#if WITH_DEV_AUTOMATION_TESTS
+
+#include "GrpcIncludesBegin.h"
+
+#include <grpcpp/client_context.h>
+
+#include "GrpcIncludesEnd.h"
+
+IMPLEMENT_SIMPLE_AUTOMATION_TEST(FConduitLatestWinsTest, "Infraworld.Conduit.LatestWins",
+    EAutomationTestFlags::ApplicationContextMask | EAutomationTestFlags::EngineFilter)
+
+bool FConduitLatestWinsTest::RunTest(const FString& Parameters)
+{
+    typedef TRequestWithContext<FByteArray> FRequest;
+
+    // Both ends are driven from this thread, as a worker would dequeue requests.
+    TConduit<FRequest, TResponseWithStatus<FByteArray>> Conduit;
+    Conduit.AcquireRequestsProducer();
+    Conduit.AcquireResponsesProducer();
+    Conduit.EnableLatestWins();
+
+    // Requests share a context, and so the token of the caller.
+    FGrpcClientContext Context;
+    const TSharedRef<FRpcCancellation, ESPMode::ThreadSafe> CallerToken = FRpcCancellation::Attach(Context);
+
+    Conduit.Enqueue(TRequestWithContext$New(FByteArray(), Context));
+    Conduit.Enqueue(TRequestWithContext$New(FByteArray(), Context));
+
+    FRequest First;
+    FRequest Second;
+    if (!TestTrue(TEXT("Both requests are queued"), Conduit.Dequeue(First) && Conduit.Dequeue(Second)))
+        return false;
+
+    TestTrue(TEXT("The superseded request is cancelled"), First.Context.Cancellation.IsValid() && First.Context.Cancellation->IsCancelled());
+    TestTrue(TEXT("The latest request is not cancelled"), Second.Context.Cancellation.IsValid() && !Second.Context.Cancellation->IsCancelled());
+    TestFalse(TEXT("The caller's token is not cancelled"), CallerToken->IsCancelled());
+
+    // The latest request is sent (a worker begins its call the same way), then the caller cancels it in flight.
+    grpc::ClientContext ClientContext;
+    {
+        const FRpcCancellationScope CancellationScope(Second.Context.Cancellation.Get(), ClientContext);
+        TestFalse(TEXT("The latest request is sent"), CancellationScope.IsCancelled());
+
+        CallerToken->Cancel();
+        TestTrue(TEXT("Cancelling the caller's token cancels the latest request"), Second.Context.Cancellation->IsCancelled());
+    }
+
+    Conduit.Enqueue(TRequestWithContext$New(FByteArray(), Context));
+
+    FRequest Third;
+    Conduit.Dequeue(Third);
+    TestTrue(TEXT("Requests with a cancelled caller's token are cancelled"), Third.Context.Cancellation->IsCancelled());
+
+    return true;
+}
+
+#endif
@@ -0,0 +1,80 @@
+/*
+ * Copyright 2018 Vizor Games LLC
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS, WITHOUT
+ * WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.See the
+ * License for the specific language governing permissions and limitations
+ * under the License.
+ */
+#include "LazyResponse.h"
+
+#include "Misc/AutomationTest.h"
+
+#if WITH_DEV_AUTOMATION_TESTS
+
+#include "GrpcIncludesBegin.h"
+
+#include <google/protobuf/api.pb.h>
+#include <google/protobuf/field_mask.pb.h>
+
+#include "GrpcIncludesEnd.h"
+
+IMPLEMENT_SIMPLE_AUTOMATION_TEST(FLazyResponseCacheTest, "Infraworld.LazyResponse.Cache",
+    EAutomationTestFlags::ApplicationContextMask | EAutomationTestFlags::EngineFilter)
+
+bool FLazyResponseCacheTest::RunTest(const FString& Parameters)
+{
+    using google::protobuf::Api;
+    using google::protobuf::FieldMask;
+    using google::protobuf::Method;
+
+    Api* Proto;
+    const TLazyMessage<Api> Lazy = TLazyMessage<Api>::Create(Proto);
+    Proto->set_name("Api");
+    Proto->set_version("v1");
+    Proto->add_methods()->set_name("First");
+    Proto->add_methods()->set_name("Second");
+
+    // Fields of the same type are cached apart, repeated reads return the cached value.
+    const FString& Name = Lazy.Get<FString>(&Api::name);
+    const FString& Version = Lazy.Get<FString>(&Api::version);
+    TestEqual(TEXT("name"), Name, FString(TEXT("Api")));
+    TestEqual(TEXT("version"), Version, FString(TEXT("v1")));
+    TestTrue(TEXT("A repeated read is cached"), &Lazy.Get<FString>(&Api::name) == &Name);
+
+    // The same field, converted into another type, is a separate entry.
+    TestEqual(TEXT("name as bytes"), Lazy.Get<FByteArray>(&Api::name).Bytes.Num(), 3);
+    TestTrue(TEXT("The string entry is intact"), &Lazy.Get<FString>(&Api::name) == &Name && Name == TEXT("Api"));
+
+    // The same accessor of different sub-messages.
+    const TLazyMessage<Method> First = Lazy.GetMessage(Lazy.GetProto().methods(0));
+    const TLazyMessage<Method> Second = Lazy.GetMessage(Lazy.GetProto().methods(1));
+    TestEqual(TEXT("methods(0).name"), First.Get<FString>(&Method::name), FString(TEXT("First")));
+    TestEqual(TEXT("methods(1).name"), Second.Get<FString>(&Method::name), FString(TEXT("Second")));
+    TestTrue(TEXT("Sub-messages are cached apart"), &First.Get<FString>(&Method::name) != &Second.Get<FString>(&Method::name));
+
+    // Copies of a view share the cache.
+    const TLazyMessage<Api> Copy = Lazy;
+    TestTrue(TEXT("A copy shares the cache"), &Copy.Get<FString>(&Api::name) == &Name);
+
+    // Repeated fields.
+    FieldMask* MaskProto;
+    const TLazyMessage<FieldMask> Mask = TLazyMessage<FieldMask>::Create(MaskProto);
+    MaskProto->add_paths("a.b");
+    MaskProto->add_paths("c");
+
+    const TArray<FString>& Paths = Mask.Get<TArray<FString>>(&FieldMask::paths);
+    TestTrue(TEXT("paths"), Paths.Num() == 2 && Paths[0] == TEXT("a.b") && Paths[1] == TEXT("c"));
+    TestTrue(TEXT("A repeated field is cached"), &Mask.Get<TArray<FString>>(&FieldMask::paths) == &Paths);
+
+    return true;
+}
+
+#endif
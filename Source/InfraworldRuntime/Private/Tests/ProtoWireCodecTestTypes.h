@@ -0,0 +1,291 @@
+/*
+ * Copyright 2018 Vizor Games LLC
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS, WITHOUT
+ * WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.See the
+ * License for the specific language governing permissions and limitations
+ * under the License.
+ */
+#pragma once
+
+#include "CoreMinimal.h"
+#include "GenUtils.h"
+
+#include "ProtoWireCodecTestTypes.generated.h"
+
+// Structs for the wire codec tests. UHT doesn't parse source files, hence the header. Most of them mirror messages,
+// generated code of which ships with protobuf (google/protobuf/*.pb.h), so that encodings could be compared.
+
+/** Mirrors google.protobuf.Syntax. */
+UENUM()
+enum class EProtoCodecTestSyntax : uint8
+{
+    Proto2,
+    Proto3
+};
+
+/** A field of every supported scalar kind. */
+USTRUCT()
+struct FProtoCodecTestScalars
+{
+    GENERATED_USTRUCT_BODY()
+
+    UPROPERTY()
+    int32 Int32Value = 0;
+
+    UPROPERTY()
+    int64 Int64Value = 0;
+
+    UPROPERTY()
+    uint32 UInt32Value = 0;
+
+    UPROPERTY()
+    uint64 UInt64Value = 0;
+
+    UPROPERTY()
+    int32 SInt32Value = 0;
+
+    UPROPERTY()
+    int64 SInt64Value = 0;
+
+    UPROPERTY()
+    uint32 Fixed32Value = 0;
+
+    UPROPERTY()
+    uint64 Fixed64Value = 0;
+
+    UPROPERTY()
+    int32 SFixed32Value = 0;
+
+    UPROPERTY()
+    int64 SFixed64Value = 0;
+
+    UPROPERTY()
+    int32 UnsignedValue = 0;
+
+    UPROPERTY()
+    int64 UnsignedFixedValue = 0;
+
+    UPROPERTY()
+    float FloatValue = 0.f;
+
+    UPROPERTY()
+    double DoubleValue = 0.0;
+
+    UPROPERTY()
+    bool bBoolValue = false;
+
+    UPROPERTY()
+    uint8 ByteValue = 0;
+
+    UPROPERTY()
+    EProtoCodecTestSyntax EnumValue = EProtoCodecTestSyntax::Proto2;
+
+    UPROPERTY()
+    FString StringValue;
+
+    UPROPERTY()
+    FName NameValue;
+
+    UPROPERTY()
+    FText TextValue;
+
+    UPROPERTY()
+    FByteArray BytesValue;
+};
+
+/** Mirrors google.protobuf.Method. */
+USTRUCT()
+struct FProtoCodecTestMethod
+{
+    GENERATED_USTRUCT_BODY()
+
+    UPROPERTY()
+    FString Name;
+
+    UPROPERTY()
+    FString RequestTypeUrl;
+
+    UPROPERTY()
+    bool bRequestStreaming = false;
+
+    UPROPERTY()
+    FString ResponseTypeUrl;
+
+    UPROPERTY()
+    bool bResponseStreaming = false;
+
+    UPROPERTY()
+    EProtoCodecTestSyntax Syntax = EProtoCodecTestSyntax::Proto2;
+};
+
+/** Mirrors google.protobuf.SourceContext. */
+USTRUCT()
+struct FProtoCodecTestSourceContext
+{
+    GENERATED_USTRUCT_BODY()
+
+    UPROPERTY()
+    FString FileName;
+};
+
+/** Mirrors google.protobuf.Api: nested and repeated messages. */
+USTRUCT()
+struct FProtoCodecTestApi
+{
+    GENERATED_USTRUCT_BODY()
+
+    UPROPERTY()
+    FString Name;
+
+    UPROPERTY()
+    TArray<FProtoCodecTestMethod> Methods;
+
+    UPROPERTY()
+    FString Version;
+
+    UPROPERTY()
+    FProtoCodecTestSourceContext SourceContext;
+
+    UPROPERTY()
+    EProtoCodecTestSyntax Syntax = EProtoCodecTestSyntax::Proto2;
+};
+
+/** Mirrors google.protobuf.SourceCodeInfo.Location: packed repeated scalars and repeated strings. */
+USTRUCT()
+struct FProtoCodecTestLocation
+{
+    GENERATED_USTRUCT_BODY()
+
+    UPROPERTY()
+    TArray<int32> Path;
+
+    UPROPERTY()
+    TArray<int32> Span;
+
+    UPROPERTY()
+    FString LeadingComments;
+
+    UPROPERTY()
+    FString TrailingComments;
+
+    UPROPERTY()
+    TArray<FString> LeadingDetachedComments;
+};
+
+/** Mirrors a part of google.protobuf.FileDescriptorProto: unpacked repeated scalars. */
+USTRUCT()
+struct FProtoCodecTestDependencies
+{
+    GENERATED_USTRUCT_BODY()
+
+    UPROPERTY()
+    FString Name;
+
+    UPROPERTY()
+    TArray<int32> PublicDependencies;
+
+    UPROPERTY()
+    TArray<int32> WeakDependencies;
+};
+
+/** Mirrors google.protobuf.Value, except for the null, struct and list kinds. */
+USTRUCT()
+struct FProtoCodecTestValue
+{
+    GENERATED_USTRUCT_BODY()
+
+    UPROPERTY()
+    double NumberValue = 0.0;
+
+    UPROPERTY()
+    FString StringValue;
+
+    UPROPERTY()
+    bool bBoolValue = false;
+};
+
+/** Mirrors google.protobuf.Struct: a map with message values. */
+USTRUCT()
+struct FProtoCodecTestStruct
+{
+    GENERATED_USTRUCT_BODY()
+
+    UPROPERTY()
+    TMap<FString, FProtoCodecTestValue> Fields;
+};
+
+/** Repeated and map fields of every kind, for round trips. */
+USTRUCT()
+struct FProtoCodecTestContainers
+{
+    GENERATED_USTRUCT_BODY()
+
+    UPROPERTY()
+    TArray<int32> Int32s;
+
+    UPROPERTY()
+    TArray<int64> SInt64s;
+
+    UPROPERTY()
+    TArray<uint32> Fixed32s;
+
+    UPROPERTY()
+    TArray<float> Floats;
+
+    UPROPERTY()
+    TArray<double> Doubles;
+
+    UPROPERTY()
+    TArray<bool> Bools;
+
+    UPROPERTY()
+    TArray<EProtoCodecTestSyntax> Enums;
+
+    UPROPERTY()
+    TArray<FString> Strings;
+
+    UPROPERTY()
+    TArray<FName> Names;
+
+    UPROPERTY()
+    TArray<FText> Texts;
+
+    UPROPERTY()
+    TArray<FByteArray> Blobs;
+
+    UPROPERTY()
+    TArray<FProtoCodecTestMethod> Messages;
+
+    UPROPERTY()
+    TMap<int32, FString> StringsById;
+
+    UPROPERTY()
+    TMap<FName, int64> SInt64sByName;
+
+    UPROPERTY()
+    TMap<FString, FProtoCodecTestMethod> MethodsByName;
+};
+
+/** Has no registered field numbers, only encodable with EProtoFieldNumbering::DeclarationOrder. */
+USTRUCT()
+struct FProtoCodecTestUnregistered
+{
+    GENERATED_USTRUCT_BODY()
+
+    UPROPERTY()
+    int32 Id = 0;
+
+    UPROPERTY()
+    FString Label;
+
+    UPROPERTY()
+    TArray<FProtoCodecTestMethod> Methods;
+};
@@ -0,0 +1,629 @@
+/*
+ * Copyright 2018 Vizor Games LLC
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS, WITHOUT
+ * WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.See the
+ * License for the specific language governing permissions and limitations
+ * under the License.
+ */
+#include "ProtoWireCodec.h"
+#include "ProtoWireCodecTestTypes.h"
+
+#include "Misc/AutomationTest.h"
+
+#if WITH_DEV_AUTOMATION_TESTS
+
+#include "GrpcIncludesBegin.h"
+
+#include <google/protobuf/api.pb.h>
+#include <google/protobuf/descriptor.pb.h>
+#include <google/protobuf/io/coded_stream.h>
+#include <google/protobuf/io/zero_copy_stream_impl_lite.h>
+#include <google/protobuf/struct.pb.h>
+#include <google/protobuf/wire_format_lite.h>
+#include <google/protobuf/wrappers.pb.h>
+
+#include "GrpcIncludesEnd.h"
+
+#include <string>
+
+#define PROTO_CODEC_TEST_FIELD(Struct, Member, ...) FProtoFieldSpec(GET_MEMBER_NAME_CHECKED(Struct, Member), __VA_ARGS__)
+
+class FProtoWireCodecTests_Internal
+{
+public:
+    // Field numbers of the mirrored structs are those of the protobuf messages.
+    static void RegisterFields()
+    {
+        static bool bRegistered = false;
+        if (bRegistered)
+            return;
+
+        bRegistered = true;
+
+        FProtoWireCodec::RegisterFields(FProtoCodecTestScalars::StaticStruct(), {
+            PROTO_CODEC_TEST_FIELD(FProtoCodecTestScalars, Int32Value, 1),
+            PROTO_CODEC_TEST_FIELD(FProtoCodecTestScalars, Int64Value, 2),
+            PROTO_CODEC_TEST_FIELD(FProtoCodecTestScalars, UInt32Value, 3),
+            PROTO_CODEC_TEST_FIELD(FProtoCodecTestScalars, UInt64Value, 4),
+            PROTO_CODEC_TEST_FIELD(FProtoCodecTestScalars, SInt32Value, 5, EProtoFieldEncoding::ZigZag),
+            PROTO_CODEC_TEST_FIELD(FProtoCodecTestScalars, SInt64Value, 6, EProtoFieldEncoding::ZigZag),
+            PROTO_CODEC_TEST_FIELD(FProtoCodecTestScalars, Fixed32Value, 7, EProtoFieldEncoding::Fixed),
+            PROTO_CODEC_TEST_FIELD(FProtoCodecTestScalars, Fixed64Value, 8, EProtoFieldEncoding::Fixed),
+            PROTO_CODEC_TEST_FIELD(FProtoCodecTestScalars, SFixed32Value, 9, EProtoFieldEncoding::Fixed),
+            PROTO_CODEC_TEST_FIELD(FProtoCodecTestScalars, SFixed64Value, 10, EProtoFieldEncoding::Fixed),
+            PROTO_CODEC_TEST_FIELD(FProtoCodecTestScalars, UnsignedValue, 11, EProtoFieldEncoding::Unsigned),
+            PROTO_CODEC_TEST_FIELD(FProtoCodecTestScalars, UnsignedFixedValue, 12, EProtoFieldEncoding::UnsignedFixed),
+            PROTO_CODEC_TEST_FIELD(FProtoCodecTestScalars, FloatValue, 13),
+            PROTO_CODEC_TEST_FIELD(FProtoCodecTestScalars, DoubleValue, 14),
+            PROTO_CODEC_TEST_FIELD(FProtoCodecTestScalars, bBoolValue, 15),
+            PROTO_CODEC_TEST_FIELD(FProtoCodecTestScalars, ByteValue, 16),
+            PROTO_CODEC_TEST_FIELD(FProtoCodecTestScalars, EnumValue, 17),
+            PROTO_CODEC_TEST_FIELD(FProtoCodecTestScalars, StringValue, 18),
+            PROTO_CODEC_TEST_FIELD(FProtoCodecTestScalars, NameValue, 19),
+            PROTO_CODEC_TEST_FIELD(FProtoCodecTestScalars, TextValue, 20),
+            PROTO_CODEC_TEST_FIELD(FProtoCodecTestScalars, BytesValue, 21)
+        });
+
+        FProtoWireCodec::RegisterFields(FProtoCodecTestMethod::StaticStruct(), {
+            PROTO_CODEC_TEST_FIELD(FProtoCodecTestMethod, Name, 1),
+            PROTO_CODEC_TEST_FIELD(FProtoCodecTestMethod, RequestTypeUrl, 2),
+            PROTO_CODEC_TEST_FIELD(FProtoCodecTestMethod, bRequestStreaming, 3),
+            PROTO_CODEC_TEST_FIELD(FProtoCodecTestMethod, ResponseTypeUrl, 4),
+            PROTO_CODEC_TEST_FIELD(FProtoCodecTestMethod, bResponseStreaming, 5),
+            PROTO_CODEC_TEST_FIELD(FProtoCodecTestMethod, Syntax, 7)
+        });
+
+        FProtoWireCodec::RegisterFields(FProtoCodecTestSourceContext::StaticStruct(), {
+            PROTO_CODEC_TEST_FIELD(FProtoCodecTestSourceContext, FileName, 1)
+        });
+
+        FProtoWireCodec::RegisterFields(FProtoCodecTestApi::StaticStruct(), {
+            PROTO_CODEC_TEST_FIELD(FProtoCodecTestApi, Name, 1),
+            PROTO_CODEC_TEST_FIELD(FProtoCodecTestApi, Methods, 2),
+            PROTO_CODEC_TEST_FIELD(FProtoCodecTestApi, Version, 4),
+            PROTO_CODEC_TEST_FIELD(FProtoCodecTestApi, SourceContext, 5),
+            PROTO_CODEC_TEST_FIELD(FProtoCodecTestApi, Syntax, 7)
+        });
+
+        FProtoWireCodec::RegisterFields(FProtoCodecTestLocation::StaticStruct(), {
+            PROTO_CODEC_TEST_FIELD(FProtoCodecTestLocation, Path, 1),
+            PROTO_CODEC_TEST_FIELD(FProtoCodecTestLocation, Span, 2),
+            PROTO_CODEC_TEST_FIELD(FProtoCodecTestLocation, LeadingComments, 3),
+            PROTO_CODEC_TEST_FIELD(FProtoCodecTestLocation, TrailingComments, 4),
+            PROTO_CODEC_TEST_FIELD(FProtoCodecTestLocation, LeadingDetachedComments, 6)
+        });
+
+        FProtoWireCodec::RegisterFields(FProtoCodecTestDependencies::StaticStruct(), {
+            PROTO_CODEC_TEST_FIELD(FProtoCodecTestDependencies, Name, 1),
+            PROTO_CODEC_TEST_FIELD(FProtoCodecTestDependencies, PublicDependencies, 10),
+            PROTO_CODEC_TEST_FIELD(FProtoCodecTestDependencies, WeakDependencies, 11)
+        });
+
+        FProtoWireCodec::RegisterFields(FProtoCodecTestValue::StaticStruct(), {
+            PROTO_CODEC_TEST_FIELD(FProtoCodecTestValue, NumberValue, 2),
+            PROTO_CODEC_TEST_FIELD(FProtoCodecTestValue, StringValue, 3),
+            PROTO_CODEC_TEST_FIELD(FProtoCodecTestValue, bBoolValue, 4)
+        });
+
+        FProtoWireCodec::RegisterFields(FProtoCodecTestStruct::StaticStruct(), {
+            PROTO_CODEC_TEST_FIELD(FProtoCodecTestStruct, Fields, 1)
+        });
+
+        FProtoWireCodec::RegisterFields(FProtoCodecTestContainers::StaticStruct(), {
+            PROTO_CODEC_TEST_FIELD(FProtoCodecTestContainers, Int32s, 1),
+            PROTO_CODEC_TEST_FIELD(FProtoCodecTestContainers, SInt64s, 2, EProtoFieldEncoding::ZigZag),
+            PROTO_CODEC_TEST_FIELD(FProtoCodecTestContainers, Fixed32s, 3, EProtoFieldEncoding::Fixed),
+            PROTO_CODEC_TEST_FIELD(FProtoCodecTestContainers, Floats, 4),
+            PROTO_CODEC_TEST_FIELD(FProtoCodecTestContainers, Doubles, 5),
+            PROTO_CODEC_TEST_FIELD(FProtoCodecTestContainers, Bools, 6),
+            PROTO_CODEC_TEST_FIELD(FProtoCodecTestContainers, Enums, 7),
+            PROTO_CODEC_TEST_FIELD(FProtoCodecTestContainers, Strings, 8),
+            PROTO_CODEC_TEST_FIELD(FProtoCodecTestContainers, Names, 9),
+            PROTO_CODEC_TEST_FIELD(FProtoCodecTestContainers, Texts, 10),
+            PROTO_CODEC_TEST_FIELD(FProtoCodecTestContainers, Blobs, 11),
+            PROTO_CODEC_TEST_FIELD(FProtoCodecTestContainers, Messages, 12),
+            PROTO_CODEC_TEST_FIELD(FProtoCodecTestContainers, StringsById, 13),
+            PROTO_CODEC_TEST_FIELD(FProtoCodecTestContainers, SInt64sByName, 14, EProtoFieldEncoding::ZigZag),
+            PROTO_CODEC_TEST_FIELD(FProtoCodecTestContainers, MethodsByName, 15)
+        });
+    }
+
+    static std::string ToStdString(const TArray<uint8>& Bytes)
+    {
+        return std::string(reinterpret_cast<const char*>(Bytes.GetData()), Bytes.Num());
+    }
+
+    static FString Describe(const std::string& Bytes)
+    {
+        FString Result;
+        for (const char Char : Bytes)
+            Result += FString::Printf(TEXT("%02X "), static_cast<uint8>(Char));
+
+        return Result;
+    }
+
+    static bool TestBytes(FAutomationTestBase& Test, const TCHAR* What, const TArray<uint8>& Actual, const std::string& Expected)
+    {
+        const std::string ActualString = ToStdString(Actual);
+        if (ActualString == Expected)
+            return true;
+
+        Test.AddError(FString::Printf(TEXT("%s: expected [%s], got [%s]"), What, *Describe(Expected), *Describe(ActualString)));
+        return false;
+    }
+
+    template<class T>
+    static bool Decode(const std::string& Bytes, T& OutItem)
+    {
+        return FProtoWireCodec::Decode(reinterpret_cast<const uint8*>(Bytes.data()), static_cast<int32>(Bytes.size()), OutItem);
+    }
+
+    template<class T>
+    static bool Decode(const TArray<uint8>& Bytes, T& OutItem, EProtoFieldNumbering Numbering = EProtoFieldNumbering::Registered)
+    {
+        return FProtoWireCodec::Decode(Bytes.GetData(), Bytes.Num(), OutItem, Numbering);
+    }
+
+    template<class T>
+    static bool IsSame(const T& A, const T& B)
+    {
+        return T::StaticStruct()->CompareScriptStruct(&A, &B, PPF_None);
+    }
+
+    static FByteArray MakeBlob(std::initializer_list<uint8> Bytes)
+    {
+        return FByteArray(TArray<uint8>(Bytes));
+    }
+};
+
+IMPLEMENT_SIMPLE_AUTOMATION_TEST(FProtoWireCodecScalarsTest, "Infraworld.ProtoWireCodec.Scalars",
+    EAutomationTestFlags::ApplicationContextMask | EAutomationTestFlags::EngineFilter)
+
+bool FProtoWireCodecScalarsTest::RunTest(const FString& Parameters)
+{
+    typedef FProtoWireCodecTests_Internal FTests;
+    using google::protobuf::internal::WireFormatLite;
+
+    FTests::RegisterFields();
+
+    // Extremes of every kind: sign extension of negative int32, ZigZag, all bits of unsigned and fixed values.
+    FProtoCodecTestScalars Scalars;
+    Scalars.Int32Value = -2;
+    Scalars.Int64Value = -3000000000LL;
+    Scalars.UInt32Value = MAX_uint32;
+    Scalars.UInt64Value = MAX_uint64;
+    Scalars.SInt32Value = MIN_int32;
+    Scalars.SInt64Value = MIN_int64;
+    Scalars.Fixed32Value = 0xDEADBEEF;
+    Scalars.Fixed64Value = 0x0123456789ABCDEFULL;
+    Scalars.SFixed32Value = -42;
+    Scalars.SFixed64Value = -42000000000LL;
+    Scalars.UnsignedValue = -1;
+    Scalars.UnsignedFixedValue = -1;
+    Scalars.FloatValue = 1.5f;
+    Scalars.DoubleValue = -0.25;
+    Scalars.bBoolValue = true;
+    Scalars.ByteValue = 200;
+    Scalars.EnumValue = EProtoCodecTestSyntax::Proto3;
+    Scalars.StringValue = TEXT("Gr\u00FC\u00DFe \U0001F600");
+    Scalars.NameValue = FName(TEXT("Codec"));
+    Scalars.TextValue = FText::FromString(TEXT("Text"));
+    Scalars.BytesValue = FTests::MakeBlob({ 0x00, 0xFF, 0x80, 0x7F });
+
+    // Written by the same routines, that generated messages use.
+    std::string Expected;
+    {
+        google::protobuf::io::StringOutputStream Stream(&Expected);
+        google::protobuf::io::CodedOutputStream Coded(&Stream);
+
+        WireFormatLite::WriteInt32(1, Scalars.Int32Value, &Coded);
+        WireFormatLite::WriteInt64(2, Scalars.Int64Value, &Coded);
+        WireFormatLite::WriteUInt32(3, Scalars.UInt32Value, &Coded);
+        WireFormatLite::WriteUInt64(4, Scalars.UInt64Value, &Coded);
+        WireFormatLite::WriteSInt32(5, Scalars.SInt32Value, &Coded);
+        WireFormatLite::WriteSInt64(6, Scalars.SInt64Value, &Coded);
+        WireFormatLite::WriteFixed32(7, Scalars.Fixed32Value, &Coded);
+        WireFormatLite::WriteFixed64(8, Scalars.Fixed64Value, &Coded);
+        WireFormatLite::WriteSFixed32(9, Scalars.SFixed32Value, &Coded);
+        WireFormatLite::WriteSFixed64(10, Scalars.SFixed64Value, &Coded);
+        WireFormatLite::WriteUInt32(11, static_cast<uint32>(Scalars.UnsignedValue), &Coded);
+        WireFormatLite::WriteFixed64(12, static_cast<uint64>(Scalars.UnsignedFixedValue), &Coded);
+        WireFormatLite::WriteFloat(13, Scalars.FloatValue, &Coded);
+        WireFormatLite::WriteDouble(14, Scalars.DoubleValue, &Coded);
+        WireFormatLite::WriteBool(15, Scalars.bBoolValue, &Coded);
+        WireFormatLite::WriteUInt32(16, Scalars.ByteValue, &Coded);
+        WireFormatLite::WriteEnum(17, static_cast<int32>(Scalars.EnumValue), &Coded);
+        WireFormatLite::WriteString(18, "Gr\xC3\xBC\xC3\x9F" "e \xF0\x9F\x98\x80", &Coded);
+        WireFormatLite::WriteString(19, "Codec", &Coded);
+        WireFormatLite::WriteString(20, "Text", &Coded);
+        WireFormatLite::WriteBytes(21, std::string("\x00\xFF\x80\x7F", 4), &Coded);
+    }
+
+    TArray<uint8> Encoded;
+    TestTrue(TEXT("Encoded"), FProtoWireCodec::Encode(Scalars, Encoded));
+    FTests::TestBytes(*this, TEXT("Scalars"), Encoded, Expected);
+
+    FProtoCodecTestScalars Decoded;
+    TestTrue(TEXT("Decoded"), FTests::Decode(Expected, Decoded));
+    TestTrue(TEXT("Scalars survive a round trip"), FTests::IsSame(Scalars, Decoded));
+
+    // The sign extension of a negative int32 matches the generated code.
+    FProtoCodecTestScalars Negative;
+    Negative.Int32Value = -2;
+
+    google::protobuf::Int32Value NegativeProto;
+    NegativeProto.set_value(-2);
+
+    TestTrue(TEXT("Encoded"), FProtoWireCodec::Encode(Negative, Encoded));
+    FTests::TestBytes(*this, TEXT("google.protobuf.Int32Value"), Encoded, NegativeProto.SerializeAsString());
+
+    return true;
+}
+
+IMPLEMENT_SIMPLE_AUTOMATION_TEST(FProtoWireCodecDefaultsTest, "Infraworld.ProtoWireCodec.Defaults",
+    EAutomationTestFlags::ApplicationContextMask | EAutomationTestFlags::EngineFilter)
+
+bool FProtoWireCodecDefaultsTest::RunTest(const FString& Parameters)
+{
+    typedef FProtoWireCodecTests_Internal FTests;
+
+    FTests::RegisterFields();
+
+    // Scalars, that have default values, are not written, as in proto3. NAME_None is an empty string.
+    TArray<uint8> Encoded;
+    TestTrue(TEXT("Encoded"), FProtoWireCodec::Encode(FProtoCodecTestScalars(), Encoded));
+    FTests::TestBytes(*this, TEXT("Default scalars"), Encoded, google::protobuf::Int32Value().SerializeAsString());
+
+    FProtoCodecTestMethod Method;
+    Method.Name = TEXT("Ping");
+
+    google::protobuf::Method MethodProto;
+    MethodProto.set_name("Ping");
+
+    TestTrue(TEXT("Encoded"), FProtoWireCodec::Encode(Method, Encoded));
+    FTests::TestBytes(*this, TEXT("Method"), Encoded, MethodProto.SerializeAsString());
+
+    // Decoding resets the struct first.
+    FProtoCodecTestScalars Decoded;
+    Decoded.Int32Value = 1;
+    Decoded.StringValue = TEXT("Stale");
+    TestTrue(TEXT("An empty message is decoded"), FTests::Decode(std::string(), Decoded));
+    TestTrue(TEXT("An empty message gives defaults"), FTests::IsSame(Decoded, FProtoCodecTestScalars()));
+
+    return true;
+}
+
+IMPLEMENT_SIMPLE_AUTOMATION_TEST(FProtoWireCodecMessagesTest, "Infraworld.ProtoWireCodec.Messages",
+    EAutomationTestFlags::ApplicationContextMask | EAutomationTestFlags::EngineFilter)
+
+bool FProtoWireCodecMessagesTest::RunTest(const FString& Parameters)
+{
+    typedef FProtoWireCodecTests_Internal FTests;
+
+    FTests::RegisterFields();
+
+    // The file name is long enough for lengths of both the nested and the outer message to take two bytes.
+    FProtoCodecTestApi Api;
+    Api.Name = TEXT("infraworld.Echo");
+    Api.Methods.AddDefaulted(2);
+    Api.Methods[0].Name = TEXT("Call");
+    Api.Methods[0].RequestTypeUrl = TEXT("type.googleapis.com/infraworld.Request");
+    Api.Methods[0].ResponseTypeUrl = TEXT("type.googleapis.com/infraworld.Response");
+    Api.Methods[0].bResponseStreaming = true;
+    Api.Methods[0].Syntax = EProtoCodecTestSyntax::Proto3;
+    Api.Methods[1].Name = TEXT("Ping");
+    Api.Version = TEXT("v1");
+    Api.SourceContext.FileName = FString::ChrN(300, TEXT('a'));
+    Api.Syntax = EProtoCodecTestSyntax::Proto3;
+
+    google::protobuf::Api Proto;
+    Proto.set_name("infraworld.Echo");
+    google::protobuf::Method* const Call = Proto.add_methods();
+    Call->set_name("Call");
+    Call->set_request_type_url("type.googleapis.com/infraworld.Request");
+    Call->set_response_type_url("type.googleapis.com/infraworld.Response");
+    Call->set_response_streaming(true);
+    Call->set_syntax(google::protobuf::SYNTAX_PROTO3);
+    Proto.add_methods()->set_name("Ping");
+    Proto.set_version("v1");
+    Proto.mutable_source_context()->set_file_name(std::string(300, 'a'));
+    Proto.set_syntax(google::protobuf::SYNTAX_PROTO3);
+
+    const std::string Expected = Proto.SerializeAsString();
+
+    TArray<uint8> Encoded;
+    TestTrue(TEXT("Encoded"), FProtoWireCodec::Encode(Api, Encoded));
+    FTests::TestBytes(*this, TEXT("Api"), Encoded, Expected);
+
+    FProtoCodecTestApi Decoded;
+    TestTrue(TEXT("Decoded"), FTests::Decode(Expected, Decoded));
+    TestTrue(TEXT("Api survives a round trip"), FTests::IsSame(Api, Decoded));
+
+    // Occurrences of a non-repeated message are merged, as in protobuf.
+    google::protobuf::Api First;
+    First.mutable_source_context()->set_file_name("first.proto");
+    First.set_name("First");
+    google::protobuf::Api Second;
+    Second.set_version("v2");
+
+    FProtoCodecTestApi Merged;
+    TestTrue(TEXT("Concatenated messages are decoded"), FTests::Decode(First.SerializeAsString() + Second.SerializeAsString(), Merged));
+    TestTrue(TEXT("Concatenated messages are merged"), Merged.Name == TEXT("First") && Merged.Version == TEXT("v2") &&
+        Merged.SourceContext.FileName == TEXT("first.proto"));
+
+    return true;
+}
+
+IMPLEMENT_SIMPLE_AUTOMATION_TEST(FProtoWireCodecRepeatedTest, "Infraworld.ProtoWireCodec.Repeated",
+    EAutomationTestFlags::ApplicationContextMask | EAutomationTestFlags::EngineFilter)
+
+bool FProtoWireCodecRepeatedTest::RunTest(const FString& Parameters)
+{
+    typedef FProtoWireCodecTests_Internal FTests;
+
+    FTests::RegisterFields();
+
+    // Packed: SourceCodeInfo.Location declares path and span as [packed = true]. The span is long enough for its
+    // length to take two bytes, empty strings of a repeated field are written.
+    FProtoCodecTestLocation Location;
+    Location.Path = { 4, 0, 2, 300, -1 };
+    for (int32 Index = 0; Index < 200; Index++)
+        Location.Span.Add(1000 + Index);
+    Location.LeadingComments = TEXT("Leading");
+    Location.LeadingDetachedComments = { TEXT("First"), TEXT(""), TEXT("Third") };
+
+    google::protobuf::SourceCodeInfo::Location LocationProto;
+    for (const int32 Value : Location.Path)
+        LocationProto.add_path(Value);
+    for (const int32 Value : Location.Span)
+        LocationProto.add_span(Value);
+    LocationProto.set_leading_comments("Leading");
+    LocationProto.add_leading_detached_comments("First");
+    LocationProto.add_leading_detached_comments("");
+    LocationProto.add_leading_detached_comments("Third");
+
+    TArray<uint8> Encoded;
+    TestTrue(TEXT("Encoded"), FProtoWireCodec::Encode(Location, Encoded));
+    FTests::TestBytes(*this, TEXT("Packed"), Encoded, LocationProto.SerializeAsString());
+
+    FProtoCodecTestLocation DecodedLocation;
+    TestTrue(TEXT("Decoded"), FTests::Decode(Encoded, DecodedLocation));
+    TestTrue(TEXT("Location survives a round trip"), FTests::IsSame(Location, DecodedLocation));
+
+    // Unpacked: FileDescriptorProto is proto2, its public_dependency and weak_dependency aren't packed.
+    google::protobuf::FileDescriptorProto FileProto;
+    FileProto.set_name("echo.proto");
+    FileProto.add_public_dependency(1);
+    FileProto.add_public_dependency(300);
+    FileProto.add_weak_dependency(-1);
+
+    FProtoCodecTestDependencies Dependencies;
+    TestTrue(TEXT("Unpacked scalars are decoded"), FTests::Decode(FileProto.SerializeAsString(), Dependencies));
+    TestTrue(TEXT("Unpacked scalars"), Dependencies.Name == TEXT("echo.proto") &&
+        Dependencies.PublicDependencies == TArray<int32>({ 1, 300 }) && Dependencies.WeakDependencies == TArray<int32>({ -1 }));
+
+    // Scalars are always written packed, protobuf accepts both forms regardless of the declaration.
+    TestTrue(TEXT("Encoded"), FProtoWireCodec::Encode(Dependencies, Encoded));
+    TestTrue(TEXT("Written packed"), FTests::ToStdString(Encoded) != FileProto.SerializeAsString());
+
+    google::protobuf::FileDescriptorProto Reparsed;
+    TestTrue(TEXT("Packed scalars are accepted by protobuf"), Reparsed.ParseFromArray(Encoded.GetData(), Encoded.Num()));
+    TestTrue(TEXT("Packed scalars are read by protobuf"), Reparsed.SerializeAsString() == FileProto.SerializeAsString());
+
+    // An element of a mismatching wire type is an unknown field, it doesn't add an element.
+    const TArray<uint8> Mismatching = { 0x50, 0x01, 0x55, 0x01, 0x00, 0x00, 0x00 };
+    TestTrue(TEXT("A mismatching element is skipped"), FTests::Decode(Mismatching, Dependencies) &&
+        Dependencies.PublicDependencies == TArray<int32>({ 1 }));
+
+    return true;
+}
+
+IMPLEMENT_SIMPLE_AUTOMATION_TEST(FProtoWireCodecMapsTest, "Infraworld.ProtoWireCodec.Maps",
+    EAutomationTestFlags::ApplicationContextMask | EAutomationTestFlags::EngineFilter)
+
+bool FProtoWireCodecMapsTest::RunTest(const FString& Parameters)
+{
+    typedef FProtoWireCodecTests_Internal FTests;
+
+    FTests::RegisterFields();
+
+    // A single entry, since the order of map entries is unspecified.
+    FProtoCodecTestStruct Struct;
+    Struct.Fields.Add(TEXT("Answer")).NumberValue = 42.0;
+
+    google::protobuf::Struct Proto;
+    (*Proto.mutable_fields())["Answer"].set_number_value(42.0);
+
+    TArray<uint8> Encoded;
+    TestTrue(TEXT("Encoded"), FProtoWireCodec::Encode(Struct, Encoded));
+    FTests::TestBytes(*this, TEXT("Map entry"), Encoded, Proto.SerializeAsString());
+
+    // Several entries are compared by protobuf.
+    Struct.Fields.Add(TEXT("String")).StringValue = TEXT("Text");
+    Struct.Fields.Add(TEXT("Bool")).bBoolValue = true;
+    TestTrue(TEXT("Encoded"), FProtoWireCodec::Encode(Struct, Encoded));
+
+    google::protobuf::Struct Reparsed;
+    TestTrue(TEXT("Entries are accepted by protobuf"), Reparsed.ParseFromArray(Encoded.GetData(), Encoded.Num()));
+    TestTrue(TEXT("Entries are read by protobuf"), Reparsed.fields_size() == 3 &&
+        Reparsed.fields().at("Answer").number_value() == 42.0 &&
+        Reparsed.fields().at("String").string_value() == "Text" &&
+        Reparsed.fields().at("Bool").bool_value());
+
+    FProtoCodecTestStruct Decoded;
+    TestTrue(TEXT("Decoded"), FTests::Decode(Reparsed.SerializeAsString(), Decoded));
+    TestTrue(TEXT("Map survives a round trip"), FTests::IsSame(Struct, Decoded));
+
+    // Duplicate keys: the last one wins, as in protobuf.
+    google::protobuf::Struct First;
+    (*First.mutable_fields())["Key"].set_number_value(1.0);
+    google::protobuf::Struct Second;
+    (*Second.mutable_fields())["Key"].set_number_value(2.0);
+    const std::string Duplicates = First.SerializeAsString() + Second.SerializeAsString();
+
+    google::protobuf::Struct DuplicatesProto;
+    TestTrue(TEXT("protobuf keeps the last duplicate"), DuplicatesProto.ParseFromString(Duplicates) &&
+        DuplicatesProto.fields().at("Key").number_value() == 2.0);
+
+    TestTrue(TEXT("Duplicate keys are decoded"), FTests::Decode(Duplicates, Decoded));
+    TestTrue(TEXT("The last duplicate wins"), Decoded.Fields.Num() == 1 && Decoded.Fields.FindRef(TEXT("Key")).NumberValue == 2.0);
+
+    // Missing keys and values are defaults.
+    const TArray<uint8> EmptyEntry = { 0x0A, 0x00 };
+    TestTrue(TEXT("An empty entry is decoded"), FTests::Decode(EmptyEntry, Decoded));
+    TestTrue(TEXT("An empty entry has the default key"), Decoded.Fields.Num() == 1 && Decoded.Fields.Contains(FString()));
+
+    return true;
+}
+
+IMPLEMENT_SIMPLE_AUTOMATION_TEST(FProtoWireCodecRoundTripTest, "Infraworld.ProtoWireCodec.RoundTrip",
+    EAutomationTestFlags::ApplicationContextMask | EAutomationTestFlags::EngineFilter)
+
+bool FProtoWireCodecRoundTripTest::RunTest(const FString& Parameters)
+{
+    typedef FProtoWireCodecTests_Internal FTests;
+
+    FTests::RegisterFields();
+
+    FProtoCodecTestMethod Method;
+    Method.Name = TEXT("Call");
+    Method.bRequestStreaming = true;
+
+    FProtoCodecTestContainers Containers;
+    Containers.Int32s = { 0, -1, 300, MAX_int32 };
+    Containers.SInt64s = { MIN_int64, -1, 0, MAX_int64 };
+    Containers.Fixed32s = { 0, MAX_uint32 };
+    Containers.Floats = { 0.f, -1.5f };
+    Containers.Doubles = { 3.25 };
+    Containers.Bools = { true, false, true };
+    Containers.Enums = { EProtoCodecTestSyntax::Proto3, EProtoCodecTestSyntax::Proto2 };
+    Containers.Strings = { TEXT(""), TEXT("\u00FC") };
+    Containers.Names = { FName(TEXT("First")), FName(TEXT("Second")) };
+    Containers.Texts = { FText::FromString(TEXT("Text")) };
+    Containers.Blobs = { FTests::MakeBlob({ 1, 2 }), FByteArray() };
+    Containers.Messages = { Method, FProtoCodecTestMethod() };
+    Containers.StringsById.Add(1, TEXT("One"));
+    Containers.StringsById.Add(-5, TEXT("Minus five"));
+    Containers.StringsById.Add(0, TEXT(""));
+    Containers.SInt64sByName.Add(FName(TEXT("Min")), MIN_int64);
+    Containers.MethodsByName.Add(TEXT("Call"), Method);
+    Containers.MethodsByName.Add(TEXT("Default"), FProtoCodecTestMethod());
+
+    TArray<uint8> Encoded;
+    FProtoCodecTestContainers Decoded;
+    TestTrue(TEXT("Encoded"), FProtoWireCodec::Encode(Containers, Encoded));
+    TestTrue(TEXT("Decoded"), FTests::Decode(Encoded, Decoded));
+    TestTrue(TEXT("Containers survive a round trip"), FTests::IsSame(Containers, Decoded));
+
+    // Structs without registered numbers, as spill files and traffic logs encode them.
+    FProtoCodecTestUnregistered Unregistered;
+    Unregistered.Id = 7;
+    Unregistered.Label = TEXT("Label");
+    Unregistered.Methods.Add(Method);
+
+    FProtoCodecTestUnregistered DecodedUnregistered;
+    TestTrue(TEXT("Encoded in declaration order"), FProtoWireCodec::Encode(Unregistered, Encoded, EProtoFieldNumbering::DeclarationOrder));
+    TestTrue(TEXT("Decoded in declaration order"), FTests::Decode(Encoded, DecodedUnregistered, EProtoFieldNumbering::DeclarationOrder));
+    TestTrue(TEXT("Declaration order survives a round trip"), FTests::IsSame(Unregistered, DecodedUnregistered));
+
+    // ...but they are refused, if registered numbers are required. The error is logged once, when the plan is built.
+    static bool bRefusalLogged = false;
+    if (!bRefusalLogged)
+    {
+        AddExpectedError(TEXT("has no registered field numbers"), EAutomationExpectedErrorFlags::Contains, 1);
+        bRefusalLogged = true;
+    }
+
+    TestFalse(TEXT("An unregistered struct is refused"), FProtoWireCodec::Encode(Unregistered, Encoded));
+
+    return true;
+}
+
+IMPLEMENT_SIMPLE_AUTOMATION_TEST(FProtoWireCodecMalformedTest, "Infraworld.ProtoWireCodec.Malformed",
+    EAutomationTestFlags::ApplicationContextMask | EAutomationTestFlags::EngineFilter)
+
+bool FProtoWireCodecMalformedTest::RunTest(const FString& Parameters)
+{
+    typedef FProtoWireCodecTests_Internal FTests;
+
+    FTests::RegisterFields();
+
+    // FProtoCodecTestScalars: 1 is int32, 7 is fixed32, 8 is fixed64, 18 is a string. 100 is unknown.
+    struct FMalformed
+    {
+        const TCHAR* What;
+        TArray<uint8> Bytes;
+    };
+
+    const FMalformed MalformedScalars[] = {
+        { TEXT("A truncated tag"), { 0x80 } },
+        { TEXT("A tag without a value"), { 0x08 } },
+        { TEXT("A truncated varint"), { 0x08, 0x80 } },
+        { TEXT("A varint longer than 10 bytes"), { 0x08, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x01 } },
+        { TEXT("A tag longer than 10 bytes"), { 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x01, 0x01 } },
+        { TEXT("A truncated fixed32"), { 0x3D, 0x01, 0x02 } },
+        { TEXT("A truncated fixed64"), { 0x41, 0x01, 0x02, 0x03, 0x04, 0x05, 0x06, 0x07 } },
+        { TEXT("A length past the end"), { 0x92, 0x01, 0x05, 'a', 'b' } },
+        { TEXT("A huge length"), { 0x92, 0x01, 0xFF, 0xFF, 0xFF, 0xFF, 0x0F, 'a' } },
+        { TEXT("A length past the end of an unknown field"), { 0xA2, 0x06, 0x03, 'a' } },
+        { TEXT("Wire type 3 (start group)"), { 0x0B } },
+        { TEXT("Wire type 4 (end group)"), { 0x0C } },
+        { TEXT("Wire type 6"), { 0x0E, 0x00 } },
+        { TEXT("Wire type 7"), { 0x0F, 0x00 } },
+        { TEXT("Wire type 3 of an unknown field"), { 0xA3, 0x06 } },
+        { TEXT("Field number 0"), { 0x00, 0x01 } },
+        { TEXT("Field number 2^29"), { 0x80, 0x80, 0x80, 0x80, 0x10, 0x01 } },
+        { TEXT("Field number 2^32 + 1 (1, if truncated)"), { 0x88, 0x80, 0x80, 0x80, 0x80, 0x01, 0x01 } }
+    };
+
+    for (const FMalformed& Case : MalformedScalars)
+    {
+        FProtoCodecTestScalars Scalars;
+        TestFalse(Case.What, FTests::Decode(Case.Bytes, Scalars));
+    }
+
+    // Nested payloads are validated against their own bounds.
+    FProtoCodecTestApi Api;
+    const TArray<uint8> TruncatedNested = { 0x12, 0x02, 0x0A, 0x05 };
+    TestFalse(TEXT("A length past the end of a nested message"), FTests::Decode(TruncatedNested, Api));
+
+    FProtoCodecTestLocation Location;
+    const TArray<uint8> TruncatedPacked = { 0x0A, 0x02, 0x80, 0x80 };
+    TestFalse(TEXT("A truncated varint in a packed field"), FTests::Decode(TruncatedPacked, Location));
+
+    FProtoCodecTestContainers Containers;
+    const TArray<uint8> TruncatedPackedFixed = { 0x1A, 0x03, 0x01, 0x02, 0x03 };
+    TestFalse(TEXT("A truncated fixed32 in a packed field"), FTests::Decode(TruncatedPackedFixed, Containers));
+
+    FProtoCodecTestStruct Struct;
+    const TArray<uint8> TruncatedEntry = { 0x0A, 0x03, 0x0A, 0x05, 'a' };
+    TestFalse(TEXT("A length past the end of a map entry"), FTests::Decode(TruncatedEntry, Struct));
+
+    // Well-formed unknown fields of every wire type and known fields of a mismatching wire type are skipped.
+    const TArray<uint8> Unknown = {
+        0xA0, 0x06, 0x01,
+        0xA5, 0x06, 0x01, 0x02, 0x03, 0x04,
+        0xA1, 0x06, 0x01, 0x02, 0x03, 0x04, 0x05, 0x06, 0x07, 0x08,
+        0xA2, 0x06, 0x01, 'x',
+        0x0D, 0x01, 0x02, 0x03, 0x04,
+        0x10, 0x05
+    };
+
+    FProtoCodecTestScalars Scalars;
+    TestTrue(TEXT("Unknown fields are skipped"), FTests::Decode(Unknown, Scalars));
+    TestTrue(TEXT("Known fields follow unknown ones"), Scalars.Int32Value == 0 && Scalars.Int64Value == 5);
+
+    return true;
+}
+
+#undef PROTO_CODEC_TEST_FIELD
+
+#endif
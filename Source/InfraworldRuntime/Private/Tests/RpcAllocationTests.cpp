@@ -0,0 +1,146 @@
+/*
+ * Copyright 2018 Vizor Games LLC
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS, WITHOUT
+ * WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.See the
+ * License for the specific language governing permissions and limitations
+ * under the License.
+ */
+#include "RpcAllocationCounter.h"
+
+#include "Misc/AutomationTest.h"
+
+#if !UE_BUILD_SHIPPING && WITH_DEV_AUTOMATION_TESTS
+
+#include "ChannelCredentials.h"
+#include "CompiledContext.h"
+#include "Conduit.h"
+#include "InProcessServers.h"
+#include "RpcEchoServer.h"
+#include "RpcEchoStub.h"
+#include "WorkerUtils.h"
+
+/**
+ * A worker, making unary calls to the echo server right on the calling thread, as a generated worker does: requests
+ * are dequeued from a conduit, are passed to AsyncRequest() and their responses are enqueued back.
+ */
+class FRpcAllocationTestWorker : public TStubbedRpcWorker<FRpcEchoStub>
+{
+public:
+    typedef TRequestWithContext<FByteArray> FRequest;
+    typedef TResponseWithStatus<FByteArray> FResponse;
+
+    TConduit<FRequest, FResponse> Conduit;
+
+    /** If valid, requests are made with it instead of their own contexts. */
+    TSharedPtr<const FGrpcCompiledContext, ESPMode::ThreadSafe> CompiledContext;
+
+    virtual bool HierarchicalInit() override
+    {
+        if (!channel::CreateChannel(this))
+            return false;
+
+        Stub = std::unique_ptr<FRpcEchoStub>(new FRpcEchoStub(Channel));
+        return true;
+    }
+
+    virtual void HierarchicalUpdate() override
+    {
+        FRequest RequestWithContext;
+        while (Conduit.Dequeue(RequestWithContext))
+        {
+            if (CompiledContext.IsValid())
+            {
+                Conduit.Enqueue(AsyncRequest<FByteArray, google::protobuf::BytesValue, FByteArray, google::protobuf::BytesValue>(
+                    RequestWithContext.Request, CompiledContext.ToSharedRef(), &FRpcEchoStub::AsyncEcho));
+            }
+            else
+            {
+                Conduit.Enqueue(AsyncRequest<FByteArray, google::protobuf::BytesValue, FByteArray, google::protobuf::BytesValue>(
+                    RequestWithContext.Request, RequestWithContext.Context, &FRpcEchoStub::AsyncEcho));
+            }
+        }
+    }
+
+    /** Makes a call, as a client would: its request and response pass the conduit both ways. */
+    bool Echo(const FByteArray& Request, const FGrpcClientContext& Context)
+    {
+        Conduit.Enqueue(TRequestWithContext$New(Request, Context));
+        HierarchicalUpdate();
+
+        FResponse Response;
+        return Conduit.Dequeue(Response) && Response.Status.ErrorCode == EGrpcStatusCode::Ok;
+    }
+};
+
+IMPLEMENT_SIMPLE_AUTOMATION_TEST(FRpcCallUnaryAllocationTest, "Infraworld.Allocations.CallUnary",
+    EAutomationTestFlags::ApplicationContextMask | EAutomationTestFlags::EngineFilter)
+
+bool FRpcCallUnaryAllocationTest::RunTest(const FString& Parameters)
+{
+    static constexpr int32 NumCalls = 16;
+
+    // A conduit allocates a queue node for every request and every response, nothing else on the path of a call may.
+    static constexpr uint64 AllocationsPerCall = 2;
+
+    FRpcEchoServer Server(false);
+    FString Target;
+    if (!TestTrue(TEXT("The echo server has started"), Server.Start(FString(FGrpcInProcessServers::UriPrefix) + TEXT("InfraworldAllocationTest"), 1, Target)))
+        return false;
+
+    FRpcAllocationTestWorker Worker;
+    Worker.URI = Target;
+    Worker.ChannelCredentials = NewObject<UInsecureChannelCredentials>();
+
+    // Both ends of the conduit are driven from this thread.
+    Worker.Conduit.AcquireRequestsProducer();
+    Worker.Conduit.AcquireResponsesProducer();
+
+    if (!TestTrue(TEXT("The worker has connected"), Worker.HierarchicalInit()))
+        return false;
+
+    // Payloads are empty, so protobuf has no strings to allocate. Only the calling thread is counted, since serving
+    // threads of the echo server allocate their calls. Memory of gRPC core (the inproc transport runs parts of the
+    // server on this thread as well) isn't counted, see FRpcAllocationCounter.
+    const FByteArray Request;
+    const FGrpcClientContext Context;
+    const FGrpcCompiledContextRef Compiled = FGrpcCompiledContext::Compile(Context);
+
+    // The first calls create method metrics and warm up the channel.
+    int32 NumSucceeded = Worker.Echo(Request, Context);
+    Worker.CompiledContext = Compiled;
+    NumSucceeded += Worker.Echo(Request, Context);
+    Worker.CompiledContext.Reset();
+
+    uint64 NumAllocations = 0;
+    uint64 NumCompiledAllocations = 0;
+    {
+        FRpcAllocationCounterScope Counter;
+        for (int32 Call = 0; Call < NumCalls; Call++)
+            NumSucceeded += Worker.Echo(Request, Context);
+
+        NumAllocations = Counter.GetNumAllocationsOnCurrentThread();
+
+        Worker.CompiledContext = Compiled;
+        for (int32 Call = 0; Call < NumCalls; Call++)
+            NumSucceeded += Worker.Echo(Request, Context);
+
+        NumCompiledAllocations = Counter.GetNumAllocationsOnCurrentThread() - NumAllocations;
+    }
+
+    TestEqual(TEXT("Number of successful calls"), NumSucceeded, NumCalls * 2 + 2);
+    TestEqual(TEXT("Allocations of successful calls"), NumAllocations, NumCalls * AllocationsPerCall);
+    TestEqual(TEXT("Allocations of successful calls with a compiled context"), NumCompiledAllocations, NumCalls * AllocationsPerCall);
+
+    Server.Shutdown();
+    return true;
+}
+
+#endif
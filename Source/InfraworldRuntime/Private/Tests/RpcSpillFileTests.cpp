@@ -0,0 +1,297 @@
+/*
+ * Copyright 2018 Vizor Games LLC
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS, WITHOUT
+ * WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.See the
+ * License for the specific language governing permissions and limitations
+ * under the License.
+ */
+#include "RpcSpillFile.h"
+#include "Conduit.h"
+#include "GenUtils.h"
+
+#include "GenericPlatform/GenericPlatformFile.h"
+#include "HAL/PlatformFilemanager.h"
+#include "HAL/PlatformProcess.h"
+#include "Misc/AutomationTest.h"
+#include "Misc/Paths.h"
+
+#if WITH_DEV_AUTOMATION_TESTS
+
+class FRpcSpillFileTests_Internal
+{
+public:
+    typedef TRequestWithContext<FByteArray> FRequest;
+    typedef TConduit<FRequest, TResponseWithStatus<FByteArray>> FConduit;
+
+    /** A request of about a kilobyte, tagged by its index. */
+    static FRequest MakeRequest(int32 Index)
+    {
+        TArray<uint8> Bytes;
+        Bytes.Init(static_cast<uint8>(Index), 1000);
+        return TRequestWithContext$New(FByteArray(Bytes), FGrpcClientContext());
+    }
+
+    static int32 GetIndex(const FRequest& Request)
+    {
+        return (Request.Request.Bytes.Num() > 0) ? Request.Request.Bytes[0] : -1;
+    }
+
+    /** An empty directory, owned by a test. */
+    static FString MakeDirectory(const TCHAR* Name)
+    {
+        const FString Directory = FPaths::AutomationTransientDir() / TEXT("Infraworld") / TEXT("Spill") / Name;
+
+        IPlatformFile& PlatformFile = FPlatformFileManager::Get().GetPlatformFile();
+        PlatformFile.DeleteDirectoryRecursively(*Directory);
+        PlatformFile.CreateDirectoryTree(*Directory);
+        return Directory;
+    }
+
+    static TArray<FString> FindSegments(const FString& Directory)
+    {
+        TArray<FString> Filenames;
+        FPlatformFileManager::Get().GetPlatformFile().FindFiles(Filenames, *Directory, TEXT("spill"));
+        return Filenames;
+    }
+
+    /** Both ends are driven from this thread, as a worker would dequeue requests. */
+    static void EnableSpill(FConduit& Conduit, const FString& Directory, int64 MemoryLimitBytes)
+    {
+        FRpcSpillSettings Settings;
+        Settings.MemoryLimitBytes = MemoryLimitBytes;
+        Settings.SegmentBytes = 4096;
+        Settings.Directory = Directory;
+
+        Conduit.AcquireRequestsProducer();
+        Conduit.AcquireResponsesProducer();
+        Conduit.EnableSpill(Settings);
+    }
+
+    /**
+     * Dequeues up to MaxNum requests, checking that their indices follow each other.
+     *
+     * @return Number of dequeued requests.
+     */
+    static int32 DequeueInOrder(FAutomationTestBase& Test, FConduit& Conduit, int32& InOutNextIndex, int32 MaxNum = MAX_int32)
+    {
+        int32 Num = 0;
+        FRequest Request;
+        while (Num < MaxNum && Conduit.Dequeue(Request))
+        {
+            Test.TestEqual(TEXT("Requests are dequeued in order"), GetIndex(Request), InOutNextIndex);
+            InOutNextIndex = GetIndex(Request) + 1;
+            Num++;
+        }
+
+        return Num;
+    }
+};
+
+IMPLEMENT_SIMPLE_AUTOMATION_TEST(FRpcSpillOrderTest, "Infraworld.Spill.Order",
+    EAutomationTestFlags::ApplicationContextMask | EAutomationTestFlags::EngineFilter)
+
+bool FRpcSpillOrderTest::RunTest(const FString& Parameters)
+{
+    typedef FRpcSpillFileTests_Internal FTests;
+
+    const FString Directory = FTests::MakeDirectory(TEXT("Order"));
+    int32 NextIndex = 0;
+    {
+        // Three requests fit in memory, the rest goes to disk.
+        FTests::FConduit Conduit;
+        FTests::EnableSpill(Conduit, Directory, 4096);
+
+        int32 Index = 0;
+        for (; Index < 10; Index++)
+            Conduit.Enqueue(FTests::MakeRequest(Index));
+
+        TestTrue(TEXT("Requests over the limit are spilled"), FTests::FindSegments(Directory).Num() > 0);
+        TestEqual(TEXT("Spilled requests are queued"), Conduit.GetRequestsDepth(), 10);
+
+        // Requests, enqueued while others are still on disk, follow them, even though the memory queue is drained.
+        TestEqual(TEXT("Requests are dequeued"), FTests::DequeueInOrder(*this, Conduit, NextIndex, 5), 5);
+
+        for (; Index < 13; Index++)
+            Conduit.Enqueue(FTests::MakeRequest(Index));
+
+        TestEqual(TEXT("Requests are dequeued"), FTests::DequeueInOrder(*this, Conduit, NextIndex), 8);
+        TestEqual(TEXT("Drained segments are deleted"), FTests::FindSegments(Directory).Num(), 0);
+
+        // Once the spill is drained, requests are kept in memory again.
+        for (; Index < 15; Index++)
+            Conduit.Enqueue(FTests::MakeRequest(Index));
+
+        TestEqual(TEXT("Requests under the limit are kept in memory"), FTests::FindSegments(Directory).Num(), 0);
+        TestEqual(TEXT("Requests are dequeued"), FTests::DequeueInOrder(*this, Conduit, NextIndex), 2);
+        TestTrue(TEXT("The conduit is empty"), Conduit.IsEmpty() && Conduit.GetRequestsDepth() == 0);
+    }
+
+    FPlatformFileManager::Get().GetPlatformFile().DeleteDirectoryRecursively(*Directory);
+    return NextIndex == 15;
+}
+
+IMPLEMENT_SIMPLE_AUTOMATION_TEST(FRpcSpillSegmentsTest, "Infraworld.Spill.Segments",
+    EAutomationTestFlags::ApplicationContextMask | EAutomationTestFlags::EngineFilter)
+
+bool FRpcSpillSegmentsTest::RunTest(const FString& Parameters)
+{
+    typedef FRpcSpillFileTests_Internal FTests;
+
+    const FString Directory = FTests::MakeDirectory(TEXT("Segments"));
+    {
+        // Records take exactly a kilobyte along with their headers, so a segment holds four of them.
+        const int32 RecordBytes = 1024 - sizeof(int32);
+        FRpcSpillFile File(Directory, TEXT("Segments"), 4096);
+
+        for (int32 Index = 0; Index < 10; Index++)
+        {
+            TArray<uint8> Record;
+            Record.Init(static_cast<uint8>(Index), RecordBytes);
+            TestTrue(TEXT("A record is written"), File.Write(Record));
+        }
+
+        TestEqual(TEXT("Full segments are rolled over"), FTests::FindSegments(Directory).Num(), 3);
+        TestEqual(TEXT("All the records are unread"), File.Num(), 10);
+        TestEqual(TEXT("All the records are on disk"), File.GetDiskBytes(), 10 * 1024ll);
+
+        for (int32 Index = 0; Index < 10; Index++)
+        {
+            TArray<uint8> Record;
+            if (!TestTrue(TEXT("A record is read"), File.Read(Record)))
+                break;
+
+            TestTrue(TEXT("Records are read in order"), Record.Num() == RecordBytes && Record[0] == Index && Record.Last() == Index);
+
+            if (Index == 3)
+            {
+                TestEqual(TEXT("A read segment is deleted"), FTests::FindSegments(Directory).Num(), 2);
+                TestEqual(TEXT("A read segment is no longer on disk"), File.GetDiskBytes(), 6 * 1024ll);
+            }
+        }
+
+        TArray<uint8> Record;
+        TestFalse(TEXT("There's nothing to read"), File.Read(Record));
+        TestTrue(TEXT("All the segments are deleted"), FTests::FindSegments(Directory).Num() == 0 && File.GetDiskBytes() == 0);
+
+        // Writing after the file has been drained starts a new segment.
+        TestTrue(TEXT("A record is written"), File.Write(Record));
+        TestEqual(TEXT("A new segment is started"), FTests::FindSegments(Directory).Num(), 1);
+    }
+
+    TestEqual(TEXT("Segments are deleted along with the file"), FTests::FindSegments(Directory).Num(), 0);
+
+    FPlatformFileManager::Get().GetPlatformFile().DeleteDirectoryRecursively(*Directory);
+    return true;
+}
+
+IMPLEMENT_SIMPLE_AUTOMATION_TEST(FRpcSpillWriteFailureTest, "Infraworld.Spill.WriteFailure",
+    EAutomationTestFlags::ApplicationContextMask | EAutomationTestFlags::EngineFilter)
+
+bool FRpcSpillWriteFailureTest::RunTest(const FString& Parameters)
+{
+    typedef FRpcSpillFileTests_Internal FTests;
+
+    IPlatformFile& PlatformFile = FPlatformFileManager::Get().GetPlatformFile();
+    const FString Directory = FTests::MakeDirectory(TEXT("WriteFailure"));
+
+    AddExpectedError(TEXT("it is kept in memory"), EAutomationExpectedErrorFlags::Contains, 1);
+    AddExpectedError(TEXT("it is dropped"), EAutomationExpectedErrorFlags::Contains, 1);
+
+    {
+        // Nothing has been spilled yet: requests, that can't be written, are kept in memory.
+        const FString Blocked = Directory / TEXT("Blocked");
+        delete PlatformFile.OpenWrite(*Blocked);
+
+        FTests::FConduit Conduit;
+        FTests::EnableSpill(Conduit, Blocked / TEXT("Spill"), 2048);
+
+        for (int32 Index = 0; Index < 5; Index++)
+            TestTrue(TEXT("A request is kept in memory"), Conduit.Enqueue(FTests::MakeRequest(Index)));
+
+        int32 NextIndex = 0;
+        TestEqual(TEXT("No request is lost"), FTests::DequeueInOrder(*this, Conduit, NextIndex), 5);
+    }
+
+    {
+        FTests::FConduit Conduit;
+        FTests::EnableSpill(Conduit, Directory, 2048);
+
+        int32 Index = 0;
+        while (Index < 10 && FTests::FindSegments(Directory).Num() == 0)
+            Conduit.Enqueue(FTests::MakeRequest(Index++));
+
+        const TArray<FString> Segments = FTests::FindSegments(Directory);
+        if (!TestEqual(TEXT("A request is spilled"), Segments.Num(), 1))
+            return false;
+
+        // A directory in place of the next segment fails the rollover.
+        const FString Segment = FPaths::GetBaseFilename(Segments[0]);
+        PlatformFile.CreateDirectory(*(Directory / Segment.LeftChop(1) + TEXT("1.spill")));
+
+        int32 NumDropped = 0;
+        for (; Index < 20; Index++)
+            NumDropped += Conduit.Enqueue(FTests::MakeRequest(Index)) ? 0 : 1;
+
+        TestEqual(TEXT("The request, that can't be spilled, is dropped"), NumDropped, 1);
+        TestEqual(TEXT("The dropped request isn't queued"), Conduit.GetRequestsDepth(), 19);
+
+        // The rest keeps its order.
+        int32 LastIndex = -1;
+        int32 NumDequeued = 0;
+        FTests::FRequest Request;
+        while (Conduit.Dequeue(Request))
+        {
+            TestTrue(TEXT("Requests are dequeued in order"), FTests::GetIndex(Request) > LastIndex);
+            LastIndex = FTests::GetIndex(Request);
+            NumDequeued++;
+        }
+
+        TestEqual(TEXT("All the other requests are dequeued"), NumDequeued, 19);
+        TestEqual(TEXT("The last request is dequeued"), LastIndex, 19);
+    }
+
+    PlatformFile.DeleteDirectoryRecursively(*Directory);
+    return true;
+}
+
+IMPLEMENT_SIMPLE_AUTOMATION_TEST(FRpcSpillStaleSegmentsTest, "Infraworld.Spill.StaleSegments",
+    EAutomationTestFlags::ApplicationContextMask | EAutomationTestFlags::EngineFilter)
+
+bool FRpcSpillStaleSegmentsTest::RunTest(const FString& Parameters)
+{
+    typedef FRpcSpillFileTests_Internal FTests;
+
+    IPlatformFile& PlatformFile = FPlatformFileManager::Get().GetPlatformFile();
+    const FString Directory = FTests::MakeDirectory(TEXT("StaleSegments"));
+
+    // No process has such an id, unlike this one.
+    const FString Stale = Directory / TEXT("Requests-2147483646-0-0.spill");
+    const FString Live = Directory / FString::Printf(TEXT("Requests-%u-1000000-0.spill"), FPlatformProcess::GetCurrentProcessId());
+    const FString Foreign = Directory / TEXT("Telemetry-2147483646-0-0.spill");
+
+    for (const FString& Filename : { Stale, Live, Foreign })
+        delete PlatformFile.OpenWrite(*Filename);
+
+    {
+        FRpcSpillSettings Settings;
+        Settings.Directory = Directory;
+        FRpcRequestSpill Spill(Settings);
+    }
+
+    TestFalse(TEXT("Segments of a dead process are deleted"), PlatformFile.FileExists(*Stale));
+    TestTrue(TEXT("Segments of a running process are kept"), PlatformFile.FileExists(*Live));
+    TestTrue(TEXT("Files, that aren't request segments, are kept"), PlatformFile.FileExists(*Foreign));
+
+    PlatformFile.DeleteDirectoryRecursively(*Directory);
+    return true;
+}
+
+#endif
@@ -0,0 +1,230 @@
+/*
+ * Copyright 2018 Vizor Games LLC
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS, WITHOUT
+ * WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.See the
+ * License for the specific language governing permissions and limitations
+ * under the License.
+ */
+#include "Utf8Conversion.h"
+
+#include "Misc/AutomationTest.h"
+
+#if WITH_DEV_AUTOMATION_TESTS
+
+class FUtf8ConversionTests_Internal
+{
+public:
+    // Lengths cover empty inputs, the 4-unit scalar loop and tails of 16 (SSE2, NEON) and 32 (AVX2) unit blocks.
+    static constexpr int32 MaxLength = 72;
+
+    static bool IsSameChars(const FString& A, const FString& B)
+    {
+        return A.Len() == B.Len() && FMemory::Memcmp(*A, *B, A.Len() * sizeof(TCHAR)) == 0;
+    }
+
+    static FString MakeString(const TArray<TCHAR>& Chars)
+    {
+        return FString(Chars.Num(), Chars.GetData());
+    }
+
+    static std::string Describe(const std::string& Bytes)
+    {
+        static const char Digits[] = "0123456789ABCDEF";
+
+        std::string Result;
+        for (const char Char : Bytes)
+        {
+            Result += Digits[(static_cast<uint8>(Char) >> 4) & 0xF];
+            Result += Digits[static_cast<uint8>(Char) & 0xF];
+            Result += ' ';
+        }
+
+        return Result;
+    }
+};
+
+IMPLEMENT_SIMPLE_AUTOMATION_TEST(FUtf8ConversionEncodeTest, "Infraworld.Utf8Conversion.Encode",
+    EAutomationTestFlags::ApplicationContextMask | EAutomationTestFlags::EngineFilter)
+
+bool FUtf8ConversionEncodeTest::RunTest(const FString& Parameters)
+{
+    typedef FUtf8ConversionTests_Internal FTests;
+
+    // Inserted into ASCII runs at every position, so every kernel meets them at every offset of its blocks.
+    TArray<TArray<TCHAR>> Insertions;
+    Insertions.Add({ static_cast<TCHAR>(0x00E9) });
+    Insertions.Add({ static_cast<TCHAR>(0x20AC) });
+    Insertions.Add({ static_cast<TCHAR>(0x007F) });
+    Insertions.Add({ static_cast<TCHAR>(0x0080) });
+    Insertions.Add({ static_cast<TCHAR>(0x0000) });
+    Insertions.Add({ static_cast<TCHAR>(0xFFFF) });
+    Insertions.Add({ static_cast<TCHAR>(0xDC00) });
+    if (sizeof(TCHAR) == 2)
+    {
+        Insertions.Add({ static_cast<TCHAR>(0xD83D), static_cast<TCHAR>(0xDE00) });
+        Insertions.Add({ static_cast<TCHAR>(0xD83D) });
+    }
+    else
+    {
+        Insertions.Add({ static_cast<TCHAR>(0x1F600) });
+        Insertions.Add({ static_cast<TCHAR>(0x110000) });
+    }
+
+    for (int32 Length = 0; Length <= FTests::MaxLength; Length++)
+    {
+        for (int32 Position = 0; Position <= Length; Position++)
+        {
+            for (const TArray<TCHAR>& Insertion : Insertions)
+            {
+                TArray<TCHAR> Chars;
+                for (int32 Index = 0; Index < Length; Index++)
+                    Chars.Add(static_cast<TCHAR>('a' + Index % 26));
+
+                Chars.Insert(Insertion, Position);
+
+                std::string Vectorized;
+                std::string Scalar;
+                FUtf8Conversion::ToUtf8(Chars.GetData(), Chars.Num(), Vectorized);
+                FUtf8Conversion::ToUtf8Scalar(Chars.GetData(), Chars.Num(), Scalar);
+
+                if (Vectorized != Scalar)
+                {
+                    AddError(FString::Printf(TEXT("Length %d, insertion of U+%04X at %d: kernels produced %s, the scalar path %s"),
+                        Length, static_cast<uint32>(Insertion[0]), Position, UTF8_TO_TCHAR(FTests::Describe(Vectorized).c_str()),
+                        UTF8_TO_TCHAR(FTests::Describe(Scalar).c_str())));
+                    return false;
+                }
+            }
+        }
+    }
+
+    // Known vectors.
+    const TCHAR Euro[] = { 0x20AC };
+    std::string Bytes;
+    FUtf8Conversion::ToUtf8(Euro, 1, Bytes);
+    TestTrue(TEXT("U+20AC is encoded as E2 82 AC"), Bytes == "\xE2\x82\xAC");
+
+    const TCHAR LowSurrogate[] = { 'a', 0xDC00, 'b' };
+    FUtf8Conversion::ToUtf8(LowSurrogate, 3, Bytes);
+    TestTrue(TEXT("An unpaired surrogate is replaced with U+FFFD"), Bytes == "a\xEF\xBF\xBD" "b");
+
+    const TCHAR Nul[] = { 'a', 0, 'b' };
+    FUtf8Conversion::ToUtf8(Nul, 3, Bytes);
+    TestTrue(TEXT("Embedded NULs are preserved"), Bytes == std::string("a\0b", 3));
+
+    if (sizeof(TCHAR) == 2)
+    {
+        const TCHAR Pair[] = { 0xD83D, 0xDE00 };
+        FUtf8Conversion::ToUtf8(Pair, 2, Bytes);
+        TestTrue(TEXT("A surrogate pair is encoded as a single 4-byte sequence"), Bytes == "\xF0\x9F\x98\x80");
+
+        const TCHAR TrailingHigh[] = { 'a', 0xD83D };
+        FUtf8Conversion::ToUtf8(TrailingHigh, 2, Bytes);
+        TestTrue(TEXT("A high surrogate at the end is replaced with U+FFFD"), Bytes == "a\xEF\xBF\xBD");
+    }
+
+    return true;
+}
+
+IMPLEMENT_SIMPLE_AUTOMATION_TEST(FUtf8ConversionDecodeTest, "Infraworld.Utf8Conversion.Decode",
+    EAutomationTestFlags::ApplicationContextMask | EAutomationTestFlags::EngineFilter)
+
+bool FUtf8ConversionDecodeTest::RunTest(const FString& Parameters)
+{
+    typedef FUtf8ConversionTests_Internal FTests;
+
+    // Valid, overlong, surrogate, out of range, truncated and stray sequences, and an embedded NUL.
+    const std::string Insertions[] =
+    {
+        "\xC3\xA9", "\xE2\x82\xAC", "\xF0\x9F\x98\x80", "\xEF\xBF\xBF", "\xF4\x8F\xBF\xBF",
+        "\xC0\x80", "\xC1\xBF", "\xE0\x80\x80", "\xE0\x9F\xBF", "\xF0\x80\x80\x80", "\xF0\x8F\xBF\xBF",
+        "\xED\xA0\x80", "\xED\xBF\xBF", "\xF4\x90\x80\x80", "\xF5\x80\x80\x80", "\xFF",
+        "\xE2\x82", "\xF0\x9F\x98", "\xC3", "\x80", "\xBF\xBF",
+        std::string("\0", 1), "\x7F",
+    };
+
+    for (int32 Length = 0; Length <= FTests::MaxLength; Length++)
+    {
+        for (int32 Position = 0; Position <= Length; Position++)
+        {
+            for (const std::string& Insertion : Insertions)
+            {
+                std::string Bytes;
+                for (int32 Index = 0; Index < Length; Index++)
+                    Bytes += static_cast<char>('a' + Index % 26);
+
+                Bytes.insert(Position, Insertion);
+
+                FString Vectorized;
+                FString Scalar;
+                const bool bVectorizedValid = FUtf8Conversion::FromUtf8(Bytes.data(), static_cast<int32>(Bytes.size()), Vectorized);
+                const bool bScalarValid = FUtf8Conversion::FromUtf8Scalar(Bytes.data(), static_cast<int32>(Bytes.size()), Scalar);
+
+                if (bVectorizedValid != bScalarValid || !FTests::IsSameChars(Vectorized, Scalar))
+                {
+                    AddError(FString::Printf(TEXT("Length %d, insertion of %s at %d: kernels and the scalar path disagree"),
+                        Length, UTF8_TO_TCHAR(FTests::Describe(Insertion).c_str()), Position));
+                    return false;
+                }
+            }
+        }
+    }
+
+    // Known vectors, ill-formed subsequences are replaced as maximal subparts (one U+FFFD per subpart).
+    struct FVector
+    {
+        std::string Bytes;
+        TArray<TCHAR> Expected;
+        bool bValid;
+    };
+
+    const TCHAR R = 0xFFFD;
+    TArray<FVector> Vectors;
+    Vectors.Add({ "\xE2\x82\xAC", { 0x20AC }, true });
+    Vectors.Add({ std::string("a\0b", 3), { 'a', 0, 'b' }, true });
+    Vectors.Add({ "\xC0\xAF", { R, R }, false });
+    Vectors.Add({ "\xE0\x80\xAF", { R, R, R }, false });
+    Vectors.Add({ "\xF0\x80\x80\xAF", { R, R, R, R }, false });
+    Vectors.Add({ "\xED\xA0\x80", { R, R, R }, false });
+    Vectors.Add({ "\xF4\x90\x80\x80", { R, R, R, R }, false });
+    Vectors.Add({ "\xE2\x82" "a", { R, 'a' }, false });
+    Vectors.Add({ "a\xF0\x9F\x98", { 'a', R }, false });
+    Vectors.Add({ "\x80\xBF", { R, R }, false });
+    Vectors.Add({ "\xF8\x88\x80\x80\x80", { R, R, R, R, R }, false });
+
+    for (const FVector& Vector : Vectors)
+    {
+        FString Decoded;
+        const bool bValid = FUtf8Conversion::FromUtf8(Vector.Bytes.data(), static_cast<int32>(Vector.Bytes.size()), Decoded);
+
+        const FString What = UTF8_TO_TCHAR(FTests::Describe(Vector.Bytes).c_str());
+        TestEqual(FString::Printf(TEXT("Validity of %s"), *What), bValid, Vector.bValid);
+        TestTrue(FString::Printf(TEXT("Decoding of %s"), *What), FTests::IsSameChars(Decoded, FTests::MakeString(Vector.Expected)));
+    }
+
+    // Round trip of every BMP character (but surrogates) and of a few supplementary ones.
+    TArray<TCHAR> Chars;
+    for (uint32 CodePoint = 1; CodePoint < 0x10000; CodePoint++)
+    {
+        if (CodePoint < 0xD800 || CodePoint > 0xDFFF)
+            Chars.Add(static_cast<TCHAR>(CodePoint));
+    }
+
+    std::string Encoded;
+    FString Decoded;
+    FUtf8Conversion::ToUtf8(Chars.GetData(), Chars.Num(), Encoded);
+    TestTrue(TEXT("Encoded BMP is valid UTF-8"), FUtf8Conversion::FromUtf8(Encoded.data(), static_cast<int32>(Encoded.size()), Decoded));
+    TestTrue(TEXT("BMP survives a round trip"), FTests::IsSameChars(Decoded, FTests::MakeString(Chars)));
+
+    return true;
+}
+
+#endif
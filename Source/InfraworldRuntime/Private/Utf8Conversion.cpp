@@ -0,0 +1,492 @@
+/*
+ * Copyright 2018 Vizor Games LLC
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS, WITHOUT
+ * WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.See the
+ * License for the specific language governing permissions and limitations
+ * under the License.
+ */
+#include "Utf8Conversion.h"
+
+#include "Templates/ChooseClass.h"
+
+#if PLATFORM_ENABLE_VECTORINTRINSICS_NEON && defined(__aarch64__)
+    #define INFRAWORLD_UTF8_NEON 1
+    #include <arm_neon.h>
+#elif PLATFORM_ENABLE_VECTORINTRINSICS && (defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2))
+    #define INFRAWORLD_UTF8_SSE2 1
+    #include <emmintrin.h>
+    #if defined(__AVX2__)
+        #define INFRAWORLD_UTF8_AVX2 1
+        #include <immintrin.h>
+    #endif
+#endif
+
+#ifndef INFRAWORLD_UTF8_NEON
+    #define INFRAWORLD_UTF8_NEON 0
+#endif
+#ifndef INFRAWORLD_UTF8_SSE2
+    #define INFRAWORLD_UTF8_SSE2 0
+#endif
+#ifndef INFRAWORLD_UTF8_AVX2
+    #define INFRAWORLD_UTF8_AVX2 0
+#endif
+
+// Raw code unit type, having the same size as TCHAR.
+using FUtf8CodeUnit = TChooseClass<sizeof(TCHAR) == 2, uint16, uint32>::Result;
+
+class FUtf8Conversion_Internal
+{
+public:
+    static constexpr uint32 ReplacementCharacter = 0xFFFD;
+
+    // Worst case amount of UTF-8 bytes per single TCHAR (a BMP character for UTF-16, any character for UTF-32).
+    static constexpr int32 MaxUtf8BytesPerChar = (sizeof(TCHAR) == 2) ? 3 : 4;
+
+    // Without block kernels, only the scalar state machines are used (a reference for tests of the kernels).
+    template<bool bUseBlocks>
+    static int32 Encode(const FUtf8CodeUnit* Source, int32 SourceLen, uint8* Dest);
+    template<bool bUseBlocks>
+    static int32 Decode(const uint8* Source, int32 SourceLen, FUtf8CodeUnit* Dest, bool& bOutValid);
+
+    template<bool bUseBlocks>
+    static void ToUtf8(const TCHAR* Source, int32 SourceLen, std::string& Out);
+    template<bool bUseBlocks>
+    static bool FromUtf8(const char* Source, int32 SourceLen, FString& Out);
+
+private:
+    // Block kernels: process the longest prefix, consisting of whole ASCII-only blocks. Return number of processed units.
+    static int32 EncodeAsciiBlocks(const uint16* Source, int32 SourceLen, uint8* Dest);
+    static int32 EncodeAsciiBlocks(const uint32* Source, int32 SourceLen, uint8* Dest);
+    static int32 DecodeAsciiBlocks(const uint8* Source, int32 SourceLen, uint16* Dest);
+    static int32 DecodeAsciiBlocks(const uint8* Source, int32 SourceLen, uint32* Dest);
+
+    static FORCEINLINE uint8* WriteCodePoint(uint32 CodePoint, uint8* Dest);
+    static FORCEINLINE FUtf8CodeUnit* WriteCodePoint(uint32 CodePoint, FUtf8CodeUnit* Dest);
+};
+
+
+/// ASCII block kernels
+
+int32 FUtf8Conversion_Internal::EncodeAsciiBlocks(const uint16* Source, int32 SourceLen, uint8* Dest)
+{
+    int32 Index = 0;
+
+#if INFRAWORLD_UTF8_AVX2
+    const __m256i NonAsciiMask256 = _mm256_set1_epi16(static_cast<int16>(0xFF80));
+    for (; Index + 32 <= SourceLen; Index += 32)
+    {
+        const __m256i A = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(Source + Index));
+        const __m256i B = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(Source + Index + 16));
+
+        if (!_mm256_testz_si256(_mm256_or_si256(A, B), NonAsciiMask256))
+            break;
+
+        // Packing works per 128-bit lane, so 64-bit quarters have to be put back in order.
+        const __m256i Packed = _mm256_permute4x64_epi64(_mm256_packus_epi16(A, B), 0xD8);
+        _mm256_storeu_si256(reinterpret_cast<__m256i*>(Dest + Index), Packed);
+    }
+#endif
+
+#if INFRAWORLD_UTF8_SSE2
+    const __m128i NonAsciiMask = _mm_set1_epi16(static_cast<int16>(0xFF80));
+    const __m128i Zero = _mm_setzero_si128();
+    for (; Index + 16 <= SourceLen; Index += 16)
+    {
+        const __m128i A = _mm_loadu_si128(reinterpret_cast<const __m128i*>(Source + Index));
+        const __m128i B = _mm_loadu_si128(reinterpret_cast<const __m128i*>(Source + Index + 8));
+
+        const __m128i NonAscii = _mm_and_si128(_mm_or_si128(A, B), NonAsciiMask);
+        if (_mm_movemask_epi8(_mm_cmpeq_epi8(NonAscii, Zero)) != 0xFFFF)
+            break;
+
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(Dest + Index), _mm_packus_epi16(A, B));
+    }
+#elif INFRAWORLD_UTF8_NEON
+    for (; Index + 16 <= SourceLen; Index += 16)
+    {
+        const uint16x8_t A = vld1q_u16(Source + Index);
+        const uint16x8_t B = vld1q_u16(Source + Index + 8);
+
+        if (vmaxvq_u16(vorrq_u16(A, B)) >= 0x80)
+            break;
+
+        vst1q_u8(Dest + Index, vcombine_u8(vmovn_u16(A), vmovn_u16(B)));
+    }
+#endif
+
+    for (; Index + 4 <= SourceLen; Index += 4)
+    {
+        if ((Source[Index] | Source[Index + 1] | Source[Index + 2] | Source[Index + 3]) >= 0x80)
+            break;
+
+        Dest[Index] = static_cast<uint8>(Source[Index]);
+        Dest[Index + 1] = static_cast<uint8>(Source[Index + 1]);
+        Dest[Index + 2] = static_cast<uint8>(Source[Index + 2]);
+        Dest[Index + 3] = static_cast<uint8>(Source[Index + 3]);
+    }
+
+    return Index;
+}
+
+int32 FUtf8Conversion_Internal::EncodeAsciiBlocks(const uint32* Source, int32 SourceLen, uint8* Dest)
+{
+    int32 Index = 0;
+
+    for (; Index + 4 <= SourceLen; Index += 4)
+    {
+        if ((Source[Index] | Source[Index + 1] | Source[Index + 2] | Source[Index + 3]) >= 0x80)
+            break;
+
+        Dest[Index] = static_cast<uint8>(Source[Index]);
+        Dest[Index + 1] = static_cast<uint8>(Source[Index + 1]);
+        Dest[Index + 2] = static_cast<uint8>(Source[Index + 2]);
+        Dest[Index + 3] = static_cast<uint8>(Source[Index + 3]);
+    }
+
+    return Index;
+}
+
+int32 FUtf8Conversion_Internal::DecodeAsciiBlocks(const uint8* Source, int32 SourceLen, uint16* Dest)
+{
+    int32 Index = 0;
+
+#if INFRAWORLD_UTF8_AVX2
+    for (; Index + 32 <= SourceLen; Index += 32)
+    {
+        const __m256i Bytes = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(Source + Index));
+
+        if (_mm256_movemask_epi8(Bytes) != 0)
+            break;
+
+        _mm256_storeu_si256(reinterpret_cast<__m256i*>(Dest + Index), _mm256_cvtepu8_epi16(_mm256_castsi256_si128(Bytes)));
+        _mm256_storeu_si256(reinterpret_cast<__m256i*>(Dest + Index + 16), _mm256_cvtepu8_epi16(_mm256_extracti128_si256(Bytes, 1)));
+    }
+#endif
+
+#if INFRAWORLD_UTF8_SSE2
+    const __m128i Zero = _mm_setzero_si128();
+    for (; Index + 16 <= SourceLen; Index += 16)
+    {
+        const __m128i Bytes = _mm_loadu_si128(reinterpret_cast<const __m128i*>(Source + Index));
+
+        if (_mm_movemask_epi8(Bytes) != 0)
+            break;
+
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(Dest + Index), _mm_unpacklo_epi8(Bytes, Zero));
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(Dest + Index + 8), _mm_unpackhi_epi8(Bytes, Zero));
+    }
+#elif INFRAWORLD_UTF8_NEON
+    for (; Index + 16 <= SourceLen; Index += 16)
+    {
+        const uint8x16_t Bytes = vld1q_u8(Source + Index);
+
+        if (vmaxvq_u8(Bytes) >= 0x80)
+            break;
+
+        vst1q_u16(Dest + Index, vmovl_u8(vget_low_u8(Bytes)));
+        vst1q_u16(Dest + Index + 8, vmovl_u8(vget_high_u8(Bytes)));
+    }
+#endif
+
+    for (; Index + 4 <= SourceLen; Index += 4)
+    {
+        if ((Source[Index] | Source[Index + 1] | Source[Index + 2] | Source[Index + 3]) & 0x80)
+            break;
+
+        Dest[Index] = Source[Index];
+        Dest[Index + 1] = Source[Index + 1];
+        Dest[Index + 2] = Source[Index + 2];
+        Dest[Index + 3] = Source[Index + 3];
+    }
+
+    return Index;
+}
+
+int32 FUtf8Conversion_Internal::DecodeAsciiBlocks(const uint8* Source, int32 SourceLen, uint32* Dest)
+{
+    int32 Index = 0;
+
+    for (; Index + 4 <= SourceLen; Index += 4)
+    {
+        if ((Source[Index] | Source[Index + 1] | Source[Index + 2] | Source[Index + 3]) & 0x80)
+            break;
+
+        Dest[Index] = Source[Index];
+        Dest[Index + 1] = Source[Index + 1];
+        Dest[Index + 2] = Source[Index + 2];
+        Dest[Index + 3] = Source[Index + 3];
+    }
+
+    return Index;
+}
+
+
+/// Scalar state machines
+
+uint8* FUtf8Conversion_Internal::WriteCodePoint(uint32 CodePoint, uint8* Dest)
+{
+    if (CodePoint < 0x80)
+    {
+        *Dest++ = static_cast<uint8>(CodePoint);
+    }
+    else if (CodePoint < 0x800)
+    {
+        *Dest++ = static_cast<uint8>(0xC0 | (CodePoint >> 6));
+        *Dest++ = static_cast<uint8>(0x80 | (CodePoint & 0x3F));
+    }
+    else if (CodePoint < 0x10000)
+    {
+        *Dest++ = static_cast<uint8>(0xE0 | (CodePoint >> 12));
+        *Dest++ = static_cast<uint8>(0x80 | ((CodePoint >> 6) & 0x3F));
+        *Dest++ = static_cast<uint8>(0x80 | (CodePoint & 0x3F));
+    }
+    else
+    {
+        *Dest++ = static_cast<uint8>(0xF0 | (CodePoint >> 18));
+        *Dest++ = static_cast<uint8>(0x80 | ((CodePoint >> 12) & 0x3F));
+        *Dest++ = static_cast<uint8>(0x80 | ((CodePoint >> 6) & 0x3F));
+        *Dest++ = static_cast<uint8>(0x80 | (CodePoint & 0x3F));
+    }
+
+    return Dest;
+}
+
+FUtf8CodeUnit* FUtf8Conversion_Internal::WriteCodePoint(uint32 CodePoint, FUtf8CodeUnit* Dest)
+{
+    if (sizeof(FUtf8CodeUnit) == 2 && CodePoint >= 0x10000)
+    {
+        CodePoint -= 0x10000;
+        *Dest++ = static_cast<FUtf8CodeUnit>(0xD800 | (CodePoint >> 10));
+        *Dest++ = static_cast<FUtf8CodeUnit>(0xDC00 | (CodePoint & 0x3FF));
+    }
+    else
+    {
+        *Dest++ = static_cast<FUtf8CodeUnit>(CodePoint);
+    }
+
+    return Dest;
+}
+
+template<bool bUseBlocks>
+int32 FUtf8Conversion_Internal::Encode(const FUtf8CodeUnit* Source, int32 SourceLen, uint8* Dest)
+{
+    uint8* Out = Dest;
+    int32 Index = 0;
+
+    while (Index < SourceLen)
+    {
+        if (bUseBlocks)
+        {
+            const int32 AsciiRun = EncodeAsciiBlocks(Source + Index, SourceLen - Index, Out);
+            Index += AsciiRun;
+            Out += AsciiRun;
+        }
+
+        // Scalar tail: either the input ended with less than a block, or a non-ASCII character was met.
+        const int32 ScalarEnd = FMath::Min(SourceLen, Index + 16);
+        while (Index < ScalarEnd)
+        {
+            uint32 CodePoint = Source[Index++];
+
+            if (CodePoint >= 0xD800 && CodePoint <= 0xDBFF && sizeof(FUtf8CodeUnit) == 2)
+            {
+                // High surrogate, must be followed by a low one.
+                if (Index < SourceLen && Source[Index] >= 0xDC00 && Source[Index] <= 0xDFFF)
+                {
+                    CodePoint = 0x10000 + ((CodePoint - 0xD800) << 10) + (Source[Index++] - 0xDC00);
+                }
+                else
+                {
+                    CodePoint = ReplacementCharacter;
+                }
+            }
+            else if ((CodePoint >= 0xD800 && CodePoint <= 0xDFFF) || CodePoint > 0x10FFFF)
+            {
+                CodePoint = ReplacementCharacter;
+            }
+
+            Out = WriteCodePoint(CodePoint, Out);
+        }
+    }
+
+    return static_cast<int32>(Out - Dest);
+}
+
+template<bool bUseBlocks>
+int32 FUtf8Conversion_Internal::Decode(const uint8* Source, int32 SourceLen, FUtf8CodeUnit* Dest, bool& bOutValid)
+{
+    FUtf8CodeUnit* Out = Dest;
+    int32 Index = 0;
+
+    while (Index < SourceLen)
+    {
+        if (bUseBlocks)
+        {
+            const int32 AsciiRun = DecodeAsciiBlocks(Source + Index, SourceLen - Index, Out);
+            Index += AsciiRun;
+            Out += AsciiRun;
+        }
+
+        const int32 ScalarEnd = FMath::Min(SourceLen, Index + 16);
+        while (Index < ScalarEnd)
+        {
+            const uint8 Lead = Source[Index];
+            if (Lead < 0x80)
+            {
+                *Out++ = Lead;
+                ++Index;
+                continue;
+            }
+
+            // Determine sequence length and the valid range of the second byte (Unicode 11.0, table 3-7).
+            int32 TrailingBytes = 0;
+            uint32 CodePoint = 0;
+            uint8 SecondMin = 0x80;
+            uint8 SecondMax = 0xBF;
+
+            if (Lead >= 0xC2 && Lead <= 0xDF)
+            {
+                TrailingBytes = 1;
+                CodePoint = Lead & 0x1F;
+            }
+            else if (Lead >= 0xE0 && Lead <= 0xEF)
+            {
+                TrailingBytes = 2;
+                CodePoint = Lead & 0x0F;
+                SecondMin = (Lead == 0xE0) ? 0xA0 : 0x80; // Overlong
+                SecondMax = (Lead == 0xED) ? 0x9F : 0xBF; // Surrogates
+            }
+            else if (Lead >= 0xF0 && Lead <= 0xF4)
+            {
+                TrailingBytes = 3;
+                CodePoint = Lead & 0x07;
+                SecondMin = (Lead == 0xF0) ? 0x90 : 0x80; // Overlong
+                SecondMax = (Lead == 0xF4) ? 0x8F : 0xBF; // Beyond U+10FFFF
+            }
+            else
+            {
+                // Stray continuation byte, overlong 2-byte lead or invalid lead.
+                *Out++ = static_cast<FUtf8CodeUnit>(ReplacementCharacter);
+                bOutValid = false;
+                ++Index;
+                continue;
+            }
+
+            int32 Cursor = Index + 1;
+            bool bWellFormed = true;
+            for (int32 Trailing = 0; Trailing < TrailingBytes; ++Trailing, ++Cursor)
+            {
+                if (Cursor >= SourceLen)
+                {
+                    bWellFormed = false;
+                    break;
+                }
+
+                const uint8 Byte = Source[Cursor];
+                const bool bInRange = (Trailing == 0) ? (Byte >= SecondMin && Byte <= SecondMax) : ((Byte & 0xC0) == 0x80);
+                if (!bInRange)
+                {
+                    bWellFormed = false;
+                    break;
+                }
+
+                CodePoint = (CodePoint << 6) | (Byte & 0x3F);
+            }
+
+            // An ill-formed subsequence is replaced by a single U+FFFD, the offending byte is being re-read.
+            Out = WriteCodePoint(bWellFormed ? CodePoint : ReplacementCharacter, Out);
+            bOutValid &= bWellFormed;
+            Index = Cursor;
+        }
+    }
+
+    return static_cast<int32>(Out - Dest);
+}
+
+template<bool bUseBlocks>
+void FUtf8Conversion_Internal::ToUtf8(const TCHAR* Source, int32 SourceLen, std::string& Out)
+{
+    if (SourceLen <= 0)
+    {
+        Out.clear();
+        return;
+    }
+
+    Out.resize(static_cast<size_t>(SourceLen) * MaxUtf8BytesPerChar);
+
+    const int32 Written = Encode<bUseBlocks>(reinterpret_cast<const FUtf8CodeUnit*>(Source), SourceLen, reinterpret_cast<uint8*>(&Out[0]));
+
+    Out.resize(Written);
+}
+
+template<bool bUseBlocks>
+bool FUtf8Conversion_Internal::FromUtf8(const char* Source, int32 SourceLen, FString& Out)
+{
+    TArray<TCHAR>& Chars = Out.GetCharArray();
+
+    if (SourceLen <= 0)
+    {
+        Chars.Reset();
+        return true;
+    }
+
+    // A single UTF-8 byte never produces more than a single TCHAR, plus a terminating NUL.
+    Chars.SetNumUninitialized(SourceLen + 1, false);
+
+    bool bValid = true;
+    const int32 Written = Decode<bUseBlocks>(reinterpret_cast<const uint8*>(Source), SourceLen,
+        reinterpret_cast<FUtf8CodeUnit*>(Chars.GetData()), bValid);
+
+    Chars.GetData()[Written] = TEXT('\0');
+    Chars.SetNum(Written + 1, false);
+
+    return bValid;
+}
+
+
+/// FUtf8Conversion interface
+
+void FUtf8Conversion::ToUtf8(const TCHAR* Source, int32 SourceLen, std::string& Out)
+{
+    FUtf8Conversion_Internal::ToUtf8<true>(Source, SourceLen, Out);
+}
+
+int32 FUtf8Conversion::ToUtf8(const TCHAR* Source, int32 SourceLen, uint8* Dest)
+{
+    if (SourceLen <= 0)
+        return 0;
+
+    return FUtf8Conversion_Internal::Encode<true>(reinterpret_cast<const FUtf8CodeUnit*>(Source), SourceLen, Dest);
+}
+
+int32 FUtf8Conversion::GetMaxUtf8Length(int32 SourceLen)
+{
+    return SourceLen * FUtf8Conversion_Internal::MaxUtf8BytesPerChar;
+}
+
+bool FUtf8Conversion::FromUtf8(const char* Source, int32 SourceLen, FString& Out)
+{
+    return FUtf8Conversion_Internal::FromUtf8<true>(Source, SourceLen, Out);
+}
+
+#if WITH_DEV_AUTOMATION_TESTS
+
+void FUtf8Conversion::ToUtf8Scalar(const TCHAR* Source, int32 SourceLen, std::string& Out)
+{
+    FUtf8Conversion_Internal::ToUtf8<false>(Source, SourceLen, Out);
+}
+
+bool FUtf8Conversion::FromUtf8Scalar(const char* Source, int32 SourceLen, FString& Out)
+{
+    return FUtf8Conversion_Internal::FromUtf8<false>(Source, SourceLen, Out);
+}
+
+#endif
@@ -0,0 +1,90 @@
+/*
+ * Copyright 2018 Vizor Games LLC
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS, WITHOUT
+ * WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.See the
+ * License for the specific language governing permissions and limitations
+ * under the License.
+ */
+#pragma once
+
+#include "CoreMinimal.h"
+#include "GenUtils.h"
+#include "RpcMethodId.h"
+
+namespace google
+{
+    namespace protobuf
+    {
+        class MessageLite;
+    }
+}
+
+/**
+ * Tunables of EGrpcCompressionAlgorithm::CompressAdaptive.
+ */
+struct INFRAWORLDRUNTIME_API FAdaptiveCompressionSettings
+{
+    /** Requests smaller than this (serialized, in bytes) are never compressed: gzip overhead outweighs any gain. */
+    int32 MinSize = 1024;
+
+    /** Requests of at least this size are gzip-compressed (checksummed), smaller ones are deflated. */
+    int32 GzipMinSize = 64 * 1024;
+
+    /** A method's requests are compressed only if their compressed/original size ratio is below this. */
+    float MaxRatio = 0.85f;
+
+    /** Number of leading bytes of a request, compressed to estimate the ratio and the CPU cost of a method. */
+    int32 SampleSize = 4096;
+
+    /** A method is resampled every ResampleInterval compressible calls, since its payloads may change over time. */
+    int32 ResampleInterval = 64;
+
+    /**
+     * Fraction of wall time, that (all workers together) may spend compressing, sampling included.
+     * 0 disables the CPU budget.
+     */
+    float CpuBudget = 0.05f;
+
+    /**
+     * Set it if bandwidth is scarce (e.g. on cellular networks): the size threshold is lowered 4 times and the ratio
+     * threshold is relaxed, so that CPU is traded for bandwidth more eagerly.
+     */
+    bool bPreferBandwidth = false;
+};
+
+/**
+ * Picks a compression algorithm for requests, sent with EGrpcCompressionAlgorithm::CompressAdaptive.
+ *
+ * The decision is based on the serialized size of a request and on the compression ratio, learned per method
+ * by occasionally compressing a sample of its requests with zlib. Estimated savings and CPU time are reported
+ * to STATGROUP_Infraworld.
+ */
+class INFRAWORLDRUNTIME_API FAdaptiveCompression
+{
+public:
+    static void SetSettings(const FAdaptiveCompressionSettings& Settings);
+    static FAdaptiveCompressionSettings GetSettings();
+
+    /**
+     * Chooses an algorithm for a request. Thread safe.
+     *
+     * @param Method Method the request is sent to.
+     * @param Request The request.
+     *
+     * @return CompressNone, CompressDeflate or CompressGzip.
+     */
+    static EGrpcCompressionAlgorithm Choose(FRpcMethodId Method, const google::protobuf::MessageLite& Request);
+
+    /**
+     * @return Learned compressed/original size ratio of a method, or a negative value if it hasn't been sampled yet.
+     */
+    static float GetLearnedRatio(FRpcMethodId Method);
+};
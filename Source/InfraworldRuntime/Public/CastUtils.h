@@ -16,6 +16,11 @@
 #pragma once
 
 #include "CoreMinimal.h"
+#include "HAL/PlatformTime.h"
+#include "Templates/IsArithmetic.h"
+#include "Templates/IsIntegral.h"
+#include "Utf8Conversion.h"
+#include "CompiledContext.h"
 
 #include <string>
 #include <functional>
@@ -81,75 +86,184 @@ namespace casts
     FORCEINLINE _UnrealMap<OutK, OutV> Proto_MapCast(const _ProtobufMap<InK, InV>& Map)
     {
         _UnrealMap<OutK, OutV> OutMap;
+        OutMap.Reserve((int32)Map.size());
 
+        // Cast results are temporaries, so they're moved into the map
         for (auto It = Map.cbegin(); It != Map.cend(); ++It)
-            OutMap.Add(Proto_Cast<OutK>(It->first), Proto_Cast<OutV>(It->second));
+            OutMap.Emplace(Proto_Cast<OutK>(It->first), Proto_Cast<OutV>(It->second));
 
         return OutMap;
     }
 
+    /**
+     * Fills an existing protobuf map (usually obtained via mutable_xxx()) with casted items of a TMap.
+     * Values are constructed in place by the map, so if the owning message lives on an arena, they're allocated there.
+     *
+     * @param Map Map to cast.
+     * @param OutMap Protobuf map to add items to.
+     */
+    template<class OutK, class OutV, class InK, class InV>
+    FORCEINLINE void Proto_MapCastTo(const _UnrealMap<InK, InV>& Map, _ProtobufMap<OutK, OutV>* OutMap)
+    {
+        for (const TPair<InK, InV>& Pair : Map)
+            (*OutMap)[Proto_Cast<OutK>(Pair.Key)] = Proto_Cast<OutV>(Pair.Value);
+    }
+
     // Protobuf Map -> TMap
     template<class OutK, class OutV, class InK, class InV>
     FORCEINLINE _ProtobufMap<OutK, OutV> Proto_MapCast(const _UnrealMap<InK, InV>& Map)
     {
         _ProtobufMap<OutK, OutV> OutMap;
-
-        for (const TPair<InK, InV>& Pair : Map)
-            OutMap.insert(google::protobuf::MapPair<OutK, OutV>(Proto_Cast<OutK>(Pair.Key), Proto_Cast<OutV>(Pair.Value)));
+        Proto_MapCastTo(Map, &OutMap);
 
         return OutMap;
     }
 
     // ~~~~~ CAST FUNCTIONS (ARRAYS) ~~~~~
 
+    /**
+     * Whether an array of InT could be converted into an array of OutT in bulk, bypassing per-item Proto_Cast<>().
+     * Holds for arithmetic types only, since Proto_Cast<>() is a plain static_cast for them.
+     */
     template<class OutT, class InT>
-    FORCEINLINE _ProtobufArray<OutT> Proto_ArrayCast(const _UnrealArray<InT>& Array)
+    struct TIsBulkArrayCastable
     {
-        // Allocate a protobuf array and reserve capacity
-        _ProtobufArray<OutT> OutArray;
-        OutArray.Reserve((int32)Array.Num());
+        enum { Value = TIsArithmetic<OutT>::Value && TIsArithmetic<InT>::Value };
+    };
 
-        // Each item shall be individually casted to OutT
-        for (const InT& Item : Array)
-            OutArray.Add(Proto_Cast<OutT>(Item));
+    /**
+     * Whether static_cast from InT to OutT preserves the bit pattern, so an array could be just memcpy'ed.
+     * True for identical types and for same-sized integers (i.e. int32 <-> uint32). Bools are excluded, since
+     * static_cast normalizes them to 0 and 1.
+     */
+    template<class OutT, class InT>
+    struct TIsMemcpyArrayCastable
+    {
+        enum
+        {
+            Value = TIsSame<OutT, InT>::Value || (TIsIntegral<OutT>::Value && TIsIntegral<InT>::Value &&
+                (sizeof(OutT) == sizeof(InT)) && !TIsSame<OutT, bool>::Value && !TIsSame<InT, bool>::Value)
+        };
+    };
 
-        return OutArray;
+    // Converts Num items of InT into a preallocated storage of OutT.
+    template<class OutT, class InT>
+    FORCEINLINE void Proto_BulkCast(const InT* RESTRICT Source, OutT* RESTRICT Dest, int32 Num)
+    {
+        if (TIsMemcpyArrayCastable<OutT, InT>::Value)
+        {
+            FMemory::Memcpy(Dest, Source, Num * sizeof(InT));
+        }
+        else
+        {
+            // A plain counted loop over raw pointers, compilers vectorize widening and narrowing conversions here.
+            for (int32 Index = 0; Index < Num; Index++)
+                Dest[Index] = static_cast<OutT>(Source[Index]);
+        }
     }
 
+    // Compile-time selection between per-item and bulk conversion.
+    template<class OutT, class InT, bool bBulk = TIsBulkArrayCastable<OutT, InT>::Value>
+    struct TProtoArrayCaster
+    {
+        static FORCEINLINE _ProtobufArray<OutT> ToProtobuf(const _UnrealArray<InT>& Array)
+        {
+            // Allocate a protobuf array and reserve capacity
+            _ProtobufArray<OutT> OutArray;
+            OutArray.Reserve((int32)Array.Num());
+
+            // Each item shall be individually casted to OutT
+            for (const InT& Item : Array)
+                OutArray.Add(Proto_Cast<OutT>(Item));
+
+            return OutArray;
+        }
+
+        static FORCEINLINE _UnrealArray<OutT> ToUnreal(const _ProtobufArray<InT>& Array)
+        {
+            // Allocate a TArray<OutT> and reserve capacity
+            _UnrealArray<OutT> OutArray;
+            OutArray.Reserve((int32)Array.size());
+
+            // Each item shall be individually casted to OutT
+            for (const InT& Item : Array)
+                OutArray.Add(Proto_Cast<OutT>(Item));
+
+            return OutArray;
+        }
+    };
+
     template<class OutT, class InT>
-    FORCEINLINE _UnrealArray<OutT> Proto_ArrayCast(const _ProtobufArray<InT>& Array)
+    struct TProtoArrayCaster<OutT, InT, true>
     {
-        // Allocate a TArray<OutT> and reserve capacity
-        _UnrealArray<OutT> OutArray;
-        OutArray.Reserve((int32)Array.size());
+        static FORCEINLINE _ProtobufArray<OutT> ToProtobuf(const _UnrealArray<InT>& Array)
+        {
+            _ProtobufArray<OutT> OutArray;
 
-        // Each item shall be individually casted to OutT
-        std::for_each(Array.cbegin(), Array.cend(), [&OutArray](InT Item) {
-            OutArray.Add(Proto_Cast<OutT>(Item));
-        });
+            const int32 Num = Array.Num();
+            if (Num > 0)
+            {
+                // Grow once, then write straight into the reserved storage.
+                OutArray.Reserve(Num);
+                Proto_BulkCast<OutT, InT>(Array.GetData(), OutArray.AddNAlreadyReserved(Num), Num);
+            }
 
-        return OutArray;
+            return OutArray;
+        }
+
+        static FORCEINLINE _UnrealArray<OutT> ToUnreal(const _ProtobufArray<InT>& Array)
+        {
+            _UnrealArray<OutT> OutArray;
+
+            const int32 Num = Array.size();
+            if (Num > 0)
+            {
+                OutArray.SetNumUninitialized(Num);
+                Proto_BulkCast<OutT, InT>(Array.data(), OutArray.GetData(), Num);
+            }
+
+            return OutArray;
+        }
+    };
+
+    template<class OutT, class InT>
+    FORCEINLINE _ProtobufArray<OutT> Proto_ArrayCast(const _UnrealArray<InT>& Array)
+    {
+        return TProtoArrayCaster<OutT, InT>::ToProtobuf(Array);
+    }
+
+    template<class OutT, class InT>
+    FORCEINLINE _UnrealArray<OutT> Proto_ArrayCast(const _ProtobufArray<InT>& Array)
+    {
+        return TProtoArrayCaster<OutT, InT>::ToUnreal(Array);
     }
 
     // Overload for _ProtobufPtrArray (google::protobuf::RepeatedPtrField<?>)
     // _ProtobufPtrArray (aka google::protobuf::RepeatedPtrField<OutT>)
     // is the same as RepeatedField<?>, but used for repeated strings or messages
 
+    /**
+     * Fills an existing repeated field (usually obtained via mutable_xxx()) with casted items of a TArray.
+     * Items are created by the field itself, so if the owning message lives on an arena, they're allocated there.
+     *
+     * @param Array Array to cast.
+     * @param OutArray Repeated field to add items to.
+     */
     template<class OutT, class InT>
-    FORCEINLINE _ProtobufPtrArray<OutT> Proto_PtrArrayCast(const _UnrealArray<InT>& Array)
+    FORCEINLINE void Proto_PtrArrayCastTo(const _UnrealArray<InT>& Array, _ProtobufPtrArray<OutT>* OutArray)
     {
-        // Allocate a protobuf array and reserve capacity
-        _ProtobufPtrArray<OutT> OutArray;
-        OutArray.Reserve((int32)Array.Num());
+        OutArray->Reserve(OutArray->size() + Array.Num());
 
-        // Each item shall be individually casted to OutT
+        // Each item shall be individually casted to OutT and moved into an element, owned by OutArray.
         for (const InT& Item : Array)
-        {
-            const OutT& cast_result = Proto_Cast<OutT>(Item);
-            
-            // We need to create a new instance of OutT to be posessed by the OutArray.
-            OutArray.AddAllocated(new OutT(cast_result));
-        }
+            *OutArray->Add() = Proto_Cast<OutT>(Item);
+    }
+
+    template<class OutT, class InT>
+    FORCEINLINE _ProtobufPtrArray<OutT> Proto_PtrArrayCast(const _UnrealArray<InT>& Array)
+    {
+        _ProtobufPtrArray<OutT> OutArray;
+        Proto_PtrArrayCastTo(Array, &OutArray);
 
         return OutArray;
     }
@@ -161,10 +275,9 @@ namespace casts
         _UnrealArray<OutT> OutArray;
         OutArray.Reserve((int32)Array.size());
 
-        // Each item shall be individually casted to OutT
-        std::for_each(Array.cbegin(), Array.cend(), [&OutArray](InT Item) {
-            OutArray.Add(Proto_Cast<OutT>(Item));
-        });
+        // Each item shall be individually casted to OutT (items are strings or messages, so never copy them)
+        for (const InT& Item : Array)
+            OutArray.Emplace(Proto_Cast<OutT>(Item));
 
         return OutArray;
     }
@@ -181,14 +294,8 @@ namespace casts
     template <>
     FORCEINLINE FByteArray Proto_Cast(const std::string& String)
     {
-        // Allocate a TArray<uint8>
-        TArray<uint8> OutArray;
-        
-        // Put String's content into the array. We can not (and do not need) to cast away const qualifier.
-        OutArray.Insert(reinterpret_cast<const uint8*>(String.c_str()), String.size(), 0);
-
-        // Finally, wrap all data into FByteArray
-        return FByteArray(OutArray);
+        // Copy String's content straight into the storage of the resulting FByteArray, without any intermediate TArray.
+        return FByteArray(reinterpret_cast<const uint8*>(String.data()), static_cast<int32>(String.size()));
     }
 
     template <>
@@ -198,18 +305,98 @@ namespace casts
         return std::string(reinterpret_cast<const char*>(Arr.GetData()), Arr.Num());
     }
 
+    /**
+     * Aliases a protobuf 'bytes' field without copying it.
+     *
+     * @warning The view points into the buffer, owned by the protobuf message, so it is valid only while the message is
+     *          alive and the field isn't modified. Use Proto_Cast<FByteArray>() if you need an owning copy.
+     * @param String Protobuf 'bytes' field.
+     * @return A non-owning view over String's content.
+     */
+    FORCEINLINE TArrayView<const uint8> Proto_BytesView(const std::string& String)
+    {
+        return TArrayView<const uint8>(reinterpret_cast<const uint8*>(String.data()), static_cast<int32>(String.size()));
+    }
+
+    /**
+     * Copies a byte array out of a protobuf 'bytes' field into an FByteArray, then releases the protobuf-side storage.
+     * Unlike Proto_Cast<FByteArray>(), the source string doesn't keep a second copy of the blob alive for the rest of
+     * the message's lifetime. TArray can't adopt the buffer of a std::string, so the bytes are copied once.
+     *
+     * @param String Protobuf 'bytes' field (usually obtained via mutable_xxx()), will be empty after the call.
+     * @param OutBytes An FByteArray to receive the content. Its previous content (and capacity) is being reused.
+     */
+    FORCEINLINE void Proto_BytesCopyAndClear(std::string& String, FByteArray& OutBytes)
+    {
+        OutBytes.Bytes.Reset(static_cast<int32>(String.size()));
+        OutBytes.Bytes.Append(reinterpret_cast<const uint8*>(String.data()), static_cast<int32>(String.size()));
+
+        // Actually free the memory, clear() alone keeps the capacity.
+        std::string().swap(String);
+    }
+
+    /**
+     * Writes an FByteArray into an existing protobuf 'bytes' field (usually obtained via mutable_xxx()), reusing
+     * capacity of the field instead of constructing a temporary std::string.
+     *
+     * @param Item Bytes to write.
+     * @param OutString Protobuf 'bytes' field.
+     */
+    FORCEINLINE void Proto_BytesAssign(const FByteArray& Item, std::string* OutString)
+    {
+        OutString->assign(reinterpret_cast<const char*>(Item.Bytes.GetData()), Item.Bytes.Num());
+    }
+
     // ~~~~~ CAST FUNCTIONS (UNREAL STRING and PROTOBUF STRING) ~~~~~
 
     template <>
     FORCEINLINE std::string Proto_Cast(const FString& String)
     {
-        return std::string(TCHAR_TO_UTF8(*String));
+        std::string OutString;
+        FUtf8Conversion::ToUtf8(*String, String.Len(), OutString);
+
+        return OutString;
     }
 
     template <>
     FORCEINLINE FString Proto_Cast(const std::string& String)
     {
-        return FString(String.c_str());
+        // Protobuf strings are UTF-8 (and may contain NULs), so they need to be decoded, not just widened.
+        FString OutString;
+        if (!FUtf8Conversion::FromUtf8(String.data(), static_cast<int32>(String.size()), OutString))
+        {
+            UE_LOG(LogTemp, Verbose, TEXT("Received a string, which is not a valid UTF-8, invalid sequences have been replaced with U+FFFD"));
+        }
+
+        return OutString;
+    }
+
+    /**
+     * Casts a compression algorithm. CompressAdaptive has no gRPC counterpart, it is resolved per request by a worker,
+     * so it is cast to GRPC_COMPRESS_NONE here.
+     */
+    FORCEINLINE grpc_compression_algorithm CastCompressionAlgorithm(EGrpcCompressionAlgorithm Algorithm)
+    {
+        switch (Algorithm)
+        {
+        case EGrpcCompressionAlgorithm::CompressDeflate:
+            return GRPC_COMPRESS_DEFLATE;
+        case EGrpcCompressionAlgorithm::CompressGzip:
+            return GRPC_COMPRESS_GZIP;
+        default:
+            return GRPC_COMPRESS_NONE;
+        }
+    }
+
+    /**
+     * Sets a compression algorithm of a call. gRPC sends the algorithm as metadata (thus allocating), even if it is
+     * GRPC_COMPRESS_NONE, so calls without compression (which is the default of channels) are left as they are.
+     */
+    FORCEINLINE void SetCompressionAlgorithm(grpc::ClientContext& OutContext, EGrpcCompressionAlgorithm Algorithm)
+    {
+        const grpc_compression_algorithm GrpcAlgorithm = CastCompressionAlgorithm(Algorithm);
+        if (GrpcAlgorithm != GRPC_COMPRESS_NONE)
+            OutContext.set_compression_algorithm(GrpcAlgorithm);
     }
 
     /**
@@ -222,6 +409,22 @@ namespace casts
      */
     FORCEINLINE void CastClientContext(const FGrpcClientContext &InContext, grpc::ClientContext &OutContext)
     {
+        // Shared metadata has been validated and converted when the context was interned.
+        if (InContext.Shared.IsValid())
+        {
+            const FGrpcCompiledContext& Shared = *InContext.Shared;
+            const bool bHasOverrides = InContext.Metadata.Num() > 0;
+            for (int32 Index = 0; Index < Shared.MetadataKeys.Num(); Index++)
+            {
+                // Per-call entries replace shared ones with the same keys.
+                if (!bHasOverrides || !InContext.Metadata.Contains(Shared.MetadataKeys[Index]))
+                    OutContext.AddMetadata(Shared.Metadata[Index].first, Shared.Metadata[Index].second);
+            }
+
+            if (InContext.Authority.IsEmpty() && InContext.Shared->bHasAuthority)
+                OutContext.set_authority(InContext.Shared->Authority);
+        }
+
         // Cast and set metadata, checking for errors.
         for (const TPair<FString, FString>& Pair : InContext.Metadata)
         {
@@ -243,8 +446,13 @@ namespace casts
             // TODO: Add some other validation checks if necessary.
         }
 
-        // Set deadline (Only if it has a positive value. It is -1 by default)
-        if (InContext.DeadlineSeconds > .0f)
+        // Set deadline: the absolute one, stamped when the request has been enqueued, or the relative one
+        if (InContext.AbsoluteDeadlineSeconds > 0.0)
+        {
+            const int64 Milliseconds = static_cast<int64>((InContext.AbsoluteDeadlineSeconds - FPlatformTime::Seconds()) * 1000.0);
+            OutContext.set_deadline(system_clock::now() + milliseconds(FMath::Max<int64>(Milliseconds, 0)));
+        }
+        else if (InContext.DeadlineSeconds > .0f)
         {
             const int64 Milliseconds = static_cast<int64>(((double)InContext.DeadlineSeconds * 1000.0));
             OutContext.set_deadline(system_clock::now() + milliseconds(Milliseconds));
@@ -255,51 +463,106 @@ namespace casts
         OutContext.set_cacheable(InContext.bCacheable);
         OutContext.set_wait_for_ready(InContext.bWaitForReady);
 
-        // Set authority
-        OutContext.set_authority(casts::Proto_Cast<std::string>(InContext.Authority));
+        // Set authority (an empty one means the default authority of the channel)
+        if (!InContext.Authority.IsEmpty())
+            OutContext.set_authority(casts::Proto_Cast<std::string>(InContext.Authority));
 
         // Set Compression Algorithm
-        OutContext.set_compression_algorithm(Proto_EnumCast<grpc_compression_algorithm>(InContext.GrpcCompressionAlgorithm));
+        SetCompressionAlgorithm(OutContext, InContext.GrpcCompressionAlgorithm);
 
         // Set Initial Metadata Corked
         OutContext.set_initial_metadata_corked(InContext.bInitialMetadataCorked);
     }
 
+    /**
+     * Applies a precompiled client context, no validation or string conversion is made.
+     *
+     * @param InContext Compiled context, @see FGrpcCompiledContext::Compile().
+     * @param OutContext Output GRPC-compatible client context.
+     */
+    FORCEINLINE void CastClientContext(const FGrpcCompiledContext& InContext, grpc::ClientContext& OutContext)
+    {
+        for (const std::pair<std::string, std::string>& Pair : InContext.Metadata)
+            OutContext.AddMetadata(Pair.first, Pair.second);
+
+        if (InContext.DeadlineMilliseconds > 0)
+            OutContext.set_deadline(system_clock::now() + milliseconds(InContext.DeadlineMilliseconds));
+
+        OutContext.set_idempotent(InContext.bIdempotent);
+        OutContext.set_cacheable(InContext.bCacheable);
+        OutContext.set_wait_for_ready(InContext.bWaitForReady);
+
+        if (InContext.bHasAuthority)
+            OutContext.set_authority(InContext.Authority);
+
+        SetCompressionAlgorithm(OutContext, InContext.CompressionAlgorithm);
+        OutContext.set_initial_metadata_corked(InContext.bInitialMetadataCorked);
+    }
+
+    FORCEINLINE EGrpcCompressionAlgorithm GetCompressionAlgorithm(const FGrpcClientContext& Context)
+    {
+        return Context.GrpcCompressionAlgorithm;
+    }
+
+    FORCEINLINE EGrpcCompressionAlgorithm GetCompressionAlgorithm(const FGrpcCompiledContext& Context)
+    {
+        return Context.CompressionAlgorithm;
+    }
+
+    /**
+     * @return True if the deadline, stamped when the request has been enqueued, has already passed.
+     */
+    FORCEINLINE bool HasExpired(const FGrpcClientContext& Context)
+    {
+        return Context.AbsoluteDeadlineSeconds > 0.0 && FPlatformTime::Seconds() >= Context.AbsoluteDeadlineSeconds;
+    }
+
+    // Deadlines of compiled contexts are relative to the moment of a call.
+    FORCEINLINE bool HasExpired(const FGrpcCompiledContext&)
+    {
+        return false;
+    }
+
+    FORCEINLINE FRpcCancellation* GetCancellation(const FGrpcClientContext& Context)
+    {
+        return Context.Cancellation.Get();
+    }
+
+    // Compiled contexts are shared by calls, so they can't carry a per-call token.
+    FORCEINLINE FRpcCancellation* GetCancellation(const FGrpcCompiledContext&)
+    {
+        return nullptr;
+    }
+
     FORCEINLINE void CastStatus(const grpc::Status& InStatus, FGrpcStatus& OutStatus)
     {
         OutStatus.ErrorCode = Proto_EnumCast<EGrpcStatusCode>(InStatus.error_code());
-        OutStatus.ErrorMessage = Proto_Cast<FString>(InStatus.error_message());
-        OutStatus.ErrorDetails = Proto_Cast<FString>(InStatus.error_details());
+
+        // Successful calls (nearly all of them) have neither a message nor details, so nothing is being converted.
+        // Strings are decoded in place, reusing buffers of the output status.
+        if (InStatus.error_message().empty())
+            OutStatus.ErrorMessage.Reset();
+        else
+            FUtf8Conversion::FromUtf8(InStatus.error_message().data(), static_cast<int32>(InStatus.error_message().size()), OutStatus.ErrorMessage);
+
+        if (InStatus.error_details().empty())
+            OutStatus.ErrorDetails.Reset();
+        else
+            FUtf8Conversion::FromUtf8(InStatus.error_details().data(), static_cast<int32>(InStatus.error_details().size()), OutStatus.ErrorDetails);
     }
 
-    // Since we have no support for unsigned types in Blueprints, we need to
+    // Since we have no support for unsigned types in Blueprints, we need to pass repeated uint32 as TArray<int32>.
+    // Both have the same layout, so it is a single memcpy.
 
     template <>
     FORCEINLINE _UnrealArray<int32> Proto_ArrayCast(const _ProtobufArray<uint32>& Array)
     {
-        // Allocate a TArray<OutT> and reserve capacity
-        _UnrealArray<int32> OutArray;
-        OutArray.Reserve((int32)Array.size());
-
-        // Each item shall be individually casted to OutT
-        std::for_each(Array.cbegin(), Array.cend(), [&OutArray](uint32 Item) {
-            OutArray.Add(Proto_Cast<int32>(Item));
-        });
-
-        return OutArray;
+        return TProtoArrayCaster<int32, uint32>::ToUnreal(Array);
     }
 
     template <>
     FORCEINLINE _ProtobufArray<uint32> Proto_ArrayCast(const _UnrealArray<int32>& Array)
     {
-        // Allocate a protobuf array and reserve capacity
-        _ProtobufArray<uint32> OutArray;
-        OutArray.Reserve((int32)Array.Num());
-
-        // Each item shall be individually casted to OutT
-        for (const int32 Item : Array)
-            OutArray.Add(Proto_Cast<uint32>(Item));
-
-        return OutArray;
+        return TProtoArrayCaster<uint32, int32>::ToProtobuf(Array);
     }
 }
@@ -17,15 +17,18 @@
 
 #include "CoreMinimal.h"
 #include "UObject/NoExportTypes.h"
+#include "HAL/CriticalSection.h"
 
 #include <memory>
 
-#include "ChannelCredentials.generated.h"
+#include "GrpcIncludesBegin.h"
+
+#include <grpcpp/security/credentials.h>
+#include <grpcpp/support/channel_arguments.h>
 
-// namespace grpc
-// {
-//     class ChannelCredentials;
-// }
+#include "GrpcIncludesEnd.h"
+
+#include "ChannelCredentials.generated.h"
 
 USTRUCT(BlueprintType)
 struct INFRAWORLDRUNTIME_API FRpcError
@@ -93,6 +96,36 @@ public:
      */
     UFUNCTION(BlueprintCallable, BlueprintPure, Category="Vizor|RPC Credentials")
     static UChannelCredentials* MakeInsecureChannelCredentials();
+
+    /**
+     * Builds gRPC credentials on the first call, further calls return the same object, so PEM strings are converted
+     * and parsed only once, no matter how many channels are created (or recreated). Thread safe.
+     *
+     * @return gRPC credentials, shared by all channels, created with this object.
+     */
+    std::shared_ptr<grpc::ChannelCredentials> GetGrpcCredentials();
+
+    /**
+     * Drops cached gRPC credentials, so they're rebuilt for the next channel (e.g. after certificates have been changed).
+     */
+    void ResetGrpcCredentials();
+
+    /**
+     * Adds arguments, needed by the credentials, to arguments of a new channel.
+     */
+    virtual void ApplyChannelArguments(grpc::ChannelArguments&) const
+    {
+    }
+
+protected:
+    /**
+     * @return Newly built gRPC credentials.
+     */
+    virtual std::shared_ptr<grpc::ChannelCredentials> BuildGrpcCredentials() const;
+
+private:
+    FCriticalSection GrpcCredentialsLock;
+    std::shared_ptr<grpc::ChannelCredentials> GrpcCredentials;
 };
 
 /**
@@ -108,7 +141,9 @@ class INFRAWORLDRUNTIME_API UGoogleDefaultCredentials : public UChannelCredentia
 {
     GENERATED_BODY()
 
-public:
+protected:
+    /// UChannelCredentials interface
+    virtual std::shared_ptr<grpc::ChannelCredentials> BuildGrpcCredentials() const override;
 };
 
 /**
@@ -128,6 +163,17 @@ public:
 
     UPROPERTY(BlueprintReadOnly, Transient, DisplayName="PEM Certificate Chain", Category=GrpcCerts)
     FString PemCertChain;
+
+    /// UChannelCredentials interface
+
+    /**
+     * Shares a process-wide TLS session cache with the channel, so reconnects and new channels to the same server
+     * resume sessions instead of doing full handshakes.
+     */
+    virtual void ApplyChannelArguments(grpc::ChannelArguments& Arguments) const override;
+
+protected:
+    virtual std::shared_ptr<grpc::ChannelCredentials> BuildGrpcCredentials() const override;
 };
 
 /**
@@ -138,7 +184,9 @@ class INFRAWORLDRUNTIME_API UInsecureChannelCredentials : public UChannelCredent
 {
     GENERATED_BODY()
 
-public:
+protected:
+    /// UChannelCredentials interface
+    virtual std::shared_ptr<grpc::ChannelCredentials> BuildGrpcCredentials() const override;
 };
 
 /**
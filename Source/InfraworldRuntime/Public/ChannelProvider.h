@@ -21,6 +21,7 @@
 
 #include "RpcClientWorker.h"
 #include "ChannelCredentials.h"
+#include "InProcessServers.h"
 
 namespace channel
 {
@@ -39,7 +40,7 @@ namespace channel
 		return true;
 	}
 
-	FORCEINLINE bool WaitForConnection(float Seconds, const std::shared_ptr<grpc::Channel>& Channel)
+	FORCEINLINE bool WaitForConnection(float Seconds, const std::shared_ptr<grpc::Channel>& Channel, const RpcClientWorker* Worker = nullptr)
 	{
 		bool IsConnected = false;
 
@@ -54,6 +55,10 @@ namespace channel
 		{
 			std::chrono::system_clock::time_point delta_tp = std::chrono::system_clock::now() + std::chrono::milliseconds(100);
 
+			// Stop waiting if the worker is being stopped meanwhile.
+			if (Worker && Worker->IsPendingStopped())
+				break;
+
 			if (current_tp < end_tp)
 				IsConnected = WaitUntilChannelIsReady(Channel, delta_tp);
 			else
@@ -76,33 +81,8 @@ namespace channel
 			return grpc::InsecureChannelCredentials();
 		}
 
-		// Classify the credentials
-		if (Credentials->IsA<UGoogleDefaultCredentials>())
-		{
-			return grpc::GoogleDefaultCredentials();
-		}
-		else if (Credentials->IsA<UInsecureChannelCredentials>())
-		{
-			return grpc::InsecureChannelCredentials();
-		}
-		else if (const USslCredentials* const SslCredentials = Cast<USslCredentials>(Credentials))
-		{
-			grpc::SslCredentialsOptions Options;
-
-			if (SslCredentials->PemRootCerts.Len() > 0)
-				Options.pem_root_certs = TCHAR_TO_ANSI(*(SslCredentials->PemRootCerts));
-			if (SslCredentials->PemPrivateKey.Len() > 0)
-				Options.pem_private_key = TCHAR_TO_ANSI(*(SslCredentials->PemPrivateKey));
-			if (SslCredentials->PemCertChain.Len() > 0)
-				Options.pem_cert_chain = TCHAR_TO_ANSI(*(SslCredentials->PemCertChain));
-
-			return grpc::SslCredentials(Options);
-		}
-
-		// Unknown credentials
-		UE_LOG(LogTemp, Error, TEXT("Don't know how to process credentials:'%s'. Replacement is grpc::InsecureChannelCredentials()."),
-			*(Credentials->GetClass()->GetName()));
-		return grpc::InsecureChannelCredentials();
+		// Built once per credentials object, @see UChannelCredentials::GetGrpcCredentials().
+		return Credentials->GetGrpcCredentials();
 	}
 
 	FORCEINLINE std::shared_ptr<grpc::Channel> CreateChannel(RpcClientWorker* Worker)
@@ -111,17 +91,53 @@ namespace channel
 		UE_CLOG(!ChannelCredentials, LogTemp, Fatal, TEXT("Channel Credentials mustn't be null"));
 
 		const FString& URI = Worker->URI;
+
+		// A worker, that has given up connecting, only needs a channel to set its stubs up: no calls are made through it
+		// (they complete as Unavailable), so it is never connected.
+		if (Worker->IsFailed())
+		{
+			Worker->Channel = grpc::CreateChannel(TCHAR_TO_ANSI(*URI), grpc::InsecureChannelCredentials());
+			return Worker->Channel;
+		}
+
+		// In-process servers are reached directly, credentials don't apply and there's no connection to wait for.
+		FString InProcessServerName;
+		if (FGrpcInProcessServers::ParseUri(URI, InProcessServerName))
+		{
+			std::shared_ptr<grpc::Channel> Channel = FGrpcInProcessServers::CreateChannel(InProcessServerName);
+
+			if (!Channel)
+			{
+				// Connection is being retried, the error is only dispatched once.
+				if (Worker->FailedConnectionAttempts == 0)
+					Worker->DispatchError(FString::Printf(TEXT("No in-process server is registered as \"%s\""), *InProcessServerName));
+				return std::shared_ptr<grpc::Channel>(nullptr);
+			}
+
+			UE_LOG(LogTemp, Display, TEXT("Connected to the in-process server \"%s\""), *InProcessServerName);
+
+			Worker->Channel = Channel;
+
+			return Channel;
+		}
+
 		UE_LOG(LogTemp, Display, TEXT("The following Channel Credentials is used: \"%s\". Connecting to: \"%s\""), *(ChannelCredentials->GetName()), *URI);
 
 		std::shared_ptr<grpc::ChannelCredentials> GrpcCredentials = GetGrpcCredentials(ChannelCredentials);
-		std::shared_ptr<grpc::Channel> Channel = grpc::CreateChannel(TCHAR_TO_ANSI(*URI), GrpcCredentials);
 
-		bool bConnectionWasSuccessful = WaitForConnection(3, Channel);
+		grpc::ChannelArguments Arguments;
+		ChannelCredentials->ApplyChannelArguments(Arguments);
+
+		std::shared_ptr<grpc::Channel> Channel = grpc::CreateCustomChannel(TCHAR_TO_ANSI(*URI), GrpcCredentials, Arguments);
+
+		bool bConnectionWasSuccessful = WaitForConnection(3, Channel, Worker);
 
 		if (!bConnectionWasSuccessful)
 		{
-			Worker->DispatchError(
-				NSLOCTEXT("InfraworldChannelProvider", "InfraworldChannelProviderGrpcServiceConnectionError", "Service connection failure!").ToString());
+			// Connection is being retried, the error is only dispatched once.
+			if (Worker->FailedConnectionAttempts == 0)
+				Worker->DispatchError(
+					NSLOCTEXT("InfraworldChannelProvider", "InfraworldChannelProviderGrpcServiceConnectionError", "Service connection failure!").ToString());
 			return std::shared_ptr<grpc::Channel>(nullptr);
 		}
 		else
@@ -130,6 +146,8 @@ namespace channel
 				*NSLOCTEXT("InfraworldChannelProvider", "InfraworldChannelProviderGrpcServiceConnectionSuccess", "Service connection established!").ToString());
 		}
 
+		Worker->Channel = Channel;
+
 		return Channel;
 	}
 }	
\ No newline at end of file
@@ -0,0 +1,100 @@
+/*
+ * Copyright 2018 Vizor Games LLC
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS, WITHOUT
+ * WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.See the
+ * License for the specific language governing permissions and limitations
+ * under the License.
+ */
+#pragma once
+
+#include "CoreMinimal.h"
+#include "GenUtils.h"
+
+#include <string>
+#include <utility>
+#include <vector>
+
+class FGrpcCompiledContext;
+
+typedef TSharedRef<const FGrpcCompiledContext, ESPMode::ThreadSafe> FGrpcCompiledContextRef;
+
+/**
+ * An immutable, precompiled form of FGrpcClientContext. Metadata is validated and encoded into UTF-8 once, when the
+ * context is compiled, so applying it to a call (see casts::CastClientContext) involves no string conversions.
+ *
+ * Most calls use one of a few fixed contexts (auth token, build id, region...), so contexts should be compiled once
+ * and shared between calls (and threads).
+ */
+class INFRAWORLDRUNTIME_API FGrpcCompiledContext
+{
+public:
+    /**
+     * Validates and compiles a context. Metadata entries, that would be rejected by gRPC, are dropped with an error.
+     *
+     * @param Context A context to compile.
+     * @return A compiled context, which could be used for any number of calls from any thread.
+     */
+    static FGrpcCompiledContextRef Compile(const FGrpcClientContext& Context);
+
+    /**
+     * Interns metadata and authority of a context: contexts with equal ones share a single compiled context, which
+     * lives as long as any context references it. Thread safe.
+     *
+     * Requests embed their contexts by value, so contexts with metadata should be interned once and then be reused:
+     * copies of an interned context don't copy any strings. Metadata, added to an interned context, is per call.
+     *
+     * @param Context A context to intern, its metadata is validated as by Compile().
+     * @return A copy of Context, which references the shared metadata and authority instead of owning them.
+     */
+    static FGrpcClientContext Intern(const FGrpcClientContext& Context);
+
+    /**
+     * @return A copy of Context, owning all of its metadata and authority (merged from the shared ones, if any), so
+     *         every field is a UPROPERTY. Used to serialize contexts.
+     */
+    static FGrpcClientContext Flatten(const FGrpcClientContext& Context);
+
+    /**
+     * Restores an equivalent client context, since compiled contexts don't keep their sources.
+     */
+    void Restore(FGrpcClientContext& OutContext) const;
+
+    /**
+     * Validates a single metadata entry, as grpc/core/lib/surface/validate_metadata does.
+     *
+     * @param Key Metadata key.
+     * @param Value Metadata value.
+     * @param OutError Reason of the failure, if any.
+     *
+     * @return True if the entry could be added to a call.
+     */
+    static bool ValidateMetadata(const FString& Key, const FString& Value, FString& OutError);
+
+    /** UTF-8 encoded metadata, (key, value) pairs. */
+    std::vector<std::pair<std::string, std::string>> Metadata;
+
+    /** Keys of Metadata, as they were in the source context, so per-call entries could override them without conversions. */
+    TArray<FString> MetadataKeys;
+
+    /** Authority header, applied only if bHasAuthority is set. */
+    std::string Authority;
+    bool bHasAuthority = false;
+
+    /** Deadline, relative to the moment of a call. Not applied if not positive. */
+    int64 DeadlineMilliseconds = -1;
+
+    EGrpcCompressionAlgorithm CompressionAlgorithm = EGrpcCompressionAlgorithm::CompressNone;
+
+    bool bIdempotent = false;
+    bool bCacheable = false;
+    bool bWaitForReady = false;
+    bool bInitialMetadataCorked = false;
+};
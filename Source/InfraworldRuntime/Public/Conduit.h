@@ -18,6 +18,52 @@
 #include "CoreMinimal.h"
 #include "HAL/PlatformTLS.h"
 #include "Containers/Queue.h"
+#include "Templates/Atomic.h"
+#include "InfraworldStats.h"
+#include "RpcCancellation.h"
+#include "RpcMetrics.h"
+#include "RpcSpillFile.h"
+#include "RpcTrace.h"
+
+// Hooks, called for every item passing a conduit. Overloaded for TRequestWithContext and TResponseWithStatus in GenUtils.h.
+template<class TItem>
+FORCEINLINE void OnConduitEnqueued(TItem& Item)
+{
+}
+
+template<class TItem>
+FORCEINLINE void OnConduitDequeued(TItem& Item)
+{
+}
+
+template<class TItem>
+FORCEINLINE uint64 GetRpcCorrelationId(const TItem& Item)
+{
+    return 0;
+}
+
+// Attaches a new cancellation token to a request, linked to its previous one (if any), and returns it. Only called in
+// latest-wins mode.
+template<class TItem>
+FORCEINLINE TSharedPtr<FRpcCancellation, ESPMode::ThreadSafe> GetRpcCancellation(TItem& Item)
+{
+    return nullptr;
+}
+
+// Serialization of requests, spilled to disk. Only called for conduits with spill enabled.
+template<class TItem>
+FORCEINLINE bool EncodeSpilledItem(const TItem& Item, TArray<uint8>& OutRecord)
+{
+    static_assert(sizeof(TItem) == 0, "Items of this type can't be spilled to disk");
+    return false;
+}
+
+template<class TItem>
+FORCEINLINE bool DecodeSpilledItem(const TArray<uint8>& Record, TItem& OutItem)
+{
+    static_assert(sizeof(TItem) == 0, "Items of this type can't be spilled to disk");
+    return false;
+}
 
 /**
  * A conduit is a combination of two channel: The Request channel, and the Response channel, representing bidirectional queue.
@@ -31,7 +77,7 @@ class TConduit
     FORCEINLINE uint32 ThreadID() const { return FPlatformTLS::GetCurrentThreadId(); }
 
 public:
-    TConduit() : RequestsProducerID(-1), ResponsesProducerID(-1)
+    TConduit() : RequestsProducerID(-1), ResponsesProducerID(-1), RequestsDepth(0), ResponsesDepth(0), Spill(nullptr)
     {
     }
 
@@ -61,42 +107,167 @@ public:
         ResponsesProducerID = ThreadID();
     }
 
+    /**
+     * Opts in spilling requests to disk: once serialized requests, queued in memory, exceed the limit, further ones are
+     * written to segment files and are read back in order. Keeps memory flat during long outages, meant for
+     * non-urgent traffic (analytics, telemetry). Requests must be USTRUCTs.
+     *
+     * Should be called from the Request producer thread, before any request has been enqueued.
+     */
+    void EnableSpill(const FRpcSpillSettings& Settings)
+    {
+        UE_CLOG(ThreadID() != RequestsProducerID, LogTemp, Fatal, TEXT("Can't call EnableSpill(), invalid thread. Expected: %u, got: %u"), RequestsProducerID, ThreadID());
+        ensureAlways(RequestsDepth.Load() == 0);
+
+        if (!ensureAlwaysMsgf(!Spill.Load(), TEXT("Spill has already been enabled")))
+            return;
+
+        EncodeSpilledRequest = [](const TRequest& Item, TArray<uint8>& OutRecord) { return EncodeSpilledItem(Item, OutRecord); };
+        DecodeSpilledRequest = [](const TArray<uint8>& Record, TRequest& OutItem) { return DecodeSpilledItem(Record, OutItem); };
+
+        // Published last, since the Response producer may already be polling IsEmpty().
+        Spill = new FRpcRequestSpill(Settings);
+    }
+
+    /**
+     * Opts in latest-wins mode: every request supersedes the previous one, which is cancelled (see FRpcCancellation),
+     * so it's dropped if it is still queued or is cancelled if it is in flight. Meant for queries, of which only
+     * the latest result matters (search as you type, camera-driven streaming). Requests, spilled to disk, can't be
+     * superseded.
+     *
+     * Should be called from the Request producer thread.
+     */
+    void EnableLatestWins()
+    {
+        UE_CLOG(ThreadID() != RequestsProducerID, LogTemp, Fatal, TEXT("Can't call EnableLatestWins(), invalid thread. Expected: %u, got: %u"), RequestsProducerID, ThreadID());
+        bLatestWins = true;
+    }
+
 // Enqueue:
     bool Enqueue(const TRequest& Item)
     {
-        UE_CLOG(ThreadID() != RequestsProducerID, LogTemp, Fatal, TEXT("Can't call Enqueue(const TRequest&), invalid thread. Expected: %u, got: %u"), ResponsesProducerID, ThreadID());
-        return Requests.Enqueue(Item);
+        return Enqueue(TRequest(Item));
     }
 
     bool Enqueue(const TResponse& Item)
     {
-        UE_CLOG(ThreadID() != ResponsesProducerID, LogTemp, Fatal, TEXT("Can't call Enqueue(const TResponse&), invalid thread. Expected: %u, got: %u"), RequestsProducerID, ThreadID());
-        return Responses.Enqueue(Item);
+        return Enqueue(TResponse(Item));
     }
 
     bool Enqueue(TRequest&& Item)
     {
         UE_CLOG(ThreadID() != RequestsProducerID, LogTemp, Fatal, TEXT("Can't call Enqueue(const TRequest&), invalid thread. Expected: %u, got: %u"), ResponsesProducerID, ThreadID());
-        return Requests.Enqueue(Item);
+        OnConduitEnqueued(Item);
+        INFRAWORLD_TRACE_SCOPE("Infraworld.EnqueueRequest", GetRpcCorrelationId(Item));
+
+        if (bLatestWins)
+        {
+            if (LatestRequest.IsValid())
+                LatestRequest->Cancel();
+
+            LatestRequest = GetRpcCancellation(Item);
+        }
+
+        ++RequestsDepth;
+        INC_DWORD_STAT(STAT_InfraworldQueuedRequests);
+
+        if (FRpcRequestSpill* const SpillState = Spill.Load())
+        {
+            // Only requests, that may go to disk, are serialized.
+            TArray<uint8> Record;
+            if (!SpillState->ShouldSerialize())
+            {
+                SpillState->Keep();
+            }
+            else if (EncodeSpilledRequest(Item, Record))
+            {
+                const ERpcSpillResult Result = SpillState->SpillOrKeep(Record);
+                if (Result == ERpcSpillResult::Spilled)
+                    return true;
+
+                if (Result == ERpcSpillResult::Dropped)
+                {
+                    --RequestsDepth;
+                    DEC_DWORD_STAT(STAT_InfraworldQueuedRequests);
+                    return false;
+                }
+            }
+            else if (SpillState->HasSpilled())
+            {
+                // Keeping it in memory would put it ahead of the spilled requests.
+                UE_LOG(LogTemp, Error, TEXT("Unable to serialize a request, it can't be spilled to disk and is dropped"));
+                SpillState->OnDropped();
+                --RequestsDepth;
+                DEC_DWORD_STAT(STAT_InfraworldQueuedRequests);
+                return false;
+            }
+            else
+            {
+                UE_LOG(LogTemp, Error, TEXT("Unable to serialize a request, it is kept in memory"));
+                SpillState->Keep();
+            }
+        }
+
+        return Requests.Enqueue(MoveTemp(Item));
     }
 
     bool Enqueue(TResponse&& Item)
     {
         UE_CLOG(ThreadID() != ResponsesProducerID, LogTemp, Fatal, TEXT("Can't call Enqueue(const TResponse&), invalid thread. Expected: %u, got: %u"), RequestsProducerID, ThreadID());
-        return Responses.Enqueue(Item);
+        OnConduitEnqueued(Item);
+        INFRAWORLD_TRACE_SCOPE("Infraworld.EnqueueResponse", GetRpcCorrelationId(Item));
+
+        ++ResponsesDepth;
+        INC_DWORD_STAT(STAT_InfraworldQueuedResponses);
+        return Responses.Enqueue(MoveTemp(Item));
     }
 
 // Dequeue
     bool Dequeue(TRequest& OutItem)
     {
         UE_CLOG(ThreadID() != ResponsesProducerID, LogTemp, Fatal, TEXT("Can't call Dequeue(TRequest& OutItem), invalid thread. Expected: %u, got: %u"), ResponsesProducerID, ThreadID());
-        return Requests.Dequeue(OutItem);
+        FRpcRequestSpill* const SpillState = Spill.Load();
+        if (Requests.Dequeue(OutItem))
+        {
+            if (SpillState)
+                SpillState->OnDequeuedFromMemory();
+        }
+        else if (!SpillState || !DequeueSpilled(*SpillState, OutItem))
+        {
+            return false;
+        }
+
+        INFRAWORLD_TRACE_SCOPE("Infraworld.DequeueRequest", GetRpcCorrelationId(OutItem));
+
+        --RequestsDepth;
+        DEC_DWORD_STAT(STAT_InfraworldQueuedRequests);
+        OnConduitDequeued(OutItem);
+        return true;
     }
 
     bool Dequeue(TResponse& OutItem)
     {
         UE_CLOG(ThreadID() != RequestsProducerID, LogTemp, Fatal, TEXT("Can't call Dequeue(TResponse& OutItem), invalid thread. Expected: %u, got: %u"), RequestsProducerID, ThreadID());
-        return Responses.Dequeue(OutItem);
+        if (!Responses.Dequeue(OutItem))
+            return false;
+
+        INFRAWORLD_TRACE_SCOPE("Infraworld.DequeueResponse", GetRpcCorrelationId(OutItem));
+
+        --ResponsesDepth;
+        DEC_DWORD_STAT(STAT_InfraworldQueuedResponses);
+        OnConduitDequeued(OutItem);
+        return true;
+    }
+
+// Depth (could be called from any thread)
+    int32 GetRequestsDepth() const
+    {
+        return RequestsDepth.Load();
+    }
+
+    int32 GetResponsesDepth() const
+    {
+        return ResponsesDepth.Load();
     }
 
 // Is Empty?
@@ -107,7 +278,10 @@ public:
         if (Id == RequestsProducerID)
             return Responses.IsEmpty();
         else if (Id == ResponsesProducerID)
-            return Requests.IsEmpty();
+        {
+            const FRpcRequestSpill* const SpillState = Spill.Load();
+            return Requests.IsEmpty() && !(SpillState && SpillState->HasSpilled());
+        }
         else
         {
             UE_LOG(LogTemp, Fatal, TEXT("Can't call IsEmpty(), from an unknown thread: %d, RequestsProducerID: %u, ResponsesProducerID: %u"), Id, RequestsProducerID, ResponsesProducerID);
@@ -116,15 +290,49 @@ public:
     }
 
 private:
+    bool DequeueSpilled(FRpcRequestSpill& SpillState, TRequest& OutItem)
+    {
+        TArray<uint8> Record;
+        while (SpillState.ReadSpilled(Record))
+        {
+            if (DecodeSpilledRequest(Record, OutItem))
+                return true;
+
+            // A request, that can't be decoded, is dropped.
+            UE_LOG(LogTemp, Error, TEXT("Unable to decode a spilled request, it is dropped"));
+            SpillState.OnDropped();
+            --RequestsDepth;
+            DEC_DWORD_STAT(STAT_InfraworldQueuedRequests);
+        }
+
+        return false;
+    }
+
     TQueue<TRequest> Requests;
     TQueue<TResponse> Responses;
 
     volatile uint32 RequestsProducerID;
     volatile uint32 ResponsesProducerID;
+
+    TAtomic<int32> RequestsDepth;
+    TAtomic<int32> ResponsesDepth;
+
+    /** Spill state (owned), null unless EnableSpill() has been called. Atomic, since both producers read it. */
+    TAtomic<FRpcRequestSpill*> Spill;
+    bool (*EncodeSpilledRequest)(const TRequest&, TArray<uint8>&) = nullptr;
+    bool (*DecodeSpilledRequest)(const TArray<uint8>&, TRequest&) = nullptr;
+
+    /** Whether EnableLatestWins() has been called, and the token of the latest request, which is cancelled by the next one. */
+    bool bLatestWins = false;
+    TSharedPtr<FRpcCancellation, ESPMode::ThreadSafe> LatestRequest;
 };
 
 template<class TRequest, class TResponse>
 TConduit<TRequest, TResponse>::~TConduit()
 {
+    // Items, left in the queues, are no longer queued.
+    DEC_DWORD_STAT_BY(STAT_InfraworldQueuedRequests, RequestsDepth.Load());
+    DEC_DWORD_STAT_BY(STAT_InfraworldQueuedResponses, ResponsesDepth.Load());
 
+    delete Spill.Load();
 }
@@ -16,8 +16,14 @@
 #pragma once
 
 #include "CoreMinimal.h"
+#include "HAL/PlatformTime.h"
+#include "RpcCancellation.h"
+#include "RpcSpillFile.h"
+#include "RpcTrace.h"
 #include "GenUtils.generated.h"
 
+class FGrpcCompiledContext;
+
 // XX - major version
 // YY - minor version
 // ZZ - patch
@@ -42,6 +48,22 @@ struct INFRAWORLDRUNTIME_API FByteArray
         Bytes(InBytes)
     {
     }
+
+    /**
+     * Adopts the storage of InBytes, no copy is being made.
+     */
+    FByteArray(TArray<uint8>&& InBytes) :
+        Bytes(MoveTemp(InBytes))
+    {
+    }
+
+    /**
+     * Copies Num bytes from Data straight into the wrapped array (a single allocation and a single copy).
+     */
+    FByteArray(const uint8* Data, int32 Num) :
+        Bytes(Data, Num)
+    {
+    }
 };
 
 // ~~~~~ Network CONTEXT ~~~~~
@@ -54,7 +76,13 @@ enum class EGrpcCompressionAlgorithm : uint8
 {
     CompressNone,
     CompressDeflate,
-    CompressGzip
+    CompressGzip,
+
+    /**
+     * Not a gRPC algorithm: one of the above is chosen per request, by its size and the compression ratio of its
+     * method. @see FAdaptiveCompression
+     */
+    CompressAdaptive
 };
 
 /**
@@ -122,32 +150,57 @@ struct INFRAWORLDRUNTIME_API FGrpcClientContext
      * Set an algorithm to be the compression algorithm used for the client call.
      */
     UPROPERTY(BlueprintReadWrite, AdvancedDisplay, Category=Metadata)
-    EGrpcCompressionAlgorithm GrpcCompressionAlgorithm;
+    EGrpcCompressionAlgorithm GrpcCompressionAlgorithm = EGrpcCompressionAlgorithm::CompressNone;
 
     /**
      * EXPERIMENTAL: Set this request to be idempotent.
      */
     UPROPERTY(BlueprintReadWrite, AdvancedDisplay, Category=Metadata)
-    bool bIdempotent;
+    bool bIdempotent = false;
 
     /**
      * EXPERIMENTAL: Set this request to be cacheable.
      */
     UPROPERTY(BlueprintReadWrite, AdvancedDisplay, Category=Metadata)
-    bool bCacheable;
+    bool bCacheable = false;
 
     /**
      * EXPERIMENTAL: Trigger wait-for-ready or not on this request.
      */
     UPROPERTY(BlueprintReadWrite, AdvancedDisplay, Category=Metadata)
-    bool bWaitForReady;
+    bool bWaitForReady = false;
 
     /**
      * Flag whether the initial metadata should be corked. If corked is true, then the initial metadata will be colasced
      * with the write of first message in the stream.
      */
     UPROPERTY(BlueprintReadWrite, AdvancedDisplay, Category=Metadata)
-    bool bInitialMetadataCorked;
+    bool bInitialMetadataCorked = false;
+
+    /**
+     * Not exposed: the moment (FPlatformTime::Seconds()) a request with this context has been enqueued into a conduit,
+     * used to measure queue wait time. Zero if unknown.
+     */
+    double EnqueueTimeSeconds = 0.0;
+
+    /** Not exposed: an id, which tags trace scopes of a call. Assigned when the request is enqueued. */
+    uint64 CorrelationId = 0;
+
+    /**
+     * Not exposed: the moment (FPlatformTime::Seconds()) the call expires. Is stamped from DeadlineSeconds when
+     * the request is enqueued, so time spent in a queue counts towards the deadline. Zero if there is no deadline,
+     * or the request hasn't been queued (DeadlineSeconds is relative to the moment of the call then).
+     */
+    double AbsoluteDeadlineSeconds = 0.0;
+
+    /**
+     * Not exposed: metadata and authority, shared by many requests, @see FGrpcCompiledContext::Intern(). If set,
+     * entries of Metadata replace shared ones with the same keys, and Authority (if not empty) replaces the shared one.
+     */
+    TSharedPtr<const FGrpcCompiledContext, ESPMode::ThreadSafe> Shared;
+
+    /** Not exposed: a token to cancel the call with, @see FRpcCancellation. */
+    TSharedPtr<FRpcCancellation, ESPMode::ThreadSafe> Cancellation;
 };
 
 
@@ -357,12 +410,23 @@ struct INFRAWORLDRUNTIME_API FGrpcStatus
     FString ErrorDetails;
 };
 
+class FRpcMethodMetrics;
+
 template<class TResponseType>
 struct TResponseWithStatus
 {
     TResponseType Response;
     FGrpcStatus Status;
 
+    /** The moment the response has been received by a worker, used to measure dispatch time. */
+    double CompletionTimeSeconds = 0.0;
+
+    /** Correlation id of the call, @see FRpcTrace. */
+    uint64 CorrelationId = 0;
+
+    /** Metrics of the method the response belongs to, if any. */
+    TSharedPtr<FRpcMethodMetrics, ESPMode::ThreadSafe> Metrics;
+
     TResponseWithStatus()
     {
     }
@@ -373,3 +437,68 @@ struct TResponseWithStatus
     {
     }
 };
+
+// ~~~~~ Conduit hooks (@see TConduit) ~~~~~
+
+/**
+ * Stamps the context of a request, which is being queued for a worker: the enqueue time, the absolute deadline and
+ * the correlation id.
+ */
+FORCEINLINE void StampEnqueuedContext(FGrpcClientContext& Context)
+{
+    Context.EnqueueTimeSeconds = FPlatformTime::Seconds();
+
+    // A deadline, that has been stamped already, is kept (e.g. if the request is enqueued again).
+    if (Context.DeadlineSeconds > 0.0f && Context.AbsoluteDeadlineSeconds <= 0.0)
+        Context.AbsoluteDeadlineSeconds = Context.EnqueueTimeSeconds + Context.DeadlineSeconds;
+
+    if (Context.CorrelationId == 0)
+        Context.CorrelationId = FRpcTrace::NextCorrelationId();
+}
+
+template<class TRequestType>
+FORCEINLINE void OnConduitEnqueued(TRequestWithContext<TRequestType>& Item)
+{
+    StampEnqueuedContext(Item.Context);
+}
+
+template<class TResponseType>
+FORCEINLINE void OnConduitDequeued(TResponseWithStatus<TResponseType>& Item)
+{
+    if (Item.Metrics.IsValid())
+    {
+        Item.Metrics->RecordDispatch(FPlatformTime::Seconds() - Item.CompletionTimeSeconds);
+        Item.Metrics.Reset();
+    }
+}
+
+template<class TRequestType>
+FORCEINLINE TSharedPtr<FRpcCancellation, ESPMode::ThreadSafe> GetRpcCancellation(TRequestWithContext<TRequestType>& Item)
+{
+    // The token of the context could be shared with other requests, superseding this one must not cancel them.
+    return FRpcCancellation::AttachLinked(Item.Context);
+}
+
+template<class TRequestType>
+FORCEINLINE uint64 GetRpcCorrelationId(const TRequestWithContext<TRequestType>& Item)
+{
+    return Item.Context.CorrelationId;
+}
+
+template<class TResponseType>
+FORCEINLINE uint64 GetRpcCorrelationId(const TResponseWithStatus<TResponseType>& Item)
+{
+    return Item.CorrelationId;
+}
+
+template<class TRequestType>
+FORCEINLINE bool EncodeSpilledItem(const TRequestWithContext<TRequestType>& Item, TArray<uint8>& OutRecord)
+{
+    return FRpcRequestSpill::EncodeRecord(TRequestType::StaticStruct(), &Item.Request, Item.Context, OutRecord);
+}
+
+template<class TRequestType>
+FORCEINLINE bool DecodeSpilledItem(const TArray<uint8>& Record, TRequestWithContext<TRequestType>& OutItem)
+{
+    return FRpcRequestSpill::DecodeRecord(TRequestType::StaticStruct(), Record, &OutItem.Request, OutItem.Context);
+}
@@ -24,6 +24,10 @@ public:
      * Attempts to validate a URI, further provided to grpc::CreateChannel function.
      * It does not tries to establish any kind of connections, so it checks only format.
      *
+     * Accepted forms are "host[:port]", "inproc:<name>" (@see FGrpcInProcessServers) and, except on Windows,
+     * Unix domain sockets: "unix:<path>" and "unix://<absolute path>". "unix-abstract:<name>" is refused, since
+     * the bundled gRPC doesn't support it.
+     *
      * @param MaybeGrpcUri Grpc URI to validate.
      * @param OutError Error message if any.
      *
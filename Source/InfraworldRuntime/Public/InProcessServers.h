@@ -0,0 +1,82 @@
+/*
+ * Copyright 2018 Vizor Games LLC
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS, WITHOUT
+ * WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.See the
+ * License for the specific language governing permissions and limitations
+ * under the License.
+ */
+#pragma once
+
+#include "CoreMinimal.h"
+
+#include <memory>
+
+#include "GrpcIncludesBegin.h"
+
+#include <grpcpp/channel.h>
+#include <grpcpp/server.h>
+
+#include "GrpcIncludesEnd.h"
+
+/**
+ * Registry of gRPC servers, hosted in the same process as their clients (dedicated servers, tests).
+ *
+ * Clients, created with an "inproc:<Name>" URI, are connected to a server registered under Name through
+ * grpc::Server::InProcessChannel(), bypassing sockets, TLS and HTTP/2 framing. Channel credentials are ignored then.
+ *
+ *     FGrpcInProcessServers::Register(TEXT("Matchmaker"), Server.get());
+ *     UMatchmakerRpcClient* Client = NewRpcClient<UMatchmakerRpcClient>(TEXT("inproc:Matchmaker"), Credentials);
+ *
+ * A server must be registered before its clients are initialized, and must be unregistered before it is shut down.
+ */
+class INFRAWORLDRUNTIME_API FGrpcInProcessServers
+{
+public:
+    /** Prefix of URIs, which refer to in-process servers. */
+    static const TCHAR* const UriPrefix;
+
+    /**
+     * Registers a server under a name. Thread safe.
+     *
+     * @param Name Name to refer to the server by, must consist of letters, digits, '-', '_' and '.'.
+     * @param Server A started server. It is not owned by the registry.
+     *
+     * @return False if the name is invalid, or a server with the same name is already registered.
+     */
+    static bool Register(const FString& Name, grpc::Server* Server);
+
+    /**
+     * Unregisters a server. Channels, which have already been created, stay valid until the server is shut down.
+     */
+    static void Unregister(const FString& Name);
+
+    /**
+     * Checks whether a URI refers to an in-process server.
+     *
+     * @param Uri URI to check.
+     * @param OutName Name of the server, if the URI has the in-process form.
+     *
+     * @return True if the URI has the "inproc:<Name>" form (the server might be not registered though).
+     */
+    static bool ParseUri(const FString& Uri, FString& OutName);
+
+    /**
+     * @return True if Name could be used to register a server.
+     */
+    static bool IsValidName(const FString& Name);
+
+    /**
+     * Creates an in-process channel to a registered server.
+     *
+     * @return The channel, or null if no server is registered under Name.
+     */
+    static std::shared_ptr<grpc::Channel> CreateChannel(const FString& Name);
+};
@@ -26,4 +26,10 @@ public:
 	/** IModuleInterface implementation */
 	virtual void StartupModule() override;
 	virtual void ShutdownModule() override;
+
+	/** The module can't be unloaded, since gRPC keeps calling its allocation functions (see FRpcMemory) until the process exits. */
+	virtual bool SupportsDynamicReloading() override
+	{
+		return false;
+	}
 };
@@ -0,0 +1,54 @@
+/*
+ * Copyright 2018 Vizor Games LLC
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS, WITHOUT
+ * WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.See the
+ * License for the specific language governing permissions and limitations
+ * under the License.
+ */
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Stats/Stats.h"
+
+/**
+ * Stats of the runtime, could be observed via 'stat infraworld'. These are process-wide totals, per client and
+ * per method metrics are available via URpcClient::GetMetricsSnapshot(), even if stats are compiled out.
+ */
+DECLARE_STATS_GROUP(TEXT("Infraworld"), STATGROUP_Infraworld, STATCAT_Advanced);
+
+// Calls
+DECLARE_CYCLE_STAT_EXTERN(TEXT("Conversion"), STAT_InfraworldConversion, STATGROUP_Infraworld, INFRAWORLDRUNTIME_API);
+DECLARE_DWORD_ACCUMULATOR_STAT_EXTERN(TEXT("Calls"), STAT_InfraworldCalls, STATGROUP_Infraworld, INFRAWORLDRUNTIME_API);
+DECLARE_DWORD_ACCUMULATOR_STAT_EXTERN(TEXT("Errors"), STAT_InfraworldErrors, STATGROUP_Infraworld, INFRAWORLDRUNTIME_API);
+DECLARE_DWORD_ACCUMULATOR_STAT_EXTERN(TEXT("In Flight"), STAT_InfraworldInFlight, STATGROUP_Infraworld, INFRAWORLDRUNTIME_API);
+DECLARE_DWORD_ACCUMULATOR_STAT_EXTERN(TEXT("Queued Requests"), STAT_InfraworldQueuedRequests, STATGROUP_Infraworld, INFRAWORLDRUNTIME_API);
+DECLARE_DWORD_ACCUMULATOR_STAT_EXTERN(TEXT("Queued Responses"), STAT_InfraworldQueuedResponses, STATGROUP_Infraworld, INFRAWORLDRUNTIME_API);
+DECLARE_DWORD_ACCUMULATOR_STAT_EXTERN(TEXT("Spilled Requests"), STAT_InfraworldSpilledRequests, STATGROUP_Infraworld, INFRAWORLDRUNTIME_API);
+DECLARE_DWORD_ACCUMULATOR_STAT_EXTERN(TEXT("Dropped Requests (spill)"), STAT_InfraworldDroppedRequests, STATGROUP_Infraworld, INFRAWORLDRUNTIME_API);
+DECLARE_DWORD_ACCUMULATOR_STAT_EXTERN(TEXT("Deadline Misses"), STAT_InfraworldDeadlineMisses, STATGROUP_Infraworld, INFRAWORLDRUNTIME_API);
+DECLARE_DWORD_ACCUMULATOR_STAT_EXTERN(TEXT("Expired Requests (not sent)"), STAT_InfraworldExpiredRequests, STATGROUP_Infraworld, INFRAWORLDRUNTIME_API);
+DECLARE_DWORD_ACCUMULATOR_STAT_EXTERN(TEXT("Cancelled Requests (not sent)"), STAT_InfraworldCancelledRequests, STATGROUP_Infraworld, INFRAWORLDRUNTIME_API);
+DECLARE_MEMORY_STAT_EXTERN(TEXT("Spill Bytes on Disk"), STAT_InfraworldSpillDiskBytes, STATGROUP_Infraworld, INFRAWORLDRUNTIME_API);
+DECLARE_MEMORY_STAT_EXTERN(TEXT("Bytes Sent"), STAT_InfraworldBytesSent, STATGROUP_Infraworld, INFRAWORLDRUNTIME_API);
+DECLARE_MEMORY_STAT_EXTERN(TEXT("Bytes Received"), STAT_InfraworldBytesReceived, STATGROUP_Infraworld, INFRAWORLDRUNTIME_API);
+DECLARE_FLOAT_ACCUMULATOR_STAT_EXTERN(TEXT("Last Network Time (ms)"), STAT_InfraworldLastNetworkMs, STATGROUP_Infraworld, INFRAWORLDRUNTIME_API);
+DECLARE_FLOAT_ACCUMULATOR_STAT_EXTERN(TEXT("Last Dispatch Time (ms)"), STAT_InfraworldLastDispatchMs, STATGROUP_Infraworld, INFRAWORLDRUNTIME_API);
+
+// Adaptive compression
+DECLARE_CYCLE_STAT_EXTERN(TEXT("Compression Sampling"), STAT_InfraworldCompressionSampling, STATGROUP_Infraworld, INFRAWORLDRUNTIME_API);
+DECLARE_DWORD_ACCUMULATOR_STAT_EXTERN(TEXT("Compressed Requests"), STAT_InfraworldCompressedRequests, STATGROUP_Infraworld, INFRAWORLDRUNTIME_API);
+DECLARE_DWORD_ACCUMULATOR_STAT_EXTERN(TEXT("Uncompressed Requests"), STAT_InfraworldUncompressedRequests, STATGROUP_Infraworld, INFRAWORLDRUNTIME_API);
+DECLARE_MEMORY_STAT_EXTERN(TEXT("Compression Bytes Saved (est.)"), STAT_InfraworldCompressionBytesSaved, STATGROUP_Infraworld, INFRAWORLDRUNTIME_API);
+DECLARE_FLOAT_ACCUMULATOR_STAT_EXTERN(TEXT("Compression CPU Seconds (est.)"), STAT_InfraworldCompressionCpuSeconds, STATGROUP_Infraworld, INFRAWORLDRUNTIME_API);
+
+// Memory, see FRpcMemory
+DECLARE_MEMORY_STAT_EXTERN(TEXT("gRPC Core Memory"), STAT_InfraworldGrpcMemory, STATGROUP_Infraworld, INFRAWORLDRUNTIME_API);
+DECLARE_MEMORY_STAT_EXTERN(TEXT("Protobuf Arena Memory"), STAT_InfraworldArenaMemory, STATGROUP_Infraworld, INFRAWORLDRUNTIME_API);
@@ -0,0 +1,244 @@
+/*
+ * Copyright 2018 Vizor Games LLC
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS, WITHOUT
+ * WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.See the
+ * License for the specific language governing permissions and limitations
+ * under the License.
+ */
+#pragma once
+
+#include "CoreMinimal.h"
+#include "CastUtils.h"
+#include "RpcMemory.h"
+
+#include <memory>
+
+#include "GrpcIncludesBegin.h"
+
+#include <google/protobuf/arena.h>
+
+#include "GrpcIncludesEnd.h"
+
+namespace lazy
+{
+    // Chooses a cast function by the type of Unreal value being requested.
+    template<class TUnrealValue>
+    struct TLazyCaster
+    {
+        template<class TProtoValue>
+        static FORCEINLINE TUnrealValue Cast(const TProtoValue& Value)
+        {
+            return casts::Proto_Cast<TUnrealValue>(Value);
+        }
+    };
+
+    template<class T>
+    struct TLazyCaster<TArray<T>>
+    {
+        template<class TProtoValue>
+        static FORCEINLINE TArray<T> Cast(const casts::_ProtobufArray<TProtoValue>& Value)
+        {
+            return casts::Proto_ArrayCast<T>(Value);
+        }
+
+        template<class TProtoValue>
+        static FORCEINLINE TArray<T> Cast(const casts::_ProtobufPtrArray<TProtoValue>& Value)
+        {
+            return casts::Proto_PtrArrayCast<T>(Value);
+        }
+    };
+
+    template<class K, class V>
+    struct TLazyCaster<TMap<K, V>>
+    {
+        template<class TProtoKey, class TProtoValue>
+        static FORCEINLINE TMap<K, V> Cast(const casts::_ProtobufMap<TProtoKey, TProtoValue>& Value)
+        {
+            return casts::Proto_MapCast<K, V>(Value);
+        }
+    };
+
+    // A unique address per type, used instead of RTTI to tell cached values apart.
+    template<class T>
+    struct TLazyTypeId
+    {
+        static const uint8 Id;
+    };
+
+    template<class T>
+    const uint8 TLazyTypeId<T>::Id = 0;
+
+    /**
+     * Keeps a received message (allocated on its own arena) and Unreal values, already converted from its fields.
+     * Is shared between all views of the message.
+     */
+    class FLazyMessageStorage
+    {
+    public:
+        struct FCachedValueBase
+        {
+            virtual ~FCachedValueBase() {}
+        };
+
+        // A field is identified by its message and its accessor, so the key doesn't depend on what the caller passes.
+        template<class T, class TAccessor>
+        struct TCachedValue : FCachedValueBase
+        {
+            TAccessor Accessor;
+            T Value;
+
+            TCachedValue(TAccessor InAccessor, T&& InValue) : Accessor(InAccessor), Value(MoveTemp(InValue))
+            {
+            }
+        };
+
+        struct FCacheEntry
+        {
+            const void* Message;
+            const void* Type;
+            TUniquePtr<FCachedValueBase> Value;
+        };
+
+        // Blocks of the arena are allocated through FMemory.
+        google::protobuf::Arena Arena;
+
+        FLazyMessageStorage() : Arena(FRpcMemory::GetArenaOptions())
+        {
+        }
+
+        // Usually only a few fields are being read, so a linear search is faster than hashing.
+        TArray<FCacheEntry> Cache;
+
+        template<class TUnrealValue, class TProtoMessage, class TAccessor>
+        const TUnrealValue& FindOrCast(const TProtoMessage* Message, TAccessor Accessor)
+        {
+            typedef TCachedValue<TUnrealValue, TAccessor> FCached;
+            const void* const Type = &TLazyTypeId<FCached>::Id;
+
+            for (const FCacheEntry& Entry : Cache)
+            {
+                if (Entry.Message == Message && Entry.Type == Type)
+                {
+                    const FCached* const Cached = static_cast<const FCached*>(Entry.Value.Get());
+                    if (Cached->Accessor == Accessor)
+                        return Cached->Value;
+                }
+            }
+
+            FCached* const Cached = new FCached(Accessor, TLazyCaster<TUnrealValue>::Cast((Message->*Accessor)()));
+            Cache.Add(FCacheEntry{Message, Type, TUniquePtr<FCachedValueBase>(Cached)});
+
+            return Cached->Value;
+        }
+    };
+}
+
+/**
+ * A view of a received protobuf message, which converts its fields into Unreal types only when they're accessed for
+ * the first time. Is returned by TStubbedRpcWorker::AsyncLazyRequest(), useful for large responses of which only a
+ * small part is being read.
+ *
+ * The message is kept alive (on its own arena) as long as any view of it (including views of its sub-messages) exists.
+ * Views are cheap to copy, but aren't thread safe: they should be used from a single thread at a time.
+ *
+ * Fields are passed as accessors of the message. Scalar fields don't need a conversion, so they should be read
+ * straight from GetProto():
+ *
+ *     const int32 Gold = Response.GetProto().gold();
+ *     const FString& Nickname = Response.Get<FString>(&FPlayerProto::nickname);
+ *     const TArray<FItem>& Items = Response.Get<TArray<FItem>>(&FPlayerProto::items);
+ */
+template<class TProtoMessage>
+class TLazyMessage
+{
+public:
+    TLazyMessage() : Message(nullptr)
+    {
+    }
+
+    TLazyMessage(const std::shared_ptr<lazy::FLazyMessageStorage>& InStorage, const TProtoMessage* InMessage) :
+        Storage(InStorage),
+        Message(InMessage)
+    {
+    }
+
+    /**
+     * Creates an empty message on a new arena, so it could be received into.
+     *
+     * @param OutMessage Mutable pointer to the message.
+     */
+    static TLazyMessage Create(TProtoMessage*& OutMessage)
+    {
+        std::shared_ptr<lazy::FLazyMessageStorage> NewStorage = std::make_shared<lazy::FLazyMessageStorage>();
+        OutMessage = google::protobuf::Arena::CreateMessage<TProtoMessage>(&NewStorage->Arena);
+
+        return TLazyMessage(NewStorage, OutMessage);
+    }
+
+    FORCEINLINE bool IsValid() const
+    {
+        return Message != nullptr;
+    }
+
+    /**
+     * @return The underlying message, fields of which could be read directly.
+     */
+    FORCEINLINE const TProtoMessage& GetProto() const
+    {
+        check(Message);
+        return *Message;
+    }
+
+    /**
+     * Converts a field (or a sub-message) of the message into an Unreal type, caching the result.
+     * Repeated fields and maps are being converted into TArray and TMap respectively.
+     *
+     * @param Accessor Getter of the field, which returns it by reference, e.g. &FPlayerProto::nickname.
+     * @return The converted value, valid as long as the view is.
+     */
+    template<class TUnrealValue, class TProtoValue>
+    FORCEINLINE const TUnrealValue& Get(const TProtoValue& (TProtoMessage::*Accessor)() const) const
+    {
+        check(Storage && Message);
+        return Storage->template FindOrCast<TUnrealValue>(Message, Accessor);
+    }
+
+    /** Getters, which return by value (scalars and enums), need no conversion: read them from GetProto(). */
+    template<class TUnrealValue, class TProtoValue>
+    const TUnrealValue& Get(TProtoValue (TProtoMessage::*Accessor)() const) const = delete;
+
+    /**
+     * @param SubMessage A sub-message, returned by reference from a getter of GetProto().
+     * @return A lazy view of a sub-message, sharing the storage (and the cache) with this view.
+     */
+    template<class TProtoSubMessage>
+    FORCEINLINE TLazyMessage<TProtoSubMessage> GetMessage(const TProtoSubMessage& SubMessage) const
+    {
+        return TLazyMessage<TProtoSubMessage>(Storage, &SubMessage);
+    }
+
+    /** A temporary isn't a part of the message, so it can't outlive the call. */
+    template<class TProtoSubMessage>
+    TLazyMessage<TProtoSubMessage> GetMessage(const TProtoSubMessage&& SubMessage) const = delete;
+
+    /**
+     * Converts the whole message at once, as non-lazy requests do.
+     */
+    template<class TUnrealMessage>
+    FORCEINLINE TUnrealMessage Convert() const
+    {
+        return casts::Proto_Cast<TUnrealMessage>(GetProto());
+    }
+
+private:
+    std::shared_ptr<lazy::FLazyMessageStorage> Storage;
+    const TProtoMessage* Message;
+};
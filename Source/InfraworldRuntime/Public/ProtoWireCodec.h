@@ -0,0 +1,173 @@
+/*
+ * Copyright 2018 Vizor Games LLC
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS, WITHOUT
+ * WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.See the
+ * License for the specific language governing permissions and limitations
+ * under the License.
+ */
+#pragma once
+
+#include "CoreMinimal.h"
+
+class UScriptStruct;
+
+namespace grpc
+{
+    class ByteBuffer;
+}
+
+/**
+ * How an integral property is represented on the wire, if it can't be inferred from the property type alone.
+ */
+enum class EProtoFieldEncoding : uint8
+{
+    /** int32/int64 for signed properties, uint32/uint64 for unsigned ones, enum for enum properties. */
+    Default,
+
+    /** sint32/sint64 (ZigZag varint). */
+    ZigZag,
+
+    /** sfixed32/sfixed64 for signed properties, fixed32/fixed64 for unsigned ones. */
+    Fixed,
+
+    /** uint32/uint64, stored in a signed property (Blueprints have no unsigned types). */
+    Unsigned,
+
+    /** fixed32/fixed64, stored in a signed property. */
+    UnsignedFixed
+};
+
+/**
+ * Where field numbers of a struct come from.
+ */
+enum class EProtoFieldNumbering : uint8
+{
+    /** Only numbers, registered via FProtoWireCodec::RegisterFields(), are used. Structs without them can't be encoded. */
+    Registered,
+
+    /**
+     * Structs without registered numbers are numbered 1, 2, 3... in declaration order. Only for messages that never
+     * leave the process (spill files, traffic logs), since real proto messages are rarely numbered this way.
+     */
+    DeclarationOrder
+};
+
+/**
+ * Maps a single property of a USTRUCT to a protobuf field.
+ */
+struct FProtoFieldSpec
+{
+    /** Name of the property (as in C++). */
+    FName PropertyName;
+
+    /** Protobuf field number. */
+    int32 FieldNumber;
+
+    /** Wire representation of the field. For TArray and TMap properties, applies to elements (to values for maps). */
+    EProtoFieldEncoding Encoding;
+
+    FProtoFieldSpec(FName InPropertyName, int32 InFieldNumber, EProtoFieldEncoding InEncoding = EProtoFieldEncoding::Default) :
+        PropertyName(InPropertyName),
+        FieldNumber(InFieldNumber),
+        Encoding(InEncoding)
+    {
+    }
+};
+
+/**
+ * Encodes USTRUCTs directly into protobuf wire format (and decodes them back), without instantiating intermediate
+ * protobuf messages and calling Proto_Cast<>().
+ *
+ * A field plan is built once per struct type from its reflection data, and is then used for every call.
+ * Field numbers must be registered via RegisterFields() before the struct is being encoded for the first time
+ * (nested structs included), structs without them are refused rather than encoded with guessed tags.
+ *
+ * Supported properties: bool, integers, float, double, enums, FString, FName, FText, FByteArray (as bytes),
+ * nested USTRUCTs (as messages), TArray of them (repeated, numbers are packed) and TMap (map<K, V>).
+ * Scalars, that have default values, are not written, as in proto3.
+ */
+class INFRAWORLDRUNTIME_API FProtoWireCodec
+{
+public:
+    /**
+     * Explicitly maps properties of Struct to protobuf fields. Properties, that aren't mentioned, are not encoded.
+     * Must be called before the struct is being encoded or decoded for the first time.
+     *
+     * @param Struct Struct to register fields for.
+     * @param Fields Property to field mapping.
+     */
+    static void RegisterFields(UScriptStruct* Struct, const TArray<FProtoFieldSpec>& Fields);
+
+    /**
+     * Encodes a struct into protobuf wire format.
+     *
+     * @param Struct Type of the struct.
+     * @param StructData Pointer to an instance of Struct.
+     * @param OutBytes Encoded message. Previous content is being replaced.
+     * @param Numbering Where field numbers come from.
+     *
+     * @return True on success, false if Struct has properties which can't be encoded or has no field numbers.
+     */
+    static bool Encode(UScriptStruct* Struct, const void* StructData, TArray<uint8>& OutBytes,
+        EProtoFieldNumbering Numbering = EProtoFieldNumbering::Registered);
+
+    /**
+     * Encodes a struct into a gRPC byte buffer. Memory of the encoded message is handed over to the buffer, no copy is
+     * being made. Messages, sent over the wire, always use registered field numbers.
+     */
+    static bool Encode(UScriptStruct* Struct, const void* StructData, grpc::ByteBuffer& OutBuffer);
+
+    /**
+     * Decodes a protobuf message into a struct. Unknown fields are skipped.
+     *
+     * @param Struct Type of the struct.
+     * @param Data Encoded message.
+     * @param Num Size of the encoded message in bytes.
+     * @param OutStructData Pointer to an instance of Struct. It is reset to defaults before decoding.
+     * @param Numbering Where field numbers come from, must match the one the message has been encoded with.
+     *
+     * @return True on success, false if the message is malformed or Struct can't be decoded.
+     */
+    static bool Decode(UScriptStruct* Struct, const uint8* Data, int32 Num, void* OutStructData,
+        EProtoFieldNumbering Numbering = EProtoFieldNumbering::Registered);
+
+    /**
+     * Decodes a protobuf message, received into a gRPC byte buffer, into a struct. Single-slice buffers (which is
+     * the common case) are decoded in place.
+     */
+    static bool Decode(UScriptStruct* Struct, const grpc::ByteBuffer& Buffer, void* OutStructData);
+
+    // Typed helpers, T must be a USTRUCT.
+
+    template<class T>
+    static FORCEINLINE bool Encode(const T& Item, TArray<uint8>& OutBytes, EProtoFieldNumbering Numbering = EProtoFieldNumbering::Registered)
+    {
+        return Encode(T::StaticStruct(), &Item, OutBytes, Numbering);
+    }
+
+    template<class T>
+    static FORCEINLINE bool Encode(const T& Item, grpc::ByteBuffer& OutBuffer)
+    {
+        return Encode(T::StaticStruct(), &Item, OutBuffer);
+    }
+
+    template<class T>
+    static FORCEINLINE bool Decode(const uint8* Data, int32 Num, T& OutItem, EProtoFieldNumbering Numbering = EProtoFieldNumbering::Registered)
+    {
+        return Decode(T::StaticStruct(), Data, Num, &OutItem, Numbering);
+    }
+
+    template<class T>
+    static FORCEINLINE bool Decode(const grpc::ByteBuffer& Buffer, T& OutItem)
+    {
+        return Decode(T::StaticStruct(), Buffer, &OutItem);
+    }
+};
@@ -0,0 +1,105 @@
+/*
+ * Copyright 2018 Vizor Games LLC
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS, WITHOUT
+ * WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.See the
+ * License for the specific language governing permissions and limitations
+ * under the License.
+ */
+#pragma once
+
+#include "CoreMinimal.h"
+
+#if !UE_BUILD_SHIPPING
+
+/**
+ * Counts allocations, made through FMemory (and thus through operator new of engine modules), used by benchmarks.
+ *
+ * While counting, GMalloc is wrapped by a proxy, which forwards all calls to the original allocator. Allocations are
+ * counted process-wide, so other threads should be idle. Memory of gRPC core and protobuf arenas, which FRpcMemory
+ * routes through FMemory as well, isn't counted: counts cover the plugin and objects, created via operator new
+ * (gRPC C++ objects, protobuf messages outside of arenas).
+ */
+class INFRAWORLDRUNTIME_API FRpcAllocationCounter
+{
+public:
+    /**
+     * Starts counting, calls could be nested. Should be called from the game thread.
+     */
+    static void Begin();
+
+    /**
+     * Stops counting, once every Begin() call is matched.
+     */
+    static void End();
+
+    /**
+     * @return Number of allocations (including reallocations), counted so far. Never decreases.
+     */
+    static uint64 GetNumAllocations();
+
+    /**
+     * @return Number of allocations, made by the calling thread while counting, so far. Unlike GetNumAllocations(),
+     *         isn't affected by other threads (e.g. of a local server).
+     */
+    static uint64 GetNumAllocationsOnCurrentThread();
+
+    /**
+     * Stops counting allocations of the calling thread until Resume() is called, calls could be nested. Used by
+     * allocation functions of gRPC core and protobuf arenas.
+     */
+    static void Pause();
+
+    /**
+     * Resumes counting allocations of the calling thread, once every Pause() call is matched.
+     */
+    static void Resume();
+};
+
+/**
+ * Counts allocations while in scope.
+ */
+class FRpcAllocationCounterScope
+{
+public:
+    FRpcAllocationCounterScope() : StartNumAllocations(0), StartNumAllocationsOnCurrentThread(0)
+    {
+        FRpcAllocationCounter::Begin();
+        StartNumAllocations = FRpcAllocationCounter::GetNumAllocations();
+        StartNumAllocationsOnCurrentThread = FRpcAllocationCounter::GetNumAllocationsOnCurrentThread();
+    }
+
+    ~FRpcAllocationCounterScope()
+    {
+        FRpcAllocationCounter::End();
+    }
+
+    /**
+     * @return Number of allocations, made since the scope has been entered.
+     */
+    uint64 GetNumAllocations() const
+    {
+        return FRpcAllocationCounter::GetNumAllocations() - StartNumAllocations;
+    }
+
+    /**
+     * @return Number of allocations, made by the thread, which has entered the scope, since then.
+     */
+    uint64 GetNumAllocationsOnCurrentThread() const
+    {
+        return FRpcAllocationCounter::GetNumAllocationsOnCurrentThread() - StartNumAllocationsOnCurrentThread;
+    }
+
+private:
+    uint64 StartNumAllocations;
+    uint64 StartNumAllocationsOnCurrentThread;
+};
+
+#endif
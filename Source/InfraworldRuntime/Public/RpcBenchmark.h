@@ -0,0 +1,90 @@
+/*
+ * Copyright 2018 Vizor Games LLC
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS, WITHOUT
+ * WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.See the
+ * License for the specific language governing permissions and limitations
+ * under the License.
+ */
+#pragma once
+
+#include "CoreMinimal.h"
+
+#if !UE_BUILD_SHIPPING
+
+/**
+ * Result of a single benchmark case.
+ */
+struct FRpcBenchmarkResult
+{
+    /** Name of the case, like 'ProtoCast.String.ToProto/1024'. */
+    FString Name;
+
+    /** Number of operations, measured by the best run. */
+    int64 Iterations = 0;
+
+    /** Time per operation of the best run, in nanoseconds. */
+    double NanosecondsPerOp = 0.0;
+
+    /** Payload bytes, processed by a single operation (0 if not applicable). */
+    int64 BytesPerOp = 0;
+
+    /** Allocations, made through FMemory by a single operation, except for gRPC core and protobuf arenas, @see FRpcAllocationCounter. */
+    double AllocationsPerOp = 0.0;
+
+    /** Whether the case is a part of the allocation-free path of calls, thus AllocationsPerOp must be 0. */
+    bool bAllocationFree = false;
+
+    /** @return True if the case has allocated, though it must not. */
+    bool HasUnexpectedAllocations() const
+    {
+        return bAllocationFree && AllocationsPerOp > 0.0;
+    }
+};
+
+/**
+ * Microbenchmarks of the runtime's hot primitives: conduits, Proto_Cast<>(), CastClientContext() and the URI validator.
+ *
+ * Every case is run several times for at least MinSeconds, the fastest run is reported. Could be started from the
+ * console (also headless, e.g. -ExecCmds="infraworld.Benchmark,quit"):
+ *
+ *     infraworld.Benchmark [NameFilter] [-MinSeconds=0.2] [-Out=Path.json]
+ *
+ * Results are written as JSON (into Saved/Profiling/Infraworld by default), so they could be compared between versions.
+ * Cases, that are parts of a successful call (status and context casts), must not allocate: that's checked after every
+ * run, see CheckAllocations(). Whole calls, made through a conduit, are checked by the Infraworld.Allocations.CallUnary
+ * automation test.
+ */
+class INFRAWORLDRUNTIME_API FRpcBenchmark
+{
+public:
+    /**
+     * Runs all benchmark cases, names of which contain Filter.
+     *
+     * @param Filter Substring of case names to run, runs everything if empty.
+     * @param MinSeconds Minimal duration of a single run of a case.
+     * @param OutResults Results, appended in order of running.
+     */
+    static void Run(const FString& Filter, double MinSeconds, TArray<FRpcBenchmarkResult>& OutResults);
+
+    /**
+     * Logs an error for every case, that must be allocation-free, but has allocated.
+     *
+     * @return Number of such cases, 0 means the successful path of calls doesn't allocate.
+     */
+    static int32 CheckAllocations(const TArray<FRpcBenchmarkResult>& Results);
+
+    /**
+     * @return Results, serialized into a JSON document along with the engine version and the platform.
+     */
+    static FString ToJson(const TArray<FRpcBenchmarkResult>& Results);
+};
+
+#endif
@@ -0,0 +1,452 @@
+/*
+ * Copyright 2018 Vizor Games LLC
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS, WITHOUT
+ * WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.See the
+ * License for the specific language governing permissions and limitations
+ * under the License.
+ */
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Async/Async.h"
+#include "Async/Future.h"
+#include "RpcClient.h"
+#include "Templates/Atomic.h"
+#include "Templates/Function.h"
+#include "WorkerUtils.h"
+
+/**
+ * Thread continuations of an asynchronous result (see TRpcAsyncResult) are run on.
+ */
+enum class ERpcContinuationThread : uint8
+{
+    /** The game thread, by the ticker of the client (as responses of conduits are dispatched). */
+    GameThread,
+
+    /**
+     * The worker thread of the client, right after the response has been received. Next calls, made from there, are
+     * sent without a round trip through the game thread, but UObjects must not be touched.
+     */
+    WorkerThread,
+
+    /** A background thread of the task graph, for heavy processing of responses, which shouldn't block the worker. */
+    TaskGraph
+};
+
+namespace calls
+{
+    /**
+     * A continuation of an asynchronous result. Continuations are linked into a lock-free list, each one is run once.
+     */
+    struct FRpcContinuation
+    {
+        typedef void (*FFunction)(void* Argument, RpcClientWorker* Worker);
+
+        FFunction Function = nullptr;
+        void* Argument = nullptr;
+
+        /** Is run right on the thread completing the result, instead of the continuation thread (used by combinators). */
+        bool bInline = false;
+
+        FRpcContinuation* Next = nullptr;
+    };
+
+    /**
+     * State of an asynchronous result, shared by its handles and by its producer (a task, posted to a worker, or a
+     * combinator). The result is written once, before the state is complete, then it is only read by continuations.
+     */
+    template<class TResult>
+    class TRpcAsyncState
+    {
+    public:
+        typedef TSharedRef<TRpcAsyncState, ESPMode::ThreadSafe> FRef;
+
+        TResult Result;
+
+        explicit TRpcAsyncState(ERpcContinuationThread InThread) : Thread(InThread), Continuations(nullptr)
+        {
+        }
+
+        FORCEINLINE bool IsComplete() const
+        {
+            return Continuations.Load() == GetCompleteMarker();
+        }
+
+        /**
+         * Adds a continuation, which must stay alive until it is run.
+         *
+         * @return False if the state is already complete, the continuation won't be run then.
+         */
+        bool TryAddContinuation(FRpcContinuation* Continuation)
+        {
+            FRpcContinuation* Head = Continuations.Load();
+            do
+            {
+                if (Head == GetCompleteMarker())
+                    return false;
+
+                Continuation->Next = Head;
+            }
+            while (!Continuations.CompareExchange(Head, Continuation));
+
+            return true;
+        }
+
+        /**
+         * Adds a callback, which is called with the result and the worker, that has completed it (null if none).
+         * Is called right away, on the calling thread, if the state is already complete.
+         */
+        template<class TCallback>
+        void AddCallback(const FRef& Self, TCallback&& Callback, bool bInline)
+        {
+            struct FCallbackContinuation : FRpcContinuation
+            {
+                FRef State;
+                typename TDecay<TCallback>::Type Callback;
+
+                FCallbackContinuation(const FRef& InState, TCallback&& InCallback) :
+                    State(InState),
+                    Callback(Forward<TCallback>(InCallback))
+                {
+                }
+
+                static void Run(void* Argument, RpcClientWorker* Worker)
+                {
+                    FCallbackContinuation* const This = static_cast<FCallbackContinuation*>(Argument);
+                    This->Callback(This->State->Result, Worker);
+                    delete This;
+                }
+            };
+
+            FCallbackContinuation* const Continuation = new FCallbackContinuation(Self, Forward<TCallback>(Callback));
+            Continuation->Function = &FCallbackContinuation::Run;
+            Continuation->Argument = Continuation;
+            Continuation->bInline = bInline;
+
+            if (!TryAddContinuation(Continuation))
+                FCallbackContinuation::Run(Continuation, nullptr);
+        }
+
+        /**
+         * Marks the state as complete, runs inline continuations and dispatches the rest to the continuation thread.
+         * Is called once, after Result has been written.
+         *
+         * @param Self Shared reference to this state, keeps it alive until continuations are run.
+         * @param Worker Worker, completing the state, null if the state is being completed without a worker.
+         */
+        void Complete(const FRef& Self, RpcClientWorker* Worker)
+        {
+            // Continuations are pushed to the front, so the list is reversed to run them in order.
+            FRpcContinuation* List = nullptr;
+            for (FRpcContinuation* Continuation = Continuations.Exchange(GetCompleteMarker()); Continuation != nullptr; )
+            {
+                FRpcContinuation* const Next = Continuation->Next;
+                Continuation->Next = List;
+                List = Continuation;
+                Continuation = Next;
+            }
+
+            FRpcContinuation* Dispatched = nullptr;
+            FRpcContinuation** DispatchedTail = &Dispatched;
+
+            while (List)
+            {
+                // A continuation destroys itself once it has been run.
+                FRpcContinuation* const Next = List->Next;
+
+                if (List->bInline)
+                {
+                    List->Function(List->Argument, Worker);
+                }
+                else
+                {
+                    List->Next = nullptr;
+                    *DispatchedTail = List;
+                    DispatchedTail = &List->Next;
+                }
+
+                List = Next;
+            }
+
+            if (!Dispatched)
+                return;
+
+            if (Thread == ERpcContinuationThread::TaskGraph)
+            {
+                AsyncTask(ENamedThreads::AnyBackgroundThreadNormalTask, [Self, Dispatched]() { Self->Resume(Dispatched, nullptr); });
+            }
+            else if (Thread == ERpcContinuationThread::GameThread && Worker)
+            {
+                Worker->PostToGameThread([Self, Dispatched]() { Self->Resume(Dispatched, nullptr); });
+            }
+            else
+            {
+                Resume(Dispatched, Worker);
+            }
+        }
+
+    private:
+        void Resume(FRpcContinuation* List, RpcClientWorker* Worker)
+        {
+            OnConduitDequeued(Result);
+
+            while (List)
+            {
+                FRpcContinuation* const Next = List->Next;
+                List->Function(List->Argument, Worker);
+                List = Next;
+            }
+        }
+
+        static FORCEINLINE FRpcContinuation* GetCompleteMarker()
+        {
+            return reinterpret_cast<FRpcContinuation*>(static_cast<UPTRINT>(1));
+        }
+
+        const ERpcContinuationThread Thread;
+
+        /** Continuations, pushed to the front, or GetCompleteMarker() once the state is complete. */
+        TAtomic<FRpcContinuation*> Continuations;
+    };
+}
+
+/**
+ * A handle of an asynchronous result, e.g. of a call made on the worker thread of a client (see RpcCall()) or of
+ * a combination of calls (see RpcWhenAll(), RpcWhenAny()). Is cheap to copy.
+ *
+ * Continuations are added via Then() (on the continuation thread) or ThenInline() (right on the completing thread), or
+ * the result could be waited for via ToFuture(). Any number of continuations is allowed, next calls are chained by
+ * making them from a continuation:
+ *
+ *     RpcCall<FLoginResponse>(AuthClient, &Auth::Stub::AsyncLogin, Request).Then([this](const TResponseWithStatus<FLoginResponse>& Login)
+ *     {
+ *         if (Login.Status.ErrorCode == EGrpcStatusCode::Ok)
+ *             RpcCall<FProfile>(ProfileClient, &Profiles::Stub::AsyncGetProfile, FProfileRequest{Login.Response.UserId}).Then(...);
+ *     });
+ */
+template<class TResult>
+class TRpcAsyncResult
+{
+public:
+    typedef calls::TRpcAsyncState<TResult> FState;
+
+    explicit TRpcAsyncResult(const typename FState::FRef& InState) : State(InState)
+    {
+    }
+
+    FORCEINLINE bool IsComplete() const
+    {
+        return State->IsComplete();
+    }
+
+    /**
+     * @return The result, should only be read once IsComplete() is true.
+     */
+    FORCEINLINE const TResult& GetResult() const
+    {
+        check(IsComplete());
+        return State->Result;
+    }
+
+    /**
+     * Adds a callback, run with the result on the continuation thread (or right away, on the calling thread, if the
+     * result is already complete).
+     */
+    void Then(TFunction<void(const TResult&)>&& Callback) const
+    {
+        State->AddCallback(State, [Callback = MoveTemp(Callback)](const TResult& Result, RpcClientWorker*) { Callback(Result); }, false);
+    }
+
+    /**
+     * Adds a callback, run right on the thread completing the result, along with the worker completing it (null if
+     * none). Is meant for combinators: callbacks must be short and thread safe.
+     */
+    template<class TCallback>
+    void ThenInline(TCallback&& Callback) const
+    {
+        State->AddCallback(State, Forward<TCallback>(Callback), true);
+    }
+
+    /**
+     * @return A future, which is fulfilled on the thread, completing the result (before continuations are run).
+     *         Is meant for code, running off the game thread, which could block while waiting.
+     */
+    TFuture<TResult> ToFuture() const
+    {
+        const TSharedRef<TPromise<TResult>, ESPMode::ThreadSafe> Promise = MakeShared<TPromise<TResult>, ESPMode::ThreadSafe>();
+        TFuture<TResult> Future = Promise->GetFuture();
+
+        ThenInline([Promise](const TResult& Result, RpcClientWorker*) { Promise->SetValue(Result); });
+        return Future;
+    }
+
+private:
+    typename FState::FRef State;
+};
+
+/**
+ * A handle of a unary call, @see RpcCall().
+ */
+template<class TResponse>
+using TRpcCall = TRpcAsyncResult<TResponseWithStatus<TResponse>>;
+
+/**
+ * Makes a unary call on the worker thread of a client and returns its handle. The call is posted to the worker right
+ * away (the worker is woken up, it doesn't wait for the next update), continuations are run on the chosen thread.
+ * A worker makes its calls one by one, so calls on the same client are serialized.
+ *
+ * If the client can't send requests, the call completes right away with the Cancelled status (Unavailable, if its
+ * worker has given up connecting).
+ *
+ * @param Client Client to make the call with, must be the client of the service MemberPointer belongs to.
+ * @param MemberPointer Async method of the stub, e.g. &Greeter::Stub::AsyncSayHello.
+ * @param Request Request to be sent, is converted into a proto message on the worker thread.
+ * @param Context Context of the call.
+ * @param Thread Thread continuations of the call run on.
+ */
+template<class TUnrealResponse, class TUnrealRequest, class TStub, class TProtoRequest, class TProtoResponse>
+TRpcCall<TUnrealResponse> RpcCall(URpcClient* Client,
+    std::unique_ptr<grpc::ClientAsyncResponseReader<TProtoResponse>> (TStub::*MemberPointer)(grpc::ClientContext*, const TProtoRequest&, grpc::CompletionQueue*),
+    const TUnrealRequest& Request, const FGrpcClientContext& Context = FGrpcClientContext(),
+    ERpcContinuationThread Thread = ERpcContinuationThread::GameThread)
+{
+    typedef calls::TRpcAsyncState<TResponseWithStatus<TUnrealResponse>> FState;
+    const typename FState::FRef State = MakeShared<FState, ESPMode::ThreadSafe>(Thread);
+
+    RpcClientWorker* const Worker = Client && Client->CanSendRequests() ? Client->GetInnerWorker() : nullptr;
+    if (!Worker)
+    {
+        if (Client && Client->GetInnerWorker() && Client->GetInnerWorker()->IsFailed())
+        {
+            State->Result.Status.ErrorCode = EGrpcStatusCode::Unavailable;
+            State->Result.Status.ErrorMessage = TEXT("The client has given up connecting to the server");
+        }
+        else
+        {
+            State->Result.Status.ErrorCode = EGrpcStatusCode::Cancelled;
+            State->Result.Status.ErrorMessage = TEXT("The client can't send requests");
+        }
+
+        State->Complete(State, nullptr);
+
+        return TRpcCall<TUnrealResponse>(State);
+    }
+
+    // As requests, passing conduits, are stamped.
+    FGrpcClientContext CallContext = Context;
+    StampEnqueuedContext(CallContext);
+
+    Worker->PostTask([State, Request, CallContext, MemberPointer](RpcClientWorker& InWorker)
+    {
+        // A failed worker completes the call as Unavailable.
+        if (InWorker.IsWorking() || InWorker.IsFailed())
+        {
+            TStubbedRpcWorker<TStub>& StubbedWorker = static_cast<TStubbedRpcWorker<TStub>&>(InWorker);
+            State->Result = StubbedWorker.template AsyncRequest<TUnrealRequest, TProtoRequest, TUnrealResponse, TProtoResponse>(Request, CallContext, MemberPointer);
+        }
+        else
+        {
+            State->Result.Status.ErrorCode = EGrpcStatusCode::Cancelled;
+            State->Result.Status.ErrorMessage = TEXT("The client has been stopped");
+            State->Result.CorrelationId = CallContext.CorrelationId;
+        }
+
+        State->Complete(State, &InWorker);
+    });
+
+    return TRpcCall<TUnrealResponse>(State);
+}
+
+/**
+ * Same as RpcCall(), but returns a future of the call, for code running off the game thread, which could block.
+ */
+template<class TUnrealResponse, class TUnrealRequest, class TStub, class TProtoRequest, class TProtoResponse>
+TFuture<TResponseWithStatus<TUnrealResponse>> RpcCallFuture(URpcClient* Client,
+    std::unique_ptr<grpc::ClientAsyncResponseReader<TProtoResponse>> (TStub::*MemberPointer)(grpc::ClientContext*, const TProtoRequest&, grpc::CompletionQueue*),
+    const TUnrealRequest& Request, const FGrpcClientContext& Context = FGrpcClientContext())
+{
+    return RpcCall<TUnrealResponse>(Client, MemberPointer, Request, Context, ERpcContinuationThread::WorkerThread).ToFuture();
+}
+
+/**
+ * Combines results (e.g. of calls, made in parallel) into a single one, which is complete once all of them are.
+ *
+ * @param Results Results to wait for.
+ * @param Thread Thread continuations of the combined result run on.
+ * @return Copies of the results, in the same order.
+ */
+template<class TResult>
+TRpcAsyncResult<TArray<TResult>> RpcWhenAll(const TArray<TRpcAsyncResult<TResult>>& Results, ERpcContinuationThread Thread = ERpcContinuationThread::GameThread)
+{
+    typedef calls::TRpcAsyncState<TArray<TResult>> FState;
+    const typename FState::FRef State = MakeShared<FState, ESPMode::ThreadSafe>(Thread);
+
+    State->Result.SetNum(Results.Num());
+
+    if (Results.Num() == 0)
+    {
+        State->Complete(State, nullptr);
+        return TRpcAsyncResult<TArray<TResult>>(State);
+    }
+
+    const TSharedRef<TAtomic<int32>, ESPMode::ThreadSafe> NumRemaining = MakeShared<TAtomic<int32>, ESPMode::ThreadSafe>(Results.Num());
+
+    for (int32 Index = 0; Index < Results.Num(); Index++)
+    {
+        Results[Index].ThenInline([State, NumRemaining, Index](const TResult& Result, RpcClientWorker* Worker)
+        {
+            State->Result[Index] = Result;
+
+            if (--(*NumRemaining) == 0)
+                State->Complete(State, Worker);
+        });
+    }
+
+    return TRpcAsyncResult<TArray<TResult>>(State);
+}
+
+/**
+ * Combines results into a single one, which is complete once any of them is.
+ *
+ * @param Results Results to wait for.
+ * @param Thread Thread continuations of the combined result run on.
+ * @return Index of the result, which has been complete first (its value could be read via GetResult()), INDEX_NONE
+ *         if Results is empty.
+ */
+template<class TResult>
+TRpcAsyncResult<int32> RpcWhenAny(const TArray<TRpcAsyncResult<TResult>>& Results, ERpcContinuationThread Thread = ERpcContinuationThread::GameThread)
+{
+    typedef calls::TRpcAsyncState<int32> FState;
+    const typename FState::FRef State = MakeShared<FState, ESPMode::ThreadSafe>(Thread);
+
+    if (Results.Num() == 0)
+    {
+        State->Result = INDEX_NONE;
+        State->Complete(State, nullptr);
+        return TRpcAsyncResult<int32>(State);
+    }
+
+    const TSharedRef<TAtomic<bool>, ESPMode::ThreadSafe> bAnyComplete = MakeShared<TAtomic<bool>, ESPMode::ThreadSafe>(false);
+
+    for (int32 Index = 0; Index < Results.Num(); Index++)
+    {
+        Results[Index].ThenInline([State, bAnyComplete, Index](const TResult&, RpcClientWorker* Worker)
+        {
+            if (!bAnyComplete->Exchange(true))
+            {
+                State->Result = Index;
+                State->Complete(State, Worker);
+            }
+        });
+    }
+
+    return TRpcAsyncResult<int32>(State);
+}
@@ -0,0 +1,129 @@
+/*
+ * Copyright 2018 Vizor Games LLC
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS, WITHOUT
+ * WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.See the
+ * License for the specific language governing permissions and limitations
+ * under the License.
+ */
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Misc/ScopeLock.h"
+#include "Templates/Atomic.h"
+
+namespace grpc
+{
+    class ClientContext;
+}
+
+struct FGrpcClientContext;
+
+/**
+ * A token to cancel a call with, set to FGrpcClientContext::Cancellation. Requests, cancelled while still queued,
+ * aren't sent at all: they complete with the Cancelled status. Calls in flight are cancelled via TryCancel().
+ *
+ *     FGrpcClientContext Context;
+ *     const TSharedRef<FRpcCancellation, ESPMode::ThreadSafe> Cancellation = FRpcCancellation::Attach(Context);
+ *     Client->Search(Request, Context);
+ *     ...
+ *     Cancellation->Cancel();
+ *
+ * A token could be shared by several calls, cancelling all of them at once. @see TConduit::EnableLatestWins() to
+ * cancel obsolete requests automatically: requests get their own tokens there, linked to the tokens of their contexts.
+ */
+class INFRAWORLDRUNTIME_API FRpcCancellation
+{
+public:
+    FRpcCancellation();
+
+    /**
+     * @param InParent A token, cancelling which cancels this one as well (null if none). Cancelling this one doesn't
+     *        affect the parent.
+     */
+    explicit FRpcCancellation(const TSharedPtr<FRpcCancellation, ESPMode::ThreadSafe>& InParent);
+
+    /**
+     * Creates a token and sets it to the context (replacing the previous one, if any).
+     */
+    static TSharedRef<FRpcCancellation, ESPMode::ThreadSafe> Attach(FGrpcClientContext& Context);
+
+    /**
+     * Creates a token, linked to the one of the context (if any), and sets it to the context instead. Cancelling the new
+     * token cancels only calls with this context (or its copies, made afterwards).
+     */
+    static TSharedRef<FRpcCancellation, ESPMode::ThreadSafe> AttachLinked(FGrpcClientContext& Context);
+
+    /**
+     * Cancels calls with this token. Thread safe, further calls do nothing.
+     */
+    void Cancel();
+
+    FORCEINLINE bool IsCancelled() const
+    {
+        return bCancelled.Load() || (Parent.IsValid() && Parent->IsCancelled());
+    }
+
+    /**
+     * Is called by a worker before a call is started, so Cancel() could cancel it in flight.
+     *
+     * @return False if the token has been cancelled, the call must not be sent then.
+     */
+    bool BeginCall(grpc::ClientContext& ClientContext);
+
+    /**
+     * Is called by a worker once the call, started by BeginCall(), is complete.
+     */
+    void EndCall(grpc::ClientContext& ClientContext);
+
+private:
+    TAtomic<bool> bCancelled;
+
+    /** Calls are registered with the parent as well, so cancelling it cancels them in flight. */
+    const TSharedPtr<FRpcCancellation, ESPMode::ThreadSafe> Parent;
+
+    FCriticalSection Lock;
+
+    /** Calls in flight, a token is usually used by a single call at a time. */
+    TArray<grpc::ClientContext*, TInlineAllocator<1>> ClientContexts;
+};
+
+/**
+ * Binds a call to a cancellation token (if any) for the duration of the scope.
+ */
+class FRpcCancellationScope
+{
+public:
+    FRpcCancellationScope(FRpcCancellation* InCancellation, grpc::ClientContext& InClientContext) :
+        Cancellation(InCancellation),
+        ClientContext(InClientContext),
+        bCancelled(InCancellation && !InCancellation->BeginCall(InClientContext))
+    {
+    }
+
+    ~FRpcCancellationScope()
+    {
+        if (Cancellation && !bCancelled)
+            Cancellation->EndCall(ClientContext);
+    }
+
+    /**
+     * @return True if the call has been cancelled before being started.
+     */
+    FORCEINLINE bool IsCancelled() const
+    {
+        return bCancelled;
+    }
+
+private:
+    FRpcCancellation* const Cancellation;
+    grpc::ClientContext& ClientContext;
+    const bool bCancelled;
+};
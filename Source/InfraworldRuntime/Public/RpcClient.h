@@ -82,10 +82,34 @@ public:
      * Checks whether the RPC Client could send requests.
      *
      * @return True if the RPC Client is properly initialized and can send requests. If not - all requests will be ignored.
+     *         False as well once the client has given up connecting (see infraworld.Reconnect.MaxAttempts): requests,
+     *         queued by then, complete with the Unavailable status.
      */
     UFUNCTION(BlueprintCallable, BlueprintPure, Category="Vizor|RPC Client", meta=(DisplayName="Can Send Requests?"))
     bool CanSendRequests() const;
 
+    /**
+     * Returns per-method metrics of this RPC Client: call counts, status codes, traffic and latency percentiles.
+     * Metrics are collected in all build configurations.
+     */
+    UFUNCTION(BlueprintCallable, Category="Vizor|RPC Client")
+    FRpcClientMetricsSnapshot GetMetricsSnapshot() const;
+
+    /**
+     * Resets metrics of this RPC Client.
+     */
+    UFUNCTION(BlueprintCallable, Category="Vizor|RPC Client")
+    void ResetMetrics();
+
+    /**
+     * @return The worker of this RPC Client, which makes its calls on a separate thread. Tasks could be posted to it,
+     *         see RpcCall(). Null if the client hasn't been initialized.
+     */
+    FORCEINLINE RpcClientWorker* GetInnerWorker() const
+    {
+        return InnerWorker.Get();
+    }
+
     /**
      * Instantiates a new RPC Dispatcher. You should use this function, not 'Construct Object from Class', to properly initialize the instance.
      *
@@ -141,6 +165,12 @@ private:
     /** An accumulator for error messages */
     TQueue<FRpcError> ErrorMessageQueue;
 
+    /** Functions, posted to the game thread by the worker (e.g. continuations of calls) */
+    TQueue<TFunction<void()>, EQueueMode::Mpsc> GameThreadQueue;
+
+    /** Runs all the functions, posted to the game thread */
+    void RunGameThreadQueue();
+
     /**
      * Global engine ticker handler
      * Only "IsValid() -> true" if this RPC client "CanSendRequests() -> true"
@@ -19,24 +19,33 @@
 
 #include "Containers/Queue.h"
 #include "ChannelCredentials.h"
+#include "HAL/Event.h"
 #include "HAL/Runnable.h"
 #include "InfraworldRuntime.h"
+#include "RpcMetrics.h"
 #include <memory>
 #include <chrono>
 
 #include "Templates/Atomic.h"
+#include "Templates/Function.h"
 
 enum class ERpcWorkerState : uint8
 {
 	PendingInitialization,
 	Initializing,
 	Working,
+	Failed,
 	PendingShutdown,
 	Shutdown
 };
 
 class FGenAsyncRequest;
 
+namespace grpc
+{
+	class Channel;
+}
+
 /**
  * Base RPC Client Worker, it 'lives' in a separate thread and updates all conduits with responses.
  */
@@ -58,22 +67,86 @@ public:
 		UE_LOG(LogInfraworldRuntime, Log, TEXT("RpcClientWorker at [%p] Marking pending stopped"), this);
 		const ERpcWorkerState PreviousWorkerState = WorkerState.Exchange(ERpcWorkerState::PendingShutdown);
 		static const TSet<ERpcWorkerState> ExpectedWorkerStates = {
-			ERpcWorkerState::PendingInitialization, ERpcWorkerState::Initializing, ERpcWorkerState::Working
+			ERpcWorkerState::PendingInitialization, ERpcWorkerState::Initializing, ERpcWorkerState::Working, ERpcWorkerState::Failed
 		};
 		ensureAlways(ExpectedWorkerStates.Contains(PreviousWorkerState));    
+
+		WakeEvent->Trigger();
     }
 	
     virtual bool HierarchicalInit() = 0;
 	virtual void HierarchicalUpdate() = 0;
 
+	FORCEINLINE bool IsWorking() const
+	{
+		return WorkerState.Load() == ERpcWorkerState::Working;
+	}
+
+	/**
+	 * @return True if the worker has given up connecting (@see infraworld.Reconnect.MaxAttempts). It keeps running
+	 *         until stopped, but completes every request as Unavailable without sending it.
+	 */
+	FORCEINLINE bool IsFailed() const
+	{
+		return WorkerState.Load() == ERpcWorkerState::Failed;
+	}
+
+	/**
+	 * Queues a task to be run on the worker thread, between updates. Tasks, posted while the worker is connecting,
+	 * are run once it is connected. Tasks, that are pending when the worker stops, are still run (IsWorking() is false
+	 * then), so they could complete their calls as cancelled.
+	 *
+	 * Should be called from the game thread or from the worker thread, i.e. not concurrently with URpcClient::Stop().
+	 */
+	void PostTask(TFunction<void(RpcClientWorker&)>&& Task);
+
+	/**
+	 * Queues a function to be run on the game thread by the ticker of the client. Thread safe.
+	 */
+	void PostToGameThread(TFunction<void()>&& Function);
+
     void DispatchError(const FString& ErrorMessage);
 
 //public:
     FString URI;
     UChannelCredentials* ChannelCredentials;
 
+	/** A channel, the worker has been connected via. Set by channel::CreateChannel(). */
+	std::shared_ptr<grpc::Channel> Channel;
+
+	/** Per-method metrics of calls, made by the worker. */
+	FRpcClientMetrics Metrics;
+
+	/**
+	 * Number of failed attempts to connect in a row, while the worker is initializing. Only the first failure is
+	 * dispatched as an error, further attempts are made with a backoff (@see infraworld.Reconnect.* console variables).
+	 * Giving up is dispatched as an error as well.
+	 */
+	int32 FailedConnectionAttempts = 0;
+
     TQueue<FRpcError>* ErrorMessageQueue;
+
+	/** Functions, posted to the game thread, @see PostToGameThread(). Owned by the client, which destroys the worker first. */
+	TQueue<TFunction<void()>, EQueueMode::Mpsc>* GameThreadQueue = nullptr;
 	
 protected:
 	TAtomic<ERpcWorkerState> WorkerState;
+
+private:
+	/**
+	 * Sleeps for a while, waking up early if the worker is being stopped.
+	 *
+	 * @return False if the worker is being stopped.
+	 */
+	bool WaitWhileInitializing(double Seconds) const;
+
+	/**
+	 * Runs all the posted tasks.
+	 */
+	void RunPendingTasks();
+
+	TQueue<TFunction<void(RpcClientWorker&)>, EQueueMode::Mpsc> Tasks;
+
+	/** Wakes the worker up when a task is posted or the worker is being stopped, so neither waits for the next update. */
+	FEvent* WakeEvent;
 };
@@ -0,0 +1,139 @@
+/*
+ * Copyright 2018 Vizor Games LLC
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS, WITHOUT
+ * WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.See the
+ * License for the specific language governing permissions and limitations
+ * under the License.
+ */
+#pragma once
+
+#include "CoreMinimal.h"
+
+#if !UE_BUILD_SHIPPING
+
+#include "RpcMetrics.h"
+
+/**
+ * How clients of a load test reach the echo server.
+ */
+enum class ERpcLoadTestTransport : uint8
+{
+    /** TCP over the loopback interface. */
+    Tcp,
+
+    /** An in-process channel, @see FGrpcInProcessServers. */
+    InProcess,
+
+    /** A Unix domain socket in the temporary directory, not available on Windows. */
+    UnixSocket
+};
+
+/**
+ * Parameters of a load test, @see FRpcLoadTest.
+ */
+struct FRpcLoadTestSettings
+{
+    /** Number of RPC clients, each one has its own worker thread and channel. */
+    int32 NumClients = 4;
+
+    /** Number of requests, each client keeps in flight. */
+    int32 Concurrency = 8;
+
+    /** Size of a request payload in bytes. */
+    int32 PayloadSize = 256;
+
+    /** Responses, received during warmup, are not measured. */
+    float WarmupSeconds = 1.0f;
+
+    /** Duration of the measurement. */
+    float DurationSeconds = 10.0f;
+
+    /** Number of threads, serving the echo server's completion queue. */
+    int32 NumServerThreads = 2;
+
+    /** Whether the server responds with empty messages instead of echoing requests back. */
+    bool bSink = false;
+
+    /** How clients reach the server. */
+    ERpcLoadTestTransport Transport = ERpcLoadTestTransport::Tcp;
+};
+
+/**
+ * Results of a load test.
+ */
+struct FRpcLoadTestReport
+{
+    FRpcLoadTestSettings Settings;
+
+    /** Whether the test has been run at all. */
+    bool bSucceeded = false;
+
+    /** Responses, received during the measurement. */
+    int64 Requests = 0;
+
+    /** Responses with a non-OK status, received during the measurement. */
+    int64 Errors = 0;
+
+    double Seconds = 0.0;
+    double RequestsPerSecond = 0.0;
+
+    /** Latency of calls from enqueuing a request on the game thread to dispatching its response. */
+    FRpcLatencySnapshot Latency;
+
+    /** Process CPU time (the server included) per request. */
+    double CpuMicrosecondsPerRequest = 0.0;
+
+    /** Allocations (made through FMemory, the server included, except for gRPC core and protobuf arenas) per request. */
+    double AllocationsPerRequest = 0.0;
+
+    FString ToJson() const;
+};
+
+/**
+ * An end-to-end load generator: starts a local echo gRPC server (on the loopback interface, a Unix domain socket or in-process) and loads it
+ * by URpcLoadTestClient instances, reporting throughput, latency percentiles, CPU time and allocations per request.
+ *
+ * Could be started from the console (also headless, e.g. -ExecCmds="infraworld.LoadTest -Quit"):
+ *
+ *     infraworld.LoadTest [-Clients=4] [-Concurrency=8] [-Payload=256] [-Warmup=1] [-Duration=10] [-ServerThreads=2]
+ *                         [-Sink] [-Transport=Tcp|Unix|InProcess] [-Out=Path.json] [-Quit]
+ */
+class INFRAWORLDRUNTIME_API FRpcLoadTest
+{
+public:
+    /**
+     * Starts a load test. Should be called from the game thread, which must be ticking for the test to proceed.
+     *
+     * @param Settings Parameters of the test.
+     * @param OnFinished Called on the game thread with the results, once the test is over.
+     *
+     * @return False if the test couldn't be started (OnFinished is not called then).
+     */
+    static bool Start(const FRpcLoadTestSettings& Settings, TFunction<void(const FRpcLoadTestReport&)> OnFinished);
+
+    /**
+     * Parses a transport name, as accepted from the console: Tcp, Unix or InProcess.
+     */
+    static bool ParseTransport(const FString& Name, ERpcLoadTestTransport& OutTransport);
+
+    /**
+     * @return Name of a transport, as written into reports: "tcp", "unix" or "inproc".
+     */
+    static const TCHAR* GetTransportName(ERpcLoadTestTransport Transport);
+
+    /**
+     * @return An address for a local server to listen on, so it could be reached by Transport, or an empty string if
+     *         the transport is not supported on this platform. ServerName tells servers of different tools apart.
+     */
+    static FString GetServerAddress(ERpcLoadTestTransport Transport, const FString& ServerName);
+};
+
+#endif
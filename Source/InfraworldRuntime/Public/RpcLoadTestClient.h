@@ -0,0 +1,71 @@
+/*
+ * Copyright 2018 Vizor Games LLC
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS, WITHOUT
+ * WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.See the
+ * License for the specific language governing permissions and limitations
+ * under the License.
+ */
+#pragma once
+
+#include "CoreMinimal.h"
+#include "RpcClient.h"
+#include "Conduit.h"
+#include "GenUtils.h"
+
+#include <string>
+
+#include "RpcLoadTestClient.generated.h"
+
+/**
+ * A call of an arbitrary unary method with a request in wire format, @see URpcLoadTestClient::Replay().
+ */
+struct FRpcRawCall
+{
+    /** Full path of the method: "/package.Service/Method". */
+    std::string MethodPath;
+
+    FByteArray Request;
+};
+
+/**
+ * A client of the echo service, started by FRpcLoadTest (and of any service, started by FRpcReplay). Made the same way generated clients are, so load tests go
+ * through the whole client stack: conduits, the worker and the ticker dispatch.
+ */
+UCLASS(NotBlueprintable, NotBlueprintType, Transient)
+class INFRAWORLDRUNTIME_API URpcLoadTestClient : public URpcClient
+{
+    GENERATED_BODY()
+
+public:
+    virtual void HierarchicalInit() override;
+    virtual void HierarchicalUpdate() override;
+
+    /**
+     * Sends Request to the echo server, the server responds with the same bytes (or with none, if it is a sink).
+     */
+    bool Echo(const FByteArray& Request, const FGrpcClientContext& Context);
+
+    /**
+     * Calls any method with a request in wire format, the response is returned in wire format as well. Used to replay
+     * recorded traffic, see FRpcReplay.
+     */
+    bool Replay(const FRpcRawCall& Call, const FGrpcClientContext& Context);
+
+    /** Called on the game thread for every received response. */
+    TFunction<void(const TResponseWithStatus<FByteArray>&)> OnEcho;
+
+    /** Called on the game thread for every response to a replayed call. */
+    TFunction<void(const TResponseWithStatus<FByteArray>&)> OnReplay;
+
+private:
+    TConduit<TRequestWithContext<FByteArray>, TResponseWithStatus<FByteArray>> EchoConduit;
+    TConduit<TRequestWithContext<FRpcRawCall>, TResponseWithStatus<FByteArray>> ReplayConduit;
+};
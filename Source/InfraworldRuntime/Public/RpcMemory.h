@@ -0,0 +1,48 @@
+/*
+ * Copyright 2018 Vizor Games LLC
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS, WITHOUT
+ * WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.See the
+ * License for the specific language governing permissions and limitations
+ * under the License.
+ */
+#pragma once
+
+#include "CoreMinimal.h"
+
+#include "GrpcIncludesBegin.h"
+
+#include <google/protobuf/arena.h>
+
+#include "GrpcIncludesEnd.h"
+
+/**
+ * Routes memory of gRPC core and of protobuf arenas through FMemory, so it's served by the engine's allocator instead
+ * of the C runtime heap, is tagged as Networking by the low level memory tracker and is shown by 'stat infraworld'.
+ *
+ * gRPC C++ and protobuf messages allocate via operator new, which engine modules already route through FMemory.
+ */
+class INFRAWORLDRUNTIME_API FRpcMemory
+{
+public:
+    /**
+     * Installs allocation functions of gRPC core. It's done when the module's binary is loaded, before gRPC could
+     * allocate anything, though blocks, allocated by the C runtime before, are still freed correctly.
+     *
+     * The functions are never uninstalled, since gRPC frees memory until the process exits, so the module must not be
+     * unloaded (see FInfraworldRuntimeModule::SupportsDynamicReloading()).
+     */
+    static void InstallGrpcAllocator();
+
+    /**
+     * @return Options of protobuf arenas, which allocate their blocks through FMemory.
+     */
+    static const google::protobuf::ArenaOptions& GetArenaOptions();
+};
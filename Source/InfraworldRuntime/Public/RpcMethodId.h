@@ -0,0 +1,107 @@
+/*
+ * Copyright 2018 Vizor Games LLC
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS, WITHOUT
+ * WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.See the
+ * License for the specific language governing permissions and limitations
+ * under the License.
+ */
+#pragma once
+
+#include "CoreMinimal.h"
+
+#include <string>
+
+namespace google
+{
+    namespace protobuf
+    {
+        class Descriptor;
+    }
+}
+
+/**
+ * A small dense index, identifying an RPC method process-wide. Used to keep per-method state (compression policy,
+ * stats) in plain arrays instead of maps keyed by strings.
+ */
+struct INFRAWORLDRUNTIME_API FRpcMethodId
+{
+    int32 Index = INDEX_NONE;
+
+    FORCEINLINE bool IsValid() const
+    {
+        return Index != INDEX_NONE;
+    }
+
+    FORCEINLINE bool operator==(const FRpcMethodId& Other) const
+    {
+        return Index == Other.Index;
+    }
+
+    /**
+     * Returns an id of a method with the given name, registering it if necessary. Thread safe.
+     */
+    static FRpcMethodId Register(const FString& Name);
+
+    /**
+     * @return Name of a registered method, or an empty string if Id is not valid.
+     */
+    static FString GetName(FRpcMethodId Id);
+
+    /**
+     * @return Number of registered methods, ids are [0, Num).
+     */
+    static int32 Num();
+
+    /**
+     * Finds a method, which takes Request and returns Response, among services of the files both messages are declared in.
+     *
+     * @return Full path of the method, as in generated code: "/package.Service/Method", or an empty string if there's no
+     *         such method. If several methods match, the first one is chosen.
+     */
+    static std::string FindMethodPath(const google::protobuf::Descriptor* Request, const google::protobuf::Descriptor* Response);
+};
+
+FORCEINLINE uint32 GetTypeHash(const FRpcMethodId& Id)
+{
+    return static_cast<uint32>(Id.Index);
+}
+
+/**
+ * An id of a method, inferred from its request and response messages. The name is built once per template
+ * instantiation, so getting the id costs nothing afterwards.
+ */
+template<class TProtoRequest, class TProtoResponse>
+struct TRpcMethodId
+{
+    static FRpcMethodId Get()
+    {
+        static const FRpcMethodId Id = FRpcMethodId::Register(
+            FString(UTF8_TO_TCHAR(TProtoRequest::descriptor()->full_name().c_str())) + TEXT(" -> ") +
+            FString(UTF8_TO_TCHAR(TProtoResponse::descriptor()->full_name().c_str())));
+
+        return Id;
+    }
+};
+
+/**
+ * Full path of a method, inferred from its request and response messages, @see FRpcMethodId::FindMethodPath().
+ * Is looked up once per template instantiation.
+ */
+template<class TProtoRequest, class TProtoResponse>
+struct TRpcMethodPath
+{
+    static const std::string& Get()
+    {
+        static const std::string Path = FRpcMethodId::FindMethodPath(TProtoRequest::descriptor(), TProtoResponse::descriptor());
+
+        return Path;
+    }
+};
@@ -0,0 +1,212 @@
+/*
+ * Copyright 2018 Vizor Games LLC
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS, WITHOUT
+ * WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.See the
+ * License for the specific language governing permissions and limitations
+ * under the License.
+ */
+#pragma once
+
+#include "CoreMinimal.h"
+#include "GenUtils.h"
+#include "RpcMethodId.h"
+#include "Templates/Atomic.h"
+#include "Misc/ScopeLock.h"
+
+#include "RpcMetrics.generated.h"
+
+/**
+ * Percentiles of a latency histogram, in milliseconds.
+ */
+USTRUCT(BlueprintType)
+struct INFRAWORLDRUNTIME_API FRpcLatencySnapshot
+{
+    GENERATED_USTRUCT_BODY()
+
+    UPROPERTY(BlueprintReadOnly, Category=Metrics)
+    int32 Count = 0;
+
+    UPROPERTY(BlueprintReadOnly, Category=Metrics)
+    float MeanMs = 0.0f;
+
+    UPROPERTY(BlueprintReadOnly, Category=Metrics)
+    float P50Ms = 0.0f;
+
+    UPROPERTY(BlueprintReadOnly, Category=Metrics)
+    float P90Ms = 0.0f;
+
+    UPROPERTY(BlueprintReadOnly, Category=Metrics)
+    float P99Ms = 0.0f;
+
+    UPROPERTY(BlueprintReadOnly, Category=Metrics)
+    float P999Ms = 0.0f;
+
+    UPROPERTY(BlueprintReadOnly, Category=Metrics)
+    float MaxMs = 0.0f;
+};
+
+/**
+ * Metrics of a single method of an RPC client.
+ */
+USTRUCT(BlueprintType)
+struct INFRAWORLDRUNTIME_API FRpcMethodMetricsSnapshot
+{
+    GENERATED_USTRUCT_BODY()
+
+    /** Method name, inferred from its request and response messages. */
+    UPROPERTY(BlueprintReadOnly, Category=Metrics)
+    FString Method;
+
+    /** Number of completed calls. */
+    UPROPERTY(BlueprintReadOnly, Category=Metrics)
+    int32 Calls = 0;
+
+    /** Number of completed calls with a non-OK status. */
+    UPROPERTY(BlueprintReadOnly, Category=Metrics)
+    int32 Errors = 0;
+
+    /** Number of requests, rejected without being sent, since their deadline had expired while they were queued. */
+    UPROPERTY(BlueprintReadOnly, Category=Metrics)
+    int32 Expired = 0;
+
+    /** Number of calls being in flight at the moment. */
+    UPROPERTY(BlueprintReadOnly, Category=Metrics)
+    int32 InFlight = 0;
+
+    UPROPERTY(BlueprintReadOnly, Category=Metrics)
+    float KilobytesSent = 0.0f;
+
+    UPROPERTY(BlueprintReadOnly, Category=Metrics)
+    float KilobytesReceived = 0.0f;
+
+    /** Number of completed calls per status code (OK included). */
+    UPROPERTY(BlueprintReadOnly, Category=Metrics)
+    TMap<EGrpcStatusCode, int32> StatusCodes;
+
+    /** Time between a request being enqueued into a conduit and being sent. */
+    UPROPERTY(BlueprintReadOnly, Category=Metrics)
+    FRpcLatencySnapshot QueueWait;
+
+    /** Time between a request being sent and its response being received. */
+    UPROPERTY(BlueprintReadOnly, Category=Metrics)
+    FRpcLatencySnapshot Network;
+
+    /** Time spent converting a request and a response between Unreal and protobuf types. */
+    UPROPERTY(BlueprintReadOnly, Category=Metrics)
+    FRpcLatencySnapshot Conversion;
+
+    /** Time between a response being received and being dequeued from a conduit. */
+    UPROPERTY(BlueprintReadOnly, Category=Metrics)
+    FRpcLatencySnapshot Dispatch;
+};
+
+/**
+ * Metrics of an RPC client, @see URpcClient::GetMetricsSnapshot().
+ */
+USTRUCT(BlueprintType)
+struct INFRAWORLDRUNTIME_API FRpcClientMetricsSnapshot
+{
+    GENERATED_USTRUCT_BODY()
+
+    UPROPERTY(BlueprintReadOnly, Category=Metrics)
+    TArray<FRpcMethodMetricsSnapshot> Methods;
+};
+
+/**
+ * A lock-free log-linear latency histogram (HDR-style): values are bucketed by their power of two and 3 more
+ * significant bits, so any percentile is reported with at most 12.5% error. Values are in microseconds.
+ */
+class INFRAWORLDRUNTIME_API FRpcLatencyHistogram
+{
+public:
+    static constexpr int32 SubBucketBits = 3;
+    static constexpr int32 SubBucketCount = 1 << SubBucketBits;
+    static constexpr int32 NumBuckets = 40 * SubBucketCount;
+
+    FRpcLatencyHistogram();
+
+    void Record(double Seconds);
+    void GetSnapshot(FRpcLatencySnapshot& OutSnapshot) const;
+    void Reset();
+
+private:
+    static int32 GetBucketIndex(uint64 Microseconds);
+    static uint64 GetBucketLowerBound(int32 Index);
+
+    TAtomic<uint64> Buckets[NumBuckets];
+    TAtomic<uint64> Count;
+    TAtomic<uint64> TotalMicroseconds;
+    TAtomic<uint64> MaxMicroseconds;
+};
+
+/**
+ * Metrics of a single method, updated by workers and read by snapshots. All updates are lock-free.
+ */
+class INFRAWORLDRUNTIME_API FRpcMethodMetrics
+{
+public:
+    explicit FRpcMethodMetrics(FRpcMethodId InMethod);
+
+    void RecordQueueWait(double Seconds);
+    void RecordConversion(double Seconds);
+    void RecordDispatch(double Seconds);
+
+    /** Should be called for a request, that has expired before being sent (it isn't counted as a call). */
+    void RecordExpired();
+
+    /** Should be called when a call starts, a matching EndCall() must follow. */
+    void BeginCall();
+    void EndCall(double NetworkSeconds, EGrpcStatusCode Code, int64 BytesSent, int64 BytesReceived);
+
+    void GetSnapshot(FRpcMethodMetricsSnapshot& OutSnapshot) const;
+    void Reset();
+
+    const FRpcMethodId Method;
+
+private:
+    static constexpr int32 NumStatusCodes = 17;
+
+    TAtomic<uint64> Calls;
+    TAtomic<uint64> Errors;
+    TAtomic<uint64> Expired;
+    TAtomic<int32> InFlight;
+    TAtomic<uint64> BytesSent;
+    TAtomic<uint64> BytesReceived;
+    TAtomic<uint64> StatusCodes[NumStatusCodes];
+
+    FRpcLatencyHistogram QueueWait;
+    FRpcLatencyHistogram Network;
+    FRpcLatencyHistogram Conversion;
+    FRpcLatencyHistogram Dispatch;
+};
+
+typedef TSharedPtr<FRpcMethodMetrics, ESPMode::ThreadSafe> FRpcMethodMetricsPtr;
+
+/**
+ * Per-method metrics of a single RPC client (a worker).
+ */
+class INFRAWORLDRUNTIME_API FRpcClientMetrics
+{
+public:
+    /**
+     * Returns metrics of a method, creating them if necessary. Thread safe.
+     */
+    FRpcMethodMetricsPtr GetMethod(FRpcMethodId Method);
+
+    void GetSnapshot(FRpcClientMetricsSnapshot& OutSnapshot) const;
+    void Reset();
+
+private:
+    mutable FCriticalSection Lock;
+
+    /** Indexed by FRpcMethodId::Index, may contain nulls. */
+    TArray<FRpcMethodMetricsPtr> Methods;
+};
@@ -0,0 +1,121 @@
+/*
+ * Copyright 2018 Vizor Games LLC
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS, WITHOUT
+ * WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.See the
+ * License for the specific language governing permissions and limitations
+ * under the License.
+ */
+#pragma once
+
+#include "CoreMinimal.h"
+
+#if !UE_BUILD_SHIPPING
+
+#include "RpcLoadTest.h"
+#include "RpcMetrics.h"
+
+/**
+ * Parameters of a replay, @see FRpcReplay.
+ */
+struct FRpcReplaySettings
+{
+    /** Whether calls are sent as fast as possible, instead of at their recorded moments. */
+    bool bAsFastAsPossible = false;
+
+    /** Playback speed of the recorded timing, e.g. 2 sends calls twice as often as they have been recorded. */
+    float Speed = 1.0f;
+
+    /** Number of RPC clients, each one has its own worker thread and channel. Calls are spread between them in turn. */
+    int32 NumClients = 1;
+
+    /** Number of calls, each client keeps in flight when replaying as fast as possible. */
+    int32 Concurrency = 8;
+
+    /** Number of threads, serving the stand-in server's completion queue. */
+    int32 NumServerThreads = 2;
+
+    /** How clients reach the stand-in server. */
+    ERpcLoadTestTransport Transport = ERpcLoadTestTransport::Tcp;
+};
+
+/**
+ * Results of a replay.
+ */
+struct FRpcReplayReport
+{
+    FRpcReplaySettings Settings;
+
+    /** Path of the replayed log. */
+    FString Filename;
+
+    /** Whether the replay has been run at all. */
+    bool bSucceeded = false;
+
+    /** Calls, which have been replayed. */
+    int64 Calls = 0;
+
+    /** Calls, that have got a non-OK status. */
+    int64 Errors = 0;
+
+    /** Calls, that have got a status other than the recorded one. */
+    int64 Mismatches = 0;
+
+    /** Duration of the replay and of the recording it replays. */
+    double Seconds = 0.0;
+    double RecordedSeconds = 0.0;
+
+    double CallsPerSecond = 0.0;
+
+    /** Latency of calls from enqueuing a request on the game thread to dispatching its response. */
+    FRpcLatencySnapshot Latency;
+
+    /** Latency of the same calls, as they have been recorded (network and server time, without the client stack). */
+    FRpcLatencySnapshot RecordedLatency;
+
+    /** Process CPU time (the server included) per call. */
+    double CpuMicrosecondsPerCall = 0.0;
+
+    /** Allocations (made through FMemory, the server included) per call. */
+    double AllocationsPerCall = 0.0;
+
+    FString ToJson() const;
+};
+
+/**
+ * Replays a traffic log, written by FRpcTrafficRecorder, through RPC clients (the whole client stack: conduits, the
+ * worker and the ticker dispatch) against a local stand-in server, which responds to every call with its recorded
+ * response and status right away. So the replay measures the cost of the client stack on real traffic, and could be
+ * repeated with different versions of the runtime to catch regressions.
+ *
+ * Requests and responses stay in wire format, so calls don't go through Proto_Cast<>(): conversions should be profiled
+ * with the generated clients themselves (e.g. by infraworld.Benchmark).
+ *
+ * Could be started from the console (also headless, e.g. -ExecCmds="infraworld.Replay Path.rpclog -Quit"):
+ *
+ *     infraworld.Replay Path.rpclog [-AsFastAsPossible] [-Speed=1] [-Clients=1] [-Concurrency=8] [-ServerThreads=2]
+ *                       [-Transport=Tcp|Unix|InProcess] [-Out=Path.json] [-Quit]
+ */
+class INFRAWORLDRUNTIME_API FRpcReplay
+{
+public:
+    /**
+     * Starts a replay. Should be called from the game thread, which must be ticking for the replay to proceed.
+     *
+     * @param Filename Path of a traffic log.
+     * @param Settings Parameters of the replay.
+     * @param OnFinished Called on the game thread with the results, once the replay is over.
+     *
+     * @return False if the replay couldn't be started (OnFinished is not called then).
+     */
+    static bool Start(const FString& Filename, const FRpcReplaySettings& Settings, TFunction<void(const FRpcReplayReport&)> OnFinished);
+};
+
+#endif
@@ -0,0 +1,209 @@
+/*
+ * Copyright 2018 Vizor Games LLC
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS, WITHOUT
+ * WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.See the
+ * License for the specific language governing permissions and limitations
+ * under the License.
+ */
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Containers/Queue.h"
+#include "HAL/CriticalSection.h"
+#include "Templates/Atomic.h"
+
+class IFileHandle;
+class UScriptStruct;
+struct FGrpcClientContext;
+
+/**
+ * Parameters of spilling requests of a conduit to disk, @see TConduit::EnableSpill().
+ */
+struct FRpcSpillSettings
+{
+    /** Once serialized requests, queued in memory, take more than this, further requests are written to disk. */
+    int64 MemoryLimitBytes = 1024 * 1024;
+
+    /** Size of a single segment file. Segments are deleted as soon as all of their requests have been read back. */
+    int64 SegmentBytes = 4 * 1024 * 1024;
+
+    /** Directory of segment files, Saved/Infraworld/Spill if empty. Segments, left there by crashed processes, are deleted. */
+    FString Directory;
+};
+
+/**
+ * Where SpillOrKeep() has put a request, @see FRpcRequestSpill.
+ */
+enum class ERpcSpillResult : uint8
+{
+    /** The request should be queued in memory. */
+    Kept,
+
+    /** The request has been written to disk. */
+    Spilled,
+
+    /** The request couldn't be written to disk, and keeping it in memory would put it ahead of the spilled ones. */
+    Dropped
+};
+
+/**
+ * An append-only queue of records, stored in a chain of segment files. Not thread safe.
+ */
+class INFRAWORLDRUNTIME_API FRpcSpillFile
+{
+public:
+    FRpcSpillFile(const FString& InDirectory, const FString& InName, int64 InSegmentBytes);
+
+    /** Closes and deletes all the segments, records left unread are lost. */
+    ~FRpcSpillFile();
+
+    /**
+     * Appends a record to the last segment, starting a new one if it is full.
+     *
+     * @return False if the record couldn't be written.
+     */
+    bool Write(const TArray<uint8>& Record);
+
+    /**
+     * Reads the oldest unread record.
+     *
+     * @return False if there are no records left, or the segment can't be read.
+     */
+    bool Read(TArray<uint8>& OutRecord);
+
+    /** @return Number of unread records. */
+    FORCEINLINE int32 Num() const
+    {
+        return NumRecords;
+    }
+
+    /** @return Size of all the segments on disk. */
+    FORCEINLINE int64 GetDiskBytes() const
+    {
+        return DiskBytes;
+    }
+
+private:
+    struct FSegment
+    {
+        FString Filename;
+        IFileHandle* Handle = nullptr;
+        int64 ReadOffset = 0;
+        int64 WriteOffset = 0;
+    };
+
+    void DeleteSegment(FSegment& Segment);
+
+    const FString Directory;
+    const FString Name;
+    const int64 SegmentBytes;
+
+    /** Segments from the oldest to the newest, only the last one is being written. */
+    TArray<FSegment> Segments;
+    int32 NextSegmentIndex = 0;
+
+    int32 NumRecords = 0;
+    int64 DiskBytes = 0;
+};
+
+/**
+ * Spill state of a conduit's request queue. Requests are kept in memory until their serialized size exceeds the limit,
+ * further requests are appended to a spill file and are read back in order, once the memory queue is drained.
+ *
+ * Requests, kept in memory, aren't serialized (except for a sample of them): they're accounted by the average size
+ * of serialized ones.
+ *
+ * Enqueue-side methods are called by the requests producer, dequeue-side ones by the responses producer.
+ */
+class INFRAWORLDRUNTIME_API FRpcRequestSpill
+{
+public:
+    explicit FRpcRequestSpill(const FRpcSpillSettings& Settings);
+    ~FRpcRequestSpill();
+
+    /**
+     * @return True if the next request should be serialized and passed to SpillOrKeep(), since it may go to disk
+     * (or its size is being sampled). Otherwise it should be queued in memory and accounted via Keep().
+     */
+    bool ShouldSerialize();
+
+    /**
+     * Decides where a request should be queued. If it should be queued on disk, it's written there.
+     *
+     * @param Record The serialized request.
+     * @return Whether the request has been spilled, should be queued in memory, or is lost.
+     */
+    ERpcSpillResult SpillOrKeep(const TArray<uint8>& Record);
+
+    /** Accounts a request, queued in memory without being serialized, by the average size. */
+    void Keep();
+
+    /** Should be called whenever a request, kept in memory, is dequeued. */
+    void OnDequeuedFromMemory();
+
+    /** Accounts a request, lost because it couldn't be serialized or deserialized (could be called by both producers). */
+    void OnDropped();
+
+    /** @return Number of requests, lost since the spill has been enabled. */
+    FORCEINLINE int32 GetNumDropped() const
+    {
+        return NumDropped.Load();
+    }
+
+    /** @return True if there are spilled requests (could be called by both producers). */
+    FORCEINLINE bool HasSpilled() const
+    {
+        return NumSpilled.Load() > 0;
+    }
+
+    /**
+     * Reads the oldest spilled request.
+     *
+     * @return False if there's nothing to read.
+     */
+    bool ReadSpilled(TArray<uint8>& OutRecord);
+
+    /**
+     * Serializes a request along with its context.
+     *
+     * @param RequestStruct Type of the request, a USTRUCT.
+     */
+    static bool EncodeRecord(UScriptStruct* RequestStruct, const void* Request, const FGrpcClientContext& Context, TArray<uint8>& OutRecord);
+
+    /**
+     * Deserializes a request, serialized by EncodeRecord().
+     */
+    static bool DecodeRecord(UScriptStruct* RequestStruct, const TArray<uint8>& Record, void* OutRequest, FGrpcClientContext& OutContext);
+
+private:
+    void Keep(int64 Size);
+
+    /** Every SizeSampleInterval-th request is serialized anyway, so that the average follows the traffic. */
+    static const int32 SizeSampleInterval = 16;
+
+    const int64 MemoryLimitBytes;
+
+    /** Moving average of serialized sizes, and the countdown to the next sample. Used by the requests producer only. */
+    int64 AverageRecordBytes = 0;
+    int32 RequestsUntilSample = 0;
+
+    /** Guards the file, so that producers agree on whether the next request goes to memory or to disk. */
+    FCriticalSection Lock;
+    FRpcSpillFile File;
+
+    /** Sizes of requests, queued in memory, in the same order. */
+    TQueue<int64> MemorySizes;
+    TAtomic<int64> MemoryBytes;
+    TAtomic<int32> NumSpilled;
+    TAtomic<int32> NumDropped;
+
+    bool bWriteErrorReported = false;
+};
@@ -0,0 +1,72 @@
+/*
+ * Copyright 2018 Vizor Games LLC
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS, WITHOUT
+ * WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.See the
+ * License for the specific language governing permissions and limitations
+ * under the License.
+ */
+#pragma once
+
+#include "CoreMinimal.h"
+
+/** Mirrors the 'infraworld.Trace' console variable. */
+extern INFRAWORLDRUNTIME_API int32 GInfraworldTrace;
+
+/**
+ * Traces stages of RPC calls, so a call could be followed across the game and the worker threads in a profiler.
+ *
+ * Scopes are emitted as CPU events in Unreal Insights on engines having it (4.25+) and as platform named events
+ * otherwise (visible in external profilers and in 'stat namedevents'). Every scope carries a correlation id of
+ * the call it belongs to.
+ *
+ * Tracing is off by default and is toggled in runtime by 'infraworld.Trace 1', a disabled scope costs a branch.
+ */
+class INFRAWORLDRUNTIME_API FRpcTrace
+{
+public:
+    FORCEINLINE static bool IsEnabled()
+    {
+        return GInfraworldTrace != 0;
+    }
+
+    /**
+     * @return A new process-wide unique correlation id, never zero.
+     */
+    static uint64 NextCorrelationId();
+
+    static void BeginScope(const TCHAR* Name, uint64 CorrelationId);
+    static void EndScope();
+};
+
+/**
+ * A trace scope, use INFRAWORLD_TRACE_SCOPE() to declare one.
+ */
+class FRpcTraceScope
+{
+public:
+    FORCEINLINE FRpcTraceScope(const TCHAR* Name, uint64 CorrelationId) : bActive(FRpcTrace::IsEnabled())
+    {
+        if (bActive)
+            FRpcTrace::BeginScope(Name, CorrelationId);
+    }
+
+    FORCEINLINE ~FRpcTraceScope()
+    {
+        if (bActive)
+            FRpcTrace::EndScope();
+    }
+
+private:
+    const bool bActive;
+};
+
+#define INFRAWORLD_TRACE_SCOPE(Name, CorrelationId) \
+    const FRpcTraceScope PREPROCESSOR_JOIN(InfraworldTraceScope_, __LINE__)(TEXT(Name), CorrelationId)
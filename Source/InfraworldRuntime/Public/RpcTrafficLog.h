@@ -0,0 +1,145 @@
+/*
+ * Copyright 2018 Vizor Games LLC
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS, WITHOUT
+ * WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.See the
+ * License for the specific language governing permissions and limitations
+ * under the License.
+ */
+#pragma once
+
+#include "CoreMinimal.h"
+
+#if !UE_BUILD_SHIPPING
+
+#include "GenUtils.h"
+#include "Templates/Atomic.h"
+
+#include <string>
+
+class FGrpcCompiledContext;
+
+namespace google
+{
+    namespace protobuf
+    {
+        class MessageLite;
+    }
+}
+
+namespace grpc
+{
+    class ByteBuffer;
+}
+
+/**
+ * A single recorded unary call.
+ */
+struct FRpcTrafficLogEntry
+{
+    /** Full path of the method: "/package.Service/Method". */
+    std::string MethodPath;
+
+    /** The moment the call has been sent, relative to the start of the recording. */
+    double StartSeconds = 0.0;
+
+    /** Time from sending the request to receiving the response, conversions are not included. */
+    double DurationSeconds = 0.0;
+
+    /** Context of the call. Compiled contexts are recorded as the contexts they could have been compiled from. */
+    FGrpcClientContext Context;
+
+    /** The request message in wire format. */
+    TArray<uint8> Request;
+
+    /** The response message in wire format, empty if the call has failed. */
+    TArray<uint8> Response;
+
+    FGrpcStatus Status;
+};
+
+/**
+ * Records unary calls, made by all RPC workers, into a compact binary log, so real sessions could be replayed offline
+ * against a local server (see FRpcReplay) to catch performance regressions of the client stack.
+ *
+ * Calls are captured at the worker boundary: requests and responses are recorded in wire format, along with contexts,
+ * timing and statuses. Recording costs a single atomic load per call while it is off. Could be controlled from the
+ * console:
+ *
+ *     infraworld.Record.Start [Path.rpclog]
+ *     infraworld.Record.Stop
+ *
+ * Logs are written into Saved/Profiling/Infraworld by default. Values of credential-like metadata are redacted, see
+ * SetRedactedMetadataKeys(). The recorder isn't compiled into shipping builds.
+ */
+class INFRAWORLDRUNTIME_API FRpcTrafficRecorder
+{
+public:
+    /**
+     * Starts recording into a new file, stopping the previous recording (if any).
+     *
+     * @return False if the file can't be created.
+     */
+    static bool Start(const FString& Filename);
+
+    /**
+     * Stops recording and closes the file.
+     */
+    static void Stop();
+
+    static FORCEINLINE bool IsRecording()
+    {
+        return bRecording.Load();
+    }
+
+    /**
+     * Sets metadata keys (wildcards, case-insensitive), values of which are replaced with "<redacted>" before being
+     * recorded. "authorization" is redacted regardless. The default list is: proxy-authorization, cookie, x-api-key,
+     * *token* and *-bin.
+     */
+    static void SetRedactedMetadataKeys(const TArray<FString>& Keys);
+
+    /**
+     * Records a finished call. Is called by workers, thread safe. Calls of methods with unknown paths are skipped.
+     *
+     * @param MethodPath Full path of the method: "/package.Service/Method".
+     * @param SendTime The moment (FPlatformTime::Seconds()) the request has been sent.
+     * @param ReceiveTime The moment the response has been received.
+     * @param Response The response, nullptr if the call has failed.
+     */
+    static void Record(const char* MethodPath, double SendTime, double ReceiveTime, const FGrpcClientContext& Context,
+        const google::protobuf::MessageLite& Request, const google::protobuf::MessageLite* Response, const FGrpcStatus& Status);
+
+    static void Record(const char* MethodPath, double SendTime, double ReceiveTime, const FGrpcCompiledContext& Context,
+        const google::protobuf::MessageLite& Request, const google::protobuf::MessageLite* Response, const FGrpcStatus& Status);
+
+    static void Record(const char* MethodPath, double SendTime, double ReceiveTime, const FGrpcClientContext& Context,
+        const grpc::ByteBuffer& Request, const grpc::ByteBuffer* Response, const FGrpcStatus& Status);
+
+private:
+    static TAtomic<bool> bRecording;
+};
+
+/**
+ * Reads logs, written by FRpcTrafficRecorder.
+ */
+class INFRAWORLDRUNTIME_API FRpcTrafficLog
+{
+public:
+    /**
+     * Loads all calls of a log in order of recording. A log, which has been cut short (e.g. by a crash), is loaded up
+     * to its last complete call.
+     *
+     * @return False if the file can't be read or isn't a traffic log.
+     */
+    static bool Load(const FString& Filename, TArray<FRpcTrafficLogEntry>& OutEntries);
+};
+
+#endif
@@ -0,0 +1,79 @@
+/*
+ * Copyright 2018 Vizor Games LLC
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS, WITHOUT
+ * WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.See the
+ * License for the specific language governing permissions and limitations
+ * under the License.
+ */
+#pragma once
+
+#include "CoreMinimal.h"
+
+#include <string>
+
+/**
+ * UTF-8 <-> TCHAR conversion used by string casts.
+ *
+ * Both directions write straight into a presized output buffer, so no intermediate allocations are made. Runs of ASCII
+ * characters are being processed in blocks using SSE2 (AVX2 if the module is compiled with it) or NEON,
+ * everything else is being decoded/encoded by a scalar state machine.
+ *
+ * TCHAR is treated as UTF-16 if it is 2 bytes wide and as UTF-32 if it is 4 bytes wide.
+ */
+class INFRAWORLDRUNTIME_API FUtf8Conversion
+{
+public:
+    /**
+     * Encodes a TCHAR string into UTF-8. Unpaired surrogates are being replaced with U+FFFD.
+     *
+     * @param Source Characters to encode, may contain NULs.
+     * @param SourceLen Number of characters in Source.
+     * @param Out A string to receive UTF-8 bytes. Its previous content is being replaced.
+     */
+    static void ToUtf8(const TCHAR* Source, int32 SourceLen, std::string& Out);
+
+    /**
+     * Encodes a TCHAR string into UTF-8, writing into a caller-provided buffer.
+     *
+     * @param Source Characters to encode, may contain NULs.
+     * @param SourceLen Number of characters in Source.
+     * @param Dest A buffer of at least GetMaxUtf8Length(SourceLen) bytes.
+     *
+     * @return Number of bytes written.
+     */
+    static int32 ToUtf8(const TCHAR* Source, int32 SourceLen, uint8* Dest);
+
+    /**
+     * @return Maximal number of UTF-8 bytes, SourceLen characters could be encoded into.
+     */
+    static int32 GetMaxUtf8Length(int32 SourceLen);
+
+    /**
+     * Decodes (and validates) a UTF-8 byte sequence into an FString. Since the input usually comes from a server,
+     * it is considered to be untrusted: overlong forms, surrogates, code points beyond U+10FFFF and truncated
+     * sequences are being replaced with U+FFFD. Embedded NULs are preserved.
+     *
+     * @param Source UTF-8 bytes to decode.
+     * @param SourceLen Number of bytes in Source.
+     * @param Out A string to receive decoded characters. Its previous content is being replaced.
+     *
+     * @return True if Source was valid UTF-8, false if any replacements were made.
+     */
+    static bool FromUtf8(const char* Source, int32 SourceLen, FString& Out);
+
+#if WITH_DEV_AUTOMATION_TESTS
+    /**
+     * Same as ToUtf8() and FromUtf8(), but block kernels are not used. A reference for automation tests.
+     */
+    static void ToUtf8Scalar(const TCHAR* Source, int32 SourceLen, std::string& Out);
+    static bool FromUtf8Scalar(const char* Source, int32 SourceLen, FString& Out);
+#endif
+};
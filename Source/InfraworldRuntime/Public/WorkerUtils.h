@@ -4,6 +4,14 @@
 #include "CastUtils.h"
 #include "Templates/Invoke.h"
 #include "RpcClientWorker.h"
+#include "ProtoWireCodec.h"
+#include "LazyResponse.h"
+#include "AdaptiveCompression.h"
+#include "RpcMethodId.h"
+#include "RpcMetrics.h"
+#include "InfraworldStats.h"
+#include "RpcTrace.h"
+#include "RpcTrafficLog.h"
 
 #include "GrpcIncludesBegin.h"
 
@@ -13,6 +21,8 @@
 #include <grpc++/client_context.h>
 #include <grpc++/completion_queue.h>
 #include <grpcpp/impl/codegen/async_unary_call.h>
+#include <grpcpp/generic/generic_stub.h>
+#include <grpcpp/support/byte_buffer.h>
 
 #include "GrpcIncludesEnd.h"
 
@@ -23,19 +33,333 @@ public:
 	template <class TUnrealRequest, class TProtoRequest, class TUnrealResponse, class TProtoResponse, class TStubRequestFunctionPointer>
 	TResponseWithStatus<TUnrealResponse> AsyncRequest(const TUnrealRequest Request, const FGrpcClientContext Context, const TStubRequestFunctionPointer MemberPointer)
 	{
-		const TProtoRequest ClientRequest = casts::Proto_Cast<TProtoRequest>(Request);
-		
+		return MakeRequest<TUnrealRequest, TProtoRequest, TUnrealResponse, TProtoResponse>(Request, Context, Context.EnqueueTimeSeconds,
+			GetCorrelationId(Context), MemberPointer);
+	}
+
+	/**
+	 * Same as AsyncRequest(), but the context is precompiled, so it is applied to the call without any conversions.
+	 */
+	template <class TUnrealRequest, class TProtoRequest, class TUnrealResponse, class TProtoResponse, class TStubRequestFunctionPointer>
+	TResponseWithStatus<TUnrealResponse> AsyncRequest(const TUnrealRequest& Request, const FGrpcCompiledContextRef& Context, const TStubRequestFunctionPointer MemberPointer)
+	{
+		return MakeRequest<TUnrealRequest, TProtoRequest, TUnrealResponse, TProtoResponse>(Request, *Context, 0.0,
+			FRpcTrace::NextCorrelationId(), MemberPointer);
+	}
+
+	/**
+	 * Same as AsyncRequest(), but the response is received into an arena and is kept as is. Its fields are converted
+	 * into Unreal types only when accessed, see TLazyMessage.
+	 */
+	template <class TUnrealRequest, class TProtoRequest, class TProtoResponse, class TStubRequestFunctionPointer>
+	TResponseWithStatus<TLazyMessage<TProtoResponse>> AsyncLazyRequest(const TUnrealRequest& Request, const FGrpcClientContext& Context, const TStubRequestFunctionPointer MemberPointer)
+	{
+		const uint64 CorrelationId = GetCorrelationId(Context);
+		const double StartTime = FPlatformTime::Seconds();
+		const FRpcMethodMetricsPtr MethodMetrics = BeginMethodMetrics<TProtoRequest, TProtoResponse>(Context.EnqueueTimeSeconds, StartTime);
+
+		const TProtoRequest ClientRequest = TimedCast<TProtoRequest>(Request, TEXT("Infraworld.ConvertRequest"), CorrelationId);
+		MethodMetrics->RecordConversion(FPlatformTime::Seconds() - StartTime);
+
+		TResponseWithStatus<TLazyMessage<TProtoResponse>> Result;
+
+		TProtoResponse* Response;
+		Result.Response = TLazyMessage<TProtoResponse>::Create(Response);
+
+		CallUnary<TProtoRequest, TProtoResponse>(ClientRequest, Context, MemberPointer, Response, Result.Status, *MethodMetrics, CorrelationId);
+
+		Result.CompletionTimeSeconds = FPlatformTime::Seconds();
+		Result.CorrelationId = CorrelationId;
+		Result.Metrics = MethodMetrics;
+
+		return Result;
+	}
+
+	/**
+	 * Performs a unary call, bypassing protobuf messages: Request is encoded straight into wire format and the response
+	 * is decoded straight into TUnrealResponse. Both structs are encoded via FProtoWireCodec, so their field numbers
+	 * must be registered via FProtoWireCodec::RegisterFields() and match the messages of the method, otherwise the
+	 * call fails with Internal. Generated workers don't use it, it's an opt-in for hand-written calls.
+	 *
+	 * @param MethodPath Full path of the method, as in generated code: "/package.Service/Method".
+	 */
+	template <class TUnrealRequest, class TUnrealResponse>
+	TResponseWithStatus<TUnrealResponse> AsyncRawRequest(const TUnrealRequest& Request, const FGrpcClientContext& Context, const char* MethodPath)
+	{
+		TResponseWithStatus<TUnrealResponse> Result;
+		Result.CorrelationId = GetCorrelationId(Context);
+
+		INFRAWORLD_TRACE_SCOPE("Infraworld.RawRequest", Result.CorrelationId);
+
+		grpc::ByteBuffer RequestBuffer;
+		if (!FProtoWireCodec::Encode(Request, RequestBuffer))
+		{
+			Result.Status.ErrorCode = EGrpcStatusCode::Internal;
+			Result.Status.ErrorMessage = TEXT("Unable to encode a request");
+			return Result;
+		}
+
+		grpc::ByteBuffer ResponseBuffer;
+		if (CallGeneric(RequestBuffer, Context, MethodPath, ResponseBuffer, Result.Status) && !FProtoWireCodec::Decode(ResponseBuffer, Result.Response))
+		{
+			Result.Status.ErrorCode = EGrpcStatusCode::Internal;
+			Result.Status.ErrorMessage = TEXT("Unable to decode a response");
+		}
+
+		return Result;
+	}
+
+	/**
+	 * Same as AsyncRawRequest(), but the request is already in wire format and the response is returned as is.
+	 * Used to replay recorded traffic, see FRpcReplay.
+	 */
+	TResponseWithStatus<FByteArray> AsyncBytesRequest(const FByteArray& Request, const FGrpcClientContext& Context, const char* MethodPath)
+	{
+		TResponseWithStatus<FByteArray> Result;
+		Result.CorrelationId = GetCorrelationId(Context);
+
+		INFRAWORLD_TRACE_SCOPE("Infraworld.RawRequest", Result.CorrelationId);
+
+		grpc::Slice RequestSlice(Request.Bytes.GetData(), Request.Bytes.Num());
+		const grpc::ByteBuffer RequestBuffer(&RequestSlice, 1);
+		grpc::ByteBuffer ResponseBuffer;
+
+		std::vector<grpc::Slice> Slices;
+		if (CallGeneric(RequestBuffer, Context, MethodPath, ResponseBuffer, Result.Status) && ResponseBuffer.Dump(&Slices).ok())
+		{
+			Result.Response.Bytes.Reserve(static_cast<int32>(ResponseBuffer.Length()));
+			for (const grpc::Slice& Slice : Slices)
+				Result.Response.Bytes.Append(Slice.begin(), static_cast<int32>(Slice.size()));
+		}
+
+		Result.CompletionTimeSeconds = FPlatformTime::Seconds();
+		return Result;
+	}
+
+protected:
+	// TContext is either FGrpcClientContext or FGrpcCompiledContext.
+	template <class TUnrealRequest, class TProtoRequest, class TUnrealResponse, class TProtoResponse, class TContext, class TStubRequestFunctionPointer>
+	TResponseWithStatus<TUnrealResponse> MakeRequest(const TUnrealRequest& Request, const TContext& Context, double EnqueueTimeSeconds,
+		uint64 CorrelationId, const TStubRequestFunctionPointer MemberPointer)
+	{
+		const double StartTime = FPlatformTime::Seconds();
+		const FRpcMethodMetricsPtr MethodMetrics = BeginMethodMetrics<TProtoRequest, TProtoResponse>(EnqueueTimeSeconds, StartTime);
+
+		const TProtoRequest ClientRequest = TimedCast<TProtoRequest>(Request, TEXT("Infraworld.ConvertRequest"), CorrelationId);
+		const double RequestConversionSeconds = FPlatformTime::Seconds() - StartTime;
+
+	    TProtoResponse Response;
+	    FGrpcStatus GrpcStatus;
+
+		CallUnary<TProtoRequest, TProtoResponse>(ClientRequest, Context, MemberPointer, &Response, GrpcStatus, *MethodMetrics, CorrelationId);
+
+		const double ReceiveTime = FPlatformTime::Seconds();
+	    TResponseWithStatus<TUnrealResponse> Result(TimedCast<TUnrealResponse>(Response, TEXT("Infraworld.ConvertResponse"), CorrelationId), GrpcStatus);
+
+		Result.CompletionTimeSeconds = FPlatformTime::Seconds();
+		Result.CorrelationId = CorrelationId;
+		Result.Metrics = MethodMetrics;
+		MethodMetrics->RecordConversion(RequestConversionSeconds + (Result.CompletionTimeSeconds - ReceiveTime));
+
+	    return Result;
+	}
+
+	template <class TProtoRequest, class TProtoResponse>
+	FRpcMethodMetricsPtr BeginMethodMetrics(double EnqueueTimeSeconds, double StartTime)
+	{
+		FRpcMethodMetricsPtr MethodMetrics = Metrics.GetMethod(TRpcMethodId<TProtoRequest, TProtoResponse>::Get());
+
+		if (EnqueueTimeSeconds > 0.0)
+			MethodMetrics->RecordQueueWait(StartTime - EnqueueTimeSeconds);
+
+		return MethodMetrics;
+	}
+
+	template <class TOut, class TIn>
+	static FORCEINLINE TOut TimedCast(const TIn& In, const TCHAR* TraceScopeName, uint64 CorrelationId)
+	{
+		SCOPE_CYCLE_COUNTER(STAT_InfraworldConversion);
+		const FRpcTraceScope TraceScope(TraceScopeName, CorrelationId);
+
+		return casts::Proto_Cast<TOut>(In);
+	}
+
+	static FORCEINLINE uint64 GetCorrelationId(const FGrpcClientContext& Context)
+	{
+		// Requests, that haven't passed a conduit, have no id yet.
+		return Context.CorrelationId ? Context.CorrelationId : FRpcTrace::NextCorrelationId();
+	}
+
+	template <class TProtoRequest, class TProtoResponse, class TContext, class TStubRequestFunctionPointer>
+	void CallUnary(const TProtoRequest& ClientRequest, const TContext& Context, const TStubRequestFunctionPointer MemberPointer,
+		TProtoResponse* OutResponse, FGrpcStatus& OutStatus, FRpcMethodMetrics& MethodMetrics, uint64 CorrelationId)
+	{
+		if (IsFailed())
+		{
+			SetUnavailableStatus(OutStatus);
+			return;
+		}
+
+		if (casts::HasExpired(Context))
+		{
+			SetExpiredStatus(OutStatus);
+			MethodMetrics.RecordExpired();
+			return;
+		}
+
 		grpc::ClientContext ClientContext;
-		casts::CastClientContext(Context, ClientContext);
+		{
+			INFRAWORLD_TRACE_SCOPE("Infraworld.CastClientContext", CorrelationId);
+			casts::CastClientContext(Context, ClientContext);
+		}
+
+		const FRpcCancellationScope CancellationScope(casts::GetCancellation(Context), ClientContext);
+		if (CancellationScope.IsCancelled())
+		{
+			SetNotSentStatus(OutStatus);
+			return;
+		}
+
+		if (casts::GetCompressionAlgorithm(Context) == EGrpcCompressionAlgorithm::CompressAdaptive)
+		{
+			const EGrpcCompressionAlgorithm Algorithm = FAdaptiveCompression::Choose(TRpcMethodId<TProtoRequest, TProtoResponse>::Get(), ClientRequest);
+			casts::SetCompressionAlgorithm(ClientContext, Algorithm);
+		}
 
-		grpc::CompletionQueue Queue;
 	    grpc::Status Status;
 		
-	    std::unique_ptr<grpc::ClientAsyncResponseReader<TProtoResponse>> Rpc(Invoke(MemberPointer, Stub.get(), &ClientContext, ClientRequest, &Queue));
+		MethodMetrics.BeginCall();
+		const double SendTime = FPlatformTime::Seconds();
 
-	    TProtoResponse Response;
-	    Rpc->Finish(&Response, &Status, (void*)1);
+		// The reader is allocated on the arena of the call, so it costs no heap allocation.
+	    std::unique_ptr<grpc::ClientAsyncResponseReader<TProtoResponse>> Rpc(Invoke(MemberPointer, Stub.get(), &ClientContext, ClientRequest, &CallQueue));
+	    Rpc->Finish(OutResponse, &Status, (void*)1);
+
+		{
+			INFRAWORLD_TRACE_SCOPE("Infraworld.Wait", CorrelationId);
+			WaitForCompletion(CallQueue, ClientContext);
+		}
+
+	    casts::CastStatus(Status, OutStatus);
+
+#if !UE_BUILD_SHIPPING
+		if (FRpcTrafficRecorder::IsRecording())
+		{
+			FRpcTrafficRecorder::Record(TRpcMethodPath<TProtoRequest, TProtoResponse>::Get().c_str(), SendTime, FPlatformTime::Seconds(),
+				Context, ClientRequest, Status.ok() ? OutResponse : nullptr, OutStatus);
+		}
+#endif
 
+		// The request size has been cached when it was serialized.
+		MethodMetrics.EndCall(FPlatformTime::Seconds() - SendTime, OutStatus.ErrorCode, ClientRequest.GetCachedSize(),
+			Status.ok() ? static_cast<int64>(OutResponse->ByteSizeLong()) : 0);
+	}
+
+	/**
+	 * Performs a unary call of a method by its path, the request and the response are in wire format.
+	 *
+	 * @return True if the call has succeeded, otherwise OutStatus tells why.
+	 */
+	bool CallGeneric(const grpc::ByteBuffer& RequestBuffer, const FGrpcClientContext& Context, const char* MethodPath,
+		grpc::ByteBuffer& OutResponseBuffer, FGrpcStatus& OutStatus)
+	{
+		if (IsFailed())
+		{
+			SetUnavailableStatus(OutStatus);
+			return false;
+		}
+
+		if (!Channel)
+		{
+			OutStatus.ErrorCode = EGrpcStatusCode::Internal;
+			OutStatus.ErrorMessage = TEXT("The worker has no channel");
+			return false;
+		}
+
+		if (!GenericStub)
+			GenericStub = std::make_unique<grpc::GenericStub>(Channel);
+
+		if (casts::HasExpired(Context))
+		{
+			SetExpiredStatus(OutStatus);
+			return false;
+		}
+
+		grpc::ClientContext ClientContext;
+		casts::CastClientContext(Context, ClientContext);
+
+		const FRpcCancellationScope CancellationScope(casts::GetCancellation(Context), ClientContext);
+		if (CancellationScope.IsCancelled())
+		{
+			SetNotSentStatus(OutStatus);
+			return false;
+		}
+
+		grpc::Status Status;
+
+#if !UE_BUILD_SHIPPING
+		const double SendTime = FPlatformTime::Seconds();
+#endif
+
+		std::unique_ptr<grpc::GenericClientAsyncResponseReader> Rpc(GenericStub->PrepareUnaryCall(&ClientContext, MethodPath, RequestBuffer, &CallQueue));
+		Rpc->StartCall();
+		Rpc->Finish(&OutResponseBuffer, &Status, (void*)1);
+
+		WaitForCompletion(CallQueue, ClientContext);
+
+		casts::CastStatus(Status, OutStatus);
+
+		if (OutStatus.ErrorCode == EGrpcStatusCode::DeadlineExceeded)
+			INC_DWORD_STAT(STAT_InfraworldDeadlineMisses);
+
+#if !UE_BUILD_SHIPPING
+		if (FRpcTrafficRecorder::IsRecording())
+		{
+			FRpcTrafficRecorder::Record(MethodPath, SendTime, FPlatformTime::Seconds(), Context, RequestBuffer,
+				Status.ok() ? &OutResponseBuffer : nullptr, OutStatus);
+		}
+#endif
+
+		return Status.ok();
+	}
+
+	/**
+	 * Completes a request without sending it, since the worker has given up connecting.
+	 */
+	static void SetUnavailableStatus(FGrpcStatus& OutStatus)
+	{
+		OutStatus.ErrorCode = EGrpcStatusCode::Unavailable;
+		OutStatus.ErrorMessage = TEXT("The client has given up connecting to the server");
+	}
+
+	/**
+	 * Completes a request, that has been cancelled before being sent.
+	 */
+	static void SetNotSentStatus(FGrpcStatus& OutStatus)
+	{
+		OutStatus.ErrorCode = EGrpcStatusCode::Cancelled;
+		OutStatus.ErrorMessage = TEXT("The request has been cancelled before being sent");
+
+		INC_DWORD_STAT(STAT_InfraworldCancelledRequests);
+	}
+
+	/**
+	 * Completes a request, the deadline of which has expired while it was queued, without sending it.
+	 */
+	static void SetExpiredStatus(FGrpcStatus& OutStatus)
+	{
+		OutStatus.ErrorCode = EGrpcStatusCode::DeadlineExceeded;
+		OutStatus.ErrorMessage = TEXT("The deadline has expired before the request has been sent");
+
+		INC_DWORD_STAT(STAT_InfraworldExpiredRequests);
+		INC_DWORD_STAT(STAT_InfraworldDeadlineMisses);
+	}
+
+	/**
+	 * Waits for the only pending event of the call queue, cancelling the call if the worker is being stopped.
+	 */
+	void WaitForCompletion(grpc::CompletionQueue& Queue, grpc::ClientContext& ClientContext)
+	{
 	    void* got_tag;
 	    bool ok = false;
 
@@ -60,15 +384,16 @@ public:
 		
 	    GPR_ASSERT(got_tag == (void*)1);
 	    GPR_ASSERT(ok);
-
-	    FGrpcStatus GrpcStatus;
-
-	    casts::CastStatus(Status, GrpcStatus);
-	    TResponseWithStatus<TUnrealResponse> Result(casts::Proto_Cast<TUnrealResponse>(Response), GrpcStatus);
-
-	    return Result;
 	}
 
-protected:
 	std::unique_ptr<TStub> Stub;
+
+	/**
+	 * Completion queue of calls. Calls are made one at a time and every one of them waits for its only event, so the
+	 * queue is empty between calls and is reused instead of being created for each of them.
+	 */
+	grpc::CompletionQueue CallQueue;
+
+	/** Lazily created stub for AsyncRawRequest(). */
+	std::unique_ptr<grpc::GenericStub> GenericStub;
 };